@@ -1460,3 +1460,497 @@ GEGL_SIMD_SUFFIX(gegl_resample_bilinear) (guchar              *dest_buf,
     }
 }
 
+
+static inline void
+gegl_sample_linear_span_impl (const gfloat * restrict src,
+                              gint                    rowstride,
+                              const gint   * restrict offsets,
+                              const gfloat * restrict fx,
+                              const gfloat * restrict fy,
+                              gfloat       * restrict dst,
+                              gint                    n,
+                              const gint              nc)
+{
+  gint i;
+
+  for (i = 0; i < n; i++)
+    {
+      const gfloat *top = src + offsets[i];
+      const gfloat *bot = top + rowstride;
+      const gfloat  x   = fx[i];
+      const gfloat  y   = fy[i];
+
+      /* same weights, and order of operations, as the linear sampler */
+      const gfloat x_times_y = x * y;
+      const gfloat w_times_y = y - x_times_y;
+      const gfloat x_times_z = x - x_times_y;
+      const gfloat w_times_z = (gfloat) 1. - (x + w_times_y);
+      gint         c;
+
+      for (c = 0; c < nc; c++)
+        {
+          dst[c] = x_times_y * bot[nc + c]
+                   +
+                   w_times_y * bot[c]
+                   +
+                   x_times_z * top[nc + c]
+                   +
+                   w_times_z * top[c];
+        }
+
+      dst += nc;
+    }
+}
+
+void
+GEGL_SIMD_SUFFIX(gegl_sample_linear_span) (const gfloat *src,
+                                           gint          rowstride,
+                                           const gint   *offsets,
+                                           const gfloat *fx,
+                                           const gfloat *fy,
+                                           gfloat       *dst,
+                                           gint          n,
+                                           gint          components)
+{
+  /* a constant component count lets the channel loop be vectorized */
+  if (components == 4)
+    gegl_sample_linear_span_impl (src, rowstride, offsets, fx, fy, dst, n, 4);
+  else
+    gegl_sample_linear_span_impl (src, rowstride, offsets, fx, fy, dst, n,
+                                  components);
+}
+
+static inline gfloat
+gegl_cubic_kernel (const gfloat x,
+                   const gfloat b,
+                   const gfloat c)
+{
+  const gfloat ax = fabsf (x);
+  const gfloat x2 = ax * ax;
+  const gfloat x3 = x2 * ax;
+
+  if (ax > 2.f)
+    return 0.f;
+
+  if (ax < 1.f)
+    return ((12.f - 9.f * b - 6.f * c)   * x3 +
+            (-18.f + 12.f * b + 6.f * c) * x2 +
+            (6.f - 2.f * b))*(1.f/6.f);
+  return ((-b - 6.f * c)        * x3 +
+          (6.f * b + 30.f * c)   * x2 +
+          (-12.f * b - 48.f * c) * ax +
+          (8.f * b + 24.f * c))*(1.f/6.f);
+}
+
+static inline void
+gegl_sample_cubic_span_impl (const gfloat * restrict src,
+                             gint                    rowstride,
+                             const gint   * restrict offsets,
+                             const gfloat * restrict fx,
+                             const gfloat * restrict fy,
+                             gfloat       * restrict dst,
+                             gint                    n,
+                             const gint              nc,
+                             const gfloat            b,
+                             const gfloat            c)
+{
+  gint k;
+
+  for (k = 0; k < n; k++)
+    {
+      const gfloat *p = src + offsets[k] - rowstride - nc;
+      gfloat        factor_i[4];
+      gint          ch;
+      gint          i;
+      gint          j;
+
+      for (ch = 0; ch < nc; ch++)
+        dst[ch] = 0.0f;
+
+      for (i = 0; i < 4; i++)
+        factor_i[i] = gegl_cubic_kernel (fx[k] - (i - 1), b, c);
+
+      for (j = 0; j < 4; j++)
+        {
+          const gfloat factor_j = gegl_cubic_kernel (fy[k] - (j - 1), b, c);
+
+          for (i = 0; i < 4; i++)
+            {
+              const gfloat factor = factor_j * factor_i[i];
+
+              for (ch = 0; ch < nc; ch++)
+                dst[ch] += factor * p[ch];
+
+              p += nc;
+            }
+
+          p += rowstride - 4 * nc;
+        }
+
+      dst += nc;
+    }
+}
+
+void
+GEGL_SIMD_SUFFIX(gegl_sample_cubic_span) (const gfloat *src,
+                                          gint          rowstride,
+                                          const gint   *offsets,
+                                          const gfloat *fx,
+                                          const gfloat *fy,
+                                          gfloat       *dst,
+                                          gint          n,
+                                          gint          components,
+                                          gfloat        b,
+                                          gfloat        c)
+{
+  if (components == 4)
+    gegl_sample_cubic_span_impl (src, rowstride, offsets, fx, fy, dst, n,
+                                 4, b, c);
+  else
+    gegl_sample_cubic_span_impl (src, rowstride, offsets, fx, fy, dst, n,
+                                 components, b, c);
+}
+
+static inline guint64
+gegl_shuffle_load_word (const guint8 *p)
+{
+  guint64 x;
+
+  memcpy (&x, p, sizeof (x));
+
+  return GUINT64_FROM_LE (x);
+}
+
+static inline void
+gegl_shuffle_store_word (guint8  *p,
+                         guint64  x)
+{
+  x = GUINT64_TO_LE (x);
+
+  memcpy (p, &x, sizeof (x));
+}
+
+static inline guint64
+gegl_shuffle_load_component (const guint8 *p,
+                             const gint    csize)
+{
+  switch (csize)
+    {
+    case 2: { guint16 v; memcpy (&v, p, 2); return v; }
+    case 4: { guint32 v; memcpy (&v, p, 4); return v; }
+    case 8: { guint64 v; memcpy (&v, p, 8); return v; }
+    default: return *p;
+    }
+}
+
+static inline void
+gegl_shuffle_store_component (guint8     *p,
+                              guint64     v,
+                              const gint  csize)
+{
+  switch (csize)
+    {
+    case 2: { guint16 w = v; memcpy (p, &w, 2); break; }
+    case 4: { guint32 w = v; memcpy (p, &w, 4); break; }
+    case 8: { memcpy (p, &v, 8); break; }
+    default: *p = v; break;
+    }
+}
+
+/* zigzag-code the difference of two components, so that small differences
+ * of either sign have only low bits set, and scatter its bytes to the byte
+ * planes.
+ */
+static inline void
+gegl_shuffle_put_delta (guint8     *plane,
+                        guint64     cur,
+                        guint64     prev,
+                        const gint  csize)
+{
+  const gint    bits = 8 * csize;
+  const guint64 mask = csize == 8 ? G_MAXUINT64 :
+                                    (G_GUINT64_CONSTANT (1) << bits) - 1;
+  guint64       d    = (cur - prev) & mask;
+  guint64       z    = ((d << 1) ^ (0 - (d >> (bits - 1)))) & mask;
+  gint          b;
+
+  for (b = 0; b < csize; b++)
+    plane[b * GEGL_SHUFFLE_BLOCK] = z >> (8 * b);
+}
+
+static inline void
+gegl_shuffle_delta_impl (const guint8 * restrict src,
+                         gint                    bpp,
+                         gint                    m,
+                         gboolean                first,
+                         guint8       * restrict planes,
+                         const gint              csize)
+{
+  gint c;
+
+  for (c = 0; c < bpp; c += csize)
+    {
+      guint8 *plane = planes + c * GEGL_SHUFFLE_BLOCK;
+      gint    t     = 0;
+      gint    b;
+
+      if (first)
+        {
+          gegl_shuffle_put_delta (plane,
+                                  gegl_shuffle_load_component (src + c, csize),
+                                  0, csize);
+
+          t = 1;
+        }
+
+      /* each delta is computed from the source alone, so that the loop has
+       * no carried dependency.
+       */
+      for (; t < m; t++)
+        {
+          const guint8 *p = src + t * bpp + c;
+
+          gegl_shuffle_put_delta (plane + t,
+                                  gegl_shuffle_load_component (p,       csize),
+                                  gegl_shuffle_load_component (p - bpp, csize),
+                                  csize);
+        }
+
+      if (m < GEGL_SHUFFLE_BLOCK)
+        {
+          for (b = 0; b < csize; b++)
+            {
+              memset (plane + b * GEGL_SHUFFLE_BLOCK + m, 0,
+                      GEGL_SHUFFLE_BLOCK - m);
+            }
+        }
+    }
+}
+
+static inline void
+gegl_shuffle_undelta_impl (const guint8 * restrict planes,
+                           gint                    bpp,
+                           gint                    m,
+                           gboolean                first,
+                           guint8       * restrict dst,
+                           const gint              csize)
+{
+  const gint    bits = 8 * csize;
+  const guint64 mask = csize == 8 ? G_MAXUINT64 :
+                                    (G_GUINT64_CONSTANT (1) << bits) - 1;
+  gint          c;
+
+  for (c = 0; c < bpp; c += csize)
+    {
+      const guint8 *plane = planes + c * GEGL_SHUFFLE_BLOCK;
+      guint64       prev  = first ? 0 :
+                            gegl_shuffle_load_component (dst - bpp + c, csize);
+      gint          t;
+
+      for (t = 0; t < m; t++)
+        {
+          guint64 z = 0;
+          gint    b;
+
+          for (b = 0; b < csize; b++)
+            z |= (guint64) plane[b * GEGL_SHUFFLE_BLOCK + t] << (8 * b);
+
+          prev = (prev + ((z >> 1) ^ (0 - (z & 1)))) & mask;
+
+          gegl_shuffle_store_component (dst + t * bpp + c, prev, csize);
+        }
+    }
+}
+
+/* transpose the 8x8 bit matrix whose rows are the bytes of x, so that bit i
+ * of byte k of the result is bit k of byte i of x.  the transposition is its
+ * own inverse.
+ */
+static inline guint64
+gegl_shuffle_transpose_bits (guint64 x)
+{
+  guint64 t;
+
+  t = (x ^ (x >>  7)) & G_GUINT64_CONSTANT (0x00aa00aa00aa00aa);
+  x = x ^ t ^ (t <<  7);
+  t = (x ^ (x >> 14)) & G_GUINT64_CONSTANT (0x0000cccc0000cccc);
+  x = x ^ t ^ (t << 14);
+  t = (x ^ (x >> 28)) & G_GUINT64_CONSTANT (0x00000000f0f0f0f0);
+  x = x ^ t ^ (t << 28);
+
+  return x;
+}
+
+gint
+GEGL_SIMD_SUFFIX(gegl_shuffle_encode) (const guint8 *src,
+                                       gint          n,
+                                       gint          bpp,
+                                       gint          csize,
+                                       guint8       *planes,
+                                       guint8       *dst,
+                                       gint          max_size)
+{
+  const gint header_size = (bpp + 1) / 2;
+  gint       size        = 0;
+  gint       i;
+
+  for (i = 0; i < n; i += GEGL_SHUFFLE_BLOCK)
+    {
+      gint    m       = MIN (n - i, GEGL_SHUFFLE_BLOCK);
+      gint    n_words = (m + 7) / 8;
+      guint8 *header;
+      gint    j;
+
+      /* a constant component size lets the loops be specialized */
+      switch (csize)
+        {
+        case 2:  gegl_shuffle_delta_impl (src, bpp, m, i == 0, planes, 2); break;
+        case 4:  gegl_shuffle_delta_impl (src, bpp, m, i == 0, planes, 4); break;
+        case 8:  gegl_shuffle_delta_impl (src, bpp, m, i == 0, planes, 8); break;
+        default: gegl_shuffle_delta_impl (src, bpp, m, i == 0, planes, 1); break;
+        }
+
+      if (size + header_size > max_size)
+        return -1;
+
+      header = dst + size;
+      size  += header_size;
+
+      memset (header, 0, header_size);
+
+      for (j = 0; j < bpp; j++)
+        {
+          const guint8 *plane = planes + j * GEGL_SHUFFLE_BLOCK;
+          guint64       x[GEGL_SHUFFLE_BLOCK / 8];
+          guint64       any   = 0;
+          gint          width;
+          gint          q;
+
+          for (q = 0; q < n_words; q++)
+            {
+              x[q] = gegl_shuffle_load_word (plane + 8 * q);
+
+              any |= x[q];
+            }
+
+          any |= any >> 32;
+          any |= any >> 16;
+          any |= any >> 8;
+          any &= 0xff;
+
+          width = any ? g_bit_storage (any) : 0;
+
+          header[j / 2] |= width << (4 * (j % 2));
+
+          if (! width)
+            continue;
+
+          if (size + n_words * width > max_size)
+            return -1;
+
+          /* store the low #width bit planes of each group of 8 bytes */
+          for (q = 0; q < n_words; q++)
+            {
+              guint64 bits = gegl_shuffle_transpose_bits (x[q]);
+
+              if (size + 8 <= max_size)
+                {
+                  gegl_shuffle_store_word (dst + size, bits);
+                }
+              else
+                {
+                  gint k;
+
+                  for (k = 0; k < width; k++)
+                    dst[size + k] = bits >> (8 * k);
+                }
+
+              size += width;
+            }
+        }
+
+      src += m * bpp;
+    }
+
+  return size;
+}
+
+gboolean
+GEGL_SIMD_SUFFIX(gegl_shuffle_decode) (const guint8 *src,
+                                       gint          size,
+                                       gint          n,
+                                       gint          bpp,
+                                       gint          csize,
+                                       guint8       *planes,
+                                       guint8       *dst)
+{
+  const guint8 *end         = src + size;
+  const gint    header_size = (bpp + 1) / 2;
+  gint          i;
+
+  for (i = 0; i < n; i += GEGL_SHUFFLE_BLOCK)
+    {
+      gint          m       = MIN (n - i, GEGL_SHUFFLE_BLOCK);
+      gint          n_words = (m + 7) / 8;
+      const guint8 *header;
+      gint          j;
+
+      if (end - src < header_size)
+        return FALSE;
+
+      header = src;
+      src   += header_size;
+
+      for (j = 0; j < bpp; j++)
+        {
+          guint8  *plane = planes + j * GEGL_SHUFFLE_BLOCK;
+          guint64  mask;
+          gint     width;
+          gint     q;
+
+          width = (header[j / 2] >> (4 * (j % 2))) & 0xf;
+
+          if (width > 8 || end - src < n_words * width)
+            return FALSE;
+
+          mask = width == 8 ? G_MAXUINT64 :
+                              (G_GUINT64_CONSTANT (1) << (8 * width)) - 1;
+
+          for (q = 0; q < n_words; q++)
+            {
+              guint64 bits;
+
+              if (end - src >= 8)
+                {
+                  bits = gegl_shuffle_load_word (src) & mask;
+                }
+              else
+                {
+                  gint k;
+
+                  bits = 0;
+
+                  for (k = 0; k < width; k++)
+                    bits |= (guint64) src[k] << (8 * k);
+                }
+
+              gegl_shuffle_store_word (plane + 8 * q,
+                                       gegl_shuffle_transpose_bits (bits));
+
+              src += width;
+            }
+        }
+
+      switch (csize)
+        {
+        case 2:  gegl_shuffle_undelta_impl (planes, bpp, m, i == 0, dst, 2); break;
+        case 4:  gegl_shuffle_undelta_impl (planes, bpp, m, i == 0, dst, 4); break;
+        case 8:  gegl_shuffle_undelta_impl (planes, bpp, m, i == 0, dst, 8); break;
+        default: gegl_shuffle_undelta_impl (planes, bpp, m, i == 0, dst, 1); break;
+        }
+
+      dst += m * bpp;
+    }
+
+  return src == end;
+}
@@ -102,6 +102,63 @@ void GEGL_SIMD_SUFFIX(gegl_resample_nearest) (guchar              *dst,
 
 GeglDownscale2x2Fun GEGL_SIMD_SUFFIX(gegl_downscale_2x2_get_fun) (const Babl *format);
 
+/* Interpolate n samples from a sampler buffer of #components floats per
+ * pixel and #rowstride floats per row. #offsets are the offsets of the
+ * pixels to the top-left of the sampling points, #fx and #fy their
+ * fractional positions within that pixel; the samples are written
+ * contiguously to #dst.
+ */
+void GEGL_SIMD_SUFFIX(gegl_sample_linear_span) (const gfloat *src,
+                              gint          rowstride,
+                              const gint   *offsets,
+                              const gfloat *fx,
+                              const gfloat *fy,
+                              gfloat       *dst,
+                              gint          n,
+                              gint          components);
+
+/* As above, with a BC-spline of parameters #b and #c. */
+void GEGL_SIMD_SUFFIX(gegl_sample_cubic_span) (const gfloat *src,
+                             gint          rowstride,
+                             const gint   *offsets,
+                             const gfloat *fx,
+                             const gfloat *fy,
+                             gfloat       *dst,
+                             gint          n,
+                             gint          components,
+                             gfloat        b,
+                             gfloat        c);
+
+/* The number of pixels encoded together by gegl_shuffle_encode(). */
+#define GEGL_SHUFFLE_BLOCK 32
+
+/* Encode #n pixels of #bpp bytes, made of components of #csize bytes, for
+ * the "shuffle" compression. Each component is delta-coded against the
+ * same component of the previous pixel, and the bytes of each block of
+ * GEGL_SHUFFLE_BLOCK pixels are split into #bpp byte planes, which are
+ * bit-packed to the width of their largest value. #planes is scratch space
+ * of #bpp * GEGL_SHUFFLE_BLOCK bytes. Returns the size of the encoded data,
+ * or -1 if it exceeds #max_size.
+ */
+gint GEGL_SIMD_SUFFIX(gegl_shuffle_encode) (const guint8 *src,
+                          gint          n,
+                          gint          bpp,
+                          gint          csize,
+                          guint8       *planes,
+                          guint8       *dst,
+                          gint          max_size);
+
+/* Decode #size bytes produced by gegl_shuffle_encode() into #n pixels.
+ * Returns FALSE if the data is malformed.
+ */
+gboolean GEGL_SIMD_SUFFIX(gegl_shuffle_decode) (const guint8 *src,
+                              gint          size,
+                              gint          n,
+                              gint          bpp,
+                              gint          csize,
+                              guint8       *planes,
+                              guint8       *dst);
+
 #ifdef ARCH_X86_64
 GeglDownscale2x2Fun gegl_downscale_2x2_get_fun_x86_64_v2 (const Babl *format);
 GeglDownscale2x2Fun gegl_downscale_2x2_get_fun_x86_64_v3 (const Babl *format);
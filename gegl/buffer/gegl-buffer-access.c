@@ -40,6 +40,7 @@
 #include "gegl-rectangle.h"
 #include "gegl-buffer-iterator-private.h"
 #include "gegl-buffer-formats.h"
+#include "gegl-trace.h"
 
 static void gegl_buffer_iterate_read_fringed (GeglBuffer          *buffer,
                                               const GeglRectangle *roi,
@@ -410,6 +411,10 @@ gegl_buffer_iterate_write (GeglBuffer          *buffer,
       fish = babl_fish ((gpointer) format,
                         (gpointer) buffer->soft_format);
 
+  GEGL_TRACE_COUNT (BYTES, (gint64) width * height * bpx_size);
+  if (fish)
+    GEGL_TRACE_COUNT (CONVERSIONS, 1);
+
   while (bufy < height)
     {
       gint tiledy  = buffer_y + bufy;
@@ -971,6 +976,10 @@ gegl_buffer_iterate_read_simple (GeglBuffer          *buffer,
     fish = babl_fish ((gpointer) buffer->soft_format,
                       (gpointer) format);
 
+  GEGL_TRACE_COUNT (BYTES, (gint64) width * height * bpx_size);
+  if (fish)
+    GEGL_TRACE_COUNT (CONVERSIONS, 1);
+
   while (bufy < height)
     {
       gint tiledy  = buffer_y + bufy;
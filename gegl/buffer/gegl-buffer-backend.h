@@ -51,6 +51,7 @@ typedef enum
   _GEGL_TILE_LAST_0_4_8_COMMAND,
 
   GEGL_TILE_COPY = _GEGL_TILE_LAST_0_4_8_COMMAND,
+  GEGL_TILE_PREFETCH,
 
   GEGL_TILE_LAST_COMMAND
 } GeglTileCommand;
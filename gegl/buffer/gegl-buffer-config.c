@@ -35,6 +35,8 @@ enum
 {
   PROP_0,
   PROP_TILE_CACHE_SIZE,
+  PROP_TILE_CACHE_COMPRESSED_SIZE,
+  PROP_TILE_CACHE_COMPRESSION,
   PROP_SWAP,
   PROP_SWAP_COMPRESSION,
   PROP_TILE_WIDTH,
@@ -56,6 +58,14 @@ gegl_buffer_config_get_property (GObject    *gobject,
         g_value_set_uint64 (value, config->tile_cache_size);
         break;
 
+      case PROP_TILE_CACHE_COMPRESSED_SIZE:
+        g_value_set_uint64 (value, config->tile_cache_compressed_size);
+        break;
+
+      case PROP_TILE_CACHE_COMPRESSION:
+        g_value_set_string (value, config->tile_cache_compression);
+        break;
+
       case PROP_TILE_WIDTH:
         g_value_set_int (value, config->tile_width);
         break;
@@ -95,6 +105,13 @@ gegl_buffer_config_set_property (GObject      *gobject,
       case PROP_TILE_CACHE_SIZE:
         config->tile_cache_size = g_value_get_uint64 (value);
         break;
+      case PROP_TILE_CACHE_COMPRESSED_SIZE:
+        config->tile_cache_compressed_size = g_value_get_uint64 (value);
+        break;
+      case PROP_TILE_CACHE_COMPRESSION:
+        g_free (config->tile_cache_compression);
+        config->tile_cache_compression = g_value_dup_string (value);
+        break;
       case PROP_TILE_WIDTH:
         config->tile_width = g_value_get_int (value);
         break;
@@ -125,6 +142,7 @@ gegl_buffer_config_finalize (GObject *gobject)
 
   g_free (config->swap);
   g_free (config->swap_compression);
+  g_free (config->tile_cache_compression);
 
   G_OBJECT_CLASS (gegl_buffer_config_parent_class)->finalize (gobject);
 }
@@ -168,6 +186,24 @@ gegl_buffer_config_class_init (GeglBufferConfigClass *klass)
                                                         G_PARAM_CONSTRUCT |
                                                         G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_TILE_CACHE_COMPRESSED_SIZE,
+                                   g_param_spec_uint64 ("tile-cache-compressed-size",
+                                                        "Compressed tile cache size",
+                                                        "size of the compressed tier of the tile cache in bytes, holding tiles evicted from the tile cache; 0 disables it",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_CONSTRUCT |
+                                                        G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TILE_CACHE_COMPRESSION,
+                                   g_param_spec_string ("tile-cache-compression",
+                                                        "Tile cache compression",
+                                                        "compression algorithm used for the compressed tier of the tile cache",
+                                                        "fast",
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_CONSTRUCT |
+                                                        G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (gobject_class, PROP_SWAP,
                                    g_param_spec_string ("swap",
                                                         "Swap",
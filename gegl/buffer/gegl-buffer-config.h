@@ -46,6 +46,8 @@ struct _GeglBufferConfig
   gchar   *swap;
   gchar   *swap_compression;
   guint64  tile_cache_size;
+  guint64  tile_cache_compressed_size;
+  gchar   *tile_cache_compression;
   gint     tile_width;
   gint     tile_height;
   gint     queue_size;
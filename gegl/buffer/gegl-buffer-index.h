@@ -1,5 +1,8 @@
 #ifndef __GEGL_BUFFER_INDEX_H
 #define __GEGL_BUFFER_INDEX_H
+
+#include "gegl-compression.h"
+
 /* File format building blocks
 
 GeglBuffer on disk representation
@@ -8,8 +11,13 @@ GeglBuffer on disk representation
 */
 
 
-/* Increase this number when the structures change.*/
-#define GEGL_FILE_SPEC_REV     0
+/* The revision written by default, which every version of GEGL can read. */
+#define GEGL_FILE_SPEC_REV        0
+/* The latest revision, with a contiguous index and compressed tiles, which is
+ * only written when asked for.  Increase this number when the structures
+ * change.
+ */
+#define GEGL_FILE_SPEC_REV_LATEST 1
 #define GEGL_MAGIC             {'G','E','G','L'}
 
 #define GEGL_FLAG_TILE         1
@@ -59,7 +67,16 @@ typedef struct {
 
   guint32 rev;             /* if it changes on disk it means the index has changed */
 
-  gint32  padding[36];     /* Pad the structure to be 256 bytes long */
+  /* the following fields are only used as of revision 1 */
+  guint32 n_entries;       /* number of entries in the index */
+  guint32 n_levels;        /* number of mipmap levels stored, in addition to
+                            * the base level
+                            */
+  gchar   compression[32]; /* name of the GeglCompression algorithm used for
+                            * compressed tiles, or an empty string
+                            */
+
+  gint32  padding[26];     /* Pad the structure to be 256 bytes long */
 } GeglBufferHeader;
 
 /* the revision of the format is stored in the flags of the header in the
@@ -67,8 +84,8 @@ typedef struct {
  */
 #define gegl_buffer_header_get_rev(header)  (((GeglBufferHeader*)(header))->flags&0xff)
 
-/* The GeglBuffer index is written to the file as a linked list of
- * GeglBufferBlock's, each block encodes it's own length and the offset
+/* In revision 0 files, the GeglBuffer index is written to the file as a
+ * linked list of GeglBufferBlock's, each block encodes it's own length and the offset
  * of the file which the next block can be found. The last block in the
  * list has the next offset set to 0.
  */
@@ -97,8 +114,34 @@ typedef struct {
                             revision changes, the existing loaded index
                             can be compare the revision of tiles and update
                             own state when revision differs. */
+
+  guint32 size;          /* size of the stored tile data; only used in
+                            memory, 0 for tiles stored uncompressed */
 } GeglBufferTile;
 
+/* the length of the GeglBufferTile blocks written to revision 0 files, which
+ * end before the in-memory size field.
+ */
+#define GEGL_BUFFER_TILE_REV0_LENGTH G_STRUCT_OFFSET (GeglBufferTile, size)
+
+/* In revision 1 files, header.next points at a contiguous array of
+ * header.n_entries GeglBufferIndexEntry's.  Tiles whose size is smaller
+ * than the tile size are compressed using header.compression, the rest are
+ * stored as is, aligned to GEGL_BUFFER_TILE_ALIGNMENT bytes, so that they can
+ * be mapped directly into memory.
+ */
+typedef struct {
+  guint64 offset;        /* offset into file for this tile             */
+  gint32  x;             /* upperleft of tile % tile_width coordinates */
+  gint32  y;
+  gint32  z;             /* mipmap subdivision level of tile (0=100%)  */
+  guint32 rev;           /* revision of the tile                       */
+  guint32 size;          /* size of the stored tile data               */
+  guint32 padding;
+} GeglBufferIndexEntry;
+
+#define GEGL_BUFFER_TILE_ALIGNMENT 64
+
 /* A convenience union to allow quick and simple casting */
 typedef union {
   guint32          length;
@@ -129,6 +172,18 @@ GeglBufferItem *gegl_buffer_read_header(int      i,
 GList          *gegl_buffer_read_index (int      i,
                                         goffset *offset);
 
+/* reads the index of either revision of the format, returning a list of
+ * GeglBufferTile's.
+ */
+GList          *gegl_buffer_read_tile_index (int                     i,
+                                             const GeglBufferHeader *header);
+
+/* returns the compression used for the compressed tiles of the file, or NULL
+ * if it doesn't have any.
+ */
+const GeglCompression *
+               gegl_buffer_header_get_compression (const GeglBufferHeader *header);
+
 #define struct_check_padding(type, size) \
   if (sizeof (type) != size) \
     {\
@@ -141,7 +196,8 @@ GList          *gegl_buffer_read_index (int      i,
     }
 #define GEGL_BUFFER_STRUCT_CHECK_PADDING \
   {struct_check_padding (GeglBufferBlock, 16);\
-  struct_check_padding (GeglBufferHeader, 256);}
+  struct_check_padding (GeglBufferHeader, 256);\
+  struct_check_padding (GeglBufferIndexEntry, 32);}
 #define GEGL_BUFFER_SANITY {static gboolean done=FALSE;if(!done){GEGL_BUFFER_STRUCT_CHECK_PADDING;done=TRUE;}}
 
 #endif
@@ -304,6 +304,61 @@ retile_subs (GeglBufferIterator *iter,
     }
 }
 
+/* returns the y coordinate of the tile row following the one containing y,
+ * in the coordinates of the first sub-iterator.
+ */
+static inline gint
+next_row_y (GeglBufferIterator *iter,
+            gint                y)
+{
+  GeglBufferIteratorPriv *priv = iter->priv;
+
+  gint tile_y = gegl_tile_indice (y + priv->origin_tile.y,
+                                  priv->origin_tile.height);
+
+  return (tile_y + 1) * priv->origin_tile.height - priv->origin_tile.y;
+}
+
+/* asks the readable buffers to read the tile row starting at y ahead of time,
+ * so that the backend can load the tiles while we're processing the current
+ * ones.
+ */
+static inline void
+prefetch_row (GeglBufferIterator *iter,
+              gint                y)
+{
+  GeglBufferIteratorPriv *priv = iter->priv;
+  SubIterState           *sub0 = &priv->sub_iter[0];
+  gint                    height;
+  gint                    index;
+
+  if (y >= sub0->full_rect.y + sub0->full_rect.height)
+    return;
+
+  height = next_row_y (iter, y) - y;
+
+  for (index = 0; index < priv->num_buffers; index++)
+    {
+      SubIterState  *sub = &priv->sub_iter[index];
+      GeglRectangle  row;
+
+      if (! (sub->access_mode & GEGL_ACCESS_READ) ||
+          sub->alias >= 0                         ||
+          sub->linear_tile)
+        {
+          continue;
+        }
+
+      row.x      = sub->full_rect.x;
+      row.y      = sub->full_rect.y + (y - sub0->full_rect.y);
+      row.width  = sub->full_rect.width;
+      row.height = height;
+
+      if (gegl_rectangle_intersect (&row, &row, &sub->full_rect))
+        gegl_buffer_prefetch (sub->buffer, &row, sub->level);
+    }
+}
+
 static inline gboolean
 initialize_rects (GeglBufferIterator *iter)
 {
@@ -312,6 +367,14 @@ initialize_rects (GeglBufferIterator *iter)
 
   retile_subs (iter, sub->full_rect.x, sub->full_rect.y);
 
+  /* the first tile is read right away; the rest of the row, and the next
+   * row, can be read in the background.
+   */
+  if (iter->items[0].roi.width < sub->full_rect.width)
+    prefetch_row (iter, sub->full_rect.y);
+
+  prefetch_row (iter, next_row_y (iter, sub->full_rect.y));
+
   return TRUE;
 }
 
@@ -336,6 +399,8 @@ increment_rects (GeglBufferIterator *iter)
           /* All done */
           return FALSE;
         }
+
+      prefetch_row (iter, next_row_y (iter, y));
     }
 
   retile_subs (iter, x, y);
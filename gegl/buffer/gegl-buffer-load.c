@@ -37,6 +37,8 @@
 #include "gegl-buffer.h"
 #include "gegl-buffer-private.h"
 #include "gegl-buffer-index.h"
+#include "gegl-compression.h"
+#include "gegl-scratch.h"
 #include "gegl-debug.h"
 
 #include <glib/gprintf.h>
@@ -52,15 +54,17 @@ typedef SSIZE_T ssize_t;
 
 typedef struct
 {
-  GeglBufferHeader header;
-  GList           *tiles;
-  gchar           *path;
-  int              i;
-  gint             tile_size;
-  const Babl      *format;
-  goffset          offset;
-  goffset          next_block;
-  gboolean         got_header;
+  GeglBufferHeader       header;
+  GList                 *tiles;
+  gchar                 *path;
+  int                    i;
+  gint                   tile_size;
+  const Babl            *format;
+  goffset                offset;
+  goffset                next_block;
+  gboolean               got_header;
+  GMappedFile           *mapped;
+  const GeglCompression *compression;
 } LoadInfo;
 
 static void seekto(LoadInfo *info, gint offset)
@@ -82,6 +86,8 @@ load_info_destroy (LoadInfo *info)
     g_free (info->path);
   if (info->i != -1)
     close (info->i);
+  if (info->mapped)
+    g_mapped_file_unref (info->mapped);
   if (info->tiles != NULL)
     {
       GList *iter;
@@ -194,13 +200,14 @@ static GeglBufferItem *read_block (int           fd,
     }
   else if (block.length < own_size)
     {
-      ret = g_malloc (own_size);
+      /* fields missing from older versions are zeroed */
+      ret = g_malloc0 (own_size);
       memcpy (ret, &block, sizeof (GeglBufferBlock));
       {
-        ssize_t sz_read = read (fd, ret + sizeof(GeglBufferBlock),
-								block.length - sizeof (GeglBufferBlock));
-		if(sz_read != -1)
-		  byte_read += sz_read;
+        ssize_t sz_read = read (fd, ((gchar*)ret) + sizeof(GeglBufferBlock),
+                                block.length - sizeof (GeglBufferBlock));
+        if(sz_read != -1)
+          byte_read += sz_read;
       }
       *((guint32*)ret) = own_size;
     }
@@ -238,9 +245,174 @@ gegl_buffer_read_index (int           i,
   return ret;
 }
 
+/* reads the contiguous index of revision 1 files */
+static GList *
+read_index_entries (int                     i,
+                    const GeglBufferHeader *header)
+{
+  GList                *ret = NULL;
+  GeglBufferIndexEntry *entries;
+  gsize                 size;
+  gsize                 byte_read = 0;
+  gint                  tile_size;
+  guint                 n;
+
+  if (header->next == 0 || header->n_entries == 0)
+    return NULL;
+
+  if (lseek (i, header->next, SEEK_SET) == -1)
+    {
+      g_warning ("failed seeking to %i", (gint) header->next);
+      return NULL;
+    }
+
+  tile_size = header->tile_width * header->tile_height *
+              header->bytes_per_pixel;
+  size      = (gsize) header->n_entries * sizeof (GeglBufferIndexEntry);
+  entries   = g_malloc (size);
+
+  while (byte_read < size)
+    {
+      ssize_t sz_read = read (i, (gchar *) entries + byte_read,
+                              size - byte_read);
+      if (sz_read <= 0)
+        break;
+      byte_read += sz_read;
+    }
+
+  if (byte_read < size)
+    g_warning ("index truncated, read %i of %i entries",
+               (gint) (byte_read / sizeof (GeglBufferIndexEntry)),
+               header->n_entries);
+
+  for (n = 0; n < byte_read / sizeof (GeglBufferIndexEntry); n++)
+    {
+      const GeglBufferIndexEntry *entry = &entries[n];
+      GeglBufferTile             *tile;
+
+      tile         = gegl_tile_entry_new (entry->x, entry->y, entry->z);
+      tile->offset = entry->offset;
+      tile->rev    = entry->rev;
+      tile->size   = entry->size != tile_size ? entry->size : 0;
+
+      GEGL_NOTE (GEGL_DEBUG_BUFFER_LOAD,"loaded entry: %i, %i, %i offset:%i size:%i",
+                 tile->x, tile->y, tile->z,
+                 (guint) tile->offset, entry->size);
+
+      ret = g_list_prepend (ret, tile);
+    }
+
+  g_free (entries);
+
+  return g_list_reverse (ret);
+}
+
+GList *
+gegl_buffer_read_tile_index (int                     i,
+                             const GeglBufferHeader *header)
+{
+  goffset offset = header->next;
+
+  if (gegl_buffer_header_get_rev (header) >= 1)
+    return read_index_entries (i, header);
+  else
+    return gegl_buffer_read_index (i, &offset);
+}
+
+const GeglCompression *
+gegl_buffer_header_get_compression (const GeglBufferHeader *header)
+{
+  const GeglCompression *compression;
+  gchar                 *name;
+
+  if (gegl_buffer_header_get_rev (header) < 1 || ! header->compression[0])
+    return NULL;
+
+  name        = g_strndup (header->compression, sizeof (header->compression));
+  compression = gegl_compression (name);
+
+  if (! compression)
+    g_warning ("unknown tile compression '%s'", name);
+
+  g_free (name);
+
+  return compression;
+}
+
 
 static void sanity(void) { GEGL_BUFFER_SANITY; }
 
+static void
+load_tile (LoadInfo       *info,
+           GeglBufferTile *entry,
+           guchar         *data)
+{
+  gint          size = entry->size ? entry->size : info->tile_size;
+  const guchar *src  = NULL;
+  guchar       *buf  = NULL;
+
+  if (entry->size && ! info->compression)
+    {
+      memset (data, 0, info->tile_size);
+      return;
+    }
+
+  if (info->mapped &&
+      entry->offset + size <= g_mapped_file_get_length (info->mapped))
+    {
+      src = (const guchar *) g_mapped_file_get_contents (info->mapped) +
+            entry->offset;
+    }
+  else
+    {
+      gint to_be_read = size;
+
+      if (entry->size)
+        src = buf = gegl_scratch_alloc (size);
+      else
+        src = data;
+
+      if (info->offset != entry->offset)
+        seekto (info, entry->offset);
+
+      while (to_be_read > 0)
+        {
+          ssize_t sz_read = read (info->i, (guchar *) src + size - to_be_read,
+                                  to_be_read);
+          if (sz_read <= 0)
+            {
+              g_warning ("failed reading tile %i,%i,%i",
+                         entry->x, entry->y, entry->z);
+              memset ((guchar *) src + size - to_be_read, 0, to_be_read);
+              break;
+            }
+          info->offset += sz_read;
+          to_be_read   -= sz_read;
+        }
+    }
+
+  if (entry->size)
+    {
+      if (! gegl_compression_decompress (info->compression, info->format,
+                                         data,
+                                         info->tile_size /
+                                         info->header.bytes_per_pixel,
+                                         src, size))
+        {
+          g_warning ("failed decompressing tile %i,%i,%i",
+                     entry->x, entry->y, entry->z);
+          memset (data, 0, info->tile_size);
+        }
+    }
+  else if (src != data)
+    {
+      memcpy (data, src, info->tile_size);
+    }
+
+  if (buf)
+    gegl_scratch_free (buf);
+}
+
 
 GeglBuffer *
 gegl_buffer_open (const gchar *path)
@@ -299,7 +471,10 @@ gegl_buffer_load (const gchar *path)
   */
   g_assert (babl_format_get_bytes_per_pixel (info->format) == info->header.bytes_per_pixel);
 
-  info->tiles = gegl_buffer_read_index (info->i, &info->offset);
+  info->tiles       = gegl_buffer_read_tile_index (info->i, &info->header);
+  info->compression = gegl_buffer_header_get_compression (&info->header);
+  info->mapped      = g_mapped_file_new (info->path, FALSE, NULL);
+  info->offset      = -1; /* reading the index moved the file offset */
 
   /* load each tile */
   {
@@ -311,31 +486,24 @@ gegl_buffer_load (const gchar *path)
         guchar         *data;
         GeglTile       *tile;
 
+        /* stored mipmap levels are only used by buffers opened on the file,
+         * the levels of the loaded buffer are rendered on demand.
+         */
+        if (entry->z != 0)
+          continue;
 
         tile = gegl_tile_source_get_tile (GEGL_TILE_SOURCE (ret),
                                           entry->x,
                                           entry->y,
                                           entry->z);
 
-        if (info->offset != entry->offset)
-          {
-            seekto (info, entry->offset);
-          }
-        /*g_assert (info->offset == entry->offset);*/
-
-
         g_assert (tile);
         gegl_tile_lock (tile);
 
         data = gegl_tile_get_data (tile);
         g_assert (data);
 
-        {
-          ssize_t sz_read = read (info->i, data, info->tile_size);
-          if(sz_read != -1)
-            info->offset += sz_read;
-        }
-        /*g_assert (info->offset == entry->offset + info->tile_size);*/
+        load_tile (info, entry, data);
 
         gegl_tile_unlock (tile);
         gegl_tile_unref (tile);
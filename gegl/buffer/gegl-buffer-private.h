@@ -90,6 +90,8 @@ void              gegl_tile_cache_destroy (void);
 
 void              gegl_tile_backend_swap_cleanup (void);
 
+void              gegl_tile_handler_zoom_cleanup (void);
+
 GeglTileBackend * gegl_buffer_backend     (GeglBuffer *buffer);
 GeglTileBackend * gegl_buffer_backend2    (GeglBuffer *buffer); /* non-cached */
 
@@ -170,6 +172,10 @@ struct _GeglTile
   guint            keep_identity:1;  /* maintain data pointer identity, rather
                                       * than data content only
                                       */
+  guint            is_read_only:1;   /* whether the tile data is read-only (for
+                                      * example, mapped from a file), and must
+                                      * be copied before it is written to
+                                      */
 
   gint             clone_state; /* tile clone/unclone state & spinlock */
   gint            *n_clones;    /* an array of two atomic counters, shared
@@ -201,8 +207,24 @@ void     gegl_tile_unlock_no_void (GeglTile *tile);
 gboolean gegl_tile_damage         (GeglTile *tile,
                                    guint64   damage);
 
+/* creates a tile whose data is read-only, and is not owned by the tile.  the
+ * data is copied the first time the tile is locked for writing, and
+ * destroy_notify is called once no tile refers to it anymore.
+ */
+GeglTile * gegl_tile_new_read_only (gconstpointer  data,
+                                    gint           size,
+                                    GDestroyNotify destroy_notify,
+                                    gpointer       destroy_notify_data);
+
 void _gegl_buffer_drop_hot_tile (GeglBuffer *buffer);
 
+/* asks the backend to read the tiles intersecting rect, at the given level,
+ * ahead of time, so that a subsequent access doesn't block on i/o.
+ */
+void gegl_buffer_prefetch (GeglBuffer          *buffer,
+                           const GeglRectangle *rect,
+                           gint                 level);
+
 GeglRectangle _gegl_get_required_for_scale (const GeglRectangle *roi,
                                             gdouble              scale);
 
@@ -254,6 +276,42 @@ extern void (*gegl_downscale_2x2) (const Babl *format,
                                    guchar     *dst_data,
                                    gint        dst_rowstride);
 
+extern void (*gegl_sample_linear_span) (const gfloat *src,
+                                        gint          rowstride,
+                                        const gint   *offsets,
+                                        const gfloat *fx,
+                                        const gfloat *fy,
+                                        gfloat       *dst,
+                                        gint          n,
+                                        gint          components);
+
+extern void (*gegl_sample_cubic_span) (const gfloat *src,
+                                       gint          rowstride,
+                                       const gint   *offsets,
+                                       const gfloat *fx,
+                                       const gfloat *fy,
+                                       gfloat       *dst,
+                                       gint          n,
+                                       gint          components,
+                                       gfloat        b,
+                                       gfloat        c);
+
+extern gint (*gegl_shuffle_encode) (const guint8 *src,
+                                    gint          n,
+                                    gint          bpp,
+                                    gint          csize,
+                                    guint8       *planes,
+                                    guint8       *dst,
+                                    gint          max_size);
+
+extern gboolean (*gegl_shuffle_decode) (const guint8 *src,
+                                        gint          size,
+                                        gint          n,
+                                        gint          bpp,
+                                        gint          csize,
+                                        guint8       *planes,
+                                        guint8       *dst);
+
 
 #ifndef __GEGL_TILE_H__
 #define gegl_tile_get_data(tile)  ((tile)->data)
@@ -30,6 +30,7 @@
 #include <io.h>
 #define write _write
 #define close _close
+#define lseek _lseek
 #endif
 #include <errno.h>
 
@@ -43,6 +44,7 @@
 #include "gegl-tile-storage.h"
 #include "gegl-tile.h"
 #include "gegl-buffer-index.h"
+#include "gegl-compression.h"
 
 #ifdef _WIN64
 #define BINARY_FLAG O_BINARY
@@ -69,12 +71,8 @@ typedef struct
   gint             o;
 
   gint             tile_size;
-  gint             offset;
+  goffset          offset;
   gint             entry_count;
-  GeglBufferBlock *in_holding; /* we need to write one block added behind
-                                * to be able to recompute the forward pointing
-                                * link from one entry to the next.
-                                */
 } SaveInfo;
 
 
@@ -99,30 +97,41 @@ gegl_tile_entry_destroy (GeglBufferTile *entry)
   g_free (entry);
 }
 
-static gsize write_block (SaveInfo        *info,
-                          GeglBufferBlock *block)
+static gboolean
+write_data (SaveInfo      *info,
+            gconstpointer  data,
+            gsize          size)
 {
-   gssize ret = 0;
-
-   if (info->in_holding)
-     {
-       glong allocated_pos = info->offset + info->in_holding->length;
-       info->in_holding->next = allocated_pos;
-
-       if (block == NULL)
-         info->in_holding->next = 0;
-
-       ret = write (info->o, info->in_holding, info->in_holding->length);
-       if (ret == -1)
-         ret = 0;
-       info->offset += ret;
-       g_assert (allocated_pos == info->offset);
-     }
-  /* write block should also allocate the block and update the
-   * previously added blocks next pointer
-   */
-   info->in_holding = block;
-   return ret;
+  while (size > 0)
+    {
+      ssize_t ret = write (info->o, data, size);
+
+      if (ret <= 0)
+        {
+          g_warning ("%s: failed writing to '%s': %s",
+                     G_STRFUNC, info->path, g_strerror (errno));
+          return FALSE;
+        }
+
+      info->offset += ret;
+      data          = (const guchar *) data + ret;
+      size         -= ret;
+    }
+
+  return TRUE;
+}
+
+/* pads the file with zeros, up to the next multiple of alignment */
+static gboolean
+write_padding (SaveInfo *info,
+               gint      alignment)
+{
+  static const guchar zeros[GEGL_BUFFER_TILE_ALIGNMENT] = { 0, };
+  gint                padding;
+
+  padding = (alignment - info->offset % alignment) % alignment;
+
+  return write_data (info, zeros, padding);
 }
 
 static void
@@ -183,6 +192,70 @@ static gint z_order_compare (gconstpointer a,
   return z_order (entryB) - z_order (entryA);
 }
 
+/* writes a revision 0 file: the header, followed by the index as a linked
+ * list of blocks, followed by the uncompressed tiles.
+ */
+static void
+save_rev0 (SaveInfo   *info,
+           GeglBuffer *buffer)
+{
+  GList   *iter;
+  goffset  block_offset = sizeof (GeglBufferHeader);
+  goffset  tile_offset;
+
+  info->header.next = info->entry_count ? block_offset : 0;
+
+  /* set the offset in the file each tile will be stored on, and link each
+   * block to the one following it.
+   */
+  tile_offset = block_offset +
+                (goffset) info->entry_count * GEGL_BUFFER_TILE_REV0_LENGTH;
+
+  for (iter = info->tiles; iter; iter = iter->next)
+    {
+      GeglBufferTile *entry = iter->data;
+
+      block_offset += GEGL_BUFFER_TILE_REV0_LENGTH;
+
+      entry->block.length = GEGL_BUFFER_TILE_REV0_LENGTH;
+      entry->block.next   = iter->next ? block_offset : 0;
+      entry->offset       = tile_offset;
+
+      tile_offset += info->tile_size;
+    }
+
+  /* save the header */
+  if (lseek (info->o, 0, SEEK_SET) == -1)
+    g_warning ("%s: failed seeking: %s", G_STRFUNC, g_strerror (errno));
+  info->offset = 0;
+
+  write_data (info, &info->header, sizeof (GeglBufferHeader));
+
+  /* save the index */
+  for (iter = info->tiles; iter; iter = iter->next)
+    write_data (info, iter->data, GEGL_BUFFER_TILE_REV0_LENGTH);
+
+  /* save each tile */
+  for (iter = info->tiles; iter; iter = iter->next)
+    {
+      GeglBufferTile *entry = iter->data;
+      GeglTile       *tile;
+
+      tile = gegl_tile_source_get_tile (GEGL_TILE_SOURCE (buffer),
+                                        entry->x,
+                                        entry->y,
+                                        entry->z);
+      g_assert (tile);
+
+      g_assert (info->offset == entry->offset);
+
+      gegl_tile_read_lock (tile);
+      write_data (info, gegl_tile_get_data (tile), info->tile_size);
+      gegl_tile_read_unlock (tile);
+
+      gegl_tile_unref (tile);
+    }
+}
 
 void
 gegl_buffer_header_init (GeglBufferHeader *header,
@@ -222,12 +295,27 @@ gegl_buffer_save (GeglBuffer          *buffer,
                   const gchar         *path,
                   const GeglRectangle *roi)
 {
-  SaveInfo *info = g_slice_new0 (SaveInfo);
+  gegl_buffer_save_full (buffer, path, roi, NULL, 0);
+}
 
-  glong prediction = 0;
-  gint bpp;
-  gint tile_width;
-  gint tile_height;
+void
+gegl_buffer_save_full (GeglBuffer          *buffer,
+                       const gchar         *path,
+                       const GeglRectangle *roi,
+                       const gchar         *compression_name,
+                       gint                 n_levels)
+{
+  SaveInfo              *info;
+  const GeglCompression *compression = NULL;
+  const Babl            *format;
+  guchar                *compressed  = NULL;
+  gint                   bpp;
+  gint                   tile_width;
+  gint                   tile_height;
+
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+  g_return_if_fail (path != NULL);
+  g_return_if_fail (n_levels >= 0 && n_levels < 16);
 
   GEGL_BUFFER_SANITY;
 
@@ -238,10 +326,7 @@ gegl_buffer_save (GeglBuffer          *buffer,
              "starting to save buffer %s, roi: %d,%d %dx%d",
              path, roi->x, roi->y, roi->width, roi->height);
 
-  /* a header should follow the same structure as a blockdef with
-   * respect to the flags and next offsets, thus this is a valid
-   * cast shortcut.
-   */
+  info = g_slice_new0 (SaveInfo);
 
   info->path = g_strdup (path);
 
@@ -253,9 +338,15 @@ gegl_buffer_save (GeglBuffer          *buffer,
 
 
   if (info->o == -1)
-    g_warning ("%s: Could not open '%s': %s", G_STRFUNC, info->path, g_strerror(errno));
+    {
+      g_warning ("%s: Could not open '%s': %s", G_STRFUNC, info->path, g_strerror(errno));
+      save_info_destroy (info);
+      return;
+    }
+
   tile_width  = buffer->tile_storage->tile_width;
   tile_height = buffer->tile_storage->tile_height;
+  format      = buffer->tile_storage->format;
   g_object_get (buffer, "px-size", &bpp, NULL);
 
   info->header.x           = roi->x;
@@ -266,53 +357,82 @@ gegl_buffer_save (GeglBuffer          *buffer,
                            tile_width,
                            tile_height,
                            bpp,
-                           buffer->tile_storage->format
+                           format
                            );
-  info->header.next = (prediction += sizeof (GeglBufferHeader));
+  info->header.n_levels = n_levels;
   info->tile_size = tile_width * tile_height * bpp;
 
   g_assert (info->tile_size % 16 == 0);
 
+  if (compression_name)
+    {
+      const gchar *name = gegl_compression_resolve_alias (compression_name);
+
+      compression = gegl_compression (name);
+
+      if (! compression)
+        {
+          g_warning ("%s: unknown compression '%s', storing tiles uncompressed",
+                     G_STRFUNC, compression_name);
+        }
+      else if (! strcmp (name, "nop"))
+        {
+          compression = NULL;
+        }
+      else if (strlen (name) >= sizeof (info->header.compression))
+        {
+          g_warning ("%s: compression name '%s' is too long, storing tiles "
+                     "uncompressed",
+                     G_STRFUNC, name);
+
+          compression = NULL;
+        }
+      else
+        {
+          strcpy (info->header.compression, name);
+
+          compressed = g_malloc (info->tile_size);
+        }
+    }
+
   GEGL_NOTE (GEGL_DEBUG_BUFFER_SAVE,
              "collecting list of tiles to be written");
   {
     gint z;
-    gint factor = 1;
 
-    for (z = 0; z < 1; z++)
+    for (z = 0; z <= n_levels; z++)
       {
-        gint bufy = roi->y;
-        while (bufy < roi->y + roi->height)
-          {
-            gint tiledy  = roi->y + bufy;
-            gint offsety = gegl_tile_offset (tiledy, tile_height);
-            gint bufx    = roi->x;
-
-            while (bufx < roi->x + roi->width)
-              {
-                gint tiledx  = roi->x + bufx;
-                gint offsetx = gegl_tile_offset (tiledx, tile_width);
-
-                gint tx = gegl_tile_indice (tiledx / factor, tile_width);
-                gint ty = gegl_tile_indice (tiledy / factor, tile_height);
-
-                if (gegl_tile_source_exist (GEGL_TILE_SOURCE (buffer), tx, ty, z))
-                  {
-                    GeglBufferTile *entry;
-
-                    GEGL_NOTE (GEGL_DEBUG_BUFFER_SAVE,
-                               "Found tile to save, tx, ty, z = %d, %d, %d",
-                               tx, ty, z);
-
-                    entry = gegl_tile_entry_new (tx, ty, z);
-                    info->tiles = g_list_prepend (info->tiles, entry);
-                    info->entry_count++;
-                  }
-                bufx += (tile_width - offsetx) * factor;
-              }
-            bufy += (tile_height - offsety) * factor;
-          }
-        factor *= 2;
+        gint x0 = gegl_tile_indice (roi->x, tile_width << z);
+        gint y0 = gegl_tile_indice (roi->y, tile_height << z);
+        gint x1 = gegl_tile_indice (roi->x + roi->width - 1, tile_width << z);
+        gint y1 = gegl_tile_indice (roi->y + roi->height - 1, tile_height << z);
+        gint tx;
+        gint ty;
+
+        if (roi->width <= 0 || roi->height <= 0)
+          break;
+
+        for (ty = y0; ty <= y1; ty++)
+          for (tx = x0; tx <= x1; tx++)
+            {
+              /* mipmap tiles are rendered on demand, so they never exist
+               * ahead of time.
+               */
+              if (z == 0 &&
+                  ! gegl_tile_source_exist (GEGL_TILE_SOURCE (buffer),
+                                            tx, ty, z))
+                {
+                  continue;
+                }
+
+              GEGL_NOTE (GEGL_DEBUG_BUFFER_SAVE,
+                         "Found tile to save, tx, ty, z = %d, %d, %d",
+                         tx, ty, z);
+
+              info->tiles = g_list_prepend (info->tiles,
+                                            gegl_tile_entry_new (tx, ty, z));
+              info->entry_count++;
+            }
       }
   GEGL_NOTE (GEGL_DEBUG_BUFFER_SAVE,
              "size of list of tiles to be written: %d",
@@ -322,71 +442,110 @@ gegl_buffer_save (GeglBuffer          *buffer,
   /* sort the list of tiles into zorder */
   info->tiles = g_list_sort (info->tiles, z_order_compare);
 
-  /* set the offset in the file each tile will be stored on */
-  {
-    GList *iter;
-    gint   predicted_offset = sizeof (GeglBufferHeader) +
-                              sizeof (GeglBufferTile) * (info->entry_count);
-    for (iter = info->tiles; iter; iter = iter->next)
-      {
-        GeglBufferTile *entry = iter->data;
-        entry->block.next = iter->next?
-                            (prediction += sizeof (GeglBufferTile)):0;
-        entry->offset = predicted_offset;
-        predicted_offset += info->tile_size;
-      }
-  }
-
-  /* save the header */
-  {
-    ssize_t ret = write (info->o, &info->header, sizeof (GeglBufferHeader));
-    if (ret != -1)
-      info->offset += ret;
-  }
-  g_assert (info->offset == info->header.next);
-
-  /* save the index */
-  {
-    GList *iter;
-    for (iter = info->tiles; iter; iter = iter->next)
-      {
-        GeglBufferItem *item = iter->data;
+  if (! compression_name && n_levels == 0)
+    {
+      save_rev0 (info, buffer);
+      save_info_destroy (info);
+      return;
+    }
 
-        write_block (info, &item->block);
+  info->header.flags = (info->header.flags & ~0xff) |
+                       GEGL_FILE_SPEC_REV_LATEST;
 
-      }
-  }
-  write_block (info, NULL); /* terminate the index */
-
-  /* update header to point to start of new index (already done for
-   * this serial saver, and the header is already written.
+  /* reserve room for the header, which is written last, once the offset and
+   * size of the index are known.
    */
+  if (lseek (info->o, sizeof (GeglBufferHeader), SEEK_SET) == -1)
+    g_warning ("%s: failed seeking: %s", G_STRFUNC, g_strerror (errno));
+  info->offset = sizeof (GeglBufferHeader);
 
-  /* save each tile */
+  /* save each tile, compressed if it makes it smaller, and aligned
+   * otherwise, so that it can be mapped as is.
+   */
   {
     GList *iter;
     for (iter = info->tiles; iter; iter = iter->next)
       {
         GeglBufferTile *entry = iter->data;
-        guchar          *data;
-        GeglTile        *tile;
+        guchar         *data;
+        GeglTile       *tile;
+        gint            size  = 0;
 
         tile = gegl_tile_source_get_tile (GEGL_TILE_SOURCE (buffer),
                                           entry->x,
                                           entry->y,
                                           entry->z);
         g_assert (tile);
+
+        gegl_tile_read_lock (tile);
+
         data = gegl_tile_get_data (tile);
         g_assert (data);
 
-        g_assert (info->offset == entry->offset);
-        {
-          ssize_t ret = write (info->o, data, info->tile_size);
-          if (ret != -1)
-            info->offset += ret;
-        }
+        if (compression &&
+            gegl_compression_compress (compression, format,
+                                       data, info->tile_size / bpp,
+                                       compressed, &size,
+                                       info->tile_size - 1))
+          {
+            entry->offset = info->offset;
+            entry->size   = size;
+
+            write_data (info, compressed, size);
+          }
+        else
+          {
+            write_padding (info, GEGL_BUFFER_TILE_ALIGNMENT);
+
+            entry->offset = info->offset;
+            entry->size   = 0;
+
+            write_data (info, data, info->tile_size);
+          }
+
+        gegl_tile_read_unlock (tile);
         gegl_tile_unref (tile);
       }
   }
+
+  /* save the index */
+  {
+    GeglBufferIndexEntry *entries;
+    GList                *iter;
+    gint                  i;
+
+    write_padding (info, sizeof (guint64));
+
+    entries = g_new0 (GeglBufferIndexEntry, MAX (info->entry_count, 1));
+
+    for (iter = info->tiles, i = 0; iter; iter = iter->next, i++)
+      {
+        const GeglBufferTile *entry = iter->data;
+
+        entries[i].offset = entry->offset;
+        entries[i].x      = entry->x;
+        entries[i].y      = entry->y;
+        entries[i].z      = entry->z;
+        entries[i].rev    = entry->rev;
+        entries[i].size   = entry->size ? entry->size : info->tile_size;
+      }
+
+    info->header.next      = info->entry_count ? info->offset : 0;
+    info->header.n_entries = info->entry_count;
+
+    write_data (info, entries,
+                info->entry_count * sizeof (GeglBufferIndexEntry));
+
+    g_free (entries);
+  }
+
+  /* save the header */
+  if (lseek (info->o, 0, SEEK_SET) == -1)
+    g_warning ("%s: failed seeking: %s", G_STRFUNC, g_strerror (errno));
+  info->offset = 0;
+
+  write_data (info, &info->header, sizeof (GeglBufferHeader));
+
+  g_free (compressed);
   save_info_destroy (info);
 }
@@ -0,0 +1,725 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <math.h>
+
+#include <glib-object.h>
+
+#include "gegl-buffer.h"
+#include "gegl-buffer-types.h"
+#include "gegl-buffer-private.h"
+#include "gegl-tile-storage.h"
+#include "gegl-parallel.h"
+
+/* whole-buffer reductions.  the reduced area is split into bands, one tile
+ * row high, which are reduced in parallel, each into its own partial result;
+ * the partial results are then combined in band order, so that the result
+ * doesn't depend on the number of threads.
+ *
+ * the results are cached on the tile storage, keyed by the reduced area in
+ * storage coordinates, so that they're shared by all the buffers of the
+ * storage, including the sub-buffers an operation is handed on every
+ * render.  they're tagged with the storage generation, which is incremented
+ * whenever a tile of any level of the storage changes, and dropped once it no
+ * longer matches.
+ */
+
+#define MAX_CACHED_RESULTS  16
+#define PERCENTILE_BINS     4096
+
+/* the cost of using an additional thread, in pixels */
+#define THREAD_COST         65536.0
+
+
+typedef enum
+{
+  REDUCTION_STATISTICS,
+  REDUCTION_HISTOGRAM
+} ReductionKind;
+
+typedef struct
+{
+  ReductionKind  kind;
+  GeglRectangle  rect; /* the reduced area, at level 0, in storage coordinates */
+  gint           level;
+  const Babl    *format;
+
+  /* histograms only */
+  gint           component;
+  gdouble        low;
+  gdouble        high;
+  gint           n_bins;
+} ReductionKey;
+
+typedef struct
+{
+  ReductionKey  key;
+  guint         generation;
+  gsize         size;
+  gpointer      result;
+} CachedResult;
+
+typedef struct
+{
+  GeglBuffer    *buffer;
+  const Babl    *format;
+  gint           level;
+  GeglRectangle  rect; /* the reduced area, at level */
+  gint           n_components;
+
+  gint           first_band_height;
+  gint           band_height;
+  gint           n_bands;
+
+  /* statistics: the minimum, maximum and sum of each component, per band */
+  gdouble       *band_results;
+
+  /* histograms */
+  gint           component;
+  gdouble        low;
+  gdouble        scale;
+  gint           n_bins;
+  guint64       *bins;
+  GMutex         mutex;
+} ReductionData;
+
+
+static GMutex cache_mutex;
+
+
+static gboolean
+reduction_key_equal (const ReductionKey *key1,
+                     const ReductionKey *key2)
+{
+  if (key1->kind   != key2->kind                        ||
+      ! gegl_rectangle_equal (&key1->rect, &key2->rect) ||
+      key1->level  != key2->level                       ||
+      key1->format != key2->format)
+    {
+      return FALSE;
+    }
+
+  if (key1->kind == REDUCTION_HISTOGRAM)
+    {
+      return key1->component == key2->component &&
+             key1->low       == key2->low       &&
+             key1->high      == key2->high      &&
+             key1->n_bins    == key2->n_bins;
+    }
+
+  return TRUE;
+}
+
+static void
+cached_result_free (CachedResult *cached)
+{
+  g_free (cached->result);
+  g_slice_free (CachedResult, cached);
+}
+
+static GQuark
+cache_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (! quark)
+    quark = g_quark_from_static_string ("gegl-buffer-statistics");
+
+  return quark;
+}
+
+static void
+cache_free (GQueue *cache)
+{
+  g_queue_free_full (cache, (GDestroyNotify) cached_result_free);
+}
+
+/* looks up the result for key, and copies it to result, which is size bytes
+ * long.  results of an older generation are dropped on the way.
+ */
+static gboolean
+cache_lookup (GeglTileStorage    *storage,
+              const ReductionKey *key,
+              guint               generation,
+              gpointer            result,
+              gsize               size)
+{
+  GQueue   *cache;
+  GList    *link;
+  gboolean  found = FALSE;
+
+  g_mutex_lock (&cache_mutex);
+
+  cache = g_object_get_qdata (G_OBJECT (storage), cache_quark ());
+
+  for (link = cache ? cache->head : NULL; link; link = g_list_next (link))
+    {
+      CachedResult *cached = link->data;
+
+      if (! reduction_key_equal (&cached->key, key))
+        continue;
+
+      if (cached->generation == generation && cached->size == size)
+        {
+          memcpy (result, cached->result, size);
+
+          /* keep the most recently used results at the head */
+          g_queue_unlink (cache, link);
+          g_queue_push_head_link (cache, link);
+
+          found = TRUE;
+        }
+      else
+        {
+          cached_result_free (cached);
+          g_queue_delete_link (cache, link);
+        }
+
+      break;
+    }
+
+  g_mutex_unlock (&cache_mutex);
+
+  return found;
+}
+
+static void
+cache_insert (GeglTileStorage    *storage,
+              const ReductionKey *key,
+              guint               generation,
+              gconstpointer       result,
+              gsize               size)
+{
+  CachedResult *cached;
+  GQueue       *cache;
+  GList        *link;
+
+  cached             = g_slice_new (CachedResult);
+  cached->key        = *key;
+  cached->generation = generation;
+  cached->size       = size;
+  cached->result     = g_malloc (size);
+
+  memcpy (cached->result, result, size);
+
+  g_mutex_lock (&cache_mutex);
+
+  cache = g_object_get_qdata (G_OBJECT (storage), cache_quark ());
+
+  if (! cache)
+    {
+      cache = g_queue_new ();
+
+      g_object_set_qdata_full (G_OBJECT (storage), cache_quark (),
+                               cache, (GDestroyNotify) cache_free);
+    }
+
+  /* another thread may have computed the same result concurrently */
+  for (link = cache->head; link; link = g_list_next (link))
+    {
+      if (reduction_key_equal (&((CachedResult *) link->data)->key, key))
+        {
+          cached_result_free (link->data);
+          g_queue_delete_link (cache, link);
+
+          break;
+        }
+    }
+
+  g_queue_push_head (cache, cached);
+
+  while (g_queue_get_length (cache) > MAX_CACHED_RESULTS)
+    cached_result_free (g_queue_pop_tail (cache));
+
+  g_mutex_unlock (&cache_mutex);
+}
+
+static gboolean
+reduction_init (ReductionData       *data,
+                ReductionKey        *key,
+                ReductionKind        kind,
+                GeglBuffer          *buffer,
+                const GeglRectangle *rect,
+                const Babl          *format,
+                gint                 level)
+{
+  GeglRectangle area;
+  gint          factor = 1 << level;
+  gint          shift_y;
+  gint          offset;
+  gint          c;
+
+  if (! format)
+    format = gegl_buffer_get_format (buffer);
+
+  data->n_components = babl_format_get_n_components (format);
+
+  for (c = 0; c < data->n_components; c++)
+    {
+      if (babl_format_get_type (format, c) != babl_type ("float"))
+        {
+          g_warning ("%s: format '%s' is not a float format",
+                     G_STRFUNC, babl_get_name (format));
+
+          return FALSE;
+        }
+    }
+
+  if (rect)
+    gegl_rectangle_intersect (&area, rect, gegl_buffer_get_extent (buffer));
+  else
+    area = *gegl_buffer_get_extent (buffer);
+
+  /* pixels outside of the abyss read as zero, which depends on the buffer,
+   * rather than on the storage the cache is keyed on.
+   */
+  gegl_rectangle_intersect (&area, &area, gegl_buffer_get_abyss (buffer));
+
+  if (gegl_rectangle_is_empty (&area))
+    return FALSE;
+
+  memset (key, 0, sizeof (*key));
+
+  key->kind   = kind;
+  key->rect   = area;
+  key->level  = level;
+  key->format = format;
+
+  key->rect.x += buffer->shift_x;
+  key->rect.y += buffer->shift_y;
+
+  data->buffer        = buffer;
+  data->format        = format;
+  data->level         = level;
+  data->rect.x        = area.x >> level;
+  data->rect.y        = area.y >> level;
+  data->rect.width    = ((area.x + area.width  + factor - 1) >> level) -
+                        data->rect.x;
+  data->rect.height   = ((area.y + area.height + factor - 1) >> level) -
+                        data->rect.y;
+
+  /* split the area into bands aligned to the tile rows of the level */
+  shift_y = buffer->shift_y >> level;
+  offset  = (data->rect.y + shift_y) % buffer->tile_height;
+
+  if (offset < 0)
+    offset += buffer->tile_height;
+
+  data->band_height       = buffer->tile_height;
+  data->first_band_height = MIN (buffer->tile_height - offset,
+                                 data->rect.height);
+  data->n_bands           = 1 + (data->rect.height -
+                                 data->first_band_height +
+                                 data->band_height - 1) / data->band_height;
+
+  return TRUE;
+}
+
+static void
+reduction_get_band (const ReductionData *data,
+                    gint                 band,
+                    GeglRectangle       *rect)
+{
+  rect->x     = data->rect.x;
+  rect->width = data->rect.width;
+
+  if (band == 0)
+    {
+      rect->y      = data->rect.y;
+      rect->height = data->first_band_height;
+    }
+  else
+    {
+      rect->y      = data->rect.y + data->first_band_height +
+                     (band - 1) * data->band_height;
+      rect->height = MIN (data->band_height,
+                          data->rect.y + data->rect.height - rect->y);
+    }
+}
+
+static gdouble
+reduction_get_thread_cost (const ReductionData *data)
+{
+  gdouble band_size = (gdouble) data->rect.width * data->band_height;
+
+  return MAX (THREAD_COST / band_size, 1.0);
+}
+
+static void
+statistics_range (gsize          offset,
+                  gsize          size,
+                  ReductionData *data)
+{
+  gint  n_components = data->n_components;
+  gsize band;
+
+  for (band = offset; band < offset + size; band++)
+    {
+      GeglBufferIterator *iter;
+      GeglRectangle       rect;
+      gdouble            *min = data->band_results + 3 * n_components * band;
+      gdouble            *max = min + n_components;
+      gdouble            *sum = max + n_components;
+      gint                c;
+
+      for (c = 0; c < n_components; c++)
+        {
+          min[c] =  G_MAXDOUBLE;
+          max[c] = -G_MAXDOUBLE;
+          sum[c] =  0.0;
+        }
+
+      reduction_get_band (data, band, &rect);
+
+      iter = gegl_buffer_iterator_new (data->buffer, &rect, data->level,
+                                       data->format,
+                                       GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          const gfloat *pixels = iter->items[0].data;
+          gint          length = iter->length;
+
+          for (c = 0; c < n_components; c++)
+            {
+              const gfloat *p    = pixels + c;
+              gfloat        cmin = min[c];
+              gfloat        cmax = max[c];
+              gdouble       csum = 0.0;
+              gint          i;
+
+              for (i = 0; i < length; i++)
+                {
+                  gfloat v = *p;
+
+                  if (v < cmin)
+                    cmin = v;
+                  if (v > cmax)
+                    cmax = v;
+
+                  csum += v;
+
+                  p += n_components;
+                }
+
+              min[c]  = cmin;
+              max[c]  = cmax;
+              sum[c] += csum;
+            }
+        }
+    }
+}
+
+static void
+histogram_range (gsize          offset,
+                 gsize          size,
+                 ReductionData *data)
+{
+  gint     n_components = data->n_components;
+  gint     last_bin     = data->n_bins - 1;
+  guint64 *bins;
+  gsize    band;
+  gint     i;
+
+  bins = g_new0 (guint64, data->n_bins);
+
+  for (band = offset; band < offset + size; band++)
+    {
+      GeglBufferIterator *iter;
+      GeglRectangle       rect;
+
+      reduction_get_band (data, band, &rect);
+
+      iter = gegl_buffer_iterator_new (data->buffer, &rect, data->level,
+                                       data->format,
+                                       GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          const gfloat *p = (const gfloat *) iter->items[0].data +
+                            data->component;
+
+          for (i = 0; i < iter->length; i++)
+            {
+              gfloat v = (*p - data->low) * data->scale;
+
+              /* values outside of the range are counted in the first or
+               * last bin; nan values aren't counted.
+               */
+              if (v >= last_bin)
+                bins[last_bin]++;
+              else if (v >= 0.0f)
+                bins[(gint) v]++;
+              else if (v < 0.0f)
+                bins[0]++;
+
+              p += n_components;
+            }
+        }
+    }
+
+  /* the counts are integers, so the order in which the ranges are merged
+   * doesn't matter.
+   */
+  g_mutex_lock (&data->mutex);
+
+  for (i = 0; i < data->n_bins; i++)
+    data->bins[i] += bins[i];
+
+  g_mutex_unlock (&data->mutex);
+
+  g_free (bins);
+}
+
+gboolean
+gegl_buffer_get_statistics (GeglBuffer          *buffer,
+                            const GeglRectangle *rect,
+                            const Babl          *format,
+                            gint                 level,
+                            gdouble             *min,
+                            gdouble             *max,
+                            gdouble             *mean)
+{
+  ReductionData  data;
+  ReductionKey   key;
+  guint          generation;
+  gdouble       *result;
+  gsize          size;
+  gint           n;
+  gint           c;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), FALSE);
+  g_return_val_if_fail (level >= 0, FALSE);
+
+  if (! reduction_init (&data, &key, REDUCTION_STATISTICS,
+                        buffer, rect, format, level))
+    {
+      return FALSE;
+    }
+
+  n      = data.n_components;
+  size   = 3 * n * sizeof (gdouble);
+  result = g_alloca (size);
+
+  generation = gegl_tile_storage_get_generation (buffer->tile_storage);
+
+  if (! cache_lookup (buffer->tile_storage, &key, generation, result, size))
+    {
+      gdouble n_pixels = (gdouble) data.rect.width * data.rect.height;
+      gint    band;
+
+      data.band_results = g_new (gdouble, 3 * n * data.n_bands);
+
+      gegl_parallel_distribute_range (
+        data.n_bands, reduction_get_thread_cost (&data),
+        (GeglParallelDistributeRangeFunc) statistics_range,
+        &data);
+
+      for (c = 0; c < n; c++)
+        {
+          result[c]         =  G_MAXDOUBLE;
+          result[n + c]     = -G_MAXDOUBLE;
+          result[2 * n + c] =  0.0;
+        }
+
+      for (band = 0; band < data.n_bands; band++)
+        {
+          const gdouble *band_result = data.band_results + 3 * n * band;
+
+          for (c = 0; c < n; c++)
+            {
+              result[c]          = MIN (result[c],     band_result[c]);
+              result[n + c]      = MAX (result[n + c], band_result[n + c]);
+              result[2 * n + c] += band_result[2 * n + c];
+            }
+        }
+
+      for (c = 0; c < n; c++)
+        result[2 * n + c] /= n_pixels;
+
+      g_free (data.band_results);
+
+      cache_insert (buffer->tile_storage, &key, generation, result, size);
+    }
+
+  for (c = 0; c < n; c++)
+    {
+      if (min)
+        min[c] = result[c];
+      if (max)
+        max[c] = result[n + c];
+      if (mean)
+        mean[c] = result[2 * n + c];
+    }
+
+  return TRUE;
+}
+
+gboolean
+gegl_buffer_get_histogram (GeglBuffer          *buffer,
+                           const GeglRectangle *rect,
+                           const Babl          *format,
+                           gint                 level,
+                           gint                 component,
+                           gdouble              low,
+                           gdouble              high,
+                           gint                 n_bins,
+                           guint64             *bins)
+{
+  ReductionData  data;
+  ReductionKey   key;
+  guint          generation;
+  gsize          size;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), FALSE);
+  g_return_val_if_fail (level >= 0, FALSE);
+  g_return_val_if_fail (component >= 0, FALSE);
+  g_return_val_if_fail (high > low, FALSE);
+  g_return_val_if_fail (n_bins > 0, FALSE);
+  g_return_val_if_fail (bins != NULL, FALSE);
+
+  if (! reduction_init (&data, &key, REDUCTION_HISTOGRAM,
+                        buffer, rect, format, level))
+    {
+      return FALSE;
+    }
+
+  g_return_val_if_fail (component < data.n_components, FALSE);
+
+  key.component = component;
+  key.low       = low;
+  key.high      = high;
+  key.n_bins    = n_bins;
+
+  size       = n_bins * sizeof (guint64);
+  generation = gegl_tile_storage_get_generation (buffer->tile_storage);
+
+  if (! cache_lookup (buffer->tile_storage, &key, generation, bins, size))
+    {
+      data.component = component;
+      data.low       = low;
+      data.scale     = n_bins / (high - low);
+      data.n_bins    = n_bins;
+      data.bins      = bins;
+
+      memset (bins, 0, size);
+
+      g_mutex_init (&data.mutex);
+
+      gegl_parallel_distribute_range (
+        data.n_bands, reduction_get_thread_cost (&data),
+        (GeglParallelDistributeRangeFunc) histogram_range,
+        &data);
+
+      g_mutex_clear (&data.mutex);
+
+      cache_insert (buffer->tile_storage, &key, generation, bins, size);
+    }
+
+  return TRUE;
+}
+
+gboolean
+gegl_buffer_get_percentiles (GeglBuffer          *buffer,
+                             const GeglRectangle *rect,
+                             const Babl          *format,
+                             gint                 level,
+                             gint                 component,
+                             gint                 n_percentiles,
+                             const gdouble       *percentiles,
+                             gdouble             *values)
+{
+  gdouble *min;
+  gdouble *max;
+  guint64 *bins;
+  guint64  total = 0;
+  gdouble  low;
+  gdouble  bin_width;
+  gint     n_components;
+  gint     i;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), FALSE);
+  g_return_val_if_fail (component >= 0, FALSE);
+  g_return_val_if_fail (n_percentiles >= 0, FALSE);
+  g_return_val_if_fail (percentiles != NULL || n_percentiles == 0, FALSE);
+  g_return_val_if_fail (values != NULL || n_percentiles == 0, FALSE);
+
+  if (! format)
+    format = gegl_buffer_get_format (buffer);
+
+  n_components = babl_format_get_n_components (format);
+
+  g_return_val_if_fail (component < n_components, FALSE);
+
+  min = g_newa (gdouble, n_components);
+  max = g_newa (gdouble, n_components);
+
+  if (! gegl_buffer_get_statistics (buffer, rect, format, level,
+                                    min, max, NULL))
+    {
+      return FALSE;
+    }
+
+  /* a constant component */
+  if (! (max[component] > min[component]))
+    {
+      for (i = 0; i < n_percentiles; i++)
+        values[i] = min[component];
+
+      return TRUE;
+    }
+
+  bins = g_new (guint64, PERCENTILE_BINS);
+
+  low       = min[component];
+  bin_width = (max[component] - low) / PERCENTILE_BINS;
+
+  gegl_buffer_get_histogram (buffer, rect, format, level, component,
+                             low, max[component], PERCENTILE_BINS, bins);
+
+  for (i = 0; i < PERCENTILE_BINS; i++)
+    total += bins[i];
+
+  for (i = 0; i < n_percentiles; i++)
+    {
+      gdouble rank = CLAMP (percentiles[i], 0.0, 100.0) / 100.0 * total;
+      guint64 count = 0;
+      gint    bin;
+
+      /* find the bin holding the rank, and interpolate within it */
+      for (bin = 0; bin < PERCENTILE_BINS - 1; bin++)
+        {
+          if (count + bins[bin] >= rank)
+            break;
+
+          count += bins[bin];
+        }
+
+      values[i] = low + bin_width * bin;
+
+      if (bins[bin])
+        values[i] += bin_width * (rank - count) / bins[bin];
+
+      values[i] = CLAMP (values[i], min[component], max[component]);
+    }
+
+  g_free (bins);
+
+  return TRUE;
+}
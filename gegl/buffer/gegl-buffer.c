@@ -38,7 +38,9 @@
 #include "gegl-buffer-private.h"
 #include "gegl-rectangle.h"
 #include "gegl-tile-handler-cache.h"
+#include "gegl-tile-handler-chain.h"
 #include "gegl-tile-handler-private.h"
+#include "gegl-tile-handler-zoom.h"
 #include "gegl-tile-storage.h"
 #include "gegl-tile-backend-file.h"
 #include "gegl-tile-backend-swap.h"
@@ -1208,10 +1210,33 @@ gegl_buffer_share_storage (GeglBuffer *buffer1,
   return buffer1->tile_storage == buffer2->tile_storage;
 }
 
+void
+gegl_buffer_set_mipmap_mode (GeglBuffer *buffer,
+                             gint        eager_levels,
+                             gboolean    linear)
+{
+  GeglTileHandler *zoom;
+
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+  g_return_if_fail (eager_levels >= 0);
+
+  zoom = gegl_tile_handler_chain_get_first (
+    GEGL_TILE_HANDLER_CHAIN (buffer->tile_storage),
+    GEGL_TYPE_TILE_HANDLER_ZOOM);
+
+  if (zoom)
+    {
+      gegl_tile_handler_zoom_set_mode (GEGL_TILE_HANDLER_ZOOM (zoom),
+                                       eager_levels, linear);
+    }
+}
+
 void
 gegl_buffer_emit_changed_signal (GeglBuffer          *buffer,
                                  const GeglRectangle *rect)
 {
+  gegl_tile_storage_changed (buffer->tile_storage);
+
   if (buffer->changed_signal_connections)
     {
       GeglRectangle copy;
@@ -1300,6 +1325,58 @@ gegl_buffer_get_tile (GeglBuffer *buffer,
   return tile;
 }
 
+void
+gegl_buffer_prefetch (GeglBuffer          *buffer,
+                      const GeglRectangle *rect,
+                      gint                 level)
+{
+  GeglTileSource  *source = (GeglTileSource *) buffer;
+  GeglTileBackend *backend;
+  gint             factor = 1 << level;
+  gint             tile_width;
+  gint             tile_height;
+  gint             x0, y0, x1, y1;
+  gint             x, y;
+
+  if (! rect || gegl_rectangle_is_empty (rect))
+    return;
+
+  /* only the swap backend reads tiles ahead of time; don't walk the tile
+   * chain if nothing has been swapped out.
+   */
+  if (gegl_tile_backend_swap_get_total () == 0)
+    return;
+
+  backend = gegl_buffer_backend (buffer);
+
+  tile_width  = buffer->tile_width;
+  tile_height = buffer->tile_height;
+
+  x0 = gegl_tile_indice (rect->x + buffer->shift_x / factor, tile_width);
+  y0 = gegl_tile_indice (rect->y + buffer->shift_y / factor, tile_height);
+  x1 = gegl_tile_indice (rect->x + rect->width  - 1 + buffer->shift_x / factor,
+                         tile_width);
+  y1 = gegl_tile_indice (rect->y + rect->height - 1 + buffer->shift_y / factor,
+                         tile_height);
+
+  g_rec_mutex_lock (&buffer->tile_storage->mutex);
+
+  /* neither if none of the buffer's own tiles are in the swap */
+  if (GEGL_IS_TILE_BACKEND_SWAP (backend) &&
+      g_hash_table_size (GEGL_TILE_BACKEND_SWAP (backend)->index) == 0)
+    {
+      g_rec_mutex_unlock (&buffer->tile_storage->mutex);
+
+      return;
+    }
+
+  for (y = y0; y <= y1; y++)
+    for (x = x0; x <= x1; x++)
+      gegl_tile_source_prefetch (source, x, y, level);
+
+  g_rec_mutex_unlock (&buffer->tile_storage->mutex);
+}
+
 void (*gegl_tile_handler_cache_ext_flush) (void *cache, const GeglRectangle *rect)=NULL;
 void (*gegl_buffer_ext_flush) (GeglBuffer *buffer, const GeglRectangle *rect)=NULL;
 void (*gegl_buffer_ext_invalidate) (GeglBuffer *buffer, const GeglRectangle *rect)=NULL;
@@ -1345,6 +1422,46 @@ void (*gegl_downscale_2x2) (const Babl *format,
                             gint        dst_rowstride) =
       gegl_downscale_2x2_generic;
 
+void (*gegl_sample_linear_span) (const gfloat *src,
+                                 gint          rowstride,
+                                 const gint   *offsets,
+                                 const gfloat *fx,
+                                 const gfloat *fy,
+                                 gfloat       *dst,
+                                 gint          n,
+                                 gint          components) =
+      gegl_sample_linear_span_generic;
+
+void (*gegl_sample_cubic_span) (const gfloat *src,
+                                gint          rowstride,
+                                const gint   *offsets,
+                                const gfloat *fx,
+                                const gfloat *fy,
+                                gfloat       *dst,
+                                gint          n,
+                                gint          components,
+                                gfloat        b,
+                                gfloat        c) =
+      gegl_sample_cubic_span_generic;
+
+gint (*gegl_shuffle_encode) (const guint8 *src,
+                             gint          n,
+                             gint          bpp,
+                             gint          csize,
+                             guint8       *planes,
+                             guint8       *dst,
+                             gint          max_size) =
+      gegl_shuffle_encode_generic;
+
+gboolean (*gegl_shuffle_decode) (const guint8 *src,
+                                 gint          size,
+                                 gint          n,
+                                 gint          bpp,
+                                 gint          csize,
+                                 guint8       *planes,
+                                 guint8       *dst) =
+      gegl_shuffle_decode_generic;
+
 
 #define GEGL_VARIANTS(variant) \
 void gegl_resample_nearest_##variant   (guchar              *dest_buf,     \
@@ -1377,7 +1494,39 @@ void gegl_downscale_2x2_##variant      (const Babl          *format,       \
                                         guchar              *src_data,     \
                                         gint                 src_rowstride,\
                                         guchar              *dst_data,     \
-                                        gint                 dst_rowstride);
+                                        gint                 dst_rowstride);\
+void gegl_sample_linear_span_##variant (const gfloat        *src,          \
+                                        gint                 rowstride,    \
+                                        const gint          *offsets,      \
+                                        const gfloat        *fx,           \
+                                        const gfloat        *fy,           \
+                                        gfloat              *dst,          \
+                                        gint                 n,            \
+                                        gint                 components);  \
+void gegl_sample_cubic_span_##variant  (const gfloat        *src,          \
+                                        gint                 rowstride,    \
+                                        const gint          *offsets,      \
+                                        const gfloat        *fx,           \
+                                        const gfloat        *fy,           \
+                                        gfloat              *dst,          \
+                                        gint                 n,            \
+                                        gint                 components,   \
+                                        gfloat               b,            \
+                                        gfloat               c);           \
+gint gegl_shuffle_encode_##variant     (const guint8        *src,          \
+                                        gint                 n,            \
+                                        gint                 bpp,          \
+                                        gint                 csize,        \
+                                        guint8              *planes,       \
+                                        guint8              *dst,          \
+                                        gint                 max_size);    \
+gboolean gegl_shuffle_decode_##variant (const guint8        *src,          \
+                                        gint                 size,         \
+                                        gint                 n,            \
+                                        gint                 bpp,          \
+                                        gint                 csize,        \
+                                        guint8              *planes,       \
+                                        guint8              *dst);
 
 #include "gegl-variants.inc"
 //GEGL_VARIANTS(generic)
@@ -1421,6 +1570,10 @@ void _gegl_init_buffer (int variant)
     gegl_resample_boxfilter = gegl_resample_boxfilter_arm_neon;
     gegl_resample_nearest   = gegl_resample_nearest_arm_neon;
     gegl_downscale_2x2      = gegl_downscale_2x2_arm_neon;
+    gegl_sample_linear_span = gegl_sample_linear_span_arm_neon;
+    gegl_sample_cubic_span  = gegl_sample_cubic_span_arm_neon;
+    gegl_shuffle_encode     = gegl_shuffle_encode_arm_neon;
+    gegl_shuffle_decode     = gegl_shuffle_decode_arm_neon;
   }
 #endif
 #ifdef ARCH_X86_64
@@ -1433,12 +1586,20 @@ void _gegl_init_buffer (int variant)
       gegl_resample_boxfilter = gegl_resample_boxfilter_x86_64_v2;
       gegl_resample_nearest   = gegl_resample_nearest_x86_64_v2;
       gegl_downscale_2x2      = gegl_downscale_2x2_x86_64_v2;
+      gegl_sample_linear_span = gegl_sample_linear_span_x86_64_v2;
+      gegl_sample_cubic_span  = gegl_sample_cubic_span_x86_64_v2;
+      gegl_shuffle_encode     = gegl_shuffle_encode_x86_64_v2;
+      gegl_shuffle_decode     = gegl_shuffle_decode_x86_64_v2;
       break;
     case 3:
       gegl_resample_bilinear  = gegl_resample_bilinear_x86_64_v3;
       gegl_resample_boxfilter = gegl_resample_boxfilter_x86_64_v3;
       gegl_resample_nearest   = gegl_resample_nearest_x86_64_v3;
       gegl_downscale_2x2      = gegl_downscale_2x2_x86_64_v3;
+      gegl_sample_linear_span = gegl_sample_linear_span_x86_64_v3;
+      gegl_sample_cubic_span  = gegl_sample_cubic_span_x86_64_v3;
+      gegl_shuffle_encode     = gegl_shuffle_encode_x86_64_v3;
+      gegl_shuffle_decode     = gegl_shuffle_decode_x86_64_v3;
       break;
   }
 #endif
@@ -127,6 +127,34 @@ void            gegl_buffer_save              (GeglBuffer          *buffer,
                                                const gchar         *path,
                                                const GeglRectangle *roi);
 
+/**
+ * gegl_buffer_save_full:
+ * @buffer: (transfer none): a #GeglBuffer.
+ * @path: the path where the gegl buffer will be saved.
+ * @roi: (nullable): the region of interest to write, or %NULL to write the
+ * whole extent of the buffer.
+ * @compression: (nullable): the name of the compression algorithm to
+ * compress tiles with, such as "fast" or "best", "nop" to store them
+ * uncompressed, or %NULL.
+ * @n_levels: the number of mipmap levels to store, in addition to the full
+ * resolution tiles.
+ *
+ * Write a GeglBuffer to a file, like gegl_buffer_save(), optionally
+ * compressing its tiles, and storing its mipmap levels, which are then used
+ * when the file is opened with gegl_buffer_open().
+ *
+ * When @compression is not %NULL, or @n_levels is positive, the file uses a
+ * newer revision of the format, with a contiguous index, in which the tiles
+ * that are stored uncompressed are accessed without copying by buffers
+ * opened on the file.  Otherwise, the file is written in the format that
+ * gegl_buffer_save() uses, which older versions of GEGL can read.
+ */
+void            gegl_buffer_save_full         (GeglBuffer          *buffer,
+                                               const gchar         *path,
+                                               const GeglRectangle *roi,
+                                               const gchar         *compression,
+                                               gint                 n_levels);
+
 /**
  * gegl_buffer_load:
  * @path: the path to a gegl buffer on disk.
@@ -579,6 +607,54 @@ void              gegl_sampler_get            (GeglSampler       *sampler,
                                                void              *output,
                                                GeglAbyssPolicy   repeat_mode);
 
+/**
+ * gegl_sampler_get_span: (skip)
+ * @sampler: a GeglSampler gotten from gegl_buffer_sampler_new
+ * @x: x coordinate of the first sample
+ * @y: y coordinate of the first sample
+ * @dx: x step between consecutive samples
+ * @dy: y step between consecutive samples
+ * @scale: matrix representing extent of sampling area in source buffer,
+ * shared by all the samples, or NULL.
+ * @output: memory location for @n samples, stored contiguously.
+ * @n: number of samples.
+ * @repeat_mode: how requests outside the buffer extent are handled.
+ *
+ * Sample @n points along a line, the i'th point being the one reached by
+ * adding (@dx, @dy) to (@x, @y) i times. This gives the same results as
+ * calling the function returned by gegl_sampler_get_fun() for each point,
+ * but interpolates the points in batches; like that function, it does no
+ * NaN / infinity checks on the coordinates.
+ */
+void              gegl_sampler_get_span       (GeglSampler       *sampler,
+                                               gdouble            x,
+                                               gdouble            y,
+                                               gdouble            dx,
+                                               gdouble            dy,
+                                               GeglBufferMatrix2 *scale,
+                                               void              *output,
+                                               gint               n,
+                                               GeglAbyssPolicy    repeat_mode);
+
+/**
+ * gegl_sampler_get_points: (skip)
+ * @sampler: a GeglSampler gotten from gegl_buffer_sampler_new
+ * @coords: @n (x, y) coordinate pairs.
+ * @scales: @n matrices, one per sample, or NULL.
+ * @output: memory location for @n samples, stored contiguously.
+ * @n: number of samples.
+ * @repeat_mode: how requests outside the buffer extent are handled.
+ *
+ * Sample @n arbitrary points; the batched counterpart of the function
+ * returned by gegl_sampler_get_fun(), see gegl_sampler_get_span().
+ */
+void              gegl_sampler_get_points     (GeglSampler       *sampler,
+                                               const gdouble     *coords,
+                                               GeglBufferMatrix2 *scales,
+                                               void              *output,
+                                               gint               n,
+                                               GeglAbyssPolicy    repeat_mode);
+
 /* code template utility, updates the jacobian matrix using
  * a user defined mapping function for displacement, example
  * with an identity transform (note that for the identity
@@ -709,6 +785,119 @@ const GeglRectangle * gegl_buffer_get_abyss   (GeglBuffer           *buffer);
 gboolean gegl_buffer_share_storage (GeglBuffer *buffer1,
                                     GeglBuffer *buffer2);
 
+/**
+ * gegl_buffer_set_mipmap_mode:
+ * @buffer: a #GeglBuffer.
+ * @eager_levels: the number of mipmap levels to rebuild in the background
+ * after the buffer is written to, or 0 to only build them on demand.
+ * @linear: whether to filter the mipmap levels in linear light, using a
+ * float format, rather than in the format of the buffer.
+ *
+ * Sets how the mipmap levels used when reading @buffer at a reduced level of
+ * detail are generated.  With @eager_levels, the affected tiles of the first
+ * @eager_levels levels are regenerated in parallel shortly after each write,
+ * instead of when they are first read.
+ *
+ * The mode applies to all buffers sharing the storage of @buffer.  Levels
+ * that have already been generated are not regenerated when @linear changes.
+ */
+void gegl_buffer_set_mipmap_mode (GeglBuffer *buffer,
+                                  gint        eager_levels,
+                                  gboolean    linear);
+
+
+/**
+ * gegl_buffer_get_statistics:
+ * @buffer: a #GeglBuffer.
+ * @rect: (nullable): the area to reduce, or NULL for the whole buffer.
+ * @format: (nullable): the format to reduce in, or NULL for the format of
+ * @buffer.  All of its components must be floats.
+ * @level: the mipmap level to reduce.  Levels above 0 give an estimate, from
+ * the reduced resolution data of @buffer, reading 1/4^@level of the pixels.
+ * @min: (out caller-allocates) (array) (optional): return location for the
+ * minimum of each component, or NULL.
+ * @max: (out caller-allocates) (array) (optional): return location for the
+ * maximum of each component, or NULL.
+ * @mean: (out caller-allocates) (array) (optional): return location for the
+ * mean of each component, or NULL.
+ *
+ * Computes per-component statistics of @buffer over @rect, in parallel.  The
+ * result doesn't depend on the number of threads used.
+ *
+ * Results are cached, and shared by all the buffers sharing the storage of
+ * @buffer, until the buffer is next changed, so that repeated queries, such
+ * as when an operation is re-rendered with different properties, are cheap.
+ *
+ * Returns: TRUE on success, FALSE if @rect doesn't intersect @buffer.
+ */
+gboolean gegl_buffer_get_statistics  (GeglBuffer          *buffer,
+                                      const GeglRectangle *rect,
+                                      const Babl          *format,
+                                      gint                 level,
+                                      gdouble             *min,
+                                      gdouble             *max,
+                                      gdouble             *mean);
+
+/**
+ * gegl_buffer_get_histogram:
+ * @buffer: a #GeglBuffer.
+ * @rect: (nullable): the area to reduce, or NULL for the whole buffer.
+ * @format: (nullable): the format to reduce in, or NULL for the format of
+ * @buffer.  All of its components must be floats.
+ * @level: the mipmap level to reduce, see gegl_buffer_get_statistics().
+ * @component: the component of @format to count.
+ * @low: the lower bound of the first bin.
+ * @high: the upper bound of the last bin.
+ * @n_bins: the number of bins.
+ * @bins: (out caller-allocates) (array length=n_bins): return location for
+ * the counts.
+ *
+ * Computes a histogram of @component over @rect, in parallel, splitting the
+ * range between @low and @high into @n_bins equal bins.  Values below @low,
+ * or above @high, are counted in the first, or last, bin.  NaN values are not
+ * counted.  Results are cached like those of gegl_buffer_get_statistics().
+ *
+ * Returns: TRUE on success, FALSE if @rect doesn't intersect @buffer.
+ */
+gboolean gegl_buffer_get_histogram   (GeglBuffer          *buffer,
+                                      const GeglRectangle *rect,
+                                      const Babl          *format,
+                                      gint                 level,
+                                      gint                 component,
+                                      gdouble              low,
+                                      gdouble              high,
+                                      gint                 n_bins,
+                                      guint64             *bins);
+
+/**
+ * gegl_buffer_get_percentiles:
+ * @buffer: a #GeglBuffer.
+ * @rect: (nullable): the area to reduce, or NULL for the whole buffer.
+ * @format: (nullable): the format to reduce in, or NULL for the format of
+ * @buffer.  All of its components must be floats.
+ * @level: the mipmap level to reduce, see gegl_buffer_get_statistics().
+ * @component: the component of @format to use.
+ * @n_percentiles: the number of percentiles.
+ * @percentiles: (array length=n_percentiles): the percentiles to compute,
+ * between 0 and 100.
+ * @values: (out caller-allocates) (array length=n_percentiles): return
+ * location for the values of the percentiles.
+ *
+ * Computes percentiles of @component over @rect.  The values are
+ * interpolated from a 4096 bin histogram spanning the range of the
+ * component, which makes them accurate to within 1/4096 of that range.
+ *
+ * Returns: TRUE on success, FALSE if @rect doesn't intersect @buffer.
+ */
+gboolean gegl_buffer_get_percentiles (GeglBuffer          *buffer,
+                                      const GeglRectangle *rect,
+                                      const Babl          *format,
+                                      gint                 level,
+                                      gint                 component,
+                                      gint                 n_percentiles,
+                                      const gdouble       *percentiles,
+                                      gdouble             *values);
+
 
 /**
  * gegl_buffer_signal_connect:
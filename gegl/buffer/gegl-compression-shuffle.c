@@ -0,0 +1,152 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* the "shuffle" algorithm is tailored to pixel data: each component is
+ * delta-coded against the same component of the previous pixel, and, for
+ * each group of GEGL_SHUFFLE_BLOCK pixels, the bytes of the deltas are split
+ * into byte planes, each of which is stored using only as many bit planes as
+ * its largest value needs.  smooth data, and the high bytes of multi-byte
+ * components, compress well, while the work is cheap, branch-free bit
+ * manipulation, with per-architecture variants in gegl-algorithms.c.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+
+#include "gegl-buffer.h"
+#include "gegl-buffer-private.h"
+#include "gegl-algorithms.h"
+#include "gegl-compression.h"
+#include "gegl-compression-shuffle.h"
+#include "gegl-scratch.h"
+
+
+/*  local function prototypes  */
+
+static gint       gegl_compression_shuffle_get_component_size (const Babl            *format);
+
+static gboolean   gegl_compression_shuffle_compress           (const GeglCompression *compression,
+                                                               const Babl            *format,
+                                                               gconstpointer          data,
+                                                               gint                   n,
+                                                               gpointer               compressed,
+                                                               gint                  *compressed_size,
+                                                               gint                   max_compressed_size);
+static gboolean   gegl_compression_shuffle_decompress         (const GeglCompression *compression,
+                                                               const Babl            *format,
+                                                               gpointer               data,
+                                                               gint                   n,
+                                                               gconstpointer          compressed,
+                                                               gint                   compressed_size);
+
+
+/*  private functions  */
+
+static gint
+gegl_compression_shuffle_get_component_size (const Babl *format)
+{
+  gint bpp          = babl_format_get_bytes_per_pixel (format);
+  gint n_components = babl_format_get_n_components (format);
+  gint csize;
+
+  if (n_components <= 0 || bpp % n_components)
+    return 1;
+
+  csize = bpp / n_components;
+
+  /* formats mixing component types only lose some compression ratio */
+  switch (csize)
+    {
+    case 1:
+    case 2:
+    case 4:
+    case 8:
+      return csize;
+
+    default:
+      return 1;
+    }
+}
+
+static gboolean
+gegl_compression_shuffle_compress (const GeglCompression *compression,
+                                   const Babl            *format,
+                                   gconstpointer          data,
+                                   gint                   n,
+                                   gpointer               compressed,
+                                   gint                  *compressed_size,
+                                   gint                   max_compressed_size)
+{
+  gint    bpp   = babl_format_get_bytes_per_pixel (format);
+  gint    csize = gegl_compression_shuffle_get_component_size (format);
+  guint8 *planes;
+  gint    size;
+
+  planes = gegl_scratch_alloc (bpp * GEGL_SHUFFLE_BLOCK);
+
+  size = gegl_shuffle_encode (data, n, bpp, csize,
+                              planes,
+                              compressed, max_compressed_size);
+
+  gegl_scratch_free (planes);
+
+  if (size < 0)
+    return FALSE;
+
+  *compressed_size = size;
+
+  return TRUE;
+}
+
+static gboolean
+gegl_compression_shuffle_decompress (const GeglCompression *compression,
+                                     const Babl            *format,
+                                     gpointer               data,
+                                     gint                   n,
+                                     gconstpointer          compressed,
+                                     gint                   compressed_size)
+{
+  gint     bpp   = babl_format_get_bytes_per_pixel (format);
+  gint     csize = gegl_compression_shuffle_get_component_size (format);
+  guint8  *planes;
+  gboolean success;
+
+  planes = gegl_scratch_alloc (bpp * GEGL_SHUFFLE_BLOCK);
+
+  success = gegl_shuffle_decode (compressed, compressed_size, n, bpp, csize,
+                                 planes,
+                                 data);
+
+  gegl_scratch_free (planes);
+
+  return success;
+}
+
+
+/*  public functions  */
+
+void
+gegl_compression_shuffle_init (void)
+{
+  static const GeglCompression compression_shuffle =
+  {
+    .compress   = gegl_compression_shuffle_compress,
+    .decompress = gegl_compression_shuffle_decompress
+  };
+
+  gegl_compression_register ("shuffle", &compression_shuffle);
+}
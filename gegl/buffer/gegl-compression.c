@@ -23,6 +23,7 @@
 #include "gegl-compression.h"
 #include "gegl-compression-nop.h"
 #include "gegl-compression-rle.h"
+#include "gegl-compression-shuffle.h"
 #include "gegl-compression-zlib.h"
 
 
@@ -35,6 +36,7 @@ static void gegl_compression_register_alias (const gchar *name,
 /*  local variables  */
 
 static GHashTable *algorithms;
+static GHashTable *aliases;
 
 
 /*  private functions  */
@@ -56,6 +58,8 @@ gegl_compression_register_alias (const gchar *name,
         {
           gegl_compression_register (name, compression);
 
+          g_hash_table_insert (aliases, g_strdup (name), g_strdup (algorithm));
+
           break;
         }
     }
@@ -72,13 +76,16 @@ gegl_compression_init (void)
   g_return_if_fail (algorithms == NULL);
 
   algorithms = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  aliases    = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
   gegl_compression_nop_init ();
   gegl_compression_rle_init ();
+  gegl_compression_shuffle_init ();
   gegl_compression_zlib_init ();
 
   gegl_compression_register_alias ("fast",
                                    /* in order of precedence: */
+                                   "shuffle",
                                    "rle8",
                                    "zlib1",
                                    "nop",
@@ -103,6 +110,7 @@ void
 gegl_compression_cleanup (void)
 {
   g_clear_pointer (&algorithms, g_hash_table_unref);
+  g_clear_pointer (&aliases, g_hash_table_unref);
 }
 
 void
@@ -155,6 +163,18 @@ gegl_compression (const gchar *name)
   return g_hash_table_lookup (algorithms, name);
 }
 
+const gchar *
+gegl_compression_resolve_alias (const gchar *name)
+{
+  const gchar *algorithm;
+
+  g_return_val_if_fail (name != NULL, NULL);
+
+  algorithm = g_hash_table_lookup (aliases, name);
+
+  return algorithm ? algorithm : name;
+}
+
 gboolean
 gegl_compression_compress (const GeglCompression *compression,
                            const Babl            *format,
@@ -53,6 +53,8 @@ void                     gegl_compression_register   (const gchar           *nam
 const gchar           ** gegl_compression_list       (void);
 
 const GeglCompression  * gegl_compression            (const gchar           *name);
+const gchar            * gegl_compression_resolve_alias
+                                                     (const gchar           *name);
 
 gboolean                 gegl_compression_compress   (const GeglCompression *compression,
                                                       const Babl            *format,
@@ -47,6 +47,13 @@ static void            gegl_sampler_cubic_get         (      GeglSampler* restri
                                                              GeglBufferMatrix2*     scale,
                                                              void*        restrict  output,
                                                              GeglAbyssPolicy        repeat_mode);
+static void            gegl_sampler_cubic_get_span    (      GeglSampler           *self,
+                                                       const gdouble               *coords,
+                                                             GeglBufferMatrix2     *scale,
+                                                             gint                   scale_stride,
+                                                             void                  *output,
+                                                             gint                   n,
+                                                             GeglAbyssPolicy        repeat_mode);
 static void            get_property                   (      GObject               *gobject,
                                                              guint                  prop_id,
                                                              GValue                *value,
@@ -74,6 +81,7 @@ gegl_sampler_cubic_class_init (GeglSamplerCubicClass *klass)
 
   sampler_class->get         = gegl_sampler_cubic_get;
   sampler_class->interpolate = gegl_sampler_cubic_interpolate;
+  sampler_class->get_span    = gegl_sampler_cubic_get_span;
 
   g_object_class_install_property ( object_class, PROP_B,
     g_param_spec_double ("b",
@@ -231,6 +239,38 @@ gegl_sampler_cubic_get (      GeglSampler       *self,
   }
 }
 
+static void
+gegl_sampler_cubic_span_kernel (GeglSampler  *self,
+                                const gint   *offsets,
+                                const gfloat *fx,
+                                const gfloat *fy,
+                                gfloat       *dst,
+                                gint          n)
+{
+  GeglSamplerCubic *cubic = (GeglSamplerCubic*)(self);
+
+  gegl_sample_cubic_span (self->level[0].sampler_buffer,
+                          GEGL_SAMPLER_MAXIMUM_WIDTH *
+                          self->interpolate_components,
+                          offsets, fx, fy, dst, n,
+                          self->interpolate_components,
+                          cubic->b, cubic->c);
+}
+
+static void
+gegl_sampler_cubic_get_span (      GeglSampler       *self,
+                             const gdouble           *coords,
+                                   GeglBufferMatrix2 *scale,
+                                   gint               scale_stride,
+                                   void              *output,
+                                   gint               n,
+                                   GeglAbyssPolicy    repeat_mode)
+{
+  _gegl_sampler_get_span_interpolated (self, coords, scale, scale_stride,
+                                       output, n, repeat_mode, 5, FALSE,
+                                       gegl_sampler_cubic_span_kernel);
+}
+
 static void
 get_property (GObject    *object,
               guint       prop_id,
@@ -43,6 +43,13 @@ static void          gegl_sampler_linear_get         (      GeglSampler* restric
                                                             GeglBufferMatrix2     *scale,
                                                             void*        restrict  output,
                                                             GeglAbyssPolicy        repeat_mode);
+static void          gegl_sampler_linear_get_span    (      GeglSampler*           self,
+                                                      const gdouble               *coords,
+                                                            GeglBufferMatrix2     *scale,
+                                                            gint                   scale_stride,
+                                                            void*                  output,
+                                                            gint                   n,
+                                                            GeglAbyssPolicy        repeat_mode);
 
 G_DEFINE_TYPE (GeglSamplerLinear, gegl_sampler_linear, GEGL_TYPE_SAMPLER)
 
@@ -53,6 +60,7 @@ gegl_sampler_linear_class_init (GeglSamplerLinearClass *klass)
 
   sampler_class->get         = gegl_sampler_linear_get;
   sampler_class->interpolate = gegl_sampler_linear_interpolate;
+  sampler_class->get_span    = gegl_sampler_linear_get_span;
 }
 
 /*
@@ -197,3 +205,32 @@ gegl_sampler_linear_get (      GeglSampler       *self,
     self->fish_process (self->fish, (void*)result, (void*)output, 1, NULL);
   }
 }
+
+static void
+gegl_sampler_linear_span_kernel (GeglSampler  *self,
+                                 const gint   *offsets,
+                                 const gfloat *fx,
+                                 const gfloat *fy,
+                                 gfloat       *dst,
+                                 gint          n)
+{
+  gegl_sample_linear_span (self->level[0].sampler_buffer,
+                           GEGL_SAMPLER_MAXIMUM_WIDTH *
+                           self->interpolate_components,
+                           offsets, fx, fy, dst, n,
+                           self->interpolate_components);
+}
+
+static void
+gegl_sampler_linear_get_span (      GeglSampler       *self,
+                              const gdouble           *coords,
+                                    GeglBufferMatrix2 *scale,
+                                    gint               scale_stride,
+                                    void              *output,
+                                    gint               n,
+                                    GeglAbyssPolicy    repeat_mode)
+{
+  _gegl_sampler_get_span_interpolated (self, coords, scale, scale_stride,
+                                       output, n, repeat_mode, 4, TRUE,
+                                       gegl_sampler_linear_span_kernel);
+}
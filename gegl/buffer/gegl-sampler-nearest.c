@@ -27,6 +27,7 @@
 #include "gegl-tile-storage.h"
 #include "gegl-tile-backend.h"
 #include "gegl-sampler-nearest.h"
+#include "gegl-scratch.h"
 
 enum
 {
@@ -48,6 +49,15 @@ gegl_sampler_nearest_get (GeglSampler*    restrict self,
 static void
 gegl_sampler_nearest_prepare (GeglSampler*    restrict self);
 
+static void
+gegl_sampler_nearest_get_span (GeglSampler       *self,
+                               const gdouble     *coords,
+                               GeglBufferMatrix2 *scale,
+                               gint               scale_stride,
+                               void              *output,
+                               gint               n,
+                               GeglAbyssPolicy    repeat_mode);
+
 G_DEFINE_TYPE (GeglSamplerNearest, gegl_sampler_nearest, GEGL_TYPE_SAMPLER)
 
 static void
@@ -60,6 +70,7 @@ gegl_sampler_nearest_class_init (GeglSamplerNearestClass *klass)
 
   sampler_class->get = gegl_sampler_nearest_get;
   sampler_class->prepare = gegl_sampler_nearest_prepare;
+  sampler_class->get_span = gegl_sampler_nearest_get_span;
 }
 
 /*
@@ -91,6 +102,61 @@ gegl_sampler_nearest_dispose (GObject *object)
   G_OBJECT_CLASS (gegl_sampler_nearest_parent_class)->dispose (object);
 }
 
+/* returns a pointer to the pixel at (x, y), which has to be within the
+ * abyss, in the hot tile; the buffer must be locked.
+ */
+static inline const guchar *
+gegl_sampler_nearest_get_data (GeglSampler *sampler,
+                               gint         x,
+                               gint         y)
+{
+  GeglSamplerNearest *nearest_sampler = (GeglSamplerNearest*)(sampler);
+  GeglBuffer         *buffer          = sampler->buffer;
+  gint                tile_width      = buffer->tile_width;
+  gint                tile_height     = buffer->tile_height;
+  gint                tiledy          = y + buffer->shift_y;
+  gint                tiledx          = x + buffer->shift_x;
+  gint                indice_x        = gegl_tile_indice (tiledx, tile_width);
+  gint                indice_y        = gegl_tile_indice (tiledy, tile_height);
+  GeglTile           *tile            = nearest_sampler->hot_tile;
+
+  if (!(tile &&
+        tile->x == indice_x &&
+        tile->y == indice_y))
+    {
+      g_rec_mutex_lock (&buffer->tile_storage->mutex);
+
+      if (tile)
+        {
+          gegl_tile_read_unlock (tile);
+
+          gegl_tile_unref (tile);
+        }
+
+      tile = gegl_tile_source_get_tile ((GeglTileSource *) (buffer),
+                                        indice_x, indice_y,
+                                        0);
+      nearest_sampler->hot_tile = tile;
+
+      gegl_tile_read_lock (tile);
+
+      g_rec_mutex_unlock (&buffer->tile_storage->mutex);
+    }
+
+  if (tile)
+    {
+      gint tile_origin_x = indice_x * tile_width;
+      gint tile_origin_y = indice_y * tile_height;
+      gint       offsetx = tiledx - tile_origin_x;
+      gint       offsety = tiledy - tile_origin_y;
+
+      return gegl_tile_get_data (tile) +
+             (offsety * tile_width + offsetx) * nearest_sampler->buffer_bpp;
+    }
+
+  return NULL;
+}
+
 static inline void
 gegl_sampler_get_pixel (GeglSampler    *sampler,
                         gint            x,
@@ -98,7 +164,6 @@ gegl_sampler_get_pixel (GeglSampler    *sampler,
                         gpointer        data,
                         GeglAbyssPolicy repeat_mode)
 {
-  GeglSamplerNearest *nearest_sampler = (GeglSamplerNearest*)(sampler);
   GeglBuffer *buffer = sampler->buffer;
   const GeglRectangle *abyss = &buffer->abyss;
   guchar              *buf   = data;
@@ -151,57 +216,16 @@ gegl_sampler_get_pixel (GeglSampler    *sampler,
   gegl_buffer_lock (sampler->buffer);
 
   {
-    gint tile_width  = buffer->tile_width;
-    gint tile_height = buffer->tile_height;
-    gint tiledy      = y + buffer->shift_y;
-    gint tiledx      = x + buffer->shift_x;
-    gint indice_x    = gegl_tile_indice (tiledx, tile_width);
-    gint indice_y    = gegl_tile_indice (tiledy, tile_height);
-
-    GeglTile *tile = nearest_sampler->hot_tile;
-
-    if (!(tile &&
-          tile->x == indice_x &&
-          tile->y == indice_y))
-      {
-        g_rec_mutex_lock (&buffer->tile_storage->mutex);
-
-        if (tile)
-          {
-            gegl_tile_read_unlock (tile);
-
-            gegl_tile_unref (tile);
-          }
-
-        tile = gegl_tile_source_get_tile ((GeglTileSource *) (buffer),
-                                          indice_x, indice_y,
-                                          0);
-        nearest_sampler->hot_tile = tile;
-
-        gegl_tile_read_lock (tile);
-
-        g_rec_mutex_unlock (&buffer->tile_storage->mutex);
-      }
-
-    if (tile)
-      {
-        gint tile_origin_x = indice_x * tile_width;
-        gint tile_origin_y = indice_y * tile_height;
-        gint       offsetx = tiledx - tile_origin_x;
-        gint       offsety = tiledy - tile_origin_y;
-
-        guchar *tp;
-
-        tp = gegl_tile_get_data (tile) +
-             (offsety * tile_width + offsetx) * nearest_sampler->buffer_bpp;
+    const guchar *tp = gegl_sampler_nearest_get_data (sampler, x, y);
 
-        sampler->fish_process (sampler->fish, (void*)tp, (void*)buf, 1, NULL);
-      }
+    if (tp)
+      sampler->fish_process (sampler->fish, (void*)tp, (void*)buf, 1, NULL);
   }
 
   gegl_buffer_unlock (sampler->buffer);
 }
 
+
 static void
 gegl_sampler_nearest_get (      GeglSampler*    restrict  sampler,
                           const gdouble                   absolute_x,
@@ -215,6 +239,97 @@ gegl_sampler_nearest_get (      GeglSampler*    restrict  sampler,
            output, repeat_mode);
 }
 
+static void
+gegl_sampler_nearest_get_span (GeglSampler       *sampler,
+                               const gdouble     *coords,
+                               GeglBufferMatrix2 *scale,
+                               gint               scale_stride,
+                               void              *output,
+                               gint               n,
+                               GeglAbyssPolicy    repeat_mode)
+{
+  GeglSamplerNearest  *nearest_sampler = (GeglSamplerNearest*)(sampler);
+  const GeglRectangle *abyss           = &sampler->buffer->abyss;
+  gint                 buffer_bpp      = nearest_sampler->buffer_bpp;
+  gint                 bpp             = babl_format_get_bytes_per_pixel (sampler->format);
+  guchar              *pixels;
+  guchar              *dst             = output;
+  gint                 first           = 0;
+  gint                 n_pending       = 0;
+  gboolean             locked          = FALSE;
+  gint                 i;
+
+  pixels = gegl_scratch_alloc (GEGL_SAMPLER_SPAN_CHUNK * buffer_bpp);
+
+  /* the pixels within the abyss are copied out of their tiles, and
+   * converted in one go; the rest take the per-pixel path.
+   */
+#define FLUSH()                                                         \
+  G_STMT_START {                                                        \
+    if (n_pending)                                                      \
+      {                                                                 \
+        sampler->fish_process (sampler->fish, (void *) pixels,          \
+                               (void *) (dst + first * bpp), n_pending, \
+                               NULL);                                   \
+        n_pending = 0;                                                  \
+      }                                                                 \
+  } G_STMT_END
+
+  for (i = 0; i < n; i++, coords += 2)
+    {
+      gint          x = int_floorf (coords[0]);
+      gint          y = int_floorf (coords[1]);
+      const guchar *tp;
+
+      if (y <  abyss->y ||
+          x <  abyss->x ||
+          y >= abyss->y + abyss->height ||
+          x >= abyss->x + abyss->width)
+        {
+          FLUSH ();
+
+          if (locked)
+            {
+              gegl_buffer_unlock (sampler->buffer);
+              locked = FALSE;
+            }
+
+          gegl_sampler_get_pixel (sampler, x, y, dst + i * bpp, repeat_mode);
+          continue;
+        }
+
+      if (! locked)
+        {
+          gegl_buffer_lock (sampler->buffer);
+          locked = TRUE;
+        }
+
+      tp = gegl_sampler_nearest_get_data (sampler, x, y);
+
+      if (! tp)
+        {
+          FLUSH ();
+          continue;
+        }
+
+      if (! n_pending)
+        first = i;
+
+      memcpy (pixels + n_pending * buffer_bpp, tp, buffer_bpp);
+
+      if (++n_pending == GEGL_SAMPLER_SPAN_CHUNK)
+        FLUSH ();
+    }
+
+  FLUSH ();
+
+#undef FLUSH
+
+  if (locked)
+    gegl_buffer_unlock (sampler->buffer);
+
+  gegl_scratch_free (pixels);
+}
 
 static void
 gegl_sampler_nearest_prepare (GeglSampler* restrict sampler)
@@ -73,6 +73,14 @@ static void buffer_contents_changed (GeglBuffer          *buffer,
 
 static void constructed (GObject *sampler);
 
+static void gegl_sampler_get_span_generic (GeglSampler       *self,
+                                           const gdouble     *coords,
+                                           GeglBufferMatrix2 *scale,
+                                           gint               scale_stride,
+                                           void              *output,
+                                           gint               n,
+                                           GeglAbyssPolicy    repeat_mode);
+
 static GType gegl_sampler_gtype_from_enum  (GeglSamplerType      sampler_type);
 
 G_DEFINE_TYPE (GeglSampler, gegl_sampler, G_TYPE_OBJECT)
@@ -90,6 +98,7 @@ gegl_sampler_class_init (GeglSamplerClass *klass)
   klass->get         = NULL;
   klass->interpolate = NULL;
   klass->set_buffer  = set_buffer;
+  klass->get_span    = gegl_sampler_get_span_generic;
 
   object_class->set_property = set_property;
   object_class->get_property = get_property;
@@ -147,6 +156,7 @@ constructed (GObject *self)
 
   sampler->get         = klass->get;
   sampler->interpolate = klass->interpolate;
+  sampler->get_span    = klass->get_span;
 
   if (sampler->buffer)
     {
@@ -192,6 +202,198 @@ gegl_sampler_get (GeglSampler       *self,
   self->get (self, x, y, scale, output, repeat_mode);
 }
 
+static void
+gegl_sampler_get_span_generic (GeglSampler       *self,
+                               const gdouble     *coords,
+                               GeglBufferMatrix2 *scale,
+                               gint               scale_stride,
+                               void              *output,
+                               gint               n,
+                               GeglAbyssPolicy    repeat_mode)
+{
+  gint bpp = babl_format_get_bytes_per_pixel (self->format);
+  gint i;
+
+  for (i = 0; i < n; i++)
+    {
+      self->get (self, coords[0], coords[1], scale, output, repeat_mode);
+
+      coords += 2;
+      scale  += scale_stride;
+      output  = (guchar *) output + bpp;
+    }
+}
+
+void
+_gegl_sampler_get_span_interpolated (GeglSampler           *self,
+                                     const gdouble         *coords,
+                                     GeglBufferMatrix2     *scale,
+                                     gint                   scale_stride,
+                                     void                  *output,
+                                     gint                   n,
+                                     GeglAbyssPolicy        repeat_mode,
+                                     gint                   max_n_samples,
+                                     gboolean               float_coords,
+                                     GeglSamplerSpanKernel  kernel)
+{
+  gint    bpp    = babl_format_get_bytes_per_pixel (self->format);
+  gint    nc     = self->interpolate_components;
+  gfloat *buffer = self->level[0].sampler_buffer;
+  gint    offsets[GEGL_SAMPLER_SPAN_CHUNK];
+  gfloat  fx[GEGL_SAMPLER_SPAN_CHUNK];
+  gfloat  fy[GEGL_SAMPLER_SPAN_CHUNK];
+  gfloat  result[GEGL_SAMPLER_SPAN_CHUNK * 5];
+  guchar *dst    = output;
+  gint    first  = 0;
+  gint    n_pending = 0;
+  gint    i;
+
+  /* the pending points are interpolated from the sampler buffer, so they
+   * must be flushed before anything can refetch it.
+   */
+#define FLUSH()                                                         \
+  G_STMT_START {                                                        \
+    if (n_pending)                                                      \
+      {                                                                 \
+        kernel (self, offsets, fx, fy, result, n_pending);              \
+        self->fish_process (self->fish, (void *) result,                \
+                            (void *) (dst + first * bpp), n_pending,    \
+                            NULL);                                      \
+        n_pending = 0;                                                  \
+      }                                                                 \
+  } G_STMT_END
+
+  for (i = 0; i < n; i++, coords += 2, scale += scale_stride)
+    {
+      gint    ix;
+      gint    iy;
+      gint    wx;
+      gint    wy;
+      gfloat  x;
+      gfloat  y;
+      gfloat *ptr;
+
+      if (scale && _gegl_sampler_box_needed (scale))
+        {
+          FLUSH ();
+          _gegl_sampler_box_get (self, coords[0], coords[1], scale,
+                                 dst + i * bpp, repeat_mode, max_n_samples);
+          continue;
+        }
+
+      /* the same arithmetic as the sampler's interpolate () */
+      if (float_coords)
+        {
+          const gfloat iabsolute_x = (gfloat) coords[0] - 0.5;
+          const gfloat iabsolute_y = (gfloat) coords[1] - 0.5;
+
+          ix = int_floorf (iabsolute_x);
+          iy = int_floorf (iabsolute_y);
+          x  = iabsolute_x - ix;
+          y  = iabsolute_y - iy;
+        }
+      else
+        {
+          const gdouble iabsolute_x = coords[0] - 0.5;
+          const gdouble iabsolute_y = coords[1] - 0.5;
+
+          ix = int_floorf (iabsolute_x);
+          iy = int_floorf (iabsolute_y);
+          x  = iabsolute_x - ix;
+          y  = iabsolute_y - iy;
+        }
+
+      wx = ix;
+      wy = iy;
+      _gegl_sampler_wrap (self, &wx, &wy, repeat_mode);
+
+      if (! _gegl_sampler_is_cached (self, wx, wy))
+        FLUSH ();
+
+      if (! n_pending)
+        first = i;
+
+      ptr = gegl_sampler_get_ptr (self, ix, iy, repeat_mode);
+
+      offsets[n_pending] = ptr - buffer;
+      fx[n_pending]      = x;
+      fy[n_pending]      = y;
+
+      if (++n_pending == GEGL_SAMPLER_SPAN_CHUNK)
+        FLUSH ();
+    }
+
+  FLUSH ();
+
+#undef FLUSH
+}
+
+void
+gegl_sampler_get_points (GeglSampler       *self,
+                         const gdouble     *coords,
+                         GeglBufferMatrix2 *scales,
+                         void              *output,
+                         gint               n,
+                         GeglAbyssPolicy    repeat_mode)
+{
+  if (n <= 0)
+    return;
+
+  if (G_UNLIKELY (gegl_buffer_ext_flush))
+    gegl_buffer_ext_flush (self->buffer,
+                           gegl_buffer_get_extent (self->buffer));
+
+  self->get_span (self, coords, scales, scales ? 1 : 0, output, n,
+                  repeat_mode);
+}
+
+void
+gegl_sampler_get_span (GeglSampler       *self,
+                       gdouble            x,
+                       gdouble            y,
+                       gdouble            dx,
+                       gdouble            dy,
+                       GeglBufferMatrix2 *scale,
+                       void              *output,
+                       gint               n,
+                       GeglAbyssPolicy    repeat_mode)
+{
+  gdouble coords[GEGL_SAMPLER_SPAN_CHUNK * 2];
+  gint    bpp;
+
+  if (n <= 0)
+    return;
+
+  if (G_UNLIKELY (gegl_buffer_ext_flush))
+    gegl_buffer_ext_flush (self->buffer,
+                           gegl_buffer_get_extent (self->buffer));
+
+  bpp = babl_format_get_bytes_per_pixel (self->format);
+
+  while (n > 0)
+    {
+      gint chunk = MIN (n, GEGL_SAMPLER_SPAN_CHUNK);
+      gint i;
+
+      /* accumulate, rather than multiply, so that the points match those
+       * of a loop stepping by (dx, dy)
+       */
+      for (i = 0; i < chunk; i++)
+        {
+          coords[i * 2]     = x;
+          coords[i * 2 + 1] = y;
+
+          x += dx;
+          y += dy;
+        }
+
+      self->get_span (self, coords, scale, 0, output, chunk, repeat_mode);
+
+      output  = (guchar *) output + chunk * bpp;
+      n      -= chunk;
+    }
+}
+
 void
 gegl_sampler_prepare (GeglSampler *self)
 {
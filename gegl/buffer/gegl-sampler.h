@@ -59,6 +59,24 @@ typedef void (* GeglSamplerInterpolateFun) (GeglSampler     *self,
                                             gfloat          *output,
                                             GeglAbyssPolicy  repeat_mode);
 
+/* samplers can provide a get_span() function, which samples n points in
+ * one call. coords holds n (x, y) pairs; scale is either NULL, a single
+ * matrix used for every point (scale_stride = 0), or one matrix per point
+ * (scale_stride = 1). The samples are written contiguously to output, in
+ * the sampler's output format. As with get(), the coordinates are not
+ * checked.
+ */
+typedef void (* GeglSamplerSpanFun) (GeglSampler       *self,
+                                     const gdouble     *coords,
+                                     GeglBufferMatrix2 *scale,
+                                     gint               scale_stride,
+                                     void              *output,
+                                     gint               n,
+                                     GeglAbyssPolicy    repeat_mode);
+
+/* number of points sampled in one go by the get_span() implementations */
+#define GEGL_SAMPLER_SPAN_CHUNK 128
+
 typedef struct _GeglSamplerClass GeglSamplerClass;
 
 typedef struct GeglSamplerLevel
@@ -79,6 +97,7 @@ struct _GeglSampler
 
   GeglSamplerGetFun          get;
   GeglSamplerInterpolateFun  interpolate;
+  GeglSamplerSpanFun         get_span;
 
   /*< private >*/
   GeglBuffer                *buffer;
@@ -102,6 +121,7 @@ struct _GeglSamplerClass
   GeglSamplerInterpolateFun    interpolate;
   void                      (* set_buffer) (GeglSampler *self,
                                             GeglBuffer  *buffer);
+  GeglSamplerSpanFun           get_span;
 };
 
 GType gegl_sampler_get_type    (void) G_GNUC_CONST;
@@ -125,6 +145,27 @@ gfloat * _gegl_sampler_get_ptr        (GeglSampler     *sampler,
                                        gint             y,
                                        GeglAbyssPolicy  repeat_mode);
 
+/* signature of the interpolation kernels used by
+ * _gegl_sampler_get_span_interpolated(); see gegl_sample_linear_span()
+ */
+typedef void (* GeglSamplerSpanKernel) (GeglSampler  *self,
+                                        const gint   *offsets,
+                                        const gfloat *fx,
+                                        const gfloat *fy,
+                                        gfloat       *dst,
+                                        gint          n);
+
+void     _gegl_sampler_get_span_interpolated (GeglSampler           *self,
+                                              const gdouble         *coords,
+                                              GeglBufferMatrix2     *scale,
+                                              gint                   scale_stride,
+                                              void                  *output,
+                                              gint                   n,
+                                              GeglAbyssPolicy        repeat_mode,
+                                              gint                   max_n_samples,
+                                              gboolean               float_coords,
+                                              GeglSamplerSpanKernel  kernel);
+
 static inline GeglRectangle _gegl_sampler_compute_rectangle (
                                       GeglSampler *sampler,
                                       gint         x,
@@ -180,6 +221,50 @@ static inline GeglRectangle _gegl_sampler_compute_rectangle (
 }
 
 
+static inline void
+_gegl_sampler_wrap (GeglSampler     *sampler,
+                    gint            *x,
+                    gint            *y,
+                    GeglAbyssPolicy  repeat_mode)
+{
+  GeglSamplerLevel *level = &sampler->level[0];
+
+  if (repeat_mode != GEGL_ABYSS_LOOP)
+    {
+      *x = CLAMP (*x, level->abyss_rect.x,
+                      level->abyss_rect.x + level->abyss_rect.width  - 1);
+      *y = CLAMP (*y, level->abyss_rect.y,
+                      level->abyss_rect.y + level->abyss_rect.height - 1);
+    }
+  else
+    {
+      *x = sampler->buffer->abyss.x +
+           GEGL_REMAINDER (*x - sampler->buffer->abyss.x,
+                           sampler->buffer->abyss.width);
+      *y = sampler->buffer->abyss.y +
+           GEGL_REMAINDER (*y - sampler->buffer->abyss.y,
+                           sampler->buffer->abyss.height);
+    }
+}
+
+/* whether the context of the, already wrapped, pixel is in the sampler
+ * buffer, i.e. whether gegl_sampler_get_ptr() can do without fetching.
+ */
+static inline gboolean
+_gegl_sampler_is_cached (GeglSampler *sampler,
+                         gint         x,
+                         gint         y)
+{
+  GeglSamplerLevel *level = &sampler->level[0];
+
+  return ! ((x + level->context_rect.x < level->sampler_rectangle.x)      ||
+            (y + level->context_rect.y < level->sampler_rectangle.y)      ||
+            (x + level->context_rect.x + level->context_rect.width >
+             level->sampler_rectangle.x + level->sampler_rectangle.width) ||
+            (y + level->context_rect.y + level->context_rect.height >
+             level->sampler_rectangle.y + level->sampler_rectangle.height));
+}
+
 /*
  * Gets a pointer to the center pixel, within a buffer that has a
  * rowstride of GEGL_SAMPLER_MAXIMUM_WIDTH * 16 (16 is the bpp of RaGaBaA
@@ -200,29 +285,9 @@ gegl_sampler_get_ptr (GeglSampler    *sampler,
 
   GeglSamplerLevel *level = &sampler->level[0];
 
-  if (repeat_mode != GEGL_ABYSS_LOOP)
-    {
-      x = CLAMP (x, level->abyss_rect.x,
-                    level->abyss_rect.x + level->abyss_rect.width  - 1);
-      y = CLAMP (y, level->abyss_rect.y,
-                    level->abyss_rect.y + level->abyss_rect.height - 1);
-    }
-  else
-    {
-      x = sampler->buffer->abyss.x +
-          GEGL_REMAINDER (x - sampler->buffer->abyss.x,
-                          sampler->buffer->abyss.width);
-      y = sampler->buffer->abyss.y +
-          GEGL_REMAINDER (y - sampler->buffer->abyss.y,
-                          sampler->buffer->abyss.height);
-    }
+  _gegl_sampler_wrap (sampler, &x, &y, repeat_mode);
 
-  if ((x + level->context_rect.x < level->sampler_rectangle.x)      ||
-      (y + level->context_rect.y < level->sampler_rectangle.y)      ||
-      (x + level->context_rect.x + level->context_rect.width >
-       level->sampler_rectangle.x + level->sampler_rectangle.width) ||
-      (y + level->context_rect.y + level->context_rect.height >
-       level->sampler_rectangle.y + level->sampler_rectangle.height))
+  if (! _gegl_sampler_is_cached (sampler, x, y))
     {
       level->sampler_rectangle =
          _gegl_sampler_compute_rectangle (sampler, x, y, 0);
@@ -257,6 +322,18 @@ gegl_sampler_get_ptr (GeglSampler    *sampler,
 
 #include <stdio.h>
 
+/* whether scale is large enough for _gegl_sampler_box_get() to box filter */
+static inline gboolean
+_gegl_sampler_box_needed (const GeglBufferMatrix2 *scale)
+{
+  const gdouble u_norm2 = scale->coeff[0][0] * scale->coeff[0][0] +
+                          scale->coeff[1][0] * scale->coeff[1][0];
+  const gdouble v_norm2 = scale->coeff[0][1] * scale->coeff[0][1] +
+                          scale->coeff[1][1] * scale->coeff[1][1];
+
+  return u_norm2 >= 4.0 || v_norm2 >= 4.0;
+}
+
 static inline gboolean
 _gegl_sampler_box_get (GeglSampler*    restrict  self,
                        const gdouble             absolute_x,
@@ -274,7 +351,7 @@ _gegl_sampler_box_get (GeglSampler*    restrict  self,
       const gdouble v_norm2 = scale->coeff[0][1] * scale->coeff[0][1] +
                               scale->coeff[1][1] * scale->coeff[1][1];
 
-      if (u_norm2 >= 4.0 || v_norm2 >= 4.0)
+      if (_gegl_sampler_box_needed (scale))
         {
           gfloat  result[channels];
           gdouble uv_samples_inv;
@@ -197,6 +197,7 @@ gegl_tile_backend_buffer_command (GeglTileSource  *tile_source,
                                                        TRUE);
 
     case GEGL_TILE_EXIST:
+    case GEGL_TILE_PREFETCH:
       return gegl_tile_backend_buffer_forward_command (tile_backend_buffer,
                                                        command, x, y, z, data,
                                                        FALSE);
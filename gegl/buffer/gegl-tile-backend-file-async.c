@@ -63,6 +63,11 @@
 #include "gegl-buffer-types.h"
 #include "gegl-debug.h"
 #include "gegl-buffer-config.h"
+#include "gegl-buffer-private.h"
+#include "gegl-compression.h"
+#include "gegl-memory-private.h"
+#include "gegl-scratch.h"
+#include "gegl-tile.h"
 
 
 #ifndef HAVE_FSYNC
@@ -123,14 +128,13 @@ struct _GeglTileBackendFile
   gint             in_offset;
   gint             out_offset;
 
-  /* current offset, used when writing the index */
-  gint             offset;
-
-  /* when writing buffer blocks the writer keeps one block unwritten
-   * at all times to be able to keep track of the ->next offsets in
-   * the blocks.
+  /* the file mapped into memory, for reading tiles without copying them.
+   * tiles whose data points into the mapping hold a reference to it.
    */
-  GeglFileBackendEntry *in_holding;
+  GMappedFile     *mapped;
+
+  /* the compression of the compressed tiles of the file */
+  const GeglCompression *compression;
 
   /* loading buffer */
   GList           *tiles;
@@ -155,8 +159,6 @@ struct _GeglTileBackendFile
 
 
 static void     gegl_tile_backend_file_ensure_exist (GeglTileBackendFile  *self);
-static gboolean gegl_tile_backend_file_write_block  (GeglTileBackendFile  *self,
-                                                     GeglFileBackendEntry *block);
 static void     gegl_tile_backend_file_dbg_alloc    (int                   size);
 static void     gegl_tile_backend_file_dbg_dealloc  (int                   size);
 
@@ -202,14 +204,9 @@ gegl_tile_backend_file_push_queue (GeglFileBackendThreadParams *params)
 
   if (params->entry)
     {
-      if (params->operation == OP_WRITE)
-        {
-          params->entry->tile_link = g_queue_peek_tail_link (&queue);
-          queue_size += params->length + sizeof (GList) +
-            sizeof (GeglFileBackendThreadParams);
-        }
-      else /* OP_WRITE_BLOCK */
-        params->entry->block_link = g_queue_peek_tail_link (&queue);
+      params->entry->tile_link = g_queue_peek_tail_link (&queue);
+      queue_size += params->length + sizeof (GList) +
+        sizeof (GeglFileBackendThreadParams);
     }
 
   /* wake up the writer thread */
@@ -272,10 +269,7 @@ gegl_tile_backend_file_writer_thread (gpointer ignored)
       if (params->entry)
         {
           in_progress = params;
-          if (params->operation == OP_WRITE)
-            params->entry->tile_link = NULL;
-          else /* OP_WRITE_BLOCK */
-            params->entry->block_link = NULL;
+          params->entry->tile_link = NULL;
         }
       g_mutex_unlock (&mutex);
 
@@ -284,9 +278,6 @@ gegl_tile_backend_file_writer_thread (gpointer ignored)
         case OP_WRITE:
           gegl_tile_backend_file_write (params);
           break;
-        case OP_WRITE_BLOCK:
-          gegl_tile_backend_file_write (params);
-          break;
         case OP_TRUNCATE:
           if (ftruncate (params->file->o, params->length) != 0)
             g_warning ("failed to resize file: %s", g_strerror (errno));
@@ -323,14 +314,82 @@ gegl_tile_backend_file_writer_thread (gpointer ignored)
   return NULL;
 }
 
+/* returns whether a write of the entry's data is pending */
+static gboolean
+gegl_tile_backend_file_entry_is_queued (GeglFileBackendEntry *entry)
+{
+  gboolean queued = FALSE;
+
+  if (entry->tile_link || in_progress)
+    {
+      g_mutex_lock (&mutex);
+
+      queued = entry->tile_link ||
+               (in_progress && in_progress->entry == entry);
+
+      g_mutex_unlock (&mutex);
+    }
+
+  return queued;
+}
+
+/* returns the stored data of the entry inside the file mapping, or NULL if
+ * it's not mapped.
+ */
+static const guchar *
+gegl_tile_backend_file_entry_get_mapped_data (GeglTileBackendFile  *self,
+                                              GeglFileBackendEntry *entry)
+{
+  gint size = entry->tile->size;
+
+  if (! size)
+    size = gegl_tile_backend_get_tile_size (GEGL_TILE_BACKEND (self));
+
+  if (self->mapped &&
+      entry->tile->offset + size <= g_mapped_file_get_length (self->mapped))
+    {
+      return (const guchar *) g_mapped_file_get_contents (self->mapped) +
+             entry->tile->offset;
+    }
+
+  return NULL;
+}
+
+static void
+gegl_tile_backend_file_entry_decompress (GeglTileBackendFile  *self,
+                                         GeglFileBackendEntry *entry,
+                                         const guchar         *src,
+                                         guchar               *dest)
+{
+  GeglTileBackend *backend   = GEGL_TILE_BACKEND (self);
+  gint             tile_size = gegl_tile_backend_get_tile_size (backend);
+
+  if (! self->compression ||
+      ! gegl_compression_decompress (self->compression,
+                                     backend->priv->format,
+                                     dest,
+                                     tile_size / backend->priv->px_size,
+                                     src,
+                                     entry->tile->size))
+    {
+      g_warning ("unable to decompress tile %i,%i,%i",
+                 entry->tile->x, entry->tile->y, entry->tile->z);
+
+      memset (dest, 0, tile_size);
+    }
+}
+
 static void
 gegl_tile_backend_file_entry_read (GeglTileBackendFile  *self,
                                    GeglFileBackendEntry *entry,
                                    guchar               *dest)
 {
-  gint    tile_size  = gegl_tile_backend_get_tile_size (GEGL_TILE_BACKEND (self));
-  gint    to_be_read = tile_size;
-  goffset offset     = entry->tile->offset;
+  gint          tile_size  = gegl_tile_backend_get_tile_size (GEGL_TILE_BACKEND (self));
+  gint          size       = entry->tile->size ? entry->tile->size : tile_size;
+  gint          to_be_read = size;
+  goffset       offset     = entry->tile->offset;
+  const guchar *mapped_data;
+  guchar       *buf;
 
   gegl_tile_backend_file_ensure_exist (self);
 
@@ -347,7 +406,7 @@ gegl_tile_backend_file_entry_read (GeglTileBackendFile  *self,
 
       if (queued_op)
         {
-          memcpy (dest, queued_op->source, to_be_read);
+          memcpy (dest, queued_op->source, tile_size);
           g_mutex_unlock (&mutex);
 
           GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "read entry %i,%i,%i from queue", entry->tile->x, entry->tile->y, entry->tile->z);
@@ -358,6 +417,20 @@ gegl_tile_backend_file_entry_read (GeglTileBackendFile  *self,
       g_mutex_unlock (&mutex);
     }
 
+  mapped_data = gegl_tile_backend_file_entry_get_mapped_data (self, entry);
+
+  if (mapped_data)
+    {
+      if (entry->tile->size)
+        gegl_tile_backend_file_entry_decompress (self, entry, mapped_data, dest);
+      else
+        memcpy (dest, mapped_data, tile_size);
+
+      GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "read entry %i,%i,%i from mapping at %i", entry->tile->x, entry->tile->y, entry->tile->z, (gint)offset);
+
+      return;
+    }
+
   if (self->in_offset != offset)
     {
       if (lseek (self->i, offset, SEEK_SET) < 0)
@@ -368,23 +441,40 @@ gegl_tile_backend_file_entry_read (GeglTileBackendFile  *self,
       self->in_offset = offset;
     }
 
+  /* compressed tiles are read into a scratch buffer first */
+  if (entry->tile->size)
+    buf = gegl_scratch_alloc (size);
+  else
+    buf = dest;
+
   while (to_be_read > 0)
     {
       GError *error = NULL;
       gint    byte_read;
 
-      byte_read = read (self->i, dest + tile_size - to_be_read, to_be_read);
+      byte_read = read (self->i, buf + size - to_be_read, to_be_read);
       if (byte_read <= 0)
         {
           g_message ("unable to read tile data from self: "
                      "%s (%d/%d bytes read) %s",
                      g_strerror (errno), byte_read, to_be_read, error?error->message:"--");
+
+          if (buf != dest)
+            gegl_scratch_free (buf);
+
           return;
         }
       to_be_read      -= byte_read;
       self->in_offset += byte_read;
     }
 
+  if (buf != dest)
+    {
+      gegl_tile_backend_file_entry_decompress (self, entry, buf, dest);
+
+      gegl_scratch_free (buf);
+    }
+
   GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "read entry %i,%i,%i at %i", entry->tile->x, entry->tile->y, entry->tile->z, (gint)offset);
 }
 
@@ -440,37 +530,33 @@ gegl_tile_backend_file_file_entry_create (gint x,
 {
   GeglFileBackendEntry *entry = g_new0 (GeglFileBackendEntry, 1);
 
-  entry->tile       = gegl_tile_entry_new (x, y, z);
-  entry->tile_link  = NULL;
-  entry->block_link = NULL;
+  entry->tile      = gegl_tile_entry_new (x, y, z);
+  entry->tile_link = NULL;
+  entry->mapped    = FALSE;
 
   return entry;
 }
 
-static inline GeglFileBackendEntry *
-gegl_tile_backend_file_file_entry_new (GeglTileBackendFile *self)
+static guint64
+gegl_tile_backend_file_alloc_slot (GeglTileBackendFile *self)
 {
-  GeglFileBackendEntry *entry = gegl_tile_backend_file_file_entry_create (0,0,0);
-
-  GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "Creating new entry");
-
-  gegl_tile_backend_file_ensure_exist (self);
+  guint64 offset;
 
   if (self->free_list)
     {
-      guint64 offset = *(guint64*)self->free_list->data;
+      offset = *(guint64*)self->free_list->data;
 
-      entry->tile->offset = offset;
-      self->free_list = g_slist_remove (self->free_list, self->free_list->data);
+      g_free (self->free_list->data);
+      self->free_list = g_slist_delete_link (self->free_list, self->free_list);
 
-      GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "  set offset %i from free list", ((gint)entry->tile->offset));
+      GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "  set offset %i from free list", ((gint)offset));
     }
   else
     {
       gint tile_size = gegl_tile_backend_get_tile_size (GEGL_TILE_BACKEND (self));
 
-      entry->tile->offset = self->next_pre_alloc;
-      GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "  set offset %i (next allocation)", (gint)entry->tile->offset);
+      offset = self->next_pre_alloc;
+      GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "  set offset %i (next allocation)", (gint)offset);
       self->next_pre_alloc += tile_size;
 
       if (self->next_pre_alloc >= self->total) /* automatic growing ensuring that
@@ -491,6 +577,21 @@ gegl_tile_backend_file_file_entry_new (GeglTileBackendFile *self)
           self->in_offset = self->out_offset = -1;
         }
     }
+
+  return offset;
+}
+
+static inline GeglFileBackendEntry *
+gegl_tile_backend_file_file_entry_new (GeglTileBackendFile *self)
+{
+  GeglFileBackendEntry *entry = gegl_tile_backend_file_file_entry_create (0,0,0);
+
+  GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "Creating new entry");
+
+  gegl_tile_backend_file_ensure_exist (self);
+
+  entry->tile->offset = gegl_tile_backend_file_alloc_slot (self);
+
   gegl_tile_backend_file_dbg_alloc (gegl_tile_backend_get_tile_size (GEGL_TILE_BACKEND (self)));
   return entry;
 }
@@ -499,34 +600,34 @@ static void
 gegl_tile_backend_file_file_entry_destroy (GeglTileBackendFile  *self,
                                            GeglFileBackendEntry *entry)
 {
-  guint64 *offset = g_new (guint64, 1);
-  *offset = entry->tile->offset;
-
-  if (entry->tile_link || entry->block_link)
+  if (entry->tile_link)
     {
-      gint   i;
-      GList *link;
-
       g_mutex_lock (&mutex);
 
-      for (i = 0, link = entry->tile_link;
-           i < 2;
-           i++, link = entry->block_link)
+      if (entry->tile_link)
         {
-          if (link)
-            {
-              GeglFileBackendThreadParams *queued_op = link->data;
-              queued_op->file->pending_ops -= 1;
-              g_queue_delete_link (&queue, link);
-              g_free (queued_op->source);
-              g_free (queued_op);
-            }
+          GeglFileBackendThreadParams *queued_op = entry->tile_link->data;
+          queued_op->file->pending_ops -= 1;
+          g_queue_delete_link (&queue, entry->tile_link);
+          g_free (queued_op->source);
+          g_free (queued_op);
         }
 
       g_mutex_unlock (&mutex);
     }
 
-  self->free_list = g_slist_prepend (self->free_list, offset);
+  /* slots whose data is handed out from the file mapping can't be reused,
+   * and neither can the slots of compressed tiles, which are smaller than a
+   * tile.
+   */
+  if (! entry->mapped && ! entry->tile->size)
+    {
+      guint64 *offset = g_new (guint64, 1);
+      *offset = entry->tile->offset;
+
+      self->free_list = g_slist_prepend (self->free_list, offset);
+    }
+
   g_hash_table_remove (self->index, entry);
 
   gegl_tile_backend_file_dbg_dealloc (gegl_tile_backend_get_tile_size (GEGL_TILE_BACKEND (self)));
@@ -570,89 +671,6 @@ gegl_tile_backend_file_write_header (GeglTileBackendFile *self)
   return TRUE;
 }
 
-static gboolean
-gegl_tile_backend_file_write_block (GeglTileBackendFile  *self,
-                                    GeglFileBackendEntry *item)
-{
-  gegl_tile_backend_file_ensure_exist (self);
-  if (self->in_holding)
-    {
-      GeglFileBackendThreadParams *params;
-      GeglBufferBlock *block           = &(self->in_holding->tile->block);
-      guint64          next_allocation = self->offset + block->length;
-      gint             length          = block->length;
-      guchar          *new_source;
-
-      /* update the next offset pointer in the previous block */
-      if (item == NULL)
-          /* the previous block was the last block */
-          block->next = 0;
-      else
-          block->next = next_allocation;
-
-      /* XXX: should promiscuosuly try to compress here as well,. if revisions
-              are not matching..
-       */
-
-      if (self->in_holding->block_link)
-        {
-          g_mutex_lock (&mutex);
-
-          if (self->in_holding->block_link)
-            {
-              params = self->in_holding->block_link->data;
-              params->offset = self->offset;
-              memcpy (params->source, block, length);
-              g_mutex_unlock (&mutex);
-
-              self->offset = next_allocation;
-              self->in_holding = item;
-              GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "Overwrote queue block: length:%i flags:%i next:%i at offset %i",
-                         block->length,
-                         block->flags,
-                         (gint)block->next,
-                         (gint)self->offset);
-              return TRUE;
-            }
-
-          g_mutex_unlock (&mutex);
-        }
-
-      params     = g_new0 (GeglFileBackendThreadParams, 1);
-      new_source = g_malloc (length);
-
-      memcpy (new_source, block, length);
-
-      params->operation = OP_WRITE_BLOCK;
-      params->length    = length;
-      params->file      = self;
-      params->offset    = self->offset;
-      params->source    = new_source;
-      params->entry     = self->in_holding;
-
-      gegl_tile_backend_file_push_queue (params);
-
-      GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "Pushed write of block: length:%i flags:%i next:%i at offset %i",
-                 block->length,
-                 block->flags,
-                 (gint)block->next,
-                 (gint)self->offset);
-
-      self->offset = next_allocation;
-    }
-  else
-    {
-      /* we're setting up for the first write */
-      self->offset = self->next_pre_alloc; /* start writing header at end
-                                            * of file, worry about writing
-                                            * header inside free list later
-                                            */
-    }
-  self->in_holding = item;
-
-  return TRUE;
-}
-
 void
 gegl_tile_backend_file_stats (void)
 {
@@ -718,11 +736,40 @@ gegl_tile_backend_file_get_tile (GeglTileSource *self,
     return NULL;
 
   tile_size = gegl_tile_backend_get_tile_size (GEGL_TILE_BACKEND (self));
-  tile      = gegl_tile_new (tile_size);
+
+  /* uncompressed tiles inside the file mapping are used as is, and only
+   * copied once they're written to.
+   */
+  if (! entry->tile->size &&
+      entry->tile->offset % GEGL_ALIGNMENT == 0 &&
+      ! gegl_tile_backend_file_entry_is_queued (entry))
+    {
+      const guchar *data;
+
+      data = gegl_tile_backend_file_entry_get_mapped_data (tile_backend_file,
+                                                           entry);
+
+      if (data)
+        {
+          tile = gegl_tile_new_read_only (
+            data, tile_size,
+            (GDestroyNotify) g_mapped_file_unref,
+            g_mapped_file_ref (tile_backend_file->mapped));
+
+          entry->mapped = TRUE;
+        }
+    }
+
+  if (! tile)
+    {
+      tile = gegl_tile_new (tile_size);
+
+      gegl_tile_backend_file_entry_read (tile_backend_file, entry, gegl_tile_get_data (tile));
+    }
+
   gegl_tile_set_rev (tile, entry->tile->rev);
   gegl_tile_mark_as_stored (tile);
 
-  gegl_tile_backend_file_entry_read (tile_backend_file, entry, gegl_tile_get_data (tile));
   return tile;
 }
 
@@ -749,6 +796,16 @@ gegl_tile_backend_file_set_tile (GeglTileSource *self,
       entry->tile->z = z;
       g_hash_table_insert (tile_backend_file->index, entry, entry);
     }
+  else if (entry->mapped || entry->tile->size)
+    {
+      /* the stored data is either in use through the file mapping, or
+       * compressed, and can't be overwritten in place; move the tile to a new
+       * slot.
+       */
+      entry->tile->offset = gegl_tile_backend_file_alloc_slot (tile_backend_file);
+      entry->tile->size   = 0;
+      entry->mapped       = FALSE;
+    }
   entry->tile->rev = gegl_tile_get_rev (tile);
 
   gegl_tile_backend_file_entry_write (tile_backend_file, entry, gegl_tile_get_data (tile));
@@ -806,7 +863,7 @@ gegl_tile_backend_file_flush (GeglTileSource *source,
 {
   GeglTileBackend     *backend;
   GeglTileBackendFile *self;
-  GList               *tiles;
+  guint                n_entries;
 
   backend  = GEGL_TILE_BACKEND (source);
   self     = GEGL_TILE_BACKEND_FILE (backend);
@@ -815,25 +872,91 @@ gegl_tile_backend_file_flush (GeglTileSource *source,
 
   GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "flushing %s", self->path);
 
+  n_entries = g_hash_table_size (self->index);
+
+  /* the index is written in the revision of the file, so that it stays
+   * readable by whatever wrote it.
+   */
   self->header.rev ++;
   self->header.next = self->next_pre_alloc; /* this is the offset
                                                we start handing
                                                out headers from*/
-  tiles = g_hash_table_get_keys (self->index);
 
-  if (tiles == NULL)
+  if (gegl_buffer_header_get_rev (&self->header) >= 1)
+    self->header.n_entries = n_entries;
+
+  if (n_entries == 0)
     self->header.next = 0;
   else
     {
-      GList *iter;
-      for (iter = tiles; iter; iter = iter->next)
+      GeglFileBackendThreadParams *params;
+      GHashTableIter               iter;
+      gpointer                     key;
+      guint                        i = 0;
+
+      params = g_new0 (GeglFileBackendThreadParams, 1);
+
+      g_hash_table_iter_init (&iter, self->index);
+
+      if (gegl_buffer_header_get_rev (&self->header) >= 1)
         {
-          GeglFileBackendEntry *item = iter->data;
+          GeglBufferIndexEntry *entries;
+          gint                  tile_size;
+
+          tile_size = gegl_tile_backend_get_tile_size (backend);
+          entries   = g_new0 (GeglBufferIndexEntry, n_entries);
+
+          while (g_hash_table_iter_next (&iter, &key, NULL))
+            {
+              const GeglBufferTile *tile = ((GeglFileBackendEntry *) key)->tile;
 
-          gegl_tile_backend_file_write_block (self, item);
+              entries[i].offset = tile->offset;
+              entries[i].x      = tile->x;
+              entries[i].y      = tile->y;
+              entries[i].z      = tile->z;
+              entries[i].rev    = tile->rev;
+              entries[i].size   = tile->size ? tile->size : tile_size;
+
+              i++;
+            }
+
+          params->source = (guchar *) entries;
+          params->length = n_entries * sizeof (GeglBufferIndexEntry);
         }
-      gegl_tile_backend_file_write_block (self, NULL); /* terminate the index */
-      g_list_free (tiles);
+      else
+        {
+          /* revision 0 files link the blocks of the index; they're laid out
+           * one after the other.
+           */
+          guchar *blocks = g_malloc0 (n_entries * GEGL_BUFFER_TILE_REV0_LENGTH);
+
+          while (g_hash_table_iter_next (&iter, &key, NULL))
+            {
+              GeglBufferTile block = *((GeglFileBackendEntry *) key)->tile;
+
+              block.block.length = GEGL_BUFFER_TILE_REV0_LENGTH;
+              block.block.next   = i + 1 < n_entries ?
+                                   self->header.next +
+                                   (i + 1) * GEGL_BUFFER_TILE_REV0_LENGTH : 0;
+
+              memcpy (blocks + i * GEGL_BUFFER_TILE_REV0_LENGTH,
+                      &block, GEGL_BUFFER_TILE_REV0_LENGTH);
+
+              i++;
+            }
+
+          params->source = blocks;
+          params->length = n_entries * GEGL_BUFFER_TILE_REV0_LENGTH;
+        }
+
+      params->operation = OP_WRITE;
+      params->offset    = self->header.next;
+      params->file      = self;
+
+      gegl_tile_backend_file_push_queue (params);
+
+      GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "pushed index write of %i entries at %i",
+                 n_entries, (gint)self->header.next);
     }
 
   gegl_tile_backend_file_write_header (self);
@@ -983,6 +1106,9 @@ gegl_tile_backend_file_finalize (GObject *object)
   if (self->free_list)
     gegl_tile_backend_file_free_free_list (self);
 
+  if (self->mapped)
+    g_mapped_file_unref (self->mapped);
+
   if (self->path)
     {
       if (gegl_buffer_swap_has_file (self->path))
@@ -1081,11 +1207,18 @@ gegl_tile_backend_file_load_index (GeglTileBackendFile *self,
       GEGL_NOTE(GEGL_DEBUG_TILE_BACKEND, "loading index: %s", self->path);
     }
 
-  tile_size       = gegl_tile_backend_get_tile_size (GEGL_TILE_BACKEND (self));
-  offset          = self->header.next;
-  self->tiles     = gegl_buffer_read_index (self->i, &offset);
-  self->in_offset = self->out_offset = -1;
-  backend         = GEGL_TILE_BACKEND (self);
+  tile_size         = gegl_tile_backend_get_tile_size (GEGL_TILE_BACKEND (self));
+  self->tiles       = gegl_buffer_read_tile_index (self->i, &self->header);
+  self->compression = gegl_buffer_header_get_compression (&self->header);
+  self->in_offset   = self->out_offset = -1;
+  backend           = GEGL_TILE_BACKEND (self);
+
+  /* map the file anew, tiles handed out from the previous mapping keep it
+   * alive as long as they need it.
+   */
+  if (self->mapped)
+    g_mapped_file_unref (self->mapped);
+  self->mapped = g_mapped_file_new (self->path, FALSE, NULL);
 
   for (iter = self->tiles; iter; iter=iter->next)
     {
@@ -1094,8 +1227,8 @@ gegl_tile_backend_file_load_index (GeglTileBackendFile *self,
       GeglFileBackendEntry *existing =
         gegl_tile_backend_file_lookup_entry (self, item->tile.x, item->tile.y, item->tile.z);
 
-      if (item->tile.offset > max)
-        max = item->tile.offset + tile_size;
+      if (item->tile.offset + (item->tile.size ? item->tile.size : tile_size) > max)
+        max = item->tile.offset + (item->tile.size ? item->tile.size : tile_size);
 
       if (existing)
         {
@@ -1137,6 +1270,11 @@ gegl_tile_backend_file_load_index (GeglTileBackendFile *self,
     }
   g_list_free (self->tiles);
   gegl_tile_backend_file_free_free_list (self);
+
+  /* keep newly allocated tiles aligned, following compressed tiles */
+  max = (max + GEGL_BUFFER_TILE_ALIGNMENT - 1) /
+        GEGL_BUFFER_TILE_ALIGNMENT * GEGL_BUFFER_TILE_ALIGNMENT;
+
   self->next_pre_alloc = max; /* if bigger than own? */
   self->total          = max;
   self->tiles          = NULL;
@@ -42,7 +42,6 @@ typedef struct _GeglTileBackendFileClass GeglTileBackendFileClass;
 typedef enum
 {
   OP_WRITE,
-  OP_WRITE_BLOCK,
   OP_TRUNCATE,
   OP_SYNC
 } GeglFileBackendThreadOp;
@@ -50,10 +49,12 @@ typedef enum
 typedef struct
 {
   GeglBufferTile *tile;
-  /* reference to the writer queue links of this entry when writing
-     tile data or a GeglBufferBlock*/
+  /* reference to the writer queue link of this entry when writing
+     tile data */
   GList          *tile_link;
-  GList          *block_link;
+  /* whether the tile data has been handed out from the file mapping, in
+     which case it may not be overwritten */
+  gboolean        mapped;
 } GeglFileBackendEntry;
 
 typedef struct
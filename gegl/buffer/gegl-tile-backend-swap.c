@@ -32,7 +32,11 @@
 #define ftruncate _chsize_s
 #endif
 #include <string.h>
+#include <stdlib.h>
 #include <errno.h>
+#ifdef HAVE_PWRITEV
+#include <sys/uio.h>
+#endif
 
 #include <glib-object.h>
 #include <glib/gprintf.h>
@@ -51,6 +55,7 @@
 #include "gegl-tile-handler-empty.h"
 #include "gegl-debug.h"
 #include "gegl-buffer-config.h"
+#include "gegl-trace.h"
 
 
 #ifndef HAVE_FSYNC
@@ -79,6 +84,26 @@
  */
 #define COMPRESSION_MAX_RATIO 0.95
 
+/* maximal number of queued ops the writer thread handles as a single batch.
+ * the tiles of a batch are compressed in parallel, and tiles that end up
+ * adjacent in the swap file are written using a single vectored write.
+ */
+#define WRITE_BATCH_MAX 64
+
+/* maximal number of dedicated compression threads.  the writer thread itself
+ * takes part in compressing each batch as well.
+ */
+#define COMPRESSION_THREADS_MAX 8
+
+/* interval over which the write throughput is measured, in microseconds */
+#define WRITE_THROUGHPUT_INTERVAL 1000000
+
+/* maximal number of tiles that can be pending for, or held after, prefetching
+ * at any given time.  when the limit is reached, the oldest prefetched tiles
+ * that haven't been claimed are dropped.
+ */
+#define PREFETCH_MAX 128
+
 
 G_DEFINE_TYPE (GeglTileBackendSwap, gegl_tile_backend_swap, GEGL_TYPE_TILE_BACKEND)
 
@@ -117,8 +142,33 @@ typedef struct
   gint        size;
   gint        compressed_size;
   ThreadOp    operation;
+
+  /* the data to be written, filled in by the writer thread */
+  gconstpointer write_data;
+  gint          write_size;
+  gpointer      write_buffer;
 } ThreadParams;
 
+typedef enum
+{
+  PREFETCH_PENDING,
+  PREFETCH_READING,
+  PREFETCH_DONE
+} PrefetchState;
+
+typedef struct
+{
+  SwapBlock             *block;
+  gint64                 offset;
+  gint                   size;
+  const GeglCompression *compression;
+  const Babl            *format;
+  gint                   tile_size;
+  GeglTile              *tile;
+  PrefetchState          state;
+  gboolean               cancelled;
+} PrefetchParams;
+
 typedef struct _SwapGap
 {
   gint64           start;
@@ -151,9 +201,25 @@ static void        gegl_tile_backend_swap_free_block             (SwapBlock
 static gint        gegl_tile_backend_swap_get_data_size          (ThreadParams              *params);
 static gint        gegl_tile_backend_swap_get_data_cost          (ThreadParams              *params);
 static void        gegl_tile_backend_swap_free_data              (ThreadParams              *params);
-static void        gegl_tile_backend_swap_write                  (ThreadParams              *params);
+static void        gegl_tile_backend_swap_prepare_write          (ThreadParams              *params);
+static void        gegl_tile_backend_swap_compress_batch         (ThreadParams             **batch,
+                                                                  gint                       n_ops);
+static gboolean    gegl_tile_backend_swap_write_run              (ThreadParams             **run,
+                                                                  gint                       n_ops);
+static void        gegl_tile_backend_swap_write_batch            (ThreadParams             **batch,
+                                                                  gint                       n_ops);
 static void        gegl_tile_backend_swap_destroy                (ThreadParams              *params);
+static gpointer    gegl_tile_backend_swap_compression_thread     (gpointer ignored);
 static gpointer    gegl_tile_backend_swap_writer_thread          (gpointer ignored);
+static GeglTile   *gegl_tile_backend_swap_block_read             (gint64                     offset,
+                                                                  gint                       size,
+                                                                  const GeglCompression     *block_compression,
+                                                                  const Babl                *format,
+                                                                  gint                       tile_size);
+static void        gegl_tile_backend_swap_prefetch_free          (PrefetchParams            *params);
+static void        gegl_tile_backend_swap_prefetch_cancel        (SwapBlock                 *block);
+static GeglTile   *gegl_tile_backend_swap_prefetch_take          (SwapBlock                 *block);
+static gpointer    gegl_tile_backend_swap_reader_thread          (gpointer ignored);
 static GeglTile   *gegl_tile_backend_swap_entry_read             (GeglTileBackendSwap       *self,
                                                                   SwapEntry                 *entry);
 static void        gegl_tile_backend_swap_entry_write            (GeglTileBackendSwap       *self,
@@ -193,6 +259,10 @@ static gpointer    gegl_tile_backend_swap_void_tile              (GeglTileSource
                                                                   gint                       x,
                                                                   gint                       y,
                                                                   gint                       z);
+static gpointer    gegl_tile_backend_swap_prefetch_tile          (GeglTileSource            *self,
+                                                                  gint                       x,
+                                                                  gint                       y,
+                                                                  gint                       z);
 static gpointer    gegl_tile_backend_swap_exist_tile             (GeglTileSource            *self,
                                                                   GeglTile                  *tile,
                                                                   gint                       x,
@@ -228,7 +298,9 @@ static const GeglCompression *compression        = NULL;
 static gint                   in_fd              = -1;
 static gint                   out_fd             = -1;
 static gint64                 in_offset          = 0;
+#ifndef HAVE_PWRITEV
 static gint64                 out_offset         = 0;
+#endif
 static SwapGap               *gap_list           = NULL;
 static GTree                 *gap_tree           = NULL;
 static gint64                 file_size          = 0;
@@ -239,6 +311,9 @@ static gboolean               reading            = FALSE;
 static gint64                 read_total         = 0;
 static gboolean               writing            = FALSE;
 static gint64                 write_total        = 0;
+static gint64                 write_window_start = 0;
+static gint64                 write_window_total = 0;
+static guint64                write_throughput   = 0;
 static gint64                 queued_total       = 0;
 static gint64                 queued_cost        = 0;
 static gint64                 queued_max         = 0;
@@ -246,15 +321,37 @@ static gint                   queue_stalls       = 0;
 
 static GThread      *writer_thread           = NULL;
 static GQueue       *queue                   = NULL;
-static ThreadParams *in_progress             = NULL;
+static ThreadParams *in_progress[WRITE_BATCH_MAX];
+static gint          n_in_progress           = 0;
 static gboolean      exit_thread             = FALSE;
-static gpointer      compression_buffer      = NULL;
-static gint          compression_buffer_size = 0;
 static GMutex        read_mutex;
 static GMutex        queue_mutex;
 static GCond         queue_cond;
 static GCond         push_cond;
 
+static GThread      *compression_threads[COMPRESSION_THREADS_MAX];
+static gint          n_compression_threads   = 0;
+static ThreadParams **compression_batch      = NULL;
+static gint          compression_batch_size  = 0;
+static gint          compression_batch_next  = 0;
+static gint          compression_batch_left  = 0;
+static gint          compression_active      = 0;
+static gint          compression_serial      = 0;
+static gboolean      exit_compression        = FALSE;
+static GMutex        compression_mutex;
+static GCond         compression_cond;
+static GCond         compression_done_cond;
+
+static GThread      *reader_thread           = NULL;
+static GQueue       *prefetch_queue          = NULL; /* pending prefetches */
+static GQueue       *prefetch_done           = NULL; /* unclaimed prefetched tiles */
+static GHashTable   *prefetch_table          = NULL; /* block -> PrefetchParams */
+static gint          n_prefetched            = 0;    /* size of prefetch_table */
+static gboolean      exit_reader             = FALSE;
+static GMutex        prefetch_mutex;
+static GCond         prefetch_cond;
+static GCond         prefetch_done_cond;
+
 
 static void
 gegl_tile_backend_swap_push_queue (ThreadParams *params,
@@ -561,18 +658,12 @@ gegl_tile_backend_swap_free_data (ThreadParams *params)
 }
 
 static void
-gegl_tile_backend_swap_write (ThreadParams *params)
+gegl_tile_backend_swap_prepare_write (ThreadParams *params)
 {
-  const guint8 *data;
-  gint64        offset = params->block->offset;
-  gint          to_be_written;
-
-  gegl_tile_backend_swap_ensure_exist ();
-
   if (params->tile)
     {
-      data          = gegl_tile_get_data (params->tile);
-      to_be_written = params->size;
+      params->write_data = gegl_tile_get_data (params->tile);
+      params->write_size = params->size;
 
       if (params->block->compression)
         {
@@ -580,103 +671,344 @@ gegl_tile_backend_swap_write (ThreadParams *params)
           gint compressed_size;
           gint max_compressed_size;
 
-          max_compressed_size = params->size * COMPRESSION_MAX_RATIO;
-
-          if (max_compressed_size > compression_buffer_size)
-            {
-              compression_buffer      = g_realloc (compression_buffer,
-                                                   max_compressed_size);
-              compression_buffer_size = max_compressed_size;
-            }
+          max_compressed_size  = params->size * COMPRESSION_MAX_RATIO;
+          params->write_buffer = gegl_tile_alloc (max_compressed_size);
 
           if (gegl_compression_compress (params->block->compression,
                                          params->format,
-                                         data, params->size / bpp,
-                                         compression_buffer, &compressed_size,
+                                         params->write_data,
+                                         params->size / bpp,
+                                         params->write_buffer,
+                                         &compressed_size,
                                          max_compressed_size))
             {
-              data          = compression_buffer;
-              to_be_written = compressed_size;
+              params->write_data = params->write_buffer;
+              params->write_size = compressed_size;
             }
           else
             {
               params->block->compression = NULL;
+
+              g_clear_pointer (&params->write_buffer, gegl_tile_free);
             }
         }
     }
   else
     {
-      data          = params->compressed;
-      to_be_written = params->compressed_size;
+      params->write_data = params->compressed;
+      params->write_size = params->compressed_size;
     }
+}
+
+static void
+gegl_tile_backend_swap_compress_batch_ops (void)
+{
+  gint i;
+
+  while ((i = g_atomic_int_add (&compression_batch_next, 1)) <
+         compression_batch_size)
+    {
+      gegl_tile_backend_swap_prepare_write (compression_batch[i]);
 
-  if (offset >= 0 && params->block->size != to_be_written)
+      g_atomic_int_add (&compression_batch_left, -1);
+    }
+}
+
+static gpointer
+gegl_tile_backend_swap_compression_thread (gpointer ignored)
+{
+  gint serial = 0;
+
+  g_mutex_lock (&compression_mutex);
+
+  while (TRUE)
     {
-      g_atomic_pointer_add (&total_uncompressed, -params->size);
+      while (serial == compression_serial && ! exit_compression)
+        g_cond_wait (&compression_cond, &compression_mutex);
 
-      gegl_tile_backend_swap_free_block (params->block);
+      if (exit_compression)
+        break;
+
+      serial = compression_serial;
+
+      compression_active++;
+
+      g_mutex_unlock (&compression_mutex);
 
-      offset = -1;
+      gegl_tile_backend_swap_compress_batch_ops ();
+
+      g_mutex_lock (&compression_mutex);
+
+      if (! --compression_active)
+        g_cond_signal (&compression_done_cond);
     }
 
-  if (offset < 0)
+  g_mutex_unlock (&compression_mutex);
+
+  return NULL;
+}
+
+/* prepares the data of the write ops in batch for writing, compressing the
+ * tiles using the compression threads, if there's more than a single op to
+ * compress.
+ */
+static void
+gegl_tile_backend_swap_compress_batch (ThreadParams **batch,
+                                       gint           n_ops)
+{
+  gint n_compressed = 0;
+  gint i;
+
+  for (i = 0; i < n_ops; i++)
     {
-      /* storage for entry not allocated yet.  allocate now. */
-      offset = gegl_tile_backend_swap_find_offset (to_be_written);
+      if (batch[i]->tile && batch[i]->block->compression)
+        n_compressed++;
+    }
 
-      params->block->offset = offset;
-      params->block->size   = to_be_written;
+  if (n_compressed < 2 || n_compression_threads == 0)
+    {
+      for (i = 0; i < n_ops; i++)
+        gegl_tile_backend_swap_prepare_write (batch[i]);
 
-      g_atomic_pointer_add (&total_uncompressed, +params->size);
+      return;
     }
 
-  writing = TRUE;
+  g_mutex_lock (&compression_mutex);
+
+  /* a compression thread might still be on its way out of the previous
+   * batch; let it leave before resetting the batch state.
+   */
+  while (compression_active > 0)
+    g_cond_wait (&compression_done_cond, &compression_mutex);
+
+  compression_batch      = batch;
+  compression_batch_size = n_ops;
+  g_atomic_int_set (&compression_batch_next, 0);
+  g_atomic_int_set (&compression_batch_left, n_ops);
+
+  compression_serial++;
+  g_cond_broadcast (&compression_cond);
+
+  g_mutex_unlock (&compression_mutex);
 
-  if (out_offset != offset)
+  gegl_tile_backend_swap_compress_batch_ops ();
+
+  g_mutex_lock (&compression_mutex);
+
+  /* wait for the compression threads to finish the remaining ops, and to
+   * leave the batch, so that none of them touches the next one.
+   */
+  while (g_atomic_int_get (&compression_batch_left) > 0 ||
+         compression_active > 0)
     {
-      if (lseek (out_fd, offset, SEEK_SET) < 0)
-        {
-          g_warning ("unable to seek to tile in buffer: %s", g_strerror (errno));
+      g_cond_wait (&compression_done_cond, &compression_mutex);
+    }
+
+  compression_batch      = NULL;
+  compression_batch_size = 0;
 
-          goto error;
+  g_mutex_unlock (&compression_mutex);
+}
+
+static void
+gegl_tile_backend_swap_update_write_throughput (gint64 wrote)
+{
+  gint64 time = g_get_monotonic_time ();
+
+  write_total        += wrote;
+  write_window_total += wrote;
+
+  if (time - write_window_start >= WRITE_THROUGHPUT_INTERVAL)
+    {
+      if (write_window_start)
+        {
+          write_throughput = write_window_total * G_USEC_PER_SEC /
+                             (time - write_window_start);
         }
-      out_offset = offset;
+
+      write_window_start = time;
+      write_window_total = 0;
     }
+}
 
-  while (to_be_written > 0)
+/* writes the data of the ops in run, which must occupy consecutive blocks in
+ * the swap, starting at the offset of the first op.
+ */
+static gboolean
+gegl_tile_backend_swap_write_run (ThreadParams **run,
+                                  gint           n_ops)
+{
+#ifdef HAVE_PWRITEV
+  struct iovec iov[WRITE_BATCH_MAX];
+  gint64       offset = run[0]->block->offset;
+  gint         first  = 0;
+  gint         i;
+
+  for (i = 0; i < n_ops; i++)
     {
-      gint wrote;
-      wrote = write (out_fd, data, to_be_written);
+      iov[i].iov_base = (gpointer) run[i]->write_data;
+      iov[i].iov_len  = run[i]->write_size;
+    }
+
+  while (first < n_ops)
+    {
+      gssize wrote;
+
+      wrote = pwritev (out_fd, iov + first, n_ops - first, offset);
       if (wrote <= 0)
         {
           g_message ("unable to write tile data to self: "
-                     "%s (%d/%d bytes written)",
-                     g_strerror (errno), wrote, to_be_written);
+                     "%s (%d bytes written)",
+                     g_strerror (errno), (gint) wrote);
 
-          goto error;
+          return FALSE;
         }
 
-      data          += wrote;
-      to_be_written -= wrote;
-      out_offset    += wrote;
+      offset += wrote;
+
+      gegl_tile_backend_swap_update_write_throughput (wrote);
 
-      write_total   += wrote;
+      while (first < n_ops && wrote >= (gssize) iov[first].iov_len)
+        {
+          wrote -= iov[first].iov_len;
+          first++;
+        }
+
+      if (first < n_ops)
+        {
+          iov[first].iov_base  = (guint8 *) iov[first].iov_base + wrote;
+          iov[first].iov_len  -= wrote;
+        }
     }
+#else
+  gint i;
 
-  writing = FALSE;
+  for (i = 0; i < n_ops; i++)
+    {
+      const guint8 *data          = run[i]->write_data;
+      gint64        offset        = run[i]->block->offset;
+      gint          to_be_written = run[i]->write_size;
 
-  GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "writer thread wrote at %i", (gint)offset);
+      if (out_offset != offset)
+        {
+          if (lseek (out_fd, offset, SEEK_SET) < 0)
+            {
+              g_warning ("unable to seek to tile in buffer: %s", g_strerror (errno));
 
-  return;
+              out_offset = -1;
 
-error:
-  writing = FALSE;
+              return FALSE;
+            }
+          out_offset = offset;
+        }
 
-  g_atomic_pointer_add (&total_uncompressed, -params->size);
+      while (to_be_written > 0)
+        {
+          gint wrote;
+          wrote = write (out_fd, data, to_be_written);
+          if (wrote <= 0)
+            {
+              g_message ("unable to write tile data to self: "
+                         "%s (%d/%d bytes written)",
+                         g_strerror (errno), wrote, to_be_written);
 
-  gegl_tile_backend_swap_free_block (params->block);
+              out_offset = -1;
+
+              return FALSE;
+            }
 
-  return;
+          data          += wrote;
+          to_be_written -= wrote;
+          out_offset    += wrote;
+
+          gegl_tile_backend_swap_update_write_throughput (wrote);
+        }
+    }
+#endif
+
+  return TRUE;
+}
+
+static gint
+gegl_tile_backend_swap_write_compare (ThreadParams **params1,
+                                      ThreadParams **params2)
+{
+  gint64 offset1 = (*params1)->block->offset;
+  gint64 offset2 = (*params2)->block->offset;
+
+  return (offset1 > offset2) - (offset1 < offset2);
+}
+
+static void
+gegl_tile_backend_swap_write_batch (ThreadParams **batch,
+                                    gint           n_ops)
+{
+  gint i;
+  gint j;
+
+  gegl_tile_backend_swap_ensure_exist ();
+
+  gegl_tile_backend_swap_compress_batch (batch, n_ops);
+
+  for (i = 0; i < n_ops; i++)
+    {
+      ThreadParams *params = batch[i];
+
+      if (params->block->offset >= 0 &&
+          params->block->size != params->write_size)
+        {
+          g_atomic_pointer_add (&total_uncompressed, -params->size);
+
+          gegl_tile_backend_swap_free_block (params->block);
+        }
+
+      if (params->block->offset < 0)
+        {
+          /* storage for entry not allocated yet.  allocate now. */
+          params->block->offset = gegl_tile_backend_swap_find_offset (
+            params->write_size);
+          params->block->size   = params->write_size;
+
+          g_atomic_pointer_add (&total_uncompressed, +params->size);
+        }
+    }
+
+  /* sort the ops by offset, and write each run of adjacent blocks at once */
+  qsort (batch, n_ops, sizeof (ThreadParams *),
+         (GCompareFunc) gegl_tile_backend_swap_write_compare);
+
+  writing = TRUE;
+
+  for (i = 0; i < n_ops; i = j)
+    {
+      for (j = i + 1; j < n_ops; j++)
+        {
+          if (batch[j - 1]->block->offset + batch[j - 1]->write_size !=
+              batch[j]->block->offset)
+            {
+              break;
+            }
+        }
+
+      if (! gegl_tile_backend_swap_write_run (batch + i, j - i))
+        {
+          gint k;
+
+          for (k = i; k < j; k++)
+            {
+              g_atomic_pointer_add (&total_uncompressed, -batch[k]->size);
+
+              gegl_tile_backend_swap_free_block (batch[k]->block);
+            }
+
+          continue;
+        }
+
+      GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "writer thread wrote %i tiles at %i",
+                 j - i, (gint) batch[i]->block->offset);
+    }
+
+  writing = FALSE;
 }
 
 static void
@@ -697,7 +1029,9 @@ gegl_tile_backend_swap_writer_thread (gpointer ignored)
 
   while (TRUE)
     {
-      ThreadParams *params;
+      ThreadParams *writes[WRITE_BATCH_MAX];
+      gint          n_writes = 0;
+      gint          i;
 
       while (g_queue_is_empty (queue) && !exit_thread)
         {
@@ -709,32 +1043,56 @@ gegl_tile_backend_swap_writer_thread (gpointer ignored)
       if (exit_thread)
         break;
 
-      params = (ThreadParams *)g_queue_pop_head (queue);
-      if (params->block)
+      /* pop a batch of ops off the queue.  the ops remain visible to readers
+       * through in_progress until they're done.
+       */
+      while (n_in_progress < WRITE_BATCH_MAX && ! g_queue_is_empty (queue))
         {
-          in_progress = params;
+          ThreadParams *params = (ThreadParams *) g_queue_pop_head (queue);
+
           params->block->link = NULL;
+
+          in_progress[n_in_progress++] = params;
         }
 
       g_mutex_unlock (&queue_mutex);
 
-      switch (params->operation)
+      /* destroy ops are pushed to the head of the queue, and are performed
+       * first, so that the write ops are free to reuse the reclaimed space.
+       */
+      for (i = 0; i < n_in_progress; i++)
         {
-        case OP_WRITE:
-          gegl_tile_backend_swap_write (params);
-          break;
-        case OP_DESTROY:
-          gegl_tile_backend_swap_destroy (params);
-          break;
+          ThreadParams *params = in_progress[i];
+
+          switch (params->operation)
+            {
+            case OP_WRITE:
+              writes[n_writes++] = params;
+              break;
+            case OP_DESTROY:
+              gegl_tile_backend_swap_destroy (params);
+              break;
+            }
         }
 
+      if (n_writes > 0)
+        gegl_tile_backend_swap_write_batch (writes, n_writes);
+
       g_mutex_lock (&queue_mutex);
 
-      in_progress = NULL;
+      for (i = 0; i < n_in_progress; i++)
+        {
+          ThreadParams *params = in_progress[i];
 
-      gegl_tile_backend_swap_free_data (params);
+          gegl_tile_backend_swap_free_data (params);
 
-      g_slice_free (ThreadParams, params);
+          if (params->write_buffer)
+            gegl_tile_free (params->write_buffer);
+
+          g_slice_free (ThreadParams, params);
+        }
+
+      n_in_progress = 0;
     }
 
   g_mutex_unlock (&queue_mutex);
@@ -742,6 +1100,243 @@ gegl_tile_backend_swap_writer_thread (gpointer ignored)
   return NULL;
 }
 
+/* reads the size bytes of tile data stored at offset in the swap file into a
+ * new tile, decompressing it using block_compression, if not NULL.
+ */
+static GeglTile *
+gegl_tile_backend_swap_block_read (gint64                 offset,
+                                   gint                   size,
+                                   const GeglCompression *block_compression,
+                                   const Babl            *format,
+                                   gint                   tile_size)
+{
+  GeglTile *tile;
+  guint8   *data;
+  guint8   *dest;
+  gint      bpp;
+  gint      to_be_read;
+
+  bpp = babl_format_get_bytes_per_pixel (format);
+
+  tile = gegl_tile_new (tile_size);
+  dest = gegl_tile_get_data (tile);
+  gegl_tile_mark_as_stored (tile);
+
+  if (block_compression)
+    data = gegl_scratch_alloc (size);
+  else
+    data = dest;
+
+  g_mutex_lock (&read_mutex);
+
+  reading = TRUE;
+
+  if (in_offset != offset)
+    {
+      if (lseek (in_fd, offset, SEEK_SET) < 0)
+        {
+          reading = FALSE;
+
+          g_mutex_unlock (&read_mutex);
+
+          if (block_compression)
+            gegl_scratch_free (data);
+
+          g_warning ("unable to seek to tile in buffer: %s", g_strerror (errno));
+          return tile;
+        }
+      in_offset = offset;
+    }
+
+  to_be_read = size;
+
+  while (to_be_read > 0)
+    {
+      GError *error = NULL;
+      gint    bytes_read;
+
+      bytes_read = read (in_fd, data + size - to_be_read, to_be_read);
+
+      if (bytes_read <= 0)
+        {
+          reading = FALSE;
+
+          g_mutex_unlock (&read_mutex);
+
+          if (block_compression)
+            gegl_scratch_free (data);
+
+          g_message ("unable to read tile data from swap: "
+                     "%s (%d/%d bytes read) %s",
+                     g_strerror (errno), bytes_read, to_be_read, error?error->message:"--");
+          return tile;
+        }
+
+      to_be_read -= bytes_read;
+      in_offset  += bytes_read;
+
+      read_total += bytes_read;
+    }
+
+  reading = FALSE;
+
+  g_mutex_unlock (&read_mutex);
+
+  if (block_compression)
+    {
+      if (! gegl_compression_decompress (
+              block_compression, format,
+              dest, tile_size / bpp,
+              data, size))
+        {
+          g_warning ("failed to decompress tile");
+        }
+
+      gegl_scratch_free (data);
+    }
+
+  return tile;
+}
+
+static void
+gegl_tile_backend_swap_prefetch_free (PrefetchParams *params)
+{
+  if (params->tile)
+    gegl_tile_unref (params->tile);
+
+  g_slice_free (PrefetchParams, params);
+}
+
+/* drops the prefetched data of block, if any.  must be called, with
+ * queue_mutex held, whenever the data of a block changes, or when the block
+ * is destroyed.
+ */
+static void
+gegl_tile_backend_swap_prefetch_cancel (SwapBlock *block)
+{
+  PrefetchParams *params;
+
+  g_mutex_lock (&prefetch_mutex);
+
+  params = g_hash_table_lookup (prefetch_table, block);
+
+  if (params)
+    {
+      g_hash_table_remove (prefetch_table, block);
+      g_atomic_int_add (&n_prefetched, -1);
+
+      switch (params->state)
+        {
+        case PREFETCH_PENDING:
+          g_queue_remove (prefetch_queue, params);
+          gegl_tile_backend_swap_prefetch_free (params);
+          break;
+
+        case PREFETCH_READING:
+          /* the reader thread frees the params when it's done */
+          params->cancelled = TRUE;
+          break;
+
+        case PREFETCH_DONE:
+          g_queue_remove (prefetch_done, params);
+          gegl_tile_backend_swap_prefetch_free (params);
+          break;
+        }
+    }
+
+  g_mutex_unlock (&prefetch_mutex);
+}
+
+/* claims the prefetched tile of block.  if the tile is currently being read
+ * by the reader thread, waits for it to finish, instead of reading the same
+ * data again.  returns NULL if the block hasn't been prefetched.
+ */
+static GeglTile *
+gegl_tile_backend_swap_prefetch_take (SwapBlock *block)
+{
+  PrefetchParams *params;
+  GeglTile       *tile = NULL;
+
+  g_mutex_lock (&prefetch_mutex);
+
+  params = g_hash_table_lookup (prefetch_table, block);
+
+  if (params)
+    {
+      while (params->state == PREFETCH_READING)
+        g_cond_wait (&prefetch_done_cond, &prefetch_mutex);
+
+      g_hash_table_remove (prefetch_table, block);
+      g_atomic_int_add (&n_prefetched, -1);
+
+      if (params->state == PREFETCH_PENDING)
+        {
+          /* the read hasn't started yet; the caller can just as well do it
+           * itself.
+           */
+          g_queue_remove (prefetch_queue, params);
+        }
+      else
+        {
+          g_queue_remove (prefetch_done, params);
+
+          tile         = params->tile;
+          params->tile = NULL;
+        }
+
+      gegl_tile_backend_swap_prefetch_free (params);
+    }
+
+  g_mutex_unlock (&prefetch_mutex);
+
+  return tile;
+}
+
+static gpointer
+gegl_tile_backend_swap_reader_thread (gpointer ignored)
+{
+  g_mutex_lock (&prefetch_mutex);
+
+  while (TRUE)
+    {
+      PrefetchParams *params;
+      GeglTile       *tile;
+
+      while (g_queue_is_empty (prefetch_queue) && ! exit_reader)
+        g_cond_wait (&prefetch_cond, &prefetch_mutex);
+
+      if (exit_reader)
+        break;
+
+      params        = g_queue_pop_head (prefetch_queue);
+      params->state = PREFETCH_READING;
+
+      g_mutex_unlock (&prefetch_mutex);
+
+      tile = gegl_tile_backend_swap_block_read (params->offset,
+                                                params->size,
+                                                params->compression,
+                                                params->format,
+                                                params->tile_size);
+
+      g_mutex_lock (&prefetch_mutex);
+
+      params->tile  = tile;
+      params->state = PREFETCH_DONE;
+
+      if (params->cancelled)
+        gegl_tile_backend_swap_prefetch_free (params);
+      else
+        g_queue_push_tail (prefetch_done, params);
+
+      g_cond_broadcast (&prefetch_done_cond);
+    }
+
+  g_mutex_unlock (&prefetch_mutex);
+  GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "exiting reader thread");
+  return NULL;
+}
+
 static GeglTile *
 gegl_tile_backend_swap_entry_read (GeglTileBackendSwap *self,
                                    SwapEntry           *entry)
@@ -749,12 +1344,10 @@ gegl_tile_backend_swap_entry_read (GeglTileBackendSwap *self,
   GeglTileBackend *backend = GEGL_TILE_BACKEND (self);
   const Babl      *format;
   GeglTile        *tile;
-  guint8          *data;
   guint8          *dest;
   gint64           offset;
   gint             tile_size;
   gint             bpp;
-  gint             to_be_read;
 
   format    = gegl_tile_backend_get_format (backend);
   tile_size = gegl_tile_backend_get_tile_size (backend);
@@ -771,14 +1364,28 @@ gegl_tile_backend_swap_entry_read (GeglTileBackendSwap *self,
 
   g_mutex_lock (&queue_mutex);
 
-  if (entry->block->link || in_progress)
+  if (entry->block->link || n_in_progress)
     {
       ThreadParams *queued_op = NULL;
 
       if (entry->block->link)
-        queued_op = entry->block->link->data;
-      else if (in_progress->block == entry->block)
-        queued_op = in_progress;
+        {
+          queued_op = entry->block->link->data;
+        }
+      else
+        {
+          gint i;
+
+          for (i = 0; i < n_in_progress; i++)
+            {
+              if (in_progress[i]->block     == entry->block &&
+                  in_progress[i]->operation == OP_WRITE)
+                {
+                  queued_op = in_progress[i];
+                  break;
+                }
+            }
+        }
 
       if (queued_op)
         {
@@ -814,86 +1421,35 @@ gegl_tile_backend_swap_entry_read (GeglTileBackendSwap *self,
 
   g_mutex_unlock (&queue_mutex);
 
-  if (offset < 0 || in_fd < 0)
+  /* the tile might have been read ahead of time by the reader thread.  we
+   * check n_prefetched first, so that we don't contend on prefetch_mutex
+   * while nothing is being prefetched.
+   */
+  if (g_atomic_int_get (&n_prefetched) > 0)
     {
-      g_warning ("no swap storage allocated for tile");
-      return NULL;
-    }
+      tile = gegl_tile_backend_swap_prefetch_take (entry->block);
 
-  tile = gegl_tile_new (tile_size);
-  dest = gegl_tile_get_data (tile);
-  gegl_tile_mark_as_stored (tile);
-
-  if (entry->block->compression)
-    data = gegl_scratch_alloc (entry->block->size);
-  else
-    data = dest;
-
-  g_mutex_lock (&read_mutex);
-
-  reading = TRUE;
-
-  if (in_offset != offset)
-    {
-      if (lseek (in_fd, offset, SEEK_SET) < 0)
+      if (tile)
         {
-          reading = FALSE;
+          GEGL_TRACE_COUNT (SWAP_READS, 1);
 
-          g_mutex_unlock (&read_mutex);
+          GEGL_NOTE(GEGL_DEBUG_TILE_BACKEND, "read entry %i, %i, %i from prefetch", entry->x, entry->y, entry->z);
 
-          g_warning ("unable to seek to tile in buffer: %s", g_strerror (errno));
           return tile;
         }
-      in_offset = offset;
     }
 
-  to_be_read = entry->block->size;
-
-  while (to_be_read > 0)
+  if (offset < 0 || in_fd < 0)
     {
-      GError *error = NULL;
-      gint    bytes_read;
-
-      bytes_read = read (in_fd,
-                         data + entry->block->size - to_be_read, to_be_read);
-
-      if (bytes_read <= 0)
-        {
-          reading = FALSE;
-
-          g_mutex_unlock (&read_mutex);
-
-          if (entry->block->compression)
-            gegl_scratch_free (data);
-
-          g_message ("unable to read tile data from swap: "
-                     "%s (%d/%d bytes read) %s",
-                     g_strerror (errno), bytes_read, to_be_read, error?error->message:"--");
-          return tile;
-        }
-
-      to_be_read -= bytes_read;
-      in_offset  += bytes_read;
-
-      read_total += bytes_read;
+      g_warning ("no swap storage allocated for tile");
+      return NULL;
     }
 
-  reading = FALSE;
+  tile = gegl_tile_backend_swap_block_read (offset, entry->block->size,
+                                            entry->block->compression,
+                                            format, tile_size);
 
-  g_mutex_unlock (&read_mutex);
-
-  if (entry->block->compression)
-    {
-      if (! gegl_compression_decompress (
-              entry->block->compression, format,
-              dest, tile_size / bpp,
-              data, entry->block->size))
-        {
-          g_warning ("failed to decompress tile");
-        }
-
-      gegl_scratch_free (data);
-    }
+  GEGL_TRACE_COUNT (SWAP_READS, 1);
 
   GEGL_NOTE(GEGL_DEBUG_TILE_BACKEND, "read entry %i, %i, %i from %i", entry->x, entry->y, entry->z, (gint)offset);
 
@@ -917,6 +1473,12 @@ gegl_tile_backend_swap_entry_write (GeglTileBackendSwap *self,
 
   g_mutex_lock (&queue_mutex);
 
+  /* prefetches are registered under queue_mutex, so checking n_prefetched
+   * while holding it can't miss one of this block.
+   */
+  if (g_atomic_int_get (&n_prefetched) > 0)
+    gegl_tile_backend_swap_prefetch_cancel (entry->block);
+
   if (entry->block->link)
     {
       params = entry->block->link->data;
@@ -1006,6 +1568,9 @@ gegl_tile_backend_swap_block_unref (SwapBlock *block,
       if (lock)
         g_mutex_lock (&queue_mutex);
 
+      if (g_atomic_int_get (&n_prefetched) > 0)
+        gegl_tile_backend_swap_prefetch_cancel (block);
+
       if (block->link)
         {
           GList        *link      = block->link;
@@ -1215,6 +1780,109 @@ gegl_tile_backend_swap_void_tile (GeglTileSource *self,
   return NULL;
 }
 
+static gpointer
+gegl_tile_backend_swap_prefetch_tile (GeglTileSource *self,
+                                      gint            x,
+                                      gint            y,
+                                      gint            z)
+{
+  GeglTileBackendSwap *swap;
+  SwapEntry           *entry;
+  SwapBlock           *block;
+  PrefetchParams      *params;
+  gint                 i;
+
+  swap  = GEGL_TILE_BACKEND_SWAP (self);
+  entry = gegl_tile_backend_swap_lookup_entry (swap, x, y, z);
+
+  if (! entry || entry->block == gegl_tile_backend_swap_empty_block ())
+    return NULL;
+
+  block = entry->block;
+
+  g_mutex_lock (&queue_mutex);
+
+  /* if the tile is still queued for writing, it's read from memory anyway */
+  if (block->link)
+    {
+      g_mutex_unlock (&queue_mutex);
+
+      return NULL;
+    }
+
+  for (i = 0; i < n_in_progress; i++)
+    {
+      if (in_progress[i]->block == block)
+        {
+          g_mutex_unlock (&queue_mutex);
+
+          return NULL;
+        }
+    }
+
+  if (block->offset < 0 || in_fd < 0)
+    {
+      g_mutex_unlock (&queue_mutex);
+
+      return NULL;
+    }
+
+  /* the prefetch is registered while still holding queue_mutex, under which
+   * writes and destruction of the block cancel its prefetch, so that the
+   * block can't change between taking its location and registering it.
+   */
+  g_mutex_lock (&prefetch_mutex);
+
+  if (g_hash_table_contains (prefetch_table, block))
+    {
+      g_mutex_unlock (&prefetch_mutex);
+      g_mutex_unlock (&queue_mutex);
+
+      return GINT_TO_POINTER (TRUE);
+    }
+
+  /* make room by dropping the oldest unclaimed tile */
+  if (g_hash_table_size (prefetch_table) >= PREFETCH_MAX)
+    {
+      params = g_queue_pop_head (prefetch_done);
+
+      if (! params)
+        {
+          g_mutex_unlock (&prefetch_mutex);
+          g_mutex_unlock (&queue_mutex);
+
+          return NULL;
+        }
+
+      g_hash_table_remove (prefetch_table, params->block);
+      g_atomic_int_add (&n_prefetched, -1);
+      gegl_tile_backend_swap_prefetch_free (params);
+    }
+
+  params = g_slice_new0 (PrefetchParams);
+
+  params->block       = block;
+  params->offset      = block->offset;
+  params->size        = block->size;
+  params->compression = block->compression;
+  params->format      = gegl_tile_backend_get_format (GEGL_TILE_BACKEND (swap));
+  params->tile_size   = gegl_tile_backend_get_tile_size (GEGL_TILE_BACKEND (swap));
+  params->state       = PREFETCH_PENDING;
+
+  g_hash_table_insert (prefetch_table, block, params);
+  g_atomic_int_inc (&n_prefetched);
+  g_queue_push_tail (prefetch_queue, params);
+
+  g_cond_signal (&prefetch_cond);
+
+  g_mutex_unlock (&prefetch_mutex);
+  g_mutex_unlock (&queue_mutex);
+
+  GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "prefetching entry %i, %i, %i from %i", x, y, z, (gint) params->offset);
+
+  return GINT_TO_POINTER (TRUE);
+}
+
 static gpointer
 gegl_tile_backend_swap_exist_tile (GeglTileSource *self,
                                    GeglTile       *tile,
@@ -1318,6 +1986,8 @@ gegl_tile_backend_swap_command (GeglTileSource  *self,
         return NULL;
       case GEGL_TILE_COPY:
         return gegl_tile_backend_swap_copy_tile (self, x, y, z, data);
+      case GEGL_TILE_PREFETCH:
+        return gegl_tile_backend_swap_prefetch_tile (self, x, y, z);
 
       default:
         break;
@@ -1483,6 +2153,7 @@ static void
 gegl_tile_backend_swap_class_init (GeglTileBackendSwapClass *klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  gint          i;
 
   parent_class = g_type_class_peek_parent (klass);
 
@@ -1496,6 +2167,24 @@ gegl_tile_backend_swap_class_init (GeglTileBackendSwapClass *klass)
                                 gegl_tile_backend_swap_writer_thread,
                                 NULL);
 
+  n_compression_threads = CLAMP (g_get_num_processors () / 2 - 1,
+                                 0, COMPRESSION_THREADS_MAX);
+
+  for (i = 0; i < n_compression_threads; i++)
+    {
+      compression_threads[i] = g_thread_new (
+        "swap compression",
+        gegl_tile_backend_swap_compression_thread,
+        NULL);
+    }
+
+  prefetch_queue = g_queue_new ();
+  prefetch_done  = g_queue_new ();
+  prefetch_table = g_hash_table_new (NULL, NULL);
+  reader_thread  = g_thread_new ("swap reader",
+                                 gegl_tile_backend_swap_reader_thread,
+                                 NULL);
+
   g_signal_connect (gegl_buffer_config (), "notify::swap-compression",
                     G_CALLBACK (gegl_tile_backend_swap_compression_notify),
                     NULL);
@@ -1514,6 +2203,8 @@ gegl_tile_backend_swap_class_init (GeglTileBackendSwapClass *klass)
 void
 gegl_tile_backend_swap_cleanup (void)
 {
+  gint i;
+
   if (! writer_thread)
     return;
 
@@ -1527,6 +2218,24 @@ gegl_tile_backend_swap_cleanup (void)
     gegl_tile_backend_swap_compression_notify,
     NULL);
 
+  g_mutex_lock (&prefetch_mutex);
+  exit_reader = TRUE;
+  g_cond_signal (&prefetch_cond);
+  g_mutex_unlock (&prefetch_mutex);
+  g_thread_join (reader_thread);
+  reader_thread = NULL;
+
+  g_queue_free_full (prefetch_queue,
+                     (GDestroyNotify) gegl_tile_backend_swap_prefetch_free);
+  prefetch_queue = NULL;
+
+  g_queue_free_full (prefetch_done,
+                     (GDestroyNotify) gegl_tile_backend_swap_prefetch_free);
+  prefetch_done = NULL;
+
+  g_clear_pointer (&prefetch_table, g_hash_table_unref);
+  n_prefetched = 0;
+
   g_mutex_lock (&queue_mutex);
   exit_thread = TRUE;
   g_cond_signal (&queue_cond);
@@ -1534,15 +2243,21 @@ gegl_tile_backend_swap_cleanup (void)
   g_thread_join (writer_thread);
   writer_thread = NULL;
 
+  g_mutex_lock (&compression_mutex);
+  exit_compression = TRUE;
+  g_cond_broadcast (&compression_cond);
+  g_mutex_unlock (&compression_mutex);
+
+  for (i = 0; i < n_compression_threads; i++)
+    g_thread_join (compression_threads[i]);
+  n_compression_threads = 0;
+
   if (g_queue_get_length (queue) != 0)
     g_warning ("tile-backend-swap writer queue wasn't empty before freeing\n");
 
   g_queue_free (queue);
   queue = NULL;
 
-  g_clear_pointer (&compression_buffer, g_free);
-  compression_buffer_size = 0;
-
   g_tree_unref (gap_tree);
   gap_tree = NULL;
 
@@ -1667,6 +2382,19 @@ gegl_tile_backend_swap_get_write_total (void)
   return write_total;
 }
 
+guint64
+gegl_tile_backend_swap_get_write_throughput (void)
+{
+  /* the writer has been idle throughout the last measurement interval */
+  if (g_get_monotonic_time () - write_window_start >
+      2 * WRITE_THROUGHPUT_INTERVAL)
+    {
+      return 0;
+    }
+
+  return write_throughput;
+}
+
 void
 gegl_tile_backend_swap_reset_stats (void)
 {
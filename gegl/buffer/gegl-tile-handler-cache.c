@@ -18,16 +18,22 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib.h>
 #include <glib-object.h>
 
 #include "gegl-buffer-config.h"
 #include "gegl-buffer.h"
 #include "gegl-buffer-private.h"
+#include "gegl-compression.h"
+#include "gegl-scratch.h"
 #include "gegl-tile.h"
+#include "gegl-tile-backend-swap.h"
 #include "gegl-tile-handler-cache.h"
 #include "gegl-tile-storage.h"
 #include "gegl-debug.h"
+#include "gegl-trace.h"
 
 /*
 #define GEGL_DEBUG_CACHE_HITS
@@ -38,6 +44,17 @@
 #define GEGL_CACHE_TRIM_RATIO_MAX  0.50
 #define GEGL_CACHE_TRIM_RATIO_RATE 2.0
 
+/* the global cache bookkeeping is split into a number of shards, each with its
+ * own mutex and list of caches, so that threads working on different buffers
+ * don't contend on a single lock.  must be a power of two.
+ */
+#define GEGL_CACHE_N_SHARDS        16
+
+/* evicted tiles are only kept in the compressed tier if they compress to at
+ * most this fraction of their size.
+ */
+#define GEGL_CACHE_COMPRESSED_MAX_RATIO 0.75
+
 typedef struct CacheItem
 {
   GeglTile *tile; /* The tile */
@@ -49,10 +66,44 @@ typedef struct CacheItem
   gint      z;
 } CacheItem;
 
+/* a tile evicted from the cache, kept compressed in memory.  if the tile was
+ * dirty when evicted, it is only stored once it leaves the compressed tier.
+ */
+typedef struct CompressedItem
+{
+  GeglTileHandlerCache  *cache;       /* The cache the tile was evicted from */
+  GList                  link;        /* Link in the global compressed queue */
+
+  gint                   x;           /* The coordinates of the tile */
+  gint                   y;
+  gint                   z;
+
+  gboolean               dirty;       /* The tile hasn't been stored */
+  const GeglCompression *compression;
+  gint                   size;        /* The size of the compressed data */
+  guchar                *data;
+} CompressedItem;
+
 #define LINK_GET_CACHE(l) \
         ((GeglTileHandlerCache *) ((guchar *) l - G_STRUCT_OFFSET (GeglTileHandlerCache, link)))
 #define LINK_GET_ITEM(l) \
         ((CacheItem *) ((guchar *) l - G_STRUCT_OFFSET (CacheItem, link)))
+#define LINK_GET_COMPRESSED_ITEM(l) \
+        ((CompressedItem *) ((guchar *) l - G_STRUCT_OFFSET (CompressedItem, link)))
+
+typedef struct CacheShard
+{
+  GMutex   mutex;
+  GQueue   queue;      /* the caches belonging to this shard */
+  GList   *hand;       /* the CLOCK hand, pointing into queue */
+  gint64   trim_time;  /* time of the last trim started in this shard */
+  gdouble  trim_ratio;
+  gint     hits;
+  gint     misses;
+
+  /* keep the hot fields of neighboring shards on separate cache lines */
+  guchar   padding[64];
+} CacheShard;
 
 
 static gboolean   gegl_tile_handler_cache_equalfunc  (gconstpointer             a,
@@ -66,6 +117,11 @@ static gpointer   gegl_tile_handler_cache_command    (GeglTileSource           *
                                                       gint                      y,
                                                       gint                      z,
                                                       gpointer                  data);
+static inline CacheItem *
+                  cache_lookup                       (GeglTileHandlerCache     *cache,
+                                                      gint                      x,
+                                                      gint                      y,
+                                                      gint                      z);
 static gboolean   gegl_tile_handler_cache_has_tile   (GeglTileHandlerCache     *cache,
                                                       gint                      x,
                                                       gint                      y,
@@ -84,17 +140,48 @@ static gboolean   gegl_tile_handler_cache_copy       (GeglTileHandlerCache     *
                                                       gint                      y,
                                                       gint                      z,
                                                       const GeglTileCopyParams *params);
+static gboolean   gegl_tile_handler_cache_compressed_equalfunc
+                                                     (gconstpointer             a,
+                                                      gconstpointer             b);
+static guint      gegl_tile_handler_cache_compressed_hashfunc
+                                                     (gconstpointer             key);
+static GeglTile * gegl_tile_handler_cache_uncompress (GeglTileHandlerCache     *cache,
+                                                      gint                      x,
+                                                      gint                      y,
+                                                      gint                      z);
+static gboolean   gegl_tile_handler_cache_has_compressed
+                                                     (GeglTileHandlerCache     *cache,
+                                                      gint                      x,
+                                                      gint                      y,
+                                                      gint                      z);
+static void       gegl_tile_handler_cache_drop_compressed
+                                                     (GeglTileHandlerCache     *cache,
+                                                      gint                      x,
+                                                      gint                      y,
+                                                      gint                      z);
+static void       gegl_tile_handler_cache_flush_compressed
+                                                     (GeglTileHandlerCache     *cache);
+static void       gegl_tile_handler_cache_clear_compressed
+                                                     (GeglTileHandlerCache     *cache);
+static void       gegl_tile_handler_cache_trim_compressed
+                                                     (void);
 
 
-static GMutex             mutex                 = { 0, };
-static GQueue             cache_queue           = G_QUEUE_INIT;
+static CacheShard         cache_shards[GEGL_CACHE_N_SHARDS];
+static gint               cache_shard_counter   = 0; /* round-robin shard assignment */
+static gint               cache_sweep_counter   = 0; /* round-robin starting shard for cache-less trims and washes */
 static gint               cache_wash_percentage = 20;
 static          guintptr  cache_total           = 0; /* approximate amount of bytes stored */
 static guintptr           cache_total_max       = 0; /* maximal value of cache_total */
 static volatile guintptr  cache_total_uncloned  = 0; /* approximate amount of uncloned bytes stored */
-static gint               cache_hits            = 0;
-static gint               cache_misses          = 0;
-static guintptr           cache_time            = 0;
+
+/* the compressed tier.  the items, and the compressed_items tables of all
+ * caches, are protected by compressed_mutex.
+ */
+static GMutex                 compressed_mutex;
+static GQueue                 compressed_queue;           /* most recently evicted first */
+static guintptr               compressed_total = 0;       /* bytes used by the compressed tier */
+static const GeglCompression *compressed_compression = NULL;
 
 
 G_DEFINE_TYPE (GeglTileHandlerCache, gegl_tile_handler_cache, GEGL_TYPE_TILE_HANDLER)
@@ -113,6 +200,8 @@ gegl_tile_handler_cache_init (GeglTileHandlerCache *cache)
 {
   ((GeglTileSource*)cache)->command = gegl_tile_handler_cache_command;
   cache->items = g_hash_table_new (gegl_tile_handler_cache_hashfunc, gegl_tile_handler_cache_equalfunc);
+  cache->compressed_items = g_hash_table_new (gegl_tile_handler_cache_compressed_hashfunc,
+                                              gegl_tile_handler_cache_compressed_equalfunc);
   g_queue_init (&cache->queue);
 
   gegl_tile_handler_cache_connect (cache);
@@ -138,7 +227,7 @@ gegl_tile_handler_cache_reinit (GeglTileHandlerCache *cache)
   CacheItem *item;
   GList     *link;
 
-  cache->time = cache->stamp = 0;
+  cache->referenced = FALSE;
 
   if (cache->tile_storage->hot_tile)
     {
@@ -163,6 +252,8 @@ gegl_tile_handler_cache_reinit (GeglTileHandlerCache *cache)
         }
       g_slice_free (CacheItem, item);
     }
+
+  gegl_tile_handler_cache_clear_compressed (cache);
 }
 
 static void
@@ -175,6 +266,7 @@ gegl_tile_handler_cache_dispose (GObject *object)
   gegl_tile_handler_cache_reinit (cache);
 
   g_hash_table_destroy (cache->items);
+  g_hash_table_destroy (cache->compressed_items);
   G_OBJECT_CLASS (gegl_tile_handler_cache_parent_class)->dispose (object);
 }
 
@@ -194,13 +286,23 @@ gegl_tile_handler_cache_get_tile_command (GeglTileSource *tile_store,
   tile = gegl_tile_handler_cache_get_tile (cache, x, y, z);
   if (tile)
     {
-      /* we don't bother making cache_{hits,misses} atomic, since they're only
-       * needed for GeglStats.
+      /* we don't bother making the shard {hits,misses} atomic, since they're
+       * only needed for GeglStats.
        */
-      cache_hits++;
+      cache_shards[cache->shard].hits++;
+      GEGL_TRACE_COUNT (CACHE_HITS, 1);
+      return tile;
+    }
+
+  tile = gegl_tile_handler_cache_uncompress (cache, x, y, z);
+  if (tile)
+    {
+      cache_shards[cache->shard].hits++;
+      GEGL_TRACE_COUNT (CACHE_HITS, 1);
       return tile;
     }
-  cache_misses++;
+  cache_shards[cache->shard].misses++;
+  GEGL_TRACE_COUNT (CACHE_MISSES, 1);
 
   if (source)
     tile = gegl_tile_source_get_tile (source, x, y, z);
@@ -240,6 +342,8 @@ gegl_tile_handler_cache_command (GeglTileSource  *tile_store,
               if (item->tile)
                 gegl_tile_store (item->tile);
             }
+
+          gegl_tile_handler_cache_flush_compressed (cache);
         }
         break;
       case GEGL_TILE_GET:
@@ -250,9 +354,21 @@ gegl_tile_handler_cache_command (GeglTileSource  *tile_store,
         return gegl_tile_handler_cache_get_tile_command (tile_store, x, y, z);
       case GEGL_TILE_IS_CACHED:
         return GINT_TO_POINTER(gegl_tile_handler_cache_has_tile (cache, x, y, z));
+      case GEGL_TILE_PREFETCH:
+        /* there's nothing to prefetch if we already have the tile.  we use
+         * cache_lookup() directly, so as not to count the tile as referenced.
+         */
+        if (cache_lookup (cache, x, y, z) ||
+            gegl_tile_handler_cache_has_compressed (cache, x, y, z))
+          {
+            return NULL;
+          }
+        break;
       case GEGL_TILE_EXIST:
         {
-          gboolean exist = gegl_tile_handler_cache_has_tile (cache, x, y, z);
+          gboolean exist = gegl_tile_handler_cache_has_tile (cache, x, y, z) ||
+                           gegl_tile_handler_cache_has_compressed (cache,
+                                                                   x, y, z);
           if (exist)
             return (gpointer)TRUE;
         }
@@ -269,11 +385,15 @@ gegl_tile_handler_cache_command (GeglTileSource  *tile_store,
         gegl_tile_handler_cache_invalidate (cache, x, y, z);
         break;
       case GEGL_TILE_VOID:
+        gegl_tile_storage_changed (cache->tile_storage);
+
         gegl_tile_handler_cache_void (cache, x, y, z,
                                       data ? *(const guint64 *) data :
                                              ~(guint64) 0);
         break;
       case GEGL_TILE_REINIT:
+        gegl_tile_storage_changed (cache->tile_storage);
+
         gegl_tile_handler_cache_reinit (cache);
         break;
       case GEGL_TILE_COPY:
@@ -289,93 +409,74 @@ gegl_tile_handler_cache_command (GeglTileSource  *tile_store,
   return gegl_tile_handler_source_command (handler, command, x, y, z, data);
 }
 
-/* find the oldest (least-recently used) nonempty cache, after prev_cache (if
- * not NULL).  passing the previous result of this function as prev_cache
- * allows iterating over the caches in chronological order.
+/* advance the CLOCK hand of shard to the next nonempty cache which hasn't
+ * been referenced since the hand last passed over it, clearing the reference
+ * bit of the caches it skips.  this gives us an approximation of the least
+ * recently used cache, without having to maintain a global access order.
  *
- * if most caches haven't been accessed since the last call to this function,
- * it should be rather cheap (approaching O(1)).
+ * *budget limits the number of caches the hand may pass over; it should be
+ * initialized to -1 before the first call for a given shard, in which case it
+ * is set to twice the number of caches in the shard, which is enough for the
+ * hand to come back around to any cache whose bit it cleared.  since the
+ * shard mutex may be released between calls, the budget is clamped to the
+ * current number of caches on each call, so that it never outlives them.
+ * NULL is returned once the budget is exhausted, or if the shard is empty.
  *
- * the global cache mutex must be held while calling this function, however,
+ * the shard mutex must be held while calling this function, however,
  * individual caches may be accessed concurrently.  as a result, there is a
- * race between modifying the caches' last-access time during access, and
- * inspecting the time by this function.  this isn't critical, but it does mean
- * that the result might not always be accurate.
+ * race between setting the caches' reference bit during access, and
+ * inspecting it by this function.  this isn't critical, but it does mean that
+ * the result might not always be accurate.
  */
 static GeglTileHandlerCache *
-gegl_tile_handler_cache_find_oldest_cache (GeglTileHandlerCache *prev_cache)
+gegl_tile_handler_cache_clock_sweep (CacheShard *shard,
+                                     gint       *budget)
 {
-  GList                *link;
-  GeglTileHandlerCache *oldest_cache = NULL;
-  guintptr              oldest_time  = 0;
-
-  /* find the oldest cache, after prev_cache */
-  for (link = prev_cache ? g_list_next (&prev_cache->link) :
-                           g_queue_peek_head_link (&cache_queue);
-       link;
-       link = g_list_next (link))
-    {
-      GeglTileHandlerCache *cache = LINK_GET_CACHE (link);
-      guintptr              time  = cache->time;
-      guintptr              stamp = cache->stamp;
+  gint max_budget = 2 * g_queue_get_length (&shard->queue);
 
-      /* the cache is empty */
-      if (! time)
-        continue;
+  if (*budget < 0 || *budget > max_budget)
+    *budget = max_budget;
 
-      /* the cache is being disconnected */
-      if (! cache->link.data)
-        continue;
+  while (*budget > 0)
+    {
+      GeglTileHandlerCache *cache;
 
-      if (time == stamp)
-        {
-          oldest_cache = cache;
-          oldest_time  = time;
+      if (! shard->hand)
+        shard->hand = g_queue_peek_head_link (&shard->queue);
 
-          /* the cache is still stamped, so it must be the oldest of the
-           * remaining caches, and we can break early
-           */
-          break;
-        }
-      else if (! oldest_time || time < oldest_time)
+      /* the shard is empty */
+      if (! shard->hand)
         {
-          oldest_cache = cache;
-          oldest_time  = time;
+          *budget = 0;
+
+          return NULL;
         }
-    }
 
-  if (oldest_cache)
-    {
-      /* stamp the cache */
-      oldest_cache->stamp = oldest_time;
+      cache = LINK_GET_CACHE (shard->hand);
 
-      /* ... and move it after prev_cache */
-      g_queue_unlink (&cache_queue, &oldest_cache->link);
+      shard->hand = g_list_next (shard->hand);
+      (*budget)--;
 
-      if (prev_cache)
-        {
-          if (prev_cache->link.next)
-            {
-              oldest_cache->link.prev = &prev_cache->link;
-              oldest_cache->link.next = prev_cache->link.next;
+      /* the cache is empty */
+      if (g_queue_is_empty (&cache->queue))
+        continue;
 
-              oldest_cache->link.prev->next = &oldest_cache->link;
-              oldest_cache->link.next->prev = &oldest_cache->link;
+      /* the cache is being disconnected */
+      if (! cache->link.data)
+        continue;
 
-              cache_queue.length++;
-            }
-          else
-            {
-              g_queue_push_tail_link (&cache_queue, &oldest_cache->link);
-            }
-        }
-      else
+      /* the cache has been accessed recently; give it a second chance */
+      if (cache->referenced)
         {
-          g_queue_push_head_link (&cache_queue, &oldest_cache->link);
+          cache->referenced = FALSE;
+
+          continue;
         }
+
+      return cache;
     }
 
-  return oldest_cache;
+  return NULL;
 }
 
 /* write the least recently used dirty tile to disk if it
@@ -389,53 +490,58 @@ gegl_tile_handler_cache_wash (GeglTileHandlerCache *cache)
   GeglTile  *last_dirty = NULL;
   guintptr   size       = 0;
   guintptr   wash_size;
-
-  g_mutex_lock (&mutex);
+  gint       first_shard;
+  gint       i;
 
   wash_size = (gdouble) cache_total_uncloned *
               cache_wash_percentage / 100.0 + 0.5;
 
-  cache = NULL;
+  first_shard = g_atomic_int_add (&cache_sweep_counter, 1);
 
-  while (size < wash_size)
+  for (i = 0; i < GEGL_CACHE_N_SHARDS && size < wash_size; i++)
     {
-      GList *link;
+      CacheShard *shard  = &cache_shards[(first_shard + i) &
+                                         (GEGL_CACHE_N_SHARDS - 1)];
+      gint        budget = -1;
 
-      cache = gegl_tile_handler_cache_find_oldest_cache (cache);
+      g_mutex_lock (&shard->mutex);
 
-      if (cache == NULL)
-        break;
-
-      if (! g_rec_mutex_trylock (&cache->tile_storage->mutex))
+      while (size < wash_size &&
+             (cache = gegl_tile_handler_cache_clock_sweep (shard, &budget)))
         {
-          continue;
-        }
+          GList *link;
 
-      for (link = g_queue_peek_tail_link (&cache->queue);
-           link && size < wash_size;
-           link = g_list_previous (link))
-        {
-          CacheItem *item = LINK_GET_ITEM (link);
-          GeglTile  *tile = item->tile;
+          if (! g_rec_mutex_trylock (&cache->tile_storage->mutex))
+            {
+              continue;
+            }
 
-          if (tile->tile_storage && ! gegl_tile_is_stored (tile))
+          for (link = g_queue_peek_tail_link (&cache->queue);
+               link && size < wash_size;
+               link = g_list_previous (link))
             {
-              last_dirty = tile;
-              g_object_ref (last_dirty->tile_storage);
-              gegl_tile_ref (last_dirty);
+              CacheItem *item = LINK_GET_ITEM (link);
+              GeglTile  *tile = item->tile;
 
-              size = wash_size;
-              break;
+              if (tile->tile_storage && ! gegl_tile_is_stored (tile))
+                {
+                  last_dirty = tile;
+                  g_object_ref (last_dirty->tile_storage);
+                  gegl_tile_ref (last_dirty);
+
+                  size = wash_size;
+                  break;
+                }
+
+              size += tile->size;
             }
 
-          size += tile->size;
+          g_rec_mutex_unlock (&cache->tile_storage->mutex);
         }
 
-      g_rec_mutex_unlock (&cache->tile_storage->mutex);
+      g_mutex_unlock (&shard->mutex);
     }
 
-  g_mutex_unlock (&mutex);
-
   if (last_dirty != NULL)
     {
       gegl_tile_store (last_dirty);
@@ -479,7 +585,11 @@ gegl_tile_handler_cache_get_tile (GeglTileHandlerCache *cache,
     {
       g_queue_unlink (&cache->queue, &result->link);
       g_queue_push_head_link (&cache->queue, &result->link);
-      cache->time = ++cache_time;
+      /* only write the reference bit when it's not already set, so that
+       * concurrent hits don't keep bouncing the cache line around.
+       */
+      if (! cache->referenced)
+        cache->referenced = TRUE;
       if (result->tile == NULL)
       {
         g_printerr ("NULL tile in %s %p %i %i %i %p\n", __FUNCTION__, result, result->x, result->y, result->z,
@@ -509,45 +619,439 @@ gegl_tile_handler_cache_has_tile (GeglTileHandlerCache *cache,
   return FALSE;
 }
 
+static inline CompressedItem *
+compressed_lookup (GeglTileHandlerCache *cache,
+                   gint                  x,
+                   gint                  y,
+                   gint                  z)
+{
+  CompressedItem key;
+
+  key.x = x;
+  key.y = y;
+  key.z = z;
+
+  return g_hash_table_lookup (cache->compressed_items, &key);
+}
+
+static inline gsize
+compressed_item_cost (CompressedItem *item)
+{
+  return sizeof (CompressedItem) + item->size;
+}
+
+static void
+compressed_item_free (CompressedItem *item)
+{
+  g_free (item->data);
+  g_slice_free (CompressedItem, item);
+}
+
+/* removes item from the compressed tier.  compressed_mutex must be held. */
+static void
+gegl_tile_handler_cache_compressed_unlink (CompressedItem *item)
+{
+  g_hash_table_remove (item->cache->compressed_items, item);
+  g_queue_unlink (&compressed_queue, &item->link);
+  g_atomic_pointer_add (&compressed_total, -compressed_item_cost (item));
+}
+
+/* returns a new tile holding the item's data, which is dirty if the item is.
+ */
+static GeglTile *
+gegl_tile_handler_cache_compressed_get_tile (CompressedItem *item)
+{
+  GeglTileStorage *storage = item->cache->tile_storage;
+  GeglTile        *tile    = gegl_tile_new (storage->tile_size);
+
+  if (! gegl_compression_decompress (item->compression, storage->format,
+                                     gegl_tile_get_data (tile),
+                                     storage->tile_size / storage->px_size,
+                                     item->data, item->size))
+    {
+      g_warning ("failed to decompress tile %d, %d, %d",
+                 item->x, item->y, item->z);
+
+      memset (gegl_tile_get_data (tile), 0, storage->tile_size);
+    }
+
+  if (item->dirty)
+    tile->rev = tile->stored_rev + 1;
+
+  return tile;
+}
+
+/* stores the tile of a dirty item in the backend.  the storage mutex of the
+ * item's cache must be held.
+ */
+static void
+gegl_tile_handler_cache_compressed_store (CompressedItem *item)
+{
+  GeglTile *tile = gegl_tile_handler_cache_compressed_get_tile (item);
+
+  tile->x = item->x;
+  tile->y = item->y;
+  tile->z = item->z;
+
+  gegl_tile_source_set_tile (GEGL_TILE_SOURCE (item->cache->tile_storage),
+                             item->x, item->y, item->z, tile);
+
+  gegl_tile_unref (tile);
+}
+
+/* moves a tile which is being evicted from the cache to the compressed tier,
+ * if it's enabled, and if the tile is worth keeping and compresses well
+ * enough.  a dirty tile is marked as stored, since it will be stored once it
+ * leaves the compressed tier instead.
+ */
+static gboolean
+gegl_tile_handler_cache_compress (GeglTileHandlerCache *cache,
+                                  GeglTile             *tile,
+                                  gint                  x,
+                                  gint                  y,
+                                  gint                  z)
+{
+  GeglTileStorage       *storage   = cache->tile_storage;
+  guint64                max_total = gegl_buffer_config ()->tile_cache_compressed_size;
+  const GeglCompression *compression;
+  CompressedItem        *item;
+  CompressedItem        *old_item;
+  guchar                *compressed;
+  gboolean               dirty;
+  gint                   max_size;
+  gint                   size;
+
+  if (! max_total || tile->damage)
+    return FALSE;
+
+  dirty = gegl_tile_needs_store (tile);
+
+  /* a clean tile is only worth keeping if refetching it means reading it
+   * back from the swap.
+   */
+  if (! dirty &&
+      (tile->is_zero_tile ||
+       ! GEGL_IS_TILE_BACKEND_SWAP (GEGL_TILE_HANDLER (storage)->source)))
+    {
+      return FALSE;
+    }
+
+  g_mutex_lock (&compressed_mutex);
+  compression = compressed_compression;
+  g_mutex_unlock (&compressed_mutex);
+
+  if (! compression)
+    return FALSE;
+
+  max_size   = tile->size * GEGL_CACHE_COMPRESSED_MAX_RATIO;
+  compressed = gegl_scratch_alloc (max_size);
+
+  if (! gegl_compression_compress (compression, storage->format,
+                                   gegl_tile_get_data (tile),
+                                   tile->size / storage->px_size,
+                                   compressed, &size, max_size) ||
+      sizeof (CompressedItem) + size > max_total)
+    {
+      gegl_scratch_free (compressed);
+
+      return FALSE;
+    }
+
+  item = g_slice_new (CompressedItem);
+
+  item->cache       = cache;
+  item->link.data   = item;
+  item->link.next   = NULL;
+  item->link.prev   = NULL;
+  item->x           = x;
+  item->y           = y;
+  item->z           = z;
+  item->dirty       = dirty;
+  item->compression = compression;
+  item->size        = size;
+  item->data        = g_malloc (size);
+
+  memcpy (item->data, compressed, size);
+
+  gegl_scratch_free (compressed);
+
+  g_mutex_lock (&compressed_mutex);
+
+  old_item = compressed_lookup (cache, x, y, z);
+
+  if (old_item)
+    gegl_tile_handler_cache_compressed_unlink (old_item);
+
+  g_hash_table_add (cache->compressed_items, item);
+  g_queue_push_head_link (&compressed_queue, &item->link);
+  g_atomic_pointer_add (&compressed_total, compressed_item_cost (item));
+
+  g_mutex_unlock (&compressed_mutex);
+
+  if (old_item)
+    compressed_item_free (old_item);
+
+  if (dirty)
+    gegl_tile_mark_as_stored (tile);
+
+  return TRUE;
+}
+
+/* moves a tile from the compressed tier back to the cache, returning a new
+ * reference to it, or NULL if the tile is not in the compressed tier.
+ */
+static GeglTile *
+gegl_tile_handler_cache_uncompress (GeglTileHandlerCache *cache,
+                                    gint                  x,
+                                    gint                  y,
+                                    gint                  z)
+{
+  CompressedItem *item;
+  GeglTile       *tile;
+
+  if (! g_atomic_pointer_get (&compressed_total))
+    return NULL;
+
+  g_mutex_lock (&compressed_mutex);
+
+  item = compressed_lookup (cache, x, y, z);
+
+  if (item)
+    gegl_tile_handler_cache_compressed_unlink (item);
+
+  g_mutex_unlock (&compressed_mutex);
+
+  if (! item)
+    return NULL;
+
+  tile = gegl_tile_handler_cache_compressed_get_tile (item);
+
+  compressed_item_free (item);
+
+  gegl_tile_handler_cache_insert (cache, tile, x, y, z);
+
+  return tile;
+}
+
+static gboolean
+gegl_tile_handler_cache_has_compressed (GeglTileHandlerCache *cache,
+                                        gint                  x,
+                                        gint                  y,
+                                        gint                  z)
+{
+  gboolean found;
+
+  if (! g_atomic_pointer_get (&compressed_total))
+    return FALSE;
+
+  g_mutex_lock (&compressed_mutex);
+  found = compressed_lookup (cache, x, y, z) != NULL;
+  g_mutex_unlock (&compressed_mutex);
+
+  return found;
+}
+
+static void
+gegl_tile_handler_cache_drop_compressed (GeglTileHandlerCache *cache,
+                                         gint                  x,
+                                         gint                  y,
+                                         gint                  z)
+{
+  CompressedItem *item;
+
+  if (! g_atomic_pointer_get (&compressed_total))
+    return;
+
+  g_mutex_lock (&compressed_mutex);
+
+  item = compressed_lookup (cache, x, y, z);
+
+  if (item)
+    gegl_tile_handler_cache_compressed_unlink (item);
+
+  g_mutex_unlock (&compressed_mutex);
+
+  if (item)
+    compressed_item_free (item);
+}
+
+/* stores, and drops, the dirty tiles of cache in the compressed tier */
+static void
+gegl_tile_handler_cache_flush_compressed (GeglTileHandlerCache *cache)
+{
+  GHashTableIter  iter;
+  CompressedItem *item;
+  GSList         *dirty = NULL;
+  GSList         *list;
+
+  if (! g_atomic_pointer_get (&compressed_total))
+    return;
+
+  g_mutex_lock (&compressed_mutex);
+
+  g_hash_table_iter_init (&iter, cache->compressed_items);
+
+  while (g_hash_table_iter_next (&iter, (gpointer *) &item, NULL))
+    {
+      if (item->dirty)
+        dirty = g_slist_prepend (dirty, item);
+    }
+
+  for (list = dirty; list; list = g_slist_next (list))
+    gegl_tile_handler_cache_compressed_unlink (list->data);
+
+  g_mutex_unlock (&compressed_mutex);
+
+  for (list = dirty; list; list = g_slist_next (list))
+    {
+      gegl_tile_handler_cache_compressed_store (list->data);
+
+      compressed_item_free (list->data);
+    }
+
+  g_slist_free (dirty);
+}
+
+/* drops all the tiles of cache in the compressed tier */
+static void
+gegl_tile_handler_cache_clear_compressed (GeglTileHandlerCache *cache)
+{
+  GList *items;
+  GList *list;
+
+  g_mutex_lock (&compressed_mutex);
+
+  items = g_hash_table_get_values (cache->compressed_items);
+
+  for (list = items; list; list = g_list_next (list))
+    gegl_tile_handler_cache_compressed_unlink (list->data);
+
+  g_mutex_unlock (&compressed_mutex);
+
+  g_list_free_full (items, (GDestroyNotify) compressed_item_free);
+}
+
+/* evicts the least recently added tiles from the compressed tier, until it
+ * fits its size limit, storing the dirty ones.
+ */
+static void
+gegl_tile_handler_cache_trim_compressed (void)
+{
+  guint64 max_total = gegl_buffer_config ()->tile_cache_compressed_size;
+
+  while ((guintptr) g_atomic_pointer_get (&compressed_total) > max_total)
+    {
+      CompressedItem  *item    = NULL;
+      GeglTileStorage *storage = NULL;
+      GList           *link;
+
+      g_mutex_lock (&compressed_mutex);
+
+      for (link = g_queue_peek_tail_link (&compressed_queue);
+           link;
+           link = g_list_previous (link))
+        {
+          CompressedItem  *candidate = LINK_GET_COMPRESSED_ITEM (link);
+          GeglTileStorage *candidate_storage;
+
+          if (! candidate->dirty)
+            {
+              item = candidate;
+
+              break;
+            }
+
+          /* storing the tile requires the storage mutex.  like in
+           * gegl_tile_handler_cache_trim(), only try locking it, and skip the
+           * tile if it fails, to avoid deadlocks.  we also skip tiles of
+           * caches being disconnected, whose tiles are about to be dropped.
+           */
+          candidate_storage = candidate->cache->tile_storage;
+
+          if (g_rec_mutex_trylock (&candidate_storage->mutex))
+            {
+              if (candidate->cache->link.data)
+                {
+                  item    = candidate;
+                  storage = candidate_storage;
+
+                  break;
+                }
+
+              g_rec_mutex_unlock (&candidate_storage->mutex);
+            }
+        }
+
+      if (item)
+        gegl_tile_handler_cache_compressed_unlink (item);
+
+      g_mutex_unlock (&compressed_mutex);
+
+      if (! item)
+        break;
+
+      if (storage)
+        {
+          gegl_tile_handler_cache_compressed_store (item);
+
+          g_rec_mutex_unlock (&storage->mutex);
+        }
+
+      compressed_item_free (item);
+    }
+}
+
 static gboolean
 gegl_tile_handler_cache_trim (GeglTileHandlerCache *cache)
 {
+  CacheShard     *first_shard;
+  CacheShard     *shard;
   GList          *link;
   gint64          time;
-  static gint64   last_time;
-  static gdouble  ratio  = GEGL_CACHE_TRIM_RATIO_MIN;
   guint64         target_size;
   static guint    counter;
-
-  cache = NULL;
-  link  = NULL;
-
-  g_mutex_lock (&mutex);
+  gint            n_shards;
+  gint            budget;
 
   target_size = gegl_buffer_config ()->tile_cache_size;
 
   if ((guintptr) g_atomic_pointer_get (&cache_total) <= target_size)
-    {
-      g_mutex_unlock (&mutex);
+    return TRUE;
 
-      return TRUE;
-    }
+  /* start evicting from the shard of the cache that triggered the trim, so
+   * that, most of the time, we only touch a single shard.  we move on to the
+   * other shards only if this one doesn't have enough evictable tiles.
+   */
+  if (cache)
+    first_shard = &cache_shards[cache->shard];
+  else
+    first_shard = &cache_shards[g_atomic_int_add (&cache_sweep_counter, 1) &
+                                (GEGL_CACHE_N_SHARDS - 1)];
+
+  g_mutex_lock (&first_shard->mutex);
 
   time = g_get_monotonic_time ();
 
-  if (time - last_time < GEGL_CACHE_TRIM_INTERVAL)
+  if (time - first_shard->trim_time < GEGL_CACHE_TRIM_INTERVAL)
     {
-      ratio = MIN (ratio * GEGL_CACHE_TRIM_RATIO_RATE,
-                   GEGL_CACHE_TRIM_RATIO_MAX);
+      first_shard->trim_ratio = MIN (first_shard->trim_ratio *
+                                     GEGL_CACHE_TRIM_RATIO_RATE,
+                                     GEGL_CACHE_TRIM_RATIO_MAX);
     }
-  else if (time - last_time >= 2 * GEGL_CACHE_TRIM_INTERVAL)
+  else if (time - first_shard->trim_time >= 2 * GEGL_CACHE_TRIM_INTERVAL)
     {
-      ratio = GEGL_CACHE_TRIM_RATIO_MIN;
+      first_shard->trim_ratio = GEGL_CACHE_TRIM_RATIO_MIN;
     }
 
-  target_size -= target_size * ratio;
+  target_size -= target_size * first_shard->trim_ratio;
 
-  g_mutex_unlock (&mutex);
+  g_mutex_unlock (&first_shard->mutex);
+
+  shard    = first_shard;
+  n_shards = GEGL_CACHE_N_SHARDS;
+  budget   = -1;
+  cache    = NULL;
+  link     = NULL;
 
   while ((guintptr) g_atomic_pointer_get (&cache_total) > target_size)
     {
@@ -557,7 +1061,7 @@ gegl_tile_handler_cache_trim (GeglTileHandlerCache *cache)
 
 #ifdef GEGL_DEBUG_CACHE_HITS
       GEGL_NOTE(GEGL_DEBUG_CACHE, "cache_total:"G_GUINT64_FORMAT" > cache_size:"G_GUINT64_FORMAT, cache_total, gegl_buffer_config()->tile_cache_size);
-      GEGL_NOTE(GEGL_DEBUG_CACHE, "%f%% hit:%i miss:%i  %i]", cache_hits*100.0/(cache_hits+cache_misses), cache_hits, cache_misses, g_queue_get_length (&cache_queue));
+      GEGL_NOTE(GEGL_DEBUG_CACHE, "%f%% hit:%i miss:%i]", gegl_tile_handler_cache_get_hits ()*100.0/(gegl_tile_handler_cache_get_hits ()+gegl_tile_handler_cache_get_misses ()), gegl_tile_handler_cache_get_hits (), gegl_tile_handler_cache_get_misses ());
 #endif
 
       if (! link)
@@ -565,24 +1069,38 @@ gegl_tile_handler_cache_trim (GeglTileHandlerCache *cache)
           if (cache)
             g_rec_mutex_unlock (&cache->tile_storage->mutex);
 
-          g_mutex_lock (&mutex);
+          cache = NULL;
 
-          do
+          while (n_shards > 0)
             {
-              cache = gegl_tile_handler_cache_find_oldest_cache (cache);
+              g_mutex_lock (&shard->mutex);
+
+              do
+                {
+                  cache = gegl_tile_handler_cache_clock_sweep (shard, &budget);
+                }
+              while (cache &&
+                     /* XXX:  when trimming a dirty tile, gegl_tile_unref() will
+                      * try to store it, acquiring the cache's storage mutex in
+                      * the process.  this can lead to a deadlock if another
+                      * thread is already holding that mutex, and is waiting on
+                      * a shard mutex, or on a tile-storage mutex held by the
+                      * current thread.  try locking the cache's storage mutex
+                      * here, and skip the cache if it fails.
+                      */
+                     ! g_rec_mutex_trylock (&cache->tile_storage->mutex));
+
+              g_mutex_unlock (&shard->mutex);
+
+              if (cache)
+                break;
+
+              /* the shard is exhausted, move on to the next one */
+              shard = &cache_shards[(shard - cache_shards + 1) &
+                                    (GEGL_CACHE_N_SHARDS - 1)];
+              n_shards--;
+              budget = -1;
             }
-          while (cache &&
-                 /* XXX:  when trimming a dirty tile, gegl_tile_unref() will
-                  * try to store it, acquiring the cache's storage mutex in the
-                  * process.  this can lead to a deadlock if another thread is
-                  * already holding that mutex, and is waiting on the global
-                  * cache mutex, or on a tile-storage mutex held by the current
-                  * thread.  try locking the cache's storage mutex here, and
-                  * skip the cache if it fails.
-                  */
-                 ! g_rec_mutex_trylock (&cache->tile_storage->mutex));
-
-          g_mutex_unlock (&mutex);
 
           if (! cache)
             break;
@@ -638,8 +1156,6 @@ gegl_tile_handler_cache_trim (GeglTileHandlerCache *cache)
       prev_link = g_list_previous (link);
       g_queue_unlink (&cache->queue, link);
       g_hash_table_remove (cache->items, last_writable);
-      if (g_queue_is_empty (&cache->queue))
-        cache->time = cache->stamp = 0;
       if (g_atomic_int_dec_and_test (gegl_tile_n_cached_clones (tile)))
         g_atomic_pointer_add (&cache_total, -tile->size);
       g_atomic_pointer_add (&cache_total_uncloned, -tile->size);
@@ -648,7 +1164,13 @@ gegl_tile_handler_cache_trim (GeglTileHandlerCache *cache)
                                    * the hot tile will have a ref-count of
                                    * at least two.
                                    */
-      gegl_tile_store (tile);
+      if (! gegl_tile_handler_cache_compress (cache, tile,
+                                              last_writable->x,
+                                              last_writable->y,
+                                              last_writable->z))
+        {
+          gegl_tile_store (tile);
+        }
       tile->tile_storage = NULL;
       gegl_tile_unref (tile);
 
@@ -659,11 +1181,17 @@ gegl_tile_handler_cache_trim (GeglTileHandlerCache *cache)
   if (cache)
     g_rec_mutex_unlock (&cache->tile_storage->mutex);
 
-  g_mutex_lock (&mutex);
+  g_mutex_lock (&first_shard->mutex);
 
-  last_time = g_get_monotonic_time ();
+  first_shard->trim_time = g_get_monotonic_time ();
 
-  g_mutex_unlock (&mutex);
+  g_mutex_unlock (&first_shard->mutex);
+
+  if ((guintptr) g_atomic_pointer_get (&compressed_total) >
+      gegl_buffer_config ()->tile_cache_compressed_size)
+    {
+      gegl_tile_handler_cache_trim_compressed ();
+    }
 
   return cache != NULL;
 }
@@ -686,9 +1214,6 @@ gegl_tile_handler_cache_invalidate (GeglTileHandlerCache *cache,
       g_queue_unlink (&cache->queue, &item->link);
       g_hash_table_remove (cache->items, item);
 
-      if (g_queue_is_empty (&cache->queue))
-        cache->time = cache->stamp = 0;
-
       drop_hot_tile (item->tile);
       gegl_tile_mark_as_stored (item->tile); /* to cheat it out of being stored */
       item->tile->tile_storage = NULL;
@@ -696,6 +1221,8 @@ gegl_tile_handler_cache_invalidate (GeglTileHandlerCache *cache,
 
       g_slice_free (CacheItem, item);
     }
+
+  gegl_tile_handler_cache_drop_compressed (cache, x, y, z);
 }
 
 static gboolean
@@ -714,6 +1241,10 @@ gegl_tile_handler_cache_copy (GeglTileHandlerCache     *cache,
 
   tile = gegl_tile_handler_cache_get_tile (cache, x, y, z);
 
+  /* the backend's copy of a tile in the compressed tier might be outdated */
+  if (! tile)
+    tile = gegl_tile_handler_cache_uncompress (cache, x, y, z);
+
   /* if the tile is not fully valid, bail, so that the copy happens using a
    * TILE_GET commands, validating the tile in the process.
    */
@@ -816,9 +1347,6 @@ gegl_tile_handler_cache_remove_item (GeglTileHandlerCache *cache,
   g_queue_unlink (&cache->queue, &item->link);
   g_hash_table_remove (cache->items, item);
 
-  if (g_queue_is_empty (&cache->queue))
-    cache->time = cache->stamp = 0;
-
   item->tile->tile_storage = NULL;
   gegl_tile_unref (item->tile);
 
@@ -841,6 +1369,8 @@ gegl_tile_handler_cache_remove (GeglTileHandlerCache *cache,
 
       gegl_tile_handler_cache_remove_item (cache, item);
     }
+
+  gegl_tile_handler_cache_drop_compressed (cache, x, y, z);
 }
 
 static void
@@ -853,6 +1383,27 @@ gegl_tile_handler_cache_void (GeglTileHandlerCache *cache,
   CacheItem *item;
 
   item = cache_lookup (cache, x, y, z);
+
+  /* a partially-damaged tile keeps its valid parts, so bring it back from the
+   * compressed tier; a fully-damaged one can simply be dropped.
+   */
+  if (! item && gegl_tile_handler_cache_has_compressed (cache, x, y, z))
+    {
+      GeglTile *tile = NULL;
+
+      if (~damage)
+        tile = gegl_tile_handler_cache_uncompress (cache, x, y, z);
+      else
+        gegl_tile_handler_cache_drop_compressed (cache, x, y, z);
+
+      if (tile)
+        {
+          gegl_tile_unref (tile);
+
+          item = cache_lookup (cache, x, y, z);
+        }
+    }
+
   if (item)
     {
       drop_hot_tile (item->tile);
@@ -895,7 +1446,8 @@ gegl_tile_handler_cache_insert (GeglTileHandlerCache *cache,
 
   /* XXX: this is a window when the tile is a zero tile during update */
 
-  cache->time = ++cache_time;
+  if (! cache->referenced)
+    cache->referenced = TRUE;
 
   if (g_atomic_int_add (gegl_tile_n_cached_clones (tile), 1) == 0)
     total = g_atomic_pointer_add (&cache_total, tile->size) + tile->size;
@@ -940,30 +1492,40 @@ gegl_tile_handler_cache_new (void)
 void
 gegl_tile_handler_cache_connect (GeglTileHandlerCache *cache)
 {
-  /* join the global cache queue */
+  /* join the queue of one of the global cache shards */
   if (! cache->link.data)
     {
+      CacheShard *shard;
+
       cache->link.data = cache;
+      cache->shard     = g_atomic_int_add (&cache_shard_counter, 1) &
+                         (GEGL_CACHE_N_SHARDS - 1);
+
+      shard = &cache_shards[cache->shard];
 
-      g_mutex_lock (&mutex);
-      g_queue_push_tail_link (&cache_queue, &cache->link);
-      g_mutex_unlock (&mutex);
+      g_mutex_lock (&shard->mutex);
+      g_queue_push_tail_link (&shard->queue, &cache->link);
+      g_mutex_unlock (&shard->mutex);
     }
 }
 
 void
 gegl_tile_handler_cache_disconnect (GeglTileHandlerCache *cache)
 {
-  /* leave the global cache queue */
+  /* leave the queue of our cache shard */
   if (cache->link.data)
     {
+      CacheShard *shard = &cache_shards[cache->shard];
+
       cache->link.data = NULL;
 
       g_rec_mutex_lock (&cache->tile_storage->mutex);
 
-      g_mutex_lock (&mutex);
-      g_queue_unlink (&cache_queue, &cache->link);
-      g_mutex_unlock (&mutex);
+      g_mutex_lock (&shard->mutex);
+      if (shard->hand == &cache->link)
+        shard->hand = g_list_next (shard->hand);
+      g_queue_unlink (&shard->queue, &cache->link);
+      g_mutex_unlock (&shard->mutex);
 
       g_rec_mutex_unlock (&cache->tile_storage->mutex);
     }
@@ -987,36 +1549,58 @@ gegl_tile_handler_cache_get_total_uncompressed (void)
   return cache_total_uncloned;
 }
 
+gsize
+gegl_tile_handler_cache_get_total_compressed (void)
+{
+  return compressed_total;
+}
+
 gint
 gegl_tile_handler_cache_get_hits (void)
 {
-  return cache_hits;
+  gint hits = 0;
+  gint i;
+
+  for (i = 0; i < GEGL_CACHE_N_SHARDS; i++)
+    hits += cache_shards[i].hits;
+
+  return hits;
 }
 
 gint
 gegl_tile_handler_cache_get_misses (void)
 {
-  return cache_misses;
+  gint misses = 0;
+  gint i;
+
+  for (i = 0; i < GEGL_CACHE_N_SHARDS; i++)
+    misses += cache_shards[i].misses;
+
+  return misses;
 }
 
 void
 gegl_tile_handler_cache_reset_stats (void)
 {
+  gint i;
+
   cache_total_max = cache_total;
-  cache_hits      = 0;
-  cache_misses    = 0;
+
+  for (i = 0; i < GEGL_CACHE_N_SHARDS; i++)
+    {
+      cache_shards[i].hits   = 0;
+      cache_shards[i].misses = 0;
+    }
 }
 
 
-static guint
-gegl_tile_handler_cache_hashfunc (gconstpointer key)
+static inline guint
+gegl_tile_handler_cache_hash (gint srcA,
+                              gint srcB,
+                              gint srcC)
 {
-  const CacheItem *e = key;
-  guint           hash;
-  gint            i;
-  gint            srcA = e->x;
-  gint            srcB = e->y;
-  gint            srcC = e->z;
+  guint hash;
+  gint  i;
 
   /* interleave the 10 least significant bits of all coordinates,
    * this gives us Z-order / morton order of the space and should
@@ -1034,6 +1618,14 @@ gegl_tile_handler_cache_hashfunc (gconstpointer key)
   return hash;
 }
 
+static guint
+gegl_tile_handler_cache_hashfunc (gconstpointer key)
+{
+  const CacheItem *e = key;
+
+  return gegl_tile_handler_cache_hash (e->x, e->y, e->z);
+}
+
 static gboolean
 gegl_tile_handler_cache_equalfunc (gconstpointer a,
                                    gconstpointer b)
@@ -1048,6 +1640,26 @@ gegl_tile_handler_cache_equalfunc (gconstpointer a,
   return FALSE;
 }
 
+static guint
+gegl_tile_handler_cache_compressed_hashfunc (gconstpointer key)
+{
+  const CompressedItem *e = key;
+
+  return gegl_tile_handler_cache_hash (e->x, e->y, e->z);
+}
+
+static gboolean
+gegl_tile_handler_cache_compressed_equalfunc (gconstpointer a,
+                                              gconstpointer b)
+{
+  const CompressedItem *ea = a;
+  const CompressedItem *eb = b;
+
+  return ea->x == eb->x &&
+         ea->y == eb->y &&
+         ea->z == eb->z;
+}
+
 static void
 gegl_buffer_config_tile_cache_size_notify (GObject    *gobject,
                                            GParamSpec *pspec,
@@ -1060,29 +1672,94 @@ gegl_buffer_config_tile_cache_size_notify (GObject    *gobject,
     }
 }
 
+static void
+gegl_buffer_config_tile_cache_compressed_size_notify (GObject    *gobject,
+                                                      GParamSpec *pspec,
+                                                      gpointer    user_data)
+{
+  if ((guintptr) g_atomic_pointer_get (&compressed_total) >
+      gegl_buffer_config ()->tile_cache_compressed_size)
+    {
+      gegl_tile_handler_cache_trim_compressed ();
+    }
+}
+
+static void
+gegl_buffer_config_tile_cache_compression_notify (GObject    *gobject,
+                                                  GParamSpec *pspec,
+                                                  gpointer    user_data)
+{
+  const gchar           *name        = gegl_buffer_config ()->tile_cache_compression;
+  const GeglCompression *compression = NULL;
+
+  if (name)
+    compression = gegl_compression (name);
+
+  g_mutex_lock (&compressed_mutex);
+  compressed_compression = compression;
+  g_mutex_unlock (&compressed_mutex);
+}
+
 void
 gegl_tile_cache_init (void)
 {
+  gint i;
+
+  for (i = 0; i < GEGL_CACHE_N_SHARDS; i++)
+    {
+      g_queue_init (&cache_shards[i].queue);
+
+      cache_shards[i].hand       = NULL;
+      cache_shards[i].trim_ratio = GEGL_CACHE_TRIM_RATIO_MIN;
+    }
+
   g_signal_connect (gegl_buffer_config (), "notify::tile-cache-size",
                     G_CALLBACK (gegl_buffer_config_tile_cache_size_notify), NULL);
+
+  g_queue_init (&compressed_queue);
+
+  g_signal_connect (gegl_buffer_config (), "notify::tile-cache-compressed-size",
+                    G_CALLBACK (gegl_buffer_config_tile_cache_compressed_size_notify),
+                    NULL);
+  g_signal_connect (gegl_buffer_config (), "notify::tile-cache-compression",
+                    G_CALLBACK (gegl_buffer_config_tile_cache_compression_notify),
+                    NULL);
+
+  gegl_buffer_config_tile_cache_compression_notify (
+    G_OBJECT (gegl_buffer_config ()), NULL, NULL);
 }
 
 void
 gegl_tile_cache_destroy (void)
 {
+  gint i;
+
   g_signal_handlers_disconnect_by_func (gegl_buffer_config(),
                                         gegl_buffer_config_tile_cache_size_notify,
                                         NULL);
-  g_warn_if_fail (g_queue_is_empty (&cache_queue));
+  g_signal_handlers_disconnect_by_func (gegl_buffer_config(),
+                                        gegl_buffer_config_tile_cache_compressed_size_notify,
+                                        NULL);
+  g_signal_handlers_disconnect_by_func (gegl_buffer_config(),
+                                        gegl_buffer_config_tile_cache_compression_notify,
+                                        NULL);
+  g_warn_if_fail (g_queue_is_empty (&compressed_queue));
+  compressed_compression = NULL;
+  for (i = 0; i < GEGL_CACHE_N_SHARDS; i++)
+    {
+      CacheShard *shard = &cache_shards[i];
 
+      g_warn_if_fail (g_queue_is_empty (&shard->queue));
 
-  if (g_queue_is_empty (&cache_queue))
-    {
-      g_queue_clear (&cache_queue);
-    }
-  else
-    {
-     /* we leak portions of the GQueue data structure when it is not empty,
-        permitting leaked tiles to still be unreffed correctly */
+      if (g_queue_is_empty (&shard->queue))
+        {
+          g_queue_clear (&shard->queue);
+          shard->hand = NULL;
+        }
+      else
+        {
+         /* we leak portions of the GQueue data structure when it is not empty,
+            permitting leaked tiles to still be unreffed correctly */
+        }
     }
 }
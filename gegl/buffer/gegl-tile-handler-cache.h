@@ -43,8 +43,9 @@ struct _GeglTileHandlerCache
   GList            link;
   GHashTable      *items;
   GQueue           queue;
-  guintptr         time;
-  guintptr         stamp;
+  gint             shard;      /* index of the global cache shard we belong to */
+  gint             referenced; /* CLOCK reference bit, set upon access */
+  GHashTable      *compressed_items; /* our tiles in the compressed tier */
 };
 
 struct _GeglTileHandlerCacheClass
@@ -78,6 +79,7 @@ void              gegl_tile_handler_cache_tile_uncloned      (GeglTileHandlerCac
 gsize             gegl_tile_handler_cache_get_total              (void);
 gsize             gegl_tile_handler_cache_get_total_max          (void);
 gsize             gegl_tile_handler_cache_get_total_uncompressed (void);
+gsize             gegl_tile_handler_cache_get_total_compressed   (void);
 gint              gegl_tile_handler_cache_get_hits               (void);
 gint              gegl_tile_handler_cache_get_misses             (void);
 
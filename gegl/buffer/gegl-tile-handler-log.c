@@ -37,6 +37,9 @@ static const char *commands[] =
   "-", /*void*/
   "flush",
   "refetch",
+  "reinit",
+  "copy",
+  "prefetch",
   "last command",
   "eeek",
   NULL
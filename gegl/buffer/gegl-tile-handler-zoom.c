@@ -27,32 +27,156 @@
 #include "gegl-buffer-types.h"
 #include "gegl-tile-handler.h"
 #include "gegl-tile-handler-cache.h"
+#include "gegl-tile-handler-chain.h"
 #include "gegl-tile-handler-private.h"
 #include "gegl-tile-handler-zoom.h"
 #include "gegl-tile-storage.h"
 #include "gegl-buffer-private.h"
 #include "gegl-algorithms.h"
 #include "gegl-cpuaccel.h"
+#include "gegl-scratch.h"
+#include "gegl-parallel.h"
+
+
+typedef struct
+{
+  gint x;
+  gint y;
+  gint z;
+} DirtyTile;
+
+typedef struct
+{
+  gint      x;
+  gint      y;
+  GeglTile *source_tile[2][2];
+  GeglTile *tile;
+} RebuildJob;
+
+typedef struct
+{
+  GeglTileHandlerZoomFilter  filter;
+  const Babl                *format;
+  gint                       bpp;
+  gint                       tile_width;
+  gint                       tile_height;
+  gint                       tile_size;
+  RebuildJob                *jobs;
+} RebuildData;
+
+
+static void gegl_tile_handler_zoom_finalize (GObject  *object);
+static void gegl_tile_handler_zoom_rebuild  (gpointer  data,
+                                             gpointer  user_data);
 
 
 G_DEFINE_TYPE (GeglTileHandlerZoom, gegl_tile_handler_zoom,
                GEGL_TYPE_TILE_HANDLER)
 
-static guint64 total_size = 0;
+static guintptr     total_size   = 0;
+static GThreadPool *rebuild_pool = NULL;
+
+
+static void
+update_filter (GeglTileHandlerZoom *zoom,
+               const Babl          *linear_format)
+{
+  GeglTileHandlerZoomFilter *filter = &zoom->filter;
+  const Babl                *format;
+  const Babl                *fun_format;
+
+  format     = gegl_tile_backend_get_format (zoom->backend);
+  fun_format = linear_format ? linear_format : format;
+
+#ifdef ARCH_X86_64
+  {
+    GeglCpuAccelFlags cpu_accel = gegl_cpu_accel_get_support ();
+    if (cpu_accel & GEGL_CPU_ACCEL_X86_64_V3)
+      filter->downscale_2x2 = gegl_downscale_2x2_get_fun_x86_64_v3 (fun_format);
+    else if (cpu_accel & GEGL_CPU_ACCEL_X86_64_V2)
+      filter->downscale_2x2 = gegl_downscale_2x2_get_fun_x86_64_v2 (fun_format);
+    else
+      filter->downscale_2x2 = gegl_downscale_2x2_get_fun_generic (fun_format);
+  }
+#else
+  filter->downscale_2x2 = gegl_downscale_2x2_get_fun_generic (fun_format);
+#endif
+
+  filter->linear_format = linear_format;
+
+  if (linear_format)
+    {
+      filter->to_linear   = babl_fish (format, linear_format);
+      filter->from_linear = babl_fish (linear_format, format);
+    }
+  else
+    {
+      filter->to_linear   = NULL;
+      filter->from_linear = NULL;
+    }
+}
+
+static void
+downscale_2x2 (const GeglTileHandlerZoomFilter *filter,
+               const Babl                      *format,
+               gint                             width,
+               gint                             height,
+               guchar                          *src,
+               gint                             src_stride,
+               guchar                          *dest,
+               gint                             dest_stride)
+{
+  const Babl *linear_format = filter->linear_format;
+
+  if (linear_format)
+    {
+      gint    linear_bpp = babl_format_get_bytes_per_pixel (linear_format);
+      gint    in_stride  = width * linear_bpp;
+      gint    out_stride = (width / 2) * linear_bpp;
+      guchar *in_linear;
+      guchar *out_linear;
+
+      in_linear  = gegl_scratch_alloc (height * in_stride);
+      out_linear = gegl_scratch_alloc ((height / 2) * out_stride);
+
+      babl_process_rows (filter->to_linear,
+                         src,       src_stride,
+                         in_linear, in_stride,
+                         width, height);
+      filter->downscale_2x2 (linear_format,
+                             width, height,
+                             in_linear,  in_stride,
+                             out_linear, out_stride);
+      babl_process_rows (filter->from_linear,
+                         out_linear, out_stride,
+                         dest,       dest_stride,
+                         width / 2, height / 2);
+
+      gegl_scratch_free (out_linear);
+      gegl_scratch_free (in_linear);
+    }
+  else
+    {
+      filter->downscale_2x2 (format,
+                             width, height,
+                             src,  src_stride,
+                             dest, dest_stride);
+    }
+}
 
 static void
-downscale (GeglTileHandlerZoom *zoom,
-           const Babl          *format,
-           gint                 bpp,
-           guchar              *src,
-           guchar              *dest,
-           gint                 stride,
-           gint                 x,
-           gint                 y,
-           gint                 width,
-           gint                 height,
-           guint                damage,
-           gint                 i)
+downscale (const GeglTileHandlerZoomFilter *filter,
+           const Babl                      *format,
+           gint                             bpp,
+           guchar                          *src,
+           guchar                          *dest,
+           gint                             stride,
+           gint                             x,
+           gint                             y,
+           gint                             width,
+           gint                             height,
+           guint                            damage,
+           gint                             i)
 {
   gint  n    = 1 << i;
   guint mask = (1 << n) - 1;
@@ -61,23 +185,11 @@ downscale (GeglTileHandlerZoom *zoom,
     {
       if (src)
         {
-          if (!zoom->downscale_2x2)
-          {
-#ifdef ARCH_X86_64
-             GeglCpuAccelFlags cpu_accel = gegl_cpu_accel_get_support ();
-             if (cpu_accel & GEGL_CPU_ACCEL_X86_64_V3)
-               zoom->downscale_2x2 = gegl_downscale_2x2_get_fun_x86_64_v3 (format);
-             else if (cpu_accel & GEGL_CPU_ACCEL_X86_64_V2)
-               zoom->downscale_2x2 = gegl_downscale_2x2_get_fun_x86_64_v2 (format);
-             else
-#endif
-             zoom->downscale_2x2 = gegl_downscale_2x2_get_fun_generic (format);
-          }
-
-          zoom->downscale_2x2 (format,
-                               width, height,
-                               src +   y      * stride +  x      * bpp, stride,
-                               dest + (y / 2) * stride + (x / 2) * bpp, stride);
+          downscale_2x2 (filter,
+                         format,
+                         width, height,
+                         src +   y      * stride +  x      * bpp, stride,
+                         dest + (y / 2) * stride + (x / 2) * bpp, stride);
         }
       else
         {
@@ -94,7 +206,7 @@ downscale (GeglTileHandlerZoom *zoom,
             }
         }
 
-      total_size += (width / 2) * (height / 2) * bpp;
+      g_atomic_pointer_add (&total_size, (width / 2) * (height / 2) * bpp);
     }
   else
     {
@@ -106,7 +218,7 @@ downscale (GeglTileHandlerZoom *zoom,
         {
           if (i & 1)
             {
-              downscale (zoom,
+              downscale (filter,
                          format, bpp, src, dest, stride,
                          x, y,
                          width, height / 2,
@@ -114,7 +226,7 @@ downscale (GeglTileHandlerZoom *zoom,
             }
           else
             {
-              downscale (zoom,
+              downscale (filter,
                          format, bpp, src, dest, stride,
                          x, y,
                          width / 2, height,
@@ -129,7 +241,7 @@ downscale (GeglTileHandlerZoom *zoom,
         {
           if (i & 1)
             {
-              downscale (zoom,
+              downscale (filter,
                          format, bpp, src, dest, stride,
                          x, y + height / 2,
                          width, height / 2,
@@ -137,7 +249,7 @@ downscale (GeglTileHandlerZoom *zoom,
             }
           else
             {
-              downscale (zoom,
+              downscale (filter,
                          format, bpp, src, dest, stride,
                          x + width / 2, y,
                          width / 2, height,
@@ -278,7 +390,7 @@ get_tile (GeglTileSource *gegl_tile_source,
 
               dest = gegl_tile_get_data (tile) + y * stride + x * bpp;
 
-              downscale (zoom,
+              downscale (&zoom->filter,
                          format, bpp, src, dest, stride,
                          0, 0,
                          tile_width, tile_height,
@@ -299,6 +411,305 @@ get_tile (GeglTileSource *gegl_tile_source,
   return tile;
 }
 
+static guint
+dirty_tile_hash (gconstpointer key)
+{
+  const DirtyTile *dirty_tile = key;
+
+  return ((guint) dirty_tile->x * 0x9e3779b1u) ^
+         ((guint) dirty_tile->y * 0x85ebca6bu) ^
+          (guint) dirty_tile->z;
+}
+
+static gboolean
+dirty_tile_equal (gconstpointer a,
+                  gconstpointer b)
+{
+  const DirtyTile *dirty_tile_a = a;
+  const DirtyTile *dirty_tile_b = b;
+
+  return dirty_tile_a->x == dirty_tile_b->x &&
+         dirty_tile_a->y == dirty_tile_b->y &&
+         dirty_tile_a->z == dirty_tile_b->z;
+}
+
+static void
+dirty_tile_free (DirtyTile *dirty_tile)
+{
+  g_slice_free (DirtyTile, dirty_tile);
+}
+
+/* records a voided tile of an eagerly-generated level, and queues a rebuild
+ * if there isn't one pending already.  called with the storage mutex held.
+ */
+static void
+mark_dirty (GeglTileHandlerZoom *zoom,
+            gint                 x,
+            gint                 y,
+            gint                 z)
+{
+  DirtyTile key = {x, y, z};
+
+  g_mutex_lock (&zoom->dirty_mutex);
+
+  if (z <= zoom->eager_levels && ! g_hash_table_contains (zoom->dirty, &key))
+    {
+      DirtyTile *dirty_tile = g_slice_dup (DirtyTile, &key);
+
+      g_hash_table_add (zoom->dirty, dirty_tile);
+
+      if (! zoom->rebuild_queued && rebuild_pool)
+        {
+          GeglTileStorage *tile_storage;
+
+          tile_storage = _gegl_tile_handler_get_tile_storage (
+            (GeglTileHandler *) zoom);
+
+          zoom->rebuild_queued = TRUE;
+
+          g_thread_pool_push (rebuild_pool, g_object_ref (tile_storage), NULL);
+        }
+    }
+
+  g_mutex_unlock (&zoom->dirty_mutex);
+}
+
+static RebuildJob *
+rebuild_collect (GeglTileHandlerZoom *zoom,
+                 gint                 z,
+                 gint                *n_jobs)
+{
+  RebuildJob     *jobs;
+  GHashTableIter  iter;
+  DirtyTile      *dirty_tile;
+  gint            n = 0;
+
+  g_mutex_lock (&zoom->dirty_mutex);
+
+  jobs = g_new0 (RebuildJob, g_hash_table_size (zoom->dirty));
+
+  g_hash_table_iter_init (&iter, zoom->dirty);
+
+  while (g_hash_table_iter_next (&iter, (gpointer *) &dirty_tile, NULL))
+    {
+      if (dirty_tile->z == z)
+        {
+          jobs[n].x = dirty_tile->x;
+          jobs[n].y = dirty_tile->y;
+          n++;
+
+          g_hash_table_iter_remove (&iter);
+        }
+    }
+
+  g_mutex_unlock (&zoom->dirty_mutex);
+
+  *n_jobs = n;
+
+  return jobs;
+}
+
+static void
+rebuild_range (gsize    offset,
+               gsize    size,
+               gpointer user_data)
+{
+  RebuildData *data   = user_data;
+  gint         stride = data->tile_width * data->bpp;
+  gsize        k;
+
+  for (k = offset; k < offset + size; k++)
+    {
+      RebuildJob *job = &data->jobs[k];
+      gint        i, j;
+
+      job->tile = gegl_tile_new (data->tile_size);
+
+      for (i = 0; i < 2; i++)
+        for (j = 0; j < 2; j++)
+          {
+            GeglTile *source_tile = job->source_tile[i][j];
+            guchar   *src         = NULL;
+            guchar   *dest;
+
+            if (source_tile)
+              {
+                gegl_tile_read_lock (source_tile);
+
+                src = gegl_tile_get_data (source_tile);
+              }
+
+            dest = gegl_tile_get_data (job->tile)       +
+                   (j * data->tile_height / 2) * stride +
+                   (i * data->tile_width  / 2) * data->bpp;
+
+            downscale (&data->filter,
+                       data->format, data->bpp, src, dest, stride,
+                       0, 0,
+                       data->tile_width, data->tile_height,
+                       0xffff, 4);
+
+            if (source_tile)
+              gegl_tile_read_unlock (source_tile);
+          }
+    }
+}
+
+/* rebuilds the dirty tiles of a single level.  the lower-level tiles are
+ * fetched, and the new tiles are installed, under the storage mutex; the
+ * filtering itself is distributed across the parallel pool.  tiles that are
+ * voided again while they're being rebuilt are left to the next round, or to
+ * get_tile().
+ */
+static void
+rebuild_level (GeglTileHandlerZoom *zoom,
+               GeglTileStorage     *tile_storage,
+               gint                 z)
+{
+  GeglTileSource       *source = GEGL_TILE_SOURCE (zoom);
+  GeglTileHandlerCache *cache;
+  RebuildData           data;
+  RebuildJob           *jobs;
+  gint                  n_jobs;
+  gint                  n;
+  gint                  k;
+
+  cache = _gegl_tile_handler_get_cache ((GeglTileHandler *) zoom);
+
+  g_rec_mutex_lock (&tile_storage->mutex);
+
+  jobs = rebuild_collect (zoom, z, &n_jobs);
+
+  /* set_mode() may change the filter once we drop the mutex */
+  data.filter = zoom->filter;
+
+  for (k = 0, n = 0; k < n_jobs; k++)
+    {
+      RebuildJob *job   = &jobs[n];
+      gboolean    empty = TRUE;
+      gint        i, j;
+
+      *job = jobs[k];
+
+      for (i = 0; i < 2; i++)
+        for (j = 0; j < 2; j++)
+          {
+            GeglTile *source_tile;
+
+            source_tile = gegl_tile_source_get_tile (source,
+                                                     job->x * 2 + i,
+                                                     job->y * 2 + j,
+                                                     z - 1);
+
+            if (source_tile && source_tile->is_zero_tile)
+              {
+                gegl_tile_unref (source_tile);
+
+                source_tile = NULL;
+              }
+
+            if (source_tile)
+              empty = FALSE;
+
+            job->source_tile[i][j] = source_tile;
+          }
+
+      /* empty tiles are left to get_tile(), which lets the empty handler
+       * fill them in.
+       */
+      if (! empty)
+        n++;
+    }
+
+  g_rec_mutex_unlock (&tile_storage->mutex);
+
+  if (n == 0)
+    {
+      g_free (jobs);
+
+      return;
+    }
+
+  data.format      = gegl_tile_backend_get_format (zoom->backend);
+  data.bpp         = babl_format_get_bytes_per_pixel (data.format);
+  data.tile_width  = tile_storage->tile_width;
+  data.tile_height = tile_storage->tile_height;
+  data.tile_size   = tile_storage->tile_size;
+  data.jobs        = jobs;
+
+  gegl_parallel_distribute_range (n, 1.0, rebuild_range, &data);
+
+  g_rec_mutex_lock (&tile_storage->mutex);
+  g_mutex_lock (&zoom->dirty_mutex);
+
+  for (k = 0; k < n; k++)
+    {
+      RebuildJob *job = &jobs[k];
+      DirtyTile   key = {job->x, job->y, z};
+      gint        i, j;
+
+      if (cache && ! g_hash_table_contains (zoom->dirty, &key))
+        gegl_tile_handler_cache_insert (cache, job->tile, job->x, job->y, z);
+
+      gegl_tile_unref (job->tile);
+
+      for (i = 0; i < 2; i++)
+        for (j = 0; j < 2; j++)
+          {
+            if (job->source_tile[i][j])
+              gegl_tile_unref (job->source_tile[i][j]);
+          }
+    }
+
+  g_mutex_unlock (&zoom->dirty_mutex);
+  g_rec_mutex_unlock (&tile_storage->mutex);
+
+  g_free (jobs);
+}
+
+static void
+gegl_tile_handler_zoom_rebuild (gpointer data,
+                                gpointer user_data)
+{
+  GeglTileStorage     *tile_storage = data;
+  GeglTileHandlerZoom *zoom;
+
+  zoom = (GeglTileHandlerZoom *) gegl_tile_handler_chain_get_first (
+    GEGL_TILE_HANDLER_CHAIN (tile_storage), GEGL_TYPE_TILE_HANDLER_ZOOM);
+
+  while (TRUE)
+    {
+      gint eager_levels;
+      gint z;
+
+      g_mutex_lock (&zoom->dirty_mutex);
+
+      /* if we're holding the last reference to the storage, there's no one
+       * left to look at the result.
+       */
+      if (g_atomic_int_get (&G_OBJECT (tile_storage)->ref_count) == 1)
+        g_hash_table_remove_all (zoom->dirty);
+
+      if (g_hash_table_size (zoom->dirty) == 0)
+        {
+          zoom->rebuild_queued = FALSE;
+
+          g_mutex_unlock (&zoom->dirty_mutex);
+
+          break;
+        }
+
+      eager_levels = zoom->eager_levels;
+
+      g_mutex_unlock (&zoom->dirty_mutex);
+
+      for (z = 1; z <= eager_levels; z++)
+        rebuild_level (zoom, tile_storage, z);
+    }
+
+  g_object_unref (tile_storage);
+}
+
 static gpointer
 gegl_tile_handler_zoom_command (GeglTileSource  *tile_store,
                                 GeglTileCommand  command,
@@ -307,23 +718,63 @@ gegl_tile_handler_zoom_command (GeglTileSource  *tile_store,
                                 gint             z,
                                 gpointer         data)
 {
-  GeglTileHandler *handler  = (void*)tile_store;
+  GeglTileHandler     *handler = (void*)tile_store;
+  GeglTileHandlerZoom *zoom    = (GeglTileHandlerZoom *) tile_store;
 
-  if (command == GEGL_TILE_GET)
-    return get_tile (tile_store, x, y, z);
-  else
-    return gegl_tile_handler_source_command (handler, command, x, y, z, data);
+  switch (command)
+    {
+      case GEGL_TILE_GET:
+        return get_tile (tile_store, x, y, z);
+
+      case GEGL_TILE_VOID:
+        if (z > 0 && z <= zoom->eager_levels)
+          mark_dirty (zoom, x, y, z);
+        break;
+
+      case GEGL_TILE_REINIT:
+        g_mutex_lock (&zoom->dirty_mutex);
+        g_hash_table_remove_all (zoom->dirty);
+        g_mutex_unlock (&zoom->dirty_mutex);
+        break;
+
+      default:
+        break;
+    }
+
+  return gegl_tile_handler_source_command (handler, command, x, y, z, data);
 }
 
 static void
 gegl_tile_handler_zoom_class_init (GeglTileHandlerZoomClass *klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = gegl_tile_handler_zoom_finalize;
+
+  rebuild_pool = g_thread_pool_new (gegl_tile_handler_zoom_rebuild, NULL,
+                                    1, FALSE, NULL);
 }
 
 static void
 gegl_tile_handler_zoom_init (GeglTileHandlerZoom *self)
 {
   ((GeglTileSource *) self)->command = gegl_tile_handler_zoom_command;
+
+  g_mutex_init (&self->dirty_mutex);
+  self->dirty = g_hash_table_new_full (dirty_tile_hash, dirty_tile_equal,
+                                       (GDestroyNotify) dirty_tile_free,
+                                       NULL);
+}
+
+static void
+gegl_tile_handler_zoom_finalize (GObject *object)
+{
+  GeglTileHandlerZoom *zoom = GEGL_TILE_HANDLER_ZOOM (object);
+
+  g_hash_table_unref (zoom->dirty);
+  g_mutex_clear (&zoom->dirty_mutex);
+
+  G_OBJECT_CLASS (gegl_tile_handler_zoom_parent_class)->finalize (object);
 }
 
 GeglTileHandler *
@@ -333,17 +784,96 @@ gegl_tile_handler_zoom_new (GeglTileBackend *backend)
 
   ret->backend = backend;
 
+  update_filter (ret, NULL);
+
   return (void*)ret;
 }
 
+/* picks the linear float format in which levels of format are filtered, or
+ * NULL if format is filtered as is.
+ */
+static const Babl *
+get_linear_format (const Babl *format)
+{
+  const Babl    *space  = babl_format_get_space (format);
+  BablModelFlag  flags  = babl_get_model_flags (babl_format_get_model (format));
+  gboolean       alpha  = babl_format_has_alpha (format);
+  const Babl    *linear = NULL;
+
+  if (flags & BABL_MODEL_FLAG_CMYK)
+    return NULL;
+  else if (flags & BABL_MODEL_FLAG_RGB)
+    linear = babl_format_with_space (alpha ? "RaGaBaA float" : "RGB float",
+                                     space);
+  else if (flags & BABL_MODEL_FLAG_GRAYSCALE)
+    linear = babl_format_with_space (alpha ? "YaA float" : "Y float",
+                                     space);
+
+  if (linear == format)
+    return NULL;
+
+  return linear;
+}
+
+void
+gegl_tile_handler_zoom_set_mode (GeglTileHandlerZoom *zoom,
+                                 gint                 eager_levels,
+                                 gboolean             linear)
+{
+  GeglTileStorage *tile_storage;
+  const Babl      *linear_format = NULL;
+
+  g_return_if_fail (GEGL_IS_TILE_HANDLER_ZOOM (zoom));
+  g_return_if_fail (eager_levels >= 0);
+
+  tile_storage = _gegl_tile_handler_get_tile_storage ((GeglTileHandler *) zoom);
+
+  g_rec_mutex_lock (&tile_storage->mutex);
+
+  if (linear)
+    linear_format = get_linear_format (gegl_tile_backend_get_format (zoom->backend));
+
+  if (linear_format != zoom->filter.linear_format)
+    update_filter (zoom, linear_format);
+
+  g_mutex_lock (&zoom->dirty_mutex);
+
+  zoom->eager_levels = eager_levels;
+
+  if (eager_levels == 0)
+    g_hash_table_remove_all (zoom->dirty);
+
+  g_mutex_unlock (&zoom->dirty_mutex);
+
+  /* make sure writes to the base level are propagated to the eager levels */
+  if (eager_levels > tile_storage->seen_zoom)
+    tile_storage->seen_zoom = eager_levels;
+
+  g_rec_mutex_unlock (&tile_storage->mutex);
+}
+
+/* finishes the pending rebuilds, and stops the rebuild thread.  the eager
+ * levels of buffers written to afterwards are left dirty.
+ */
+void
+gegl_tile_handler_zoom_cleanup (void)
+{
+  if (rebuild_pool)
+    {
+      g_thread_pool_free (rebuild_pool, FALSE, TRUE);
+
+      rebuild_pool = NULL;
+    }
+}
+
 guint64
 gegl_tile_handler_zoom_get_total (void)
 {
-  return total_size;
+  return (guintptr) g_atomic_pointer_get (&total_size);
 }
 
 void
 gegl_tile_handler_zoom_reset_stats (void)
 {
-  total_size = 0;
+  g_atomic_pointer_set (&total_size, 0);
 }
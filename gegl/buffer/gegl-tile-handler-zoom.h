@@ -47,12 +47,32 @@ typedef void (*GeglDownscale2x2Fun) (const Babl *format,
                                      guchar *dst_data,
                                      gint    dst_rowstride);
 
-struct _GeglTileHandlerZoom
+/* how levels are filtered.  when linear_format is set, tiles are converted
+ * to it, filtered, and converted back to the backend format.
+ */
+typedef struct
 {
-  GeglTileHandler       parent_instance;
-  GeglTileBackend      *backend;
-  GeglTileStorage      *tile_storage;
   GeglDownscale2x2Fun   downscale_2x2;
+  const Babl           *linear_format;
+  const Babl           *to_linear;
+  const Babl           *from_linear;
+} GeglTileHandlerZoomFilter;
+
+struct _GeglTileHandlerZoom
+{
+  GeglTileHandler            parent_instance;
+  GeglTileBackend           *backend;
+  GeglTileStorage           *tile_storage;
+  GeglTileHandlerZoomFilter  filter;
+
+  /* levels 1 through eager_levels are rebuilt in the background after the
+   * base level is written to.  dirty holds the voided tiles of these levels,
+   * and is protected by dirty_mutex.
+   */
+  gint                       eager_levels;
+  GMutex                     dirty_mutex;
+  GHashTable                *dirty;
+  gboolean                   rebuild_queued;
 };
 
 struct _GeglTileHandlerZoomClass
@@ -64,6 +84,10 @@ GType             gegl_tile_handler_zoom_get_type (void) G_GNUC_CONST;
 
 GeglTileHandler * gegl_tile_handler_zoom_new      (GeglTileBackend *backend);
 
+void              gegl_tile_handler_zoom_set_mode (GeglTileHandlerZoom *zoom,
+                                                   gint                 eager_levels,
+                                                   gboolean             linear);
+
 guint64           gegl_tile_handler_zoom_get_total   (void);
 void              gegl_tile_handler_zoom_reset_stats (void);
 
@@ -259,6 +259,29 @@ gegl_tile_source_refetch (GeglTileSource *source,
 {
   gegl_tile_source_command (source, GEGL_TILE_REFETCH, x, y, z, NULL);
 }
+/*   INTERNAL API
+ * gegl_tile_source_prefetch:
+ * @source: a GeglTileSource *
+ * @x: x coordinate
+ * @y: y coordinate
+ * @z: tile zoom level
+ *
+ * A hint that the tile at the given coordinates is going to be requested
+ * soon.  Handlers and backends that can't provide the tile cheaply may start
+ * loading it in the background, so that the subsequent get is fast.
+ *
+ * Returns: TRUE if the tile is being prefetched.
+ */
+static inline gboolean
+gegl_tile_source_prefetch (GeglTileSource *source,
+                           gint            x,
+                           gint            y,
+                           gint            z)
+{
+  return gegl_tile_source_command (source, GEGL_TILE_PREFETCH,
+                                   x, y, z, NULL) != NULL;
+}
+
 /*   INTERNAL API
  * gegl_tile_source_idle:
  * @source: a GeglTileSource *
@@ -54,6 +54,10 @@ struct _GeglTileStorage
 
   GeglTile      *hot_tile; /* cached tile for speeding up gegl_buffer_get_pixel
                               and gegl_buffer_set_pixel (1x1 sized gets/sets)*/
+
+  guint          generation; /* incremented whenever a tile of any level
+                                changes, used to invalidate cached buffer
+                                statistics */
 };
 
 struct _GeglTileStorageClass
@@ -76,4 +80,9 @@ GeglTile * gegl_tile_storage_try_steal_hot_tile (GeglTileStorage *tile_storage,
 void       gegl_tile_storage_take_hot_tile      (GeglTileStorage *tile_storage,
                                                  GeglTile        *tile);
 
+#define    gegl_tile_storage_changed(tile_storage) \
+  g_atomic_int_inc (&(tile_storage)->generation)
+#define    gegl_tile_storage_get_generation(tile_storage) \
+  ((guint) g_atomic_int_get (&(tile_storage)->generation))
+
 #endif
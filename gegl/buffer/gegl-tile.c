@@ -44,6 +44,16 @@ enum
   CLONE_STATE_UNCLONING
 };
 
+/* the n_clones array of read-only tiles, along with the function releasing
+ * their data.
+ */
+typedef struct
+{
+  gint           n_clones[2];
+  GDestroyNotify destroy_notify;
+  gpointer       destroy_notify_data;
+} ReadOnlyData;
+
 GeglTile *gegl_tile_ref (GeglTile *tile)
 {
   g_atomic_int_inc (&tile->ref_count);
@@ -133,6 +143,7 @@ gegl_tile_dup (GeglTile *src)
       tile->size                = src->size;
       tile->is_zero_tile        = src->is_zero_tile;
       tile->is_global_tile      = src->is_global_tile;
+      tile->is_read_only        = src->is_read_only;
       tile->clone_state         = CLONE_STATE_CLONED;
       tile->n_clones            = src->n_clones;
 
@@ -183,18 +194,65 @@ gegl_tile_new (gint size)
   return tile;
 }
 
+static void
+gegl_tile_read_only_data_free (ReadOnlyData *read_only)
+{
+  if (read_only->destroy_notify)
+    read_only->destroy_notify (read_only->destroy_notify_data);
+
+  g_slice_free (ReadOnlyData, read_only);
+}
+
+GeglTile *
+gegl_tile_new_read_only (gconstpointer  data,
+                         gint           size,
+                         GDestroyNotify destroy_notify,
+                         gpointer       destroy_notify_data)
+{
+  GeglTile     *tile      = gegl_tile_new_bare_internal ();
+  ReadOnlyData *read_only = g_slice_new (ReadOnlyData);
+
+  read_only->n_clones[0]         = 1;
+  read_only->n_clones[1]         = 0;
+  read_only->destroy_notify      = destroy_notify;
+  read_only->destroy_notify_data = destroy_notify_data;
+
+  tile->data         = (guchar *) data;
+  tile->size         = size;
+  tile->is_read_only = TRUE;
+  /* make sure the first write lock goes through gegl_tile_unclone() */
+  tile->clone_state  = CLONE_STATE_CLONED;
+  tile->n_clones     = read_only->n_clones;
+
+  tile->destroy_notify      = (GDestroyNotify) gegl_tile_read_only_data_free;
+  tile->destroy_notify_data = read_only;
+
+  return tile;
+}
+
 static inline void
 gegl_tile_unclone (GeglTile *tile)
 {
-  if (*gegl_tile_n_clones (tile) > 1)
+  if (*gegl_tile_n_clones (tile) > 1 || tile->is_read_only)
     {
       GeglTileHandlerCache *notify_cache = NULL;
       gboolean              cached;
       gboolean              global;
+      gboolean              read_only;
+      gboolean              release    = FALSE;
+      GDestroyNotify        destroy_notify;
+      gpointer              destroy_notify_data;
 
       global               = tile->is_global_tile;
       tile->is_global_tile = FALSE;
 
+      /* read-only data has to be copied even if we're its only user, and
+       * released once it's no longer shared.
+       */
+      read_only           = tile->is_read_only;
+      destroy_notify      = tile->destroy_notify;
+      destroy_notify_data = tile->destroy_notify_data;
+
       if (! global)
         {
           while (! g_atomic_int_compare_and_exchange (&tile->read_lock_count,
@@ -224,13 +282,20 @@ gegl_tile_unclone (GeglTile *tile)
 
           if (g_atomic_int_dec_and_test (gegl_tile_n_clones (tile)))
             {
-              /* someone else uncloned the tile in the meantime, and we're now
-               * the last copy; bail.
-               */
-              *gegl_tile_n_clones (tile)        = 1;
-              *gegl_tile_n_cached_clones (tile) = cached;
-
-              goto end;
+              if (read_only)
+                {
+                  release = TRUE;
+                }
+              else
+                {
+                  /* someone else uncloned the tile in the meantime, and
+                   * we're now the last copy; bail.
+                   */
+                  *gegl_tile_n_clones (tile)        = 1;
+                  *gegl_tile_n_cached_clones (tile) = cached;
+
+                  goto end;
+                }
             }
 
           tile->data = gegl_tile_alloc (tile->size);
@@ -241,13 +306,20 @@ gegl_tile_unclone (GeglTile *tile)
 
           if (g_atomic_int_dec_and_test (gegl_tile_n_clones (tile)))
             {
-              /* someone else uncloned the tile in the meantime, and we're now
-               * the last copy; bail.
-               */
-              *gegl_tile_n_clones (tile)        = 1;
-              *gegl_tile_n_cached_clones (tile) = cached;
-
-              goto end;
+              if (read_only)
+                {
+                  release = TRUE;
+                }
+              else
+                {
+                  /* someone else uncloned the tile in the meantime, and
+                   * we're now the last copy; bail.
+                   */
+                  *gegl_tile_n_clones (tile)        = 1;
+                  *gegl_tile_n_cached_clones (tile) = cached;
+
+                  goto end;
+                }
             }
 
           tile->data = gegl_tile_alloc0 (tile->size);
@@ -261,14 +333,21 @@ gegl_tile_unclone (GeglTile *tile)
 
           if (g_atomic_int_dec_and_test (gegl_tile_n_clones (tile)))
             {
-              /* someone else uncloned the tile in the meantime, and we're now
-               * the last copy; bail.
-               */
-              gegl_tile_free (buf);
-              *gegl_tile_n_clones (tile)        = 1;
-              *gegl_tile_n_cached_clones (tile) = cached;
-
-              goto end;
+              if (read_only)
+                {
+                  release = TRUE;
+                }
+              else
+                {
+                  /* someone else uncloned the tile in the meantime, and
+                   * we're now the last copy; bail.
+                   */
+                  gegl_tile_free (buf);
+                  *gegl_tile_n_clones (tile)        = 1;
+                  *gegl_tile_n_cached_clones (tile) = cached;
+
+                  goto end;
+                }
             }
 
           tile->data = buf;
@@ -281,6 +360,11 @@ gegl_tile_unclone (GeglTile *tile)
       tile->destroy_notify      = (gpointer) &free_data_directly;
       tile->destroy_notify_data = NULL;
 
+      tile->is_read_only = FALSE;
+
+      if (release)
+        destroy_notify (destroy_notify_data);
+
 end:
       if (notify_cache)
         gegl_tile_handler_cache_tile_uncloned (notify_cache, tile);
@@ -353,6 +437,9 @@ gegl_tile_unlock (GeglTile *tile)
           tile->unlock_notify (tile, tile->unlock_notify_data);
         }
 
+      if (tile->tile_storage)
+        gegl_tile_storage_changed (tile->tile_storage);
+
       if (tile->z == 0)
         {
           gegl_tile_void_pyramid (tile, ~(guint64) 0);
@@ -372,6 +459,9 @@ gegl_tile_unlock_no_void (GeglTile *tile)
         {
           tile->unlock_notify (tile, tile->unlock_notify_data);
         }
+
+      if (tile->tile_storage)
+        gegl_tile_storage_changed (tile->tile_storage);
     }
 }
 
@@ -58,6 +58,8 @@ enum
   PROP_0,
   PROP_QUALITY,
   PROP_TILE_CACHE_SIZE,
+  PROP_TILE_CACHE_COMPRESSED_SIZE,
+  PROP_TILE_CACHE_COMPRESSION,
   PROP_CHUNK_SIZE,
   PROP_SWAP,
   PROP_SWAP_COMPRESSION,
@@ -86,6 +88,14 @@ gegl_config_get_property (GObject    *gobject,
         g_value_set_uint64 (value, config->tile_cache_size);
         break;
 
+      case PROP_TILE_CACHE_COMPRESSED_SIZE:
+        g_value_set_uint64 (value, config->tile_cache_compressed_size);
+        break;
+
+      case PROP_TILE_CACHE_COMPRESSION:
+        g_value_set_string (value, config->tile_cache_compression);
+        break;
+
       case PROP_CHUNK_SIZE:
         g_value_set_int (value, config->chunk_size);
         break;
@@ -149,6 +159,13 @@ gegl_config_set_property (GObject      *gobject,
       case PROP_TILE_CACHE_SIZE:
         config->tile_cache_size = g_value_get_uint64 (value);
         break;
+      case PROP_TILE_CACHE_COMPRESSED_SIZE:
+        config->tile_cache_compressed_size = g_value_get_uint64 (value);
+        break;
+      case PROP_TILE_CACHE_COMPRESSION:
+        g_free (config->tile_cache_compression);
+        config->tile_cache_compression = g_value_dup_string (value);
+        break;
       case PROP_CHUNK_SIZE:
         config->chunk_size = g_value_get_int (value);
         break;
@@ -198,6 +215,7 @@ gegl_config_finalize (GObject *gobject)
 
   g_free (config->swap);
   g_free (config->swap_compression);
+  g_free (config->tile_cache_compression);
   g_free (config->application_license);
 
   G_OBJECT_CLASS (gegl_config_parent_class)->finalize (gobject);
@@ -348,6 +366,22 @@ gegl_config_class_init (GeglConfigClass *klass)
                                      G_PARAM_STATIC_STRINGS));
   }
 
+  g_object_class_install_property (gobject_class, PROP_TILE_CACHE_COMPRESSED_SIZE,
+                                   g_param_spec_uint64 ("tile-cache-compressed-size",
+                                                        "Compressed tile cache size",
+                                                        "size of the compressed tier of the tile cache in bytes, holding tiles evicted from the tile cache; 0 disables it",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TILE_CACHE_COMPRESSION,
+                                   g_param_spec_string ("tile-cache-compression",
+                                                        "Tile cache compression",
+                                                        "compression algorithm used for the compressed tier of the tile cache",
+                                                        NULL,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (gobject_class, PROP_CHUNK_SIZE,
                                    g_param_spec_int ("chunk-size",
                                                      "Chunk size",
@@ -448,6 +482,8 @@ gegl_config_init (GeglConfig *self)
                          "tile-width",
                          "tile-height",
                          "tile-cache-size",
+                         "tile-cache-compressed-size",
+                         "tile-cache-compression",
                          NULL};
   GeglBufferConfig *bconf = gegl_buffer_config ();
   for (int i = 0; forward_props[i]; i++)
@@ -38,6 +38,8 @@ struct _GeglConfig
   gchar   *swap;
   gchar   *swap_compression;
   guint64  tile_cache_size;
+  guint64  tile_cache_compressed_size;
+  gchar   *tile_cache_compression;
   gint     chunk_size; /* The size of elements being processed at once */
   gdouble  quality;
   gint     tile_width;
@@ -97,7 +97,8 @@ guint gegl_debug_flags = 0;
 #include "graph/gegl-node-private.h"
 #include "gegl-random-private.h"
 #include "gegl-parallel-private.h"
-#include "gegl-cpuaccel.h"
+#include "gegl-trace.h"
+#include "gegl-cpuaccel-private.h"
 
 static gboolean      gegl_post_parse_hook      (GOptionContext *context,
                                                 GOptionGroup   *group,
@@ -517,6 +518,14 @@ gegl_config_parse_env (GeglConfig *config)
                     NULL);
     }
 
+  if (g_getenv ("GEGL_CACHE_COMPRESSED_SIZE"))
+    {
+      g_object_set (config,
+                    "tile-cache-compressed-size",
+                    (guint64) atoll(g_getenv("GEGL_CACHE_COMPRESSED_SIZE")) * 1024 * 1024,
+                    NULL);
+    }
+
   if (g_getenv ("GEGL_CHUNK_SIZE"))
     config->chunk_size = atoi(g_getenv("GEGL_CHUNK_SIZE"));
 
@@ -568,6 +577,16 @@ gegl_config_parse_env (GeglConfig *config)
         g_warning ("Unknown value for GEGL_USE_OPENCL: %s", opencl_env);
     }
 
+  if (g_getenv ("GEGL_USE_SIMD"))
+    {
+      const char *simd_env = g_getenv ("GEGL_USE_SIMD");
+
+      if (g_ascii_strcasecmp (simd_env, "no") == 0)
+        gegl_cpu_accel_set_use (FALSE);
+      else if (g_ascii_strcasecmp (simd_env, "yes") != 0)
+        g_warning ("Unknown value for GEGL_USE_SIMD: %s", simd_env);
+    }
+
   if (g_getenv ("GEGL_SWAP"))
     g_object_set (config, "swap", g_getenv ("GEGL_SWAP"), NULL);
 
@@ -617,6 +636,7 @@ gegl_exit (void)
 
   GEGL_INSTRUMENT_START()
 
+  gegl_tile_handler_zoom_cleanup ();
   gegl_tile_backend_swap_cleanup ();
   gegl_tile_cache_destroy ();
   gegl_operation_gtype_cleanup ();
@@ -624,6 +644,7 @@ gegl_exit (void)
   gegl_compression_cleanup ();
   gegl_random_cleanup ();
   gegl_parallel_cleanup ();
+  gegl_trace_cleanup ();
   gegl_buffer_swap_cleanup ();
   gegl_tile_alloc_cleanup ();
   gegl_cl_cleanup ();
@@ -782,6 +803,9 @@ gegl_post_parse_hook (GOptionContext *context,
   if (g_getenv ("GEGL_DEBUG_TIME") != NULL)
     gegl_instrument_enable ();
 
+  if (g_getenv ("GEGL_TRACE") != NULL)
+    gegl_trace_enable (g_getenv ("GEGL_TRACE"));
+
   gegl_instrument ("gegl", "gegl_init", 0);
 
   config = gegl_config ();
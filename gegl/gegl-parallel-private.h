@@ -31,12 +31,22 @@ gdouble   gegl_parallel_distribute_get_thread_time       (void);
 gint      gegl_parallel_distribute_get_optimal_n_threads (gdouble n_elements,
                                                           gdouble thread_cost);
 
+gboolean  gegl_parallel_is_worker_thread                 (void);
+
 
 /*  stats  */
 
 gint      gegl_parallel_get_n_assigned_worker_threads    (void);
 gint      gegl_parallel_get_n_active_worker_threads      (void);
 
+gint      gegl_parallel_get_n_worker_threads             (void);
+void      gegl_parallel_get_worker_thread_stats          (gint     i,
+                                                          gdouble *busy_time,
+                                                          gdouble *idle_time,
+                                                          gint    *n_steals);
+
+void      gegl_parallel_reset_stats                      (void);
+
 
 G_END_DECLS
 
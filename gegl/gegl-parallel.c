@@ -27,29 +27,66 @@
 #include "gegl-config.h"
 #include "gegl-parallel.h"
 #include "gegl-parallel-private.h"
+#include "gegl-trace.h"
 
 
 #define GEGL_PARALLEL_DISTRIBUTE_MAX_THREADS           GEGL_MAX_THREADS
 #define GEGL_PARALLEL_DISTRIBUTE_THREAD_TIME_N_SAMPLES 10
+/* the number of parts per thread range and area distributions are split into,
+ * when the work is large enough, so that threads finishing early can pick up
+ * the remaining parts of threads that are lagging behind.
+ */
+#define GEGL_PARALLEL_DISTRIBUTE_PARTS_PER_THREAD      4
+/* the maximal fraction of the total work the per-part overhead of the extra
+ * parts may amount to
+ */
+#define GEGL_PARALLEL_DISTRIBUTE_MAX_PART_OVERHEAD     (1.0 / 16.0)
 
 
+typedef struct _GeglParallelDistributeQueue GeglParallelDistributeQueue;
+
+/* a call to gegl_parallel_distribute().  the parts of the task are claimed
+ * one at a time, by any thread that picks up the task, until none are left.
+ */
 typedef struct
 {
-  GeglParallelDistributeFunc func;
-  gint                       n;
-  gpointer                   user_data;
+  GeglParallelDistributeFunc   func;
+  gint                         n;
+  gpointer                     user_data;
+
+  GeglParallelDistributeQueue *queue;
+  volatile gint                next;  /* the next part to claim */
+  volatile gint                users; /* the number of threads holding the
+                                       * task, including its owner
+                                       */
+
+  const gchar                 *trace_name; /* the span the task was created
+                                            * in, when tracing
+                                            */
 } GeglParallelDistributeTask;
 
+/* a task deque.  threads push the tasks they create, and pop the most recent
+ * ones, at its tail, while other threads steal the oldest tasks at its head.
+ */
+struct _GeglParallelDistributeQueue
+{
+  GMutex                       mutex;
+  GQueue                       tasks;
+};
+
 typedef struct
 {
-  GThread                    *thread;
-  GMutex                      mutex;
-  GCond                       cond;
+  GThread                     *thread;
+  gint                         index;
+  gboolean                     quit;
 
-  gboolean                    quit;
+  GeglParallelDistributeQueue  queue;
 
-  GeglParallelDistributeTask *volatile task;
-  volatile gint               i;
+  gboolean                     busy;
+  gint64                       state_time;
+  gint64                       busy_time;
+  gint64                       idle_time;
+  gint                         n_steals;
 } GeglParallelDistributeThread;
 
 
@@ -60,6 +97,12 @@ static void          gegl_parallel_notify_threads                   (GeglConfig
 static void          gegl_parallel_set_n_threads                    (gint                          n_threads,
                                                                      gboolean                      finish_tasks);
 
+static void          gegl_parallel_distribute_internal              (gint                          n,
+                                                                     GeglParallelDistributeFunc    func,
+                                                                     gpointer                      user_data);
+static gint          gegl_parallel_distribute_get_n_parts           (gdouble                       n_elements,
+                                                                     gdouble                       thread_cost,
+                                                                     gint                          n_threads);
 static void          gegl_parallel_distribute_set_n_threads         (gint                          n_threads);
 static gpointer      gegl_parallel_distribute_thread_func           (GeglParallelDistributeThread *thread);
 static void          gegl_parallel_distribute_update_thread_time    (void);
@@ -70,11 +113,26 @@ static void          gegl_parallel_distribute_update_thread_time    (void);
 static gint                         gegl_parallel_distribute_n_threads = 1;
 static GeglParallelDistributeThread gegl_parallel_distribute_threads[GEGL_PARALLEL_DISTRIBUTE_MAX_THREADS - 1];
 
+/* tasks created by threads outside the pool */
+static GeglParallelDistributeQueue  gegl_parallel_distribute_global_queue;
+static GPrivate                     gegl_parallel_distribute_current_thread;
+
+/* idle worker threads wait for new tasks on work_cond */
+static GMutex                       gegl_parallel_distribute_work_mutex;
+static GCond                        gegl_parallel_distribute_work_cond;
+static volatile gint                gegl_parallel_distribute_n_queued_tasks;
+static volatile gint                gegl_parallel_distribute_n_idle_threads;
+static volatile gint                gegl_parallel_distribute_n_busy_threads;
+
+/* task owners wait for the other users of their task on completion_cond */
 static GMutex                       gegl_parallel_distribute_completion_mutex;
 static GCond                        gegl_parallel_distribute_completion_cond;
-static volatile gint                gegl_parallel_distribute_completion_counter;
-static volatile gint                gegl_parallel_distribute_busy;
-static gint                         gegl_parallel_distribute_n_assigned_threads;
+
+/* the number of in-flight gegl_parallel_distribute() calls, and whether the
+ * thread pool is being resized, during which tasks run serially.
+ */
+static volatile gint                gegl_parallel_distribute_n_tasks;
+static volatile gint                gegl_parallel_distribute_resizing;
 
 static gdouble                      gegl_parallel_distribute_thread_time;
 
@@ -109,6 +167,12 @@ gegl_parallel_distribute_get_thread_time (void)
   return gegl_parallel_distribute_thread_time;
 }
 
+gboolean
+gegl_parallel_is_worker_thread (void)
+{
+  return g_private_get (&gegl_parallel_distribute_current_thread) != NULL;
+}
+
 /* calculates the optimal number of threads, n_threads, to process n_elements
  * elements, assuming the cost of processing the elements is proportional to
  * the number of elements to be processed by each thread, and assuming that
@@ -148,9 +212,6 @@ gegl_parallel_distribute (gint                       max_n,
                           GeglParallelDistributeFunc func,
                           gpointer                   user_data)
 {
-  GeglParallelDistributeTask task;
-  gint                       i;
-
   g_return_if_fail (func != NULL);
 
   if (max_n == 0)
@@ -161,56 +222,7 @@ gegl_parallel_distribute (gint                       max_n,
   else
     max_n = MIN (max_n, gegl_parallel_distribute_n_threads);
 
-  if (max_n == 1 ||
-      ! g_atomic_int_compare_and_exchange (&gegl_parallel_distribute_busy,
-                                           0, 1))
-    {
-      func (0, 1, user_data);
-
-      return;
-    }
-
-  task.n         = max_n;
-  task.func      = func;
-  task.user_data = user_data;
-
-  gegl_parallel_distribute_n_assigned_threads = task.n - 1;
-
-  g_atomic_int_set (&gegl_parallel_distribute_completion_counter, task.n - 1);
-
-  for (i = 0; i < task.n - 1; i++)
-    {
-      GeglParallelDistributeThread *thread =
-        &gegl_parallel_distribute_threads[i];
-
-      g_mutex_lock (&thread->mutex);
-
-      thread->task = &task;
-      thread->i    = i;
-
-      g_cond_signal (&thread->cond);
-
-      g_mutex_unlock (&thread->mutex);
-    }
-
-  func (i, task.n, user_data);
-
-  if (g_atomic_int_get (&gegl_parallel_distribute_completion_counter))
-    {
-      g_mutex_lock (&gegl_parallel_distribute_completion_mutex);
-
-      while (g_atomic_int_get (&gegl_parallel_distribute_completion_counter))
-        {
-          g_cond_wait (&gegl_parallel_distribute_completion_cond,
-                       &gegl_parallel_distribute_completion_mutex);
-        }
-
-      g_mutex_unlock (&gegl_parallel_distribute_completion_mutex);
-    }
-
-  gegl_parallel_distribute_n_assigned_threads = 0;
-
-  g_atomic_int_set (&gegl_parallel_distribute_busy, 0);
+  gegl_parallel_distribute_internal (max_n, func, user_data);
 }
 
 typedef struct
@@ -265,8 +277,9 @@ gegl_parallel_distribute_range (gsize                           size,
   data.func      = func;
   data.user_data = user_data;
 
-  gegl_parallel_distribute (
-    n_threads,
+  gegl_parallel_distribute_internal (
+    MIN (gegl_parallel_distribute_get_n_parts (size, thread_cost, n_threads),
+         size),
     (GeglParallelDistributeFunc) gegl_parallel_distribute_range_func,
     &data);
 }
@@ -328,6 +341,7 @@ gegl_parallel_distribute_area (const GeglRectangle            *area,
 {
   GeglParallelDistributeAreaData data;
   gint                           n_threads;
+  gint                           n_parts;
 
   g_return_if_fail (area != NULL);
   g_return_if_fail (func != NULL);
@@ -368,13 +382,23 @@ gegl_parallel_distribute_area (const GeglRectangle            *area,
       return;
     }
 
+  n_parts = gegl_parallel_distribute_get_n_parts (
+    (gdouble) area->width * (gdouble) area->height,
+    thread_cost,
+    n_threads);
+
+  if (split_strategy == GEGL_SPLIT_STRATEGY_HORIZONTAL)
+    n_parts = MIN (n_parts, area->height);
+  else
+    n_parts = MIN (n_parts, area->width);
+
   data.area           = area;
   data.split_strategy = split_strategy;
   data.func           = func;
   data.user_data      = user_data;
 
-  gegl_parallel_distribute (
-    n_threads,
+  gegl_parallel_distribute_internal (
+    n_parts,
     (GeglParallelDistributeFunc) gegl_parallel_distribute_area_func,
     &data);
 }
@@ -386,13 +410,61 @@ gegl_parallel_distribute_area (const GeglRectangle            *area,
 gint
 gegl_parallel_get_n_assigned_worker_threads (void)
 {
-  return gegl_parallel_distribute_n_assigned_threads;
+  return (gegl_parallel_distribute_n_threads - 1) -
+         g_atomic_int_get (&gegl_parallel_distribute_n_idle_threads);
 }
 
 gint
 gegl_parallel_get_n_active_worker_threads (void)
 {
-  return gegl_parallel_distribute_completion_counter;
+  return g_atomic_int_get (&gegl_parallel_distribute_n_busy_threads);
+}
+
+gint
+gegl_parallel_get_n_worker_threads (void)
+{
+  return gegl_parallel_distribute_n_threads - 1;
+}
+
+void
+gegl_parallel_get_worker_thread_stats (gint     i,
+                                       gdouble *busy_time,
+                                       gdouble *idle_time,
+                                       gint    *n_steals)
+{
+  GeglParallelDistributeThread *thread;
+  gint64                        busy = 0;
+  gint64                        idle = 0;
+  gint                          steals = 0;
+
+  if (i >= 0 && i < gegl_parallel_distribute_n_threads - 1)
+    {
+      thread = &gegl_parallel_distribute_threads[i];
+
+      busy   = thread->busy_time;
+      idle   = thread->idle_time;
+      steals = thread->n_steals;
+    }
+
+  if (busy_time) *busy_time = (gdouble) busy / G_TIME_SPAN_SECOND;
+  if (idle_time) *idle_time = (gdouble) idle / G_TIME_SPAN_SECOND;
+  if (n_steals)  *n_steals  = steals;
+}
+
+void
+gegl_parallel_reset_stats (void)
+{
+  gint i;
+
+  for (i = 0; i < GEGL_PARALLEL_DISTRIBUTE_MAX_THREADS - 1; i++)
+    {
+      GeglParallelDistributeThread *thread =
+        &gegl_parallel_distribute_threads[i];
+
+      thread->busy_time = 0;
+      thread->idle_time = 0;
+      thread->n_steals  = 0;
+    }
 }
 
 
@@ -419,13 +491,289 @@ gegl_parallel_set_n_threads (gint     n_threads,
   gegl_parallel_distribute_set_n_threads (n_threads);
 }
 
+/* returns the number of parts to split the processing of n_elements elements
+ * into, when distributed across n_threads threads.  we use more parts than
+ * threads, to balance uneven work dynamically, as long as the additional
+ * per-part overhead is negligible.
+ */
+static gint
+gegl_parallel_distribute_get_n_parts (gdouble n_elements,
+                                      gdouble thread_cost,
+                                      gint    n_threads)
+{
+  gdouble n_parts = n_threads * GEGL_PARALLEL_DISTRIBUTE_PARTS_PER_THREAD;
+
+  if (thread_cost > 0.0)
+    {
+      n_parts = MIN (n_parts,
+                     n_elements * GEGL_PARALLEL_DISTRIBUTE_MAX_PART_OVERHEAD /
+                     thread_cost);
+    }
+
+  return MAX ((gint) n_parts, n_threads);
+}
+
+/* switches the calling worker thread between the busy and idle states,
+ * accumulating the time spent in the previous state.
+ */
+static void
+gegl_parallel_distribute_thread_set_busy (GeglParallelDistributeThread *thread,
+                                          gboolean                      busy)
+{
+  gint64 time;
+
+  if (! thread || thread->busy == busy)
+    return;
+
+  time = g_get_monotonic_time ();
+
+  if (thread->busy)
+    {
+      thread->busy_time += time - thread->state_time;
+
+      g_atomic_int_add (&gegl_parallel_distribute_n_busy_threads, -1);
+    }
+  else
+    {
+      thread->idle_time += time - thread->state_time;
+
+      g_atomic_int_inc (&gegl_parallel_distribute_n_busy_threads);
+    }
+
+  thread->busy       = busy;
+  thread->state_time = time;
+}
+
+static void
+gegl_parallel_distribute_queue_push (GeglParallelDistributeQueue *queue,
+                                     GeglParallelDistributeTask  *task)
+{
+  task->queue = queue;
+
+  g_mutex_lock (&queue->mutex);
+
+  g_queue_push_tail (&queue->tasks, task);
+
+  g_mutex_unlock (&queue->mutex);
+
+  g_atomic_int_inc (&gegl_parallel_distribute_n_queued_tasks);
+
+  if (g_atomic_int_get (&gegl_parallel_distribute_n_idle_threads) > 0)
+    {
+      g_mutex_lock (&gegl_parallel_distribute_work_mutex);
+
+      g_cond_broadcast (&gegl_parallel_distribute_work_cond);
+
+      g_mutex_unlock (&gegl_parallel_distribute_work_mutex);
+    }
+}
+
+/* acquires a task from the queue, either the newest one (for the owner of the
+ * queue), or the oldest one (when stealing).
+ */
+static GeglParallelDistributeTask *
+gegl_parallel_distribute_queue_acquire (GeglParallelDistributeQueue *queue,
+                                        gboolean                     newest)
+{
+  GeglParallelDistributeTask *task;
+
+  g_mutex_lock (&queue->mutex);
+
+  if (newest)
+    task = g_queue_peek_tail (&queue->tasks);
+  else
+    task = g_queue_peek_head (&queue->tasks);
+
+  if (task)
+    g_atomic_int_inc (&task->users);
+
+  g_mutex_unlock (&queue->mutex);
+
+  return task;
+}
+
+/* removes the task from its queue, once all its parts have been claimed */
+static void
+gegl_parallel_distribute_task_unlink (GeglParallelDistributeTask *task)
+{
+  GeglParallelDistributeQueue *queue = task->queue;
+  gboolean                     removed;
+
+  g_mutex_lock (&queue->mutex);
+
+  removed = g_queue_remove (&queue->tasks, task);
+
+  g_mutex_unlock (&queue->mutex);
+
+  if (removed)
+    g_atomic_int_add (&gegl_parallel_distribute_n_queued_tasks, -1);
+}
+
+static void
+gegl_parallel_distribute_task_release (GeglParallelDistributeTask *task)
+{
+  /* the task is owned by the stack of the thread which created it, and
+   * mustn't be touched once its owner is the only user left.
+   */
+  if (g_atomic_int_add (&task->users, -1) == 2)
+    {
+      g_mutex_lock (&gegl_parallel_distribute_completion_mutex);
+
+      g_cond_broadcast (&gegl_parallel_distribute_completion_cond);
+
+      g_mutex_unlock (&gegl_parallel_distribute_completion_mutex);
+    }
+}
+
+static void
+gegl_parallel_distribute_task_run (GeglParallelDistributeTask *task)
+{
+  gint i;
+
+  while ((i = g_atomic_int_add (&task->next, 1)) < task->n)
+    task->func (i, task->n, task->user_data);
+
+  gegl_parallel_distribute_task_unlink (task);
+}
+
+/* finds a task to help with, looking at the calling thread's own queue first,
+ * then, if steal is TRUE, at the global queue, and finally stealing from the
+ * other threads.
+ */
+static GeglParallelDistributeTask *
+gegl_parallel_distribute_find_task (GeglParallelDistributeThread *thread,
+                                    gboolean                      steal)
+{
+  GeglParallelDistributeTask *task = NULL;
+  gint                        n_threads;
+  gint                        first;
+  gint                        i;
+
+  if (! g_atomic_int_get (&gegl_parallel_distribute_n_queued_tasks))
+    return NULL;
+
+  if (thread)
+    task = gegl_parallel_distribute_queue_acquire (&thread->queue, TRUE);
+
+  if (! steal)
+    return task;
+
+  if (! task)
+    {
+      task = gegl_parallel_distribute_queue_acquire (
+        &gegl_parallel_distribute_global_queue, FALSE);
+    }
+
+  n_threads = gegl_parallel_distribute_n_threads - 1;
+  first     = thread ? thread->index + 1 : 0;
+
+  for (i = 0; ! task && i < n_threads; i++)
+    {
+      GeglParallelDistributeThread *victim =
+        &gegl_parallel_distribute_threads[(first + i) % n_threads];
+
+      if (victim == thread)
+        continue;
+
+      task = gegl_parallel_distribute_queue_acquire (&victim->queue, FALSE);
+
+      if (task && thread)
+        thread->n_steals++;
+    }
+
+  return task;
+}
+
+static void
+gegl_parallel_distribute_internal (gint                       n,
+                                   GeglParallelDistributeFunc func,
+                                   gpointer                   user_data)
+{
+  GeglParallelDistributeThread *thread;
+  GeglParallelDistributeTask    task;
+
+  g_atomic_int_inc (&gegl_parallel_distribute_n_tasks);
+
+  if (n == 1 || g_atomic_int_get (&gegl_parallel_distribute_resizing))
+    {
+      g_atomic_int_add (&gegl_parallel_distribute_n_tasks, -1);
+
+      func (0, 1, user_data);
+
+      return;
+    }
+
+  thread = g_private_get (&gegl_parallel_distribute_current_thread);
+
+  task.func      = func;
+  task.n         = n;
+  task.user_data = user_data;
+  task.next      = 0;
+  task.users     = 1;
+
+  task.trace_name = NULL;
+
+  if (G_UNLIKELY (gegl_trace_enabled))
+    task.trace_name = gegl_trace_get_current_name ();
+
+  /* tasks created by worker threads, i.e., nested tasks, go to the thread's
+   * own queue, so that it keeps processing them, while other threads may
+   * steal them.
+   */
+  gegl_parallel_distribute_queue_push (
+    thread ? &thread->queue : &gegl_parallel_distribute_global_queue,
+    &task);
+
+  gegl_parallel_distribute_task_run (&task);
+
+  /* wait for the parts claimed by other threads.  in the meantime, we only
+   * help with tasks from our own queue, since an unrelated task might need
+   * resources we're holding.
+   */
+  while (g_atomic_int_get (&task.users) > 1)
+    {
+      GeglParallelDistributeTask *other;
+
+      other = gegl_parallel_distribute_find_task (thread, FALSE);
+
+      if (other)
+        {
+          gegl_parallel_distribute_task_run (other);
+          gegl_parallel_distribute_task_release (other);
+
+          continue;
+        }
+
+      g_mutex_lock (&gegl_parallel_distribute_completion_mutex);
+
+      if (g_atomic_int_get (&task.users) > 1)
+        {
+          gegl_parallel_distribute_thread_set_busy (thread, FALSE);
+
+          g_cond_wait (&gegl_parallel_distribute_completion_cond,
+                       &gegl_parallel_distribute_completion_mutex);
+
+          gegl_parallel_distribute_thread_set_busy (thread, TRUE);
+        }
+
+      g_mutex_unlock (&gegl_parallel_distribute_completion_mutex);
+    }
+
+  g_atomic_int_add (&gegl_parallel_distribute_n_tasks, -1);
+}
+
 static void
 gegl_parallel_distribute_set_n_threads (gint n_threads)
 {
   gint i;
 
-  while (! g_atomic_int_compare_and_exchange (&gegl_parallel_distribute_busy,
-                                              0, 1));
+  /* wait for all in-flight tasks to finish, while running new ones
+   * serially
+   */
+  g_atomic_int_set (&gegl_parallel_distribute_resizing, 1);
+
+  while (g_atomic_int_get (&gegl_parallel_distribute_n_tasks) > 0)
+    g_thread_yield ();
 
   n_threads = CLAMP (n_threads, 1, GEGL_PARALLEL_DISTRIBUTE_MAX_THREADS);
 
@@ -436,8 +784,10 @@ gegl_parallel_distribute_set_n_threads (gint n_threads)
           GeglParallelDistributeThread *thread =
             &gegl_parallel_distribute_threads[i];
 
-          thread->quit = FALSE;
-          thread->task = NULL;
+          thread->index      = i;
+          thread->quit       = FALSE;
+          thread->busy       = FALSE;
+          thread->state_time = g_get_monotonic_time ();
 
           thread->thread = g_thread_new (
             "worker",
@@ -447,19 +797,20 @@ gegl_parallel_distribute_set_n_threads (gint n_threads)
     }
   else if (n_threads < gegl_parallel_distribute_n_threads) /* need less threads */
     {
+      g_mutex_lock (&gegl_parallel_distribute_work_mutex);
+
       for (i = n_threads - 1; i < gegl_parallel_distribute_n_threads - 1; i++)
         {
           GeglParallelDistributeThread *thread =
             &gegl_parallel_distribute_threads[i];
 
-          g_mutex_lock (&thread->mutex);
-
           thread->quit = TRUE;
-          g_cond_signal (&thread->cond);
-
-          g_mutex_unlock (&thread->mutex);
         }
 
+      g_cond_broadcast (&gegl_parallel_distribute_work_cond);
+
+      g_mutex_unlock (&gegl_parallel_distribute_work_mutex);
+
       for (i = n_threads - 1; i < gegl_parallel_distribute_n_threads - 1; i++)
         {
           GeglParallelDistributeThread *thread =
@@ -471,7 +822,7 @@ gegl_parallel_distribute_set_n_threads (gint n_threads)
 
   gegl_parallel_distribute_n_threads = n_threads;
 
-  g_atomic_int_set (&gegl_parallel_distribute_busy, 0);
+  g_atomic_int_set (&gegl_parallel_distribute_resizing, 0);
 
   gegl_parallel_distribute_update_thread_time ();
 }
@@ -479,36 +830,71 @@ gegl_parallel_distribute_set_n_threads (gint n_threads)
 static gpointer
 gegl_parallel_distribute_thread_func (GeglParallelDistributeThread *thread)
 {
-  g_mutex_lock (&thread->mutex);
+  g_private_set (&gegl_parallel_distribute_current_thread, thread);
+
+  if (G_UNLIKELY (gegl_trace_enabled))
+    {
+      gchar *name = g_strdup_printf ("worker %d", thread->index + 1);
+
+      gegl_trace_set_thread_name (name);
+
+      g_free (name);
+    }
 
   while (TRUE)
     {
-      if (thread->quit)
-        {
-          break;
-        }
-      else if (thread->task)
+      GeglParallelDistributeTask *task;
+
+      task = gegl_parallel_distribute_find_task (thread, TRUE);
+
+      if (task)
         {
-          thread->task->func (thread->i, thread->task->n,
-                              thread->task->user_data);
+          gegl_parallel_distribute_thread_set_busy (thread, TRUE);
 
-          if (g_atomic_int_dec_and_test (
-                &gegl_parallel_distribute_completion_counter))
+          if (G_UNLIKELY (gegl_trace_enabled && task->trace_name))
             {
-              g_mutex_lock (&gegl_parallel_distribute_completion_mutex);
+              GeglTraceSpan span;
 
-              g_cond_signal (&gegl_parallel_distribute_completion_cond);
+              gegl_trace_span_begin (&span, task->trace_name, "worker");
 
-              g_mutex_unlock (&gegl_parallel_distribute_completion_mutex);
+              gegl_parallel_distribute_task_run (task);
+
+              gegl_trace_span_end (&span, NULL, -1.0);
+            }
+          else
+            {
+              gegl_parallel_distribute_task_run (task);
             }
 
-          thread->task = NULL;
+          gegl_parallel_distribute_task_release (task);
+
+          gegl_parallel_distribute_thread_set_busy (thread, FALSE);
+
+          continue;
         }
 
-      g_cond_wait (&thread->cond, &thread->mutex);
-    }
+      g_mutex_lock (&gegl_parallel_distribute_work_mutex);
+
+      g_atomic_int_inc (&gegl_parallel_distribute_n_idle_threads);
+
+      while (! thread->quit &&
+             ! g_atomic_int_get (&gegl_parallel_distribute_n_queued_tasks))
+        {
+          g_cond_wait (&gegl_parallel_distribute_work_cond,
+                       &gegl_parallel_distribute_work_mutex);
+        }
+
+      g_atomic_int_add (&gegl_parallel_distribute_n_idle_threads, -1);
 
-  g_mutex_unlock (&thread->mutex);
+      if (thread->quit)
+        {
+          g_mutex_unlock (&gegl_parallel_distribute_work_mutex);
+
+          break;
+        }
+
+      g_mutex_unlock (&gegl_parallel_distribute_work_mutex);
+    }
 
   return NULL;
 }
@@ -38,6 +38,7 @@ enum
   PROP_TILE_CACHE_TOTAL,
   PROP_TILE_CACHE_TOTAL_MAX,
   PROP_TILE_CACHE_TOTAL_UNCOMPRESSED,
+  PROP_TILE_CACHE_COMPRESSED_TOTAL,
   PROP_TILE_CACHE_HITS,
   PROP_TILE_CACHE_MISSES,
   PROP_SWAP_TOTAL,
@@ -51,11 +52,15 @@ enum
   PROP_SWAP_READ_TOTAL,
   PROP_SWAP_WRITING,
   PROP_SWAP_WRITE_TOTAL,
+  PROP_SWAP_WRITE_THROUGHPUT,
   PROP_ZOOM_TOTAL,
   PROP_TILE_ALLOC_TOTAL,
   PROP_SCRATCH_TOTAL,
   PROP_ASSIGNED_THREADS,
-  PROP_ACTIVE_THREADS
+  PROP_ACTIVE_THREADS,
+  PROP_THREADS_BUSY_TIME,
+  PROP_THREADS_IDLE_TIME,
+  PROP_THREADS_STEALS
 };
 
 
@@ -101,6 +106,13 @@ gegl_stats_class_init (GeglStatsClass *klass)
                                                         0, G_MAXUINT64, 0,
                                                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class, PROP_TILE_CACHE_COMPRESSED_TOTAL,
+                                   g_param_spec_uint64 ("tile-cache-compressed-total",
+                                                        "Tile Cache compressed total",
+                                                        "Total size of the compressed tile cache tier in bytes",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (object_class, PROP_TILE_CACHE_HITS,
                                    g_param_spec_int ("tile-cache-hits",
                                                      "Tile Cache hits",
@@ -197,6 +209,13 @@ gegl_stats_class_init (GeglStatsClass *klass)
                                                         0, G_MAXUINT64, 0,
                                                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class, PROP_SWAP_WRITE_THROUGHPUT,
+                                   g_param_spec_uint64 ("swap-write-throughput",
+                                                        "Swap write throughput",
+                                                        "Rate at which data is written to the swap, in bytes per second",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (object_class, PROP_ZOOM_TOTAL,
                                    g_param_spec_uint64 ("zoom-total",
                                                         "Zoom total",
@@ -231,6 +250,68 @@ gegl_stats_class_init (GeglStatsClass *klass)
                                                      "Number of active worker threads",
                                                      0, G_MAXINT, 0,
                                                      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_THREADS_BUSY_TIME,
+                                   g_param_spec_variant ("threads-busy-time",
+                                                         "Threads busy time",
+                                                         "Time each worker thread spent processing tasks, in seconds",
+                                                         G_VARIANT_TYPE ("ad"), NULL,
+                                                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_THREADS_IDLE_TIME,
+                                   g_param_spec_variant ("threads-idle-time",
+                                                         "Threads idle time",
+                                                         "Time each worker thread spent waiting for tasks, in seconds",
+                                                         G_VARIANT_TYPE ("ad"), NULL,
+                                                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_THREADS_STEALS,
+                                   g_param_spec_variant ("threads-steals",
+                                                         "Threads steals",
+                                                         "Number of tasks each worker thread stole from other threads",
+                                                         G_VARIANT_TYPE ("ai"), NULL,
+                                                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+}
+
+static GVariant *
+gegl_stats_get_threads_stats (guint property_id)
+{
+  GVariantBuilder builder;
+  gint            n_threads = gegl_parallel_get_n_worker_threads ();
+  gint            i;
+
+  if (property_id == PROP_THREADS_STEALS)
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("ai"));
+  else
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("ad"));
+
+  for (i = 0; i < n_threads; i++)
+    {
+      gdouble busy_time;
+      gdouble idle_time;
+      gint    n_steals;
+
+      gegl_parallel_get_worker_thread_stats (i,
+                                             &busy_time, &idle_time,
+                                             &n_steals);
+
+      switch (property_id)
+        {
+        case PROP_THREADS_BUSY_TIME:
+          g_variant_builder_add (&builder, "d", busy_time);
+          break;
+
+        case PROP_THREADS_IDLE_TIME:
+          g_variant_builder_add (&builder, "d", idle_time);
+          break;
+
+        case PROP_THREADS_STEALS:
+          g_variant_builder_add (&builder, "i", n_steals);
+          break;
+        }
+    }
+
+  return g_variant_builder_end (&builder);
 }
 
 static void
@@ -272,6 +353,10 @@ gegl_stats_get_property (GObject    *object,
         g_value_set_uint64 (value, gegl_tile_handler_cache_get_total_uncompressed ());
         break;
 
+      case PROP_TILE_CACHE_COMPRESSED_TOTAL:
+        g_value_set_uint64 (value, gegl_tile_handler_cache_get_total_compressed ());
+        break;
+
       case PROP_TILE_CACHE_HITS:
         g_value_set_int (value, gegl_tile_handler_cache_get_hits ());
         break;
@@ -324,6 +409,10 @@ gegl_stats_get_property (GObject    *object,
         g_value_set_uint64 (value, gegl_tile_backend_swap_get_write_total ());
         break;
 
+      case PROP_SWAP_WRITE_THROUGHPUT:
+        g_value_set_uint64 (value, gegl_tile_backend_swap_get_write_throughput ());
+        break;
+
       case PROP_ZOOM_TOTAL:
         g_value_set_uint64 (value, gegl_tile_handler_zoom_get_total ());
         break;
@@ -344,6 +433,13 @@ gegl_stats_get_property (GObject    *object,
         g_value_set_int (value, gegl_parallel_get_n_active_worker_threads ());
         break;
 
+      case PROP_THREADS_BUSY_TIME:
+      case PROP_THREADS_IDLE_TIME:
+      case PROP_THREADS_STEALS:
+        g_value_take_variant (value,
+                              gegl_stats_get_threads_stats (property_id));
+        break;
+
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
         break;
@@ -356,4 +452,5 @@ gegl_stats_reset (GeglStats *stats)
   gegl_tile_handler_cache_reset_stats ();
   gegl_tile_backend_swap_reset_stats ();
   gegl_tile_handler_zoom_reset_stats ();
+  gegl_parallel_reset_stats ();
 }
@@ -0,0 +1,331 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "gegl.h"
+#include "gegl-trace.h"
+
+
+typedef struct
+{
+  const gchar   *name;
+  const gchar   *category;
+  gint64         start;
+  gint64         duration;
+  GeglRectangle  rect;
+  gboolean       has_rect;
+  gdouble        pixel_time;
+  gint64         counters[GEGL_TRACE_N_COUNTERS];
+} TraceEvent;
+
+/* each thread records its events into its own array, so that recording
+ * doesn't need any locking.  the arrays are only read once all threads are
+ * done, when the trace is written.
+ */
+typedef struct
+{
+  gint         tid;
+  gchar       *name;
+  const gchar *current_name;
+  gint64       counters[GEGL_TRACE_N_COUNTERS];
+  GArray      *events;
+} TraceThread;
+
+
+static const gchar *counter_names[GEGL_TRACE_N_COUNTERS] =
+{
+  "bytes",
+  "cache-hits",
+  "cache-misses",
+  "swap-reads",
+  "conversions"
+};
+
+gboolean gegl_trace_enabled = FALSE;
+
+static gchar     *trace_path  = NULL;
+static gint64     trace_start = 0;
+static GMutex     threads_mutex;
+static GPtrArray *threads     = NULL;
+static GPrivate   current_thread;
+
+
+static TraceThread *
+get_thread (void)
+{
+  TraceThread *thread = g_private_get (&current_thread);
+
+  if (G_UNLIKELY (! thread))
+    {
+      thread         = g_slice_new0 (TraceThread);
+      thread->events = g_array_new (FALSE, FALSE, sizeof (TraceEvent));
+
+      g_mutex_lock (&threads_mutex);
+
+      thread->tid = threads->len + 1;
+      g_ptr_array_add (threads, thread);
+
+      g_mutex_unlock (&threads_mutex);
+
+      g_private_set (&current_thread, thread);
+    }
+
+  return thread;
+}
+
+void
+gegl_trace_enable (const gchar *path)
+{
+  g_return_if_fail (path != NULL);
+
+  if (gegl_trace_enabled)
+    return;
+
+  trace_path  = g_strdup (path);
+  trace_start = g_get_monotonic_time ();
+
+  if (! threads)
+    threads = g_ptr_array_new ();
+
+  gegl_trace_enabled = TRUE;
+
+  gegl_trace_set_thread_name ("main");
+}
+
+void
+gegl_trace_set_thread_name (const gchar *name)
+{
+  TraceThread *thread;
+
+  if (! gegl_trace_enabled)
+    return;
+
+  thread = get_thread ();
+
+  g_free (thread->name);
+  thread->name = g_strdup (name);
+}
+
+void
+gegl_trace_count (GeglTraceCounter counter,
+                  gint64           n)
+{
+  get_thread ()->counters[counter] += n;
+}
+
+void
+gegl_trace_span_begin (GeglTraceSpan *span,
+                       const gchar   *name,
+                       const gchar   *category)
+{
+  TraceThread *thread = get_thread ();
+
+  span->name        = name;
+  span->category    = category;
+  span->parent_name = thread->current_name;
+  span->start       = g_get_monotonic_time ();
+
+  memcpy (span->counters, thread->counters, sizeof (span->counters));
+
+  thread->current_name = name;
+}
+
+void
+gegl_trace_span_end (GeglTraceSpan       *span,
+                     const GeglRectangle *rect,
+                     gdouble              pixel_time)
+{
+  TraceThread *thread = get_thread ();
+  TraceEvent   event;
+  gint         i;
+
+  event.name       = span->name;
+  event.category   = span->category;
+  event.start      = span->start - trace_start;
+  event.duration   = g_get_monotonic_time () - span->start;
+  event.has_rect   = rect != NULL;
+  event.pixel_time = pixel_time;
+
+  if (rect)
+    event.rect = *rect;
+
+  for (i = 0; i < GEGL_TRACE_N_COUNTERS; i++)
+    event.counters[i] = thread->counters[i] - span->counters[i];
+
+  g_array_append_val (thread->events, event);
+
+  thread->current_name = span->parent_name;
+}
+
+const gchar *
+gegl_trace_get_current_name (void)
+{
+  return get_thread ()->current_name;
+}
+
+static void
+write_string (FILE        *file,
+              const gchar *str)
+{
+  fputc ('"', file);
+
+  for (; *str; str++)
+    {
+      guchar c = *str;
+
+      if (c == '"' || c == '\\')
+        fprintf (file, "\\%c", c);
+      else if (c < 0x20)
+        fprintf (file, "\\u%04x", c);
+      else
+        fputc (c, file);
+    }
+
+  fputc ('"', file);
+}
+
+static void
+write_event (FILE              *file,
+             const TraceThread *thread,
+             const TraceEvent  *event)
+{
+  gint i;
+
+  fprintf (file, "{\"name\":");
+  write_string (file, event->name);
+  fprintf (file, ",\"cat\":");
+  write_string (file, event->category);
+  fprintf (file,
+           ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+           "\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT
+           ",\"args\":{",
+           thread->tid, event->start, event->duration);
+
+  if (event->has_rect)
+    {
+      fprintf (file,
+               "\"x\":%d,\"y\":%d,\"width\":%d,\"height\":%d,"
+               "\"pixels\":%" G_GINT64_FORMAT ",",
+               event->rect.x, event->rect.y,
+               event->rect.width, event->rect.height,
+               (gint64) event->rect.width * event->rect.height);
+    }
+
+  if (event->pixel_time >= 0.0)
+    {
+      gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+      fprintf (file, "\"pixel-time\":%s,",
+               g_ascii_dtostr (buf, sizeof (buf), event->pixel_time));
+    }
+
+  for (i = 0; i < GEGL_TRACE_N_COUNTERS; i++)
+    {
+      fprintf (file, "%s\"%s\":%" G_GINT64_FORMAT,
+               i ? "," : "", counter_names[i], event->counters[i]);
+    }
+
+  fprintf (file, "}}");
+}
+
+static void
+write_trace (const gchar *path)
+{
+  FILE *file;
+  guint i;
+  guint j;
+
+  file = g_fopen (path, "w");
+
+  if (! file)
+    {
+      g_warning ("failed to write trace to '%s'", path);
+
+      return;
+    }
+
+  fprintf (file, "{\"traceEvents\":[\n");
+
+  for (i = 0; i < threads->len; i++)
+    {
+      const TraceThread *thread = threads->pdata[i];
+
+      fprintf (file,
+               "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+               "\"tid\":%d,\"args\":{\"name\":",
+               i ? ",\n" : "", thread->tid);
+
+      if (thread->name)
+        {
+          write_string (file, thread->name);
+        }
+      else
+        {
+          gchar *name = g_strdup_printf ("thread %d", thread->tid);
+
+          write_string (file, name);
+
+          g_free (name);
+        }
+
+      fprintf (file, "}}");
+
+      for (j = 0; j < thread->events->len; j++)
+        {
+          fprintf (file, ",\n");
+
+          write_event (file, thread,
+                       &g_array_index (thread->events, TraceEvent, j));
+        }
+    }
+
+  fprintf (file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+  fclose (file);
+}
+
+void
+gegl_trace_cleanup (void)
+{
+  guint i;
+
+  if (! gegl_trace_enabled)
+    return;
+
+  gegl_trace_enabled = FALSE;
+
+  write_trace (trace_path);
+
+  /* other threads may still hold on to their records, so we only drop the
+   * recorded events, and keep the records themselves around in case tracing
+   * is enabled again.
+   */
+  for (i = 0; i < threads->len; i++)
+    {
+      TraceThread *thread = threads->pdata[i];
+
+      g_array_set_size (thread->events, 0);
+    }
+
+  g_clear_pointer (&trace_path, g_free);
+}
@@ -0,0 +1,83 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_TRACE_H__
+#define __GEGL_TRACE_H__
+
+G_BEGIN_DECLS
+
+/* per-thread render tracing.  when enabled, through the GEGL_TRACE
+ * environment variable, spans are recorded for each chunk processed by each
+ * node, and for each part of it processed by the parallel pool, together
+ * with the per-thread counters accumulated while the span was open.  the
+ * trace is written in the Chrome trace-event JSON format, which can be
+ * loaded into chrome://tracing or Perfetto, by gegl_exit().
+ */
+
+typedef enum
+{
+  GEGL_TRACE_COUNTER_BYTES,        /* bytes moved in and out of buffers */
+  GEGL_TRACE_COUNTER_CACHE_HITS,
+  GEGL_TRACE_COUNTER_CACHE_MISSES,
+  GEGL_TRACE_COUNTER_SWAP_READS,
+  GEGL_TRACE_COUNTER_CONVERSIONS,  /* babl conversions of buffer data */
+
+  GEGL_TRACE_N_COUNTERS
+} GeglTraceCounter;
+
+typedef struct
+{
+  const gchar *name;
+  const gchar *category;
+  const gchar *parent_name;
+  gint64       start;
+  gint64       counters[GEGL_TRACE_N_COUNTERS];
+} GeglTraceSpan;
+
+extern gboolean gegl_trace_enabled;
+
+#define GEGL_TRACE_COUNT(counter, n)                                 \
+  G_STMT_START {                                                     \
+    if (G_UNLIKELY (gegl_trace_enabled))                             \
+      gegl_trace_count (GEGL_TRACE_COUNTER_##counter, (n));          \
+  } G_STMT_END
+
+/* start recording, writing the trace to path upon gegl_trace_cleanup() */
+void          gegl_trace_enable           (const gchar         *path);
+void          gegl_trace_cleanup          (void);
+
+void          gegl_trace_set_thread_name  (const gchar         *name);
+
+void          gegl_trace_count            (GeglTraceCounter     counter,
+                                           gint64               n);
+
+/* name and category must remain valid until the trace is written; use
+ * g_intern_string() for names that don't.  spans opened by the same thread
+ * must be properly nested.
+ */
+void          gegl_trace_span_begin       (GeglTraceSpan       *span,
+                                           const gchar         *name,
+                                           const gchar         *category);
+void          gegl_trace_span_end         (GeglTraceSpan       *span,
+                                           const GeglRectangle *rect,
+                                           gdouble              pixel_time);
+
+/* the name of the innermost span open on the calling thread, if any */
+const gchar * gegl_trace_get_current_name (void);
+
+G_END_DECLS
+
+#endif /* __GEGL_TRACE_H__ */
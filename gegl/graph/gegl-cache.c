@@ -30,6 +30,11 @@
 #include "gegl-region.h"
 #include "gegl-buffer.h" /* for GeglRectangle XXX ... */
 
+/* the maximal number of tiles whose generation is bumped individually by a
+ * single invalidated rectangle; larger rectangles bump all tiles at once.
+ */
+#define GEGL_CACHE_MAX_TILE_GENERATIONS 4096
+
 enum
 {
   PROP_0,
@@ -172,6 +177,9 @@ static void
 gegl_cache_init (GeglCache *self)
 {
   g_mutex_init (&self->mutex);
+
+  self->tile_generations = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+                                                  g_free, NULL);
 }
 
 static void
@@ -189,6 +197,7 @@ finalize (GObject *gobject)
   gint i;
 
   g_mutex_clear (&self->mutex);
+  g_hash_table_unref (self->tile_generations);
   for (i = 0; i < GEGL_CACHE_VALID_MIPMAPS; i++)
     if (self->valid_region[i])
       gegl_region_destroy (self->valid_region[i]);
@@ -256,6 +265,68 @@ get_property (GObject    *gobject,
     }
 }
 
+static inline gint64
+gegl_cache_tile_key (gint tile_x,
+                     gint tile_y)
+{
+  return ((gint64) tile_y << 32) | (guint32) tile_x;
+}
+
+/* stamps the tiles intersecting rect with the current generation.  must be
+ * called with the cache mutex held.
+ */
+static void
+gegl_cache_bump_tile_generations (GeglCache           *self,
+                                  const GeglRectangle *rect)
+{
+  GeglBuffer *buffer = GEGL_BUFFER (self);
+  gint        tile_width;
+  gint        tile_height;
+  gint        x0, y0, x1, y1;
+  gint        x, y;
+
+  if (! rect || gegl_rectangle_is_infinite_plane (rect))
+    {
+      self->base_generation = self->generation;
+      g_hash_table_remove_all (self->tile_generations);
+
+      return;
+    }
+
+  if (gegl_rectangle_is_empty (rect))
+    return;
+
+  tile_width  = buffer->tile_width;
+  tile_height = buffer->tile_height;
+
+  x0 = gegl_tile_indice (rect->x + buffer->shift_x, tile_width);
+  y0 = gegl_tile_indice (rect->y + buffer->shift_y, tile_height);
+  x1 = gegl_tile_indice (rect->x + rect->width  - 1 + buffer->shift_x,
+                         tile_width);
+  y1 = gegl_tile_indice (rect->y + rect->height - 1 + buffer->shift_y,
+                         tile_height);
+
+  if ((gint64) (x1 - x0 + 1) * (y1 - y0 + 1) > GEGL_CACHE_MAX_TILE_GENERATIONS)
+    {
+      gegl_cache_bump_tile_generations (self, NULL);
+
+      return;
+    }
+
+  for (y = y0; y <= y1; y++)
+    {
+      for (x = x0; x <= x1; x++)
+        {
+          gint64 *key = g_new (gint64, 1);
+
+          *key = gegl_cache_tile_key (x, y);
+
+          g_hash_table_insert (self->tile_generations,
+                               key, GUINT_TO_POINTER (self->generation));
+        }
+    }
+}
+
 void
 gegl_cache_invalidate (GeglCache           *self,
                        const GeglRectangle *roi)
@@ -272,6 +343,8 @@ gegl_cache_invalidate (GeglCache           *self,
       g_mutex_lock (&self->mutex);
       for (i = 0; i < GEGL_CACHE_VALID_MIPMAPS; i++)
         gegl_region_subtract (self->valid_region[i], temp_region);
+      self->generation++;
+      gegl_cache_bump_tile_generations (self, &expanded);
       g_mutex_unlock (&self->mutex);
       gegl_region_destroy (temp_region);
       g_signal_emit (self, gegl_cache_signals[INVALIDATED], 0,
@@ -287,12 +360,68 @@ gegl_cache_invalidate (GeglCache           *self,
           gegl_region_destroy (self->valid_region[i]);
         self->valid_region[i] = gegl_region_new ();
       }
+      self->generation++;
+      gegl_cache_bump_tile_generations (self, NULL);
       g_mutex_unlock (&self->mutex);
       g_signal_emit (self, gegl_cache_signals[INVALIDATED], 0,
                      &rect, NULL);
     }
 }
 
+/* invalidates the (possibly disjoint) area covered by region, only touching
+ * the tiles it actually intersects, rather than its bounding box.
+ */
+void
+gegl_cache_invalidate_region (GeglCache        *self,
+                              const GeglRegion *region)
+{
+  GeglRectangle *rects;
+  gint           n_rects;
+  GeglRegion    *temp_region;
+  gint           i;
+
+  g_return_if_fail (GEGL_IS_CACHE (self));
+  g_return_if_fail (region != NULL);
+
+  gegl_region_get_rectangles ((GeglRegion *) region, &rects, &n_rects);
+
+  if (n_rects == 0)
+    {
+      g_free (rects);
+
+      return;
+    }
+
+  temp_region = gegl_region_new ();
+
+  g_mutex_lock (&self->mutex);
+
+  self->generation++;
+
+  for (i = 0; i < n_rects; i++)
+    {
+      GeglRectangle expanded = gegl_rectangle_expand (&rects[i]);
+
+      gegl_region_union_with_rect (temp_region, &expanded);
+      gegl_cache_bump_tile_generations (self, &expanded);
+    }
+
+  for (i = 0; i < GEGL_CACHE_VALID_MIPMAPS; i++)
+    gegl_region_subtract (self->valid_region[i], temp_region);
+
+  g_mutex_unlock (&self->mutex);
+
+  gegl_region_destroy (temp_region);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      g_signal_emit (self, gegl_cache_signals[INVALIDATED], 0,
+                     &rects[i], NULL);
+    }
+
+  g_free (rects);
+}
+
 void
 gegl_cache_computed (GeglCache           *self,
                      const GeglRectangle *rect,
@@ -311,6 +440,50 @@ gegl_cache_computed (GeglCache           *self,
   g_signal_emit (self, gegl_cache_signals[COMPUTED], 0, rect, NULL);
 }
 
+guint
+gegl_cache_get_generation (GeglCache *self)
+{
+  guint generation;
+
+  g_return_val_if_fail (GEGL_IS_CACHE (self), 0);
+
+  g_mutex_lock (&self->mutex);
+  generation = self->generation;
+  g_mutex_unlock (&self->mutex);
+
+  return generation;
+}
+
+guint
+gegl_cache_get_tile_generation (GeglCache *self,
+                                gint       tile_x,
+                                gint       tile_y)
+{
+  gint64   key;
+  gpointer value;
+  guint    generation;
+
+  g_return_val_if_fail (GEGL_IS_CACHE (self), 0);
+
+  key = gegl_cache_tile_key (tile_x, tile_y);
+
+  g_mutex_lock (&self->mutex);
+
+  if (g_hash_table_lookup_extended (self->tile_generations, &key,
+                                    NULL, &value))
+    {
+      generation = GPOINTER_TO_UINT (value);
+    }
+  else
+    {
+      generation = self->base_generation;
+    }
+
+  g_mutex_unlock (&self->mutex);
+
+  return generation;
+}
+
 gboolean
 gegl_buffer_list_valid_rectangles (GeglBuffer     *buffer,
                                    GeglRectangle **rectangles,
@@ -43,6 +43,13 @@ struct _GeglCache
 
   GeglRegion   *valid_region[GEGL_CACHE_VALID_MIPMAPS];
   GMutex        mutex;
+
+  /* per-tile generation counters, bumped whenever (part of) a tile is
+   * invalidated.  tiles not in the table are at base_generation.
+   */
+  GHashTable   *tile_generations;
+  guint         generation;
+  guint         base_generation;
 };
 
 struct _GeglCacheClass
@@ -53,10 +60,27 @@ struct _GeglCacheClass
 GType    gegl_cache_get_type    (void) G_GNUC_CONST;
 void     gegl_cache_invalidate  (GeglCache           *self,
                                  const GeglRectangle *roi);
+void     gegl_cache_invalidate_region
+                                (GeglCache           *self,
+                                 const GeglRegion    *region);
 void     gegl_cache_computed    (GeglCache           *self,
                                  const GeglRectangle *rect,
                                  gint                 level);
 
+/* returns the current generation of the cache, incremented on each
+ * invalidation.
+ */
+guint    gegl_cache_get_generation
+                                (GeglCache           *self);
+/* returns the generation in which the tile at the given tile indices was
+ * last invalidated; tiles whose generation didn't change since a previous
+ * query hold the same content.
+ */
+guint    gegl_cache_get_tile_generation
+                                (GeglCache           *self,
+                                 gint                 tile_x,
+                                 gint                 tile_y);
+
 G_END_DECLS
 
 #endif /* __GEGL_CACHE_H__ */
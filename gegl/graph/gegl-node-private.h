@@ -138,6 +138,9 @@ GeglCache   * gegl_node_get_cache           (GeglNode      *node);
 void          gegl_node_invalidated         (GeglNode      *node,
                                              const GeglRectangle *rect,
                                              gboolean             clean_cache);
+void          gegl_node_invalidated_region  (GeglNode      *node,
+                                             const GeglRegion    *region,
+                                             gboolean             clean_cache);
 
 GeglVisitable *
              gegl_node_get_output_visitable (GeglNode      *self);
@@ -648,22 +648,15 @@ gegl_node_connect_to (GeglNode    *sink,
   return gegl_node_connect (sink, sink_pad_name, source, source_pad_name);
 }
 
-/* the implementation of gegl_node_invalidated() can use either GeglRegions
- * or GeglRectangles (bounding boxes) for calculating the invalidated areas
- * of the nodes in the graph.  The GeglRegion version is more granular,
- * invalidating exact areas, but has higher overhead, while the GeglRectangle
- * version in more coarse, potentially over-invalidating (but never under-
- * invalidating), but has lower overhead.
- *
- * TODO: decide if the higher overhead of the GeglRegion version is worth it.
+/* regions invalidated by a single change are propagated as a set of
+ * rectangles; past this many rectangles, they're reduced to their bounding
+ * box, to keep the cost of propagating them down the graph bounded.
  */
-/* #define GEGL_NODE_INVALIDATED_USE_REGIONS */
-
-#ifdef GEGL_NODE_INVALIDATED_USE_REGIONS
+#define GEGL_NODE_INVALIDATED_MAX_RECTANGLES 64
 
 static gboolean
-gegl_node_invalidated_invalidate_node (GeglNode *node,
-                                       gpointer  data)
+gegl_node_invalidated_region_invalidate_node (GeglNode *node,
+                                              gpointer  data)
 {
   GHashTable    *regions = data;
   GeglRegion    *region  = g_hash_table_lookup (regions, node);
@@ -677,11 +670,34 @@ gegl_node_invalidated_invalidate_node (GeglNode *node,
   gegl_region_get_rectangles (region,
                               &rects, &n_rects);
 
-  for (i = 0; i < n_rects; i++)
+  if (n_rects > GEGL_NODE_INVALIDATED_MAX_RECTANGLES)
     {
-      if (node->cache)
-        gegl_cache_invalidate (node->cache, &rects[i]);
+      gegl_region_get_clipbox (region, &rects[0]);
 
+      n_rects = 1;
+    }
+
+  if (node->cache)
+    {
+      if (n_rects == 1)
+        {
+          gegl_cache_invalidate (node->cache, &rects[0]);
+        }
+      else
+        {
+          GeglRegion *cache_region = gegl_region_new ();
+
+          for (i = 0; i < n_rects; i++)
+            gegl_region_union_with_rect (cache_region, &rects[i]);
+
+          gegl_cache_invalidate_region (node->cache, cache_region);
+
+          gegl_region_destroy (cache_region);
+        }
+    }
+
+  for (i = 0; i < n_rects; i++)
+    {
       g_signal_emit (node, gegl_node_signals[INVALIDATED], 0,
                      &rects[i], NULL);
     }
@@ -700,22 +716,18 @@ gegl_node_invalidated_invalidate_node (GeglNode *node,
           g_hash_table_insert (regions, sink_node, sink_region);
         }
 
-      if (sink_node->operation)
+      for (i = 0; i < n_rects; i++)
         {
-          for (i = 0; i < n_rects; i++)
-            {
-              GeglRectangle invalidated_rect;
+          GeglRectangle invalidated_rect = rects[i];
 
+          if (sink_node->operation)
+            {
               invalidated_rect = gegl_operation_get_invalidated_by_change (
                 sink_node->operation,
                 gegl_pad_get_name (sink_pad), &rects[i]);
-
-              gegl_region_union_with_rect (sink_region, &invalidated_rect);
             }
-        }
-      else
-        {
-          gegl_region_union (sink_region, region);
+
+          gegl_region_union_with_rect (sink_region, &invalidated_rect);
         }
     }
 
@@ -724,29 +736,46 @@ gegl_node_invalidated_invalidate_node (GeglNode *node,
   return FALSE;
 }
 
+/* like gegl_node_invalidated(), but invalidates an arbitrary region, which is
+ * propagated as such down the graph, so that only the areas actually affected
+ * by the change are invalidated in the caches of the following nodes.
+ */
 void
-gegl_node_invalidated (GeglNode            *node,
-                       const GeglRectangle *rect,
-                       gboolean             clear_cache)
+gegl_node_invalidated_region (GeglNode         *node,
+                              const GeglRegion *region,
+                              gboolean          clear_cache)
 {
   GHashTable  *regions;
   GeglVisitor *visitor;
 
   g_return_if_fail (GEGL_IS_NODE (node));
+  g_return_if_fail (region != NULL);
 
-  if (!rect)
-    rect = &node->have_rect;
+  if (gegl_region_empty (region))
+    return;
 
   if (node->cache && clear_cache)
-    gegl_buffer_clear (GEGL_BUFFER (node->cache), rect);
+    {
+      GeglRectangle *rects;
+      gint           n_rects;
+      gint           i;
+
+      gegl_region_get_rectangles ((GeglRegion *) region, &rects, &n_rects);
+
+      for (i = 0; i < n_rects; i++)
+        gegl_buffer_clear (GEGL_BUFFER (node->cache), &rects[i]);
+
+      g_free (rects);
+    }
 
   regions = g_hash_table_new_full (NULL, NULL, NULL,
                                    (GDestroyNotify) gegl_region_destroy);
 
-  g_hash_table_insert (regions, node, gegl_region_rectangle (rect));
+  g_hash_table_insert (regions, node, gegl_region_copy (region));
 
-  visitor = gegl_callback_visitor_new (gegl_node_invalidated_invalidate_node,
-                                       regions);
+  visitor = gegl_callback_visitor_new (
+    gegl_node_invalidated_region_invalidate_node,
+    regions);
 
   gegl_visitor_traverse_reverse_topological (visitor,
                                              gegl_node_get_output_visitable (node));
@@ -755,8 +784,42 @@ gegl_node_invalidated (GeglNode            *node,
   g_hash_table_unref (regions);
 }
 
+/* the implementation of gegl_node_invalidated() can use either GeglRegions
+ * or GeglRectangles (bounding boxes) for calculating the invalidated areas
+ * of the nodes in the graph.  The GeglRegion version is more granular,
+ * invalidating exact areas, but has higher overhead, while the GeglRectangle
+ * version in more coarse, potentially over-invalidating (but never under-
+ * invalidating), but has lower overhead.
+ *
+ * operations that know the exact area affected by a change can use the
+ * GeglRegion version explicitly, through gegl_node_invalidated_region().
+ */
+/* #define GEGL_NODE_INVALIDATED_USE_REGIONS */
+
+#ifdef GEGL_NODE_INVALIDATED_USE_REGIONS
+
+void
+gegl_node_invalidated (GeglNode            *node,
+                       const GeglRectangle *rect,
+                       gboolean             clear_cache)
+{
+  GeglRegion *region;
+
+  g_return_if_fail (GEGL_IS_NODE (node));
+
+  if (!rect)
+    rect = &node->have_rect;
+
+  region = gegl_region_rectangle (rect);
+
+  gegl_node_invalidated_region (node, region, clear_cache);
+
+  gegl_region_destroy (region);
+}
+
 #else /* ! GEGL_NODE_INVALIDATED_USE_REGIONS */
 
+
 static gboolean
 gegl_node_invalidated_invalidate_node (GeglNode *node,
                                        gpointer  data)
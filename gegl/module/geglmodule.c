@@ -216,6 +216,42 @@ gegl_module_new (const gchar *filename,
   return module;
 }
 
+/**
+ * gegl_module_new_deferred:
+ * @filename: The filename of a loadable module.
+ * @verbose:  Pass %TRUE to enable debugging output.
+ *
+ * Creates a new #GeglModule instance without loading it. The types it
+ * implements get registered the first time the module is used, see
+ * g_type_module_use().
+ *
+ * Return value: The new #GeglModule object.
+ **/
+GeglModule *
+gegl_module_new_deferred (const gchar *filename,
+                          gboolean     verbose)
+{
+  GeglModule *module;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+
+  module = g_object_new (GEGL_TYPE_MODULE, NULL);
+
+  module->filename     = g_strdup (filename);
+  module->load_inhibit = FALSE;
+  module->verbose      = verbose ? TRUE : FALSE;
+  module->on_disk      = TRUE;
+  module->state        = GEGL_MODULE_STATE_NOT_LOADED;
+
+  g_type_module_set_name (G_TYPE_MODULE (module), filename);
+
+  if (verbose)
+    g_print ("Deferring module '%s'\n",
+             gegl_filename_to_utf8 (filename));
+
+  return module;
+}
+
 /**
  * gegl_module_query_module:
  * @module: A #GeglModule.
@@ -97,6 +97,8 @@ GType         gegl_module_get_type         (void) G_GNUC_CONST;
 GeglModule  * gegl_module_new              (const gchar     *filename,
                                             gboolean         load_inhibit,
                                             gboolean         verbose);
+GeglModule  * gegl_module_new_deferred     (const gchar     *filename,
+                                            gboolean         verbose);
 
 gboolean      gegl_module_query_module     (GeglModule      *module);
 
@@ -18,12 +18,16 @@
 #include <string.h>
 
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #include "gegl-plugin.h"
 #include "geglmodule.h"
 #include "geglmoduledb.h"
 #include "gegldatafiles.h"
 #include "gegl-cpuaccel.h"
 #include "gegl-config.h"
+#include "operation/gegl-operations.h"
+#include "operation/gegl-operation-handlers.h"
+#include "operation/gegl-operation-handlers-private.h"
 
 
 #ifdef ARCH_X86_64
@@ -42,6 +46,19 @@
 #define MODULE_SUFFIX "dylib"
 #endif
 
+/* The module manifest caches, for every module loaded before, the names
+ * and keys of the operations it provides, and the content types its
+ * operations load and save, so that modules need not be opened until one
+ * of their operations is used. Entries are keyed by the modification time
+ * and size of the module file. MANIFEST_FORMAT is bumped whenever the
+ * contents of the manifest change.
+ */
+#define MANIFEST_FORMAT          2
+#define MANIFEST_NAME            "module-manifest.ini"
+#define MANIFEST_GROUP           "manifest"
+#define MANIFEST_MODULE_PREFIX   "module "
+#define MANIFEST_OPERATION_PREFIX "operation "
+
 enum
 {
   ADD,
@@ -111,6 +128,7 @@ gegl_module_db_init (GeglModuleDB *db)
   db->modules      = NULL;
   db->load_inhibit = NULL;
   db->verbose      = FALSE;
+  db->manifest     = NULL;
 }
 
 static void
@@ -120,6 +138,7 @@ gegl_module_db_finalize (GObject *object)
 
   g_list_free (db->modules);
   g_free (db->load_inhibit);
+  g_clear_pointer (&db->manifest, g_key_file_free);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -272,6 +291,460 @@ gegl_module_db_remove_duplicates (GeglModuleDB *db)
 }
 #endif
 
+static gchar *
+gegl_module_db_manifest_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), GEGL_LIBRARY,
+                           MANIFEST_NAME, NULL);
+}
+
+static gchar *
+gegl_module_db_manifest_version (void)
+{
+  return g_strdup_printf ("%d.%d.%d-%x-%d",
+                          GEGL_MAJOR_VERSION,
+                          GEGL_MINOR_VERSION,
+                          GEGL_MICRO_VERSION,
+                          GEGL_MODULE_ABI_VERSION,
+                          MANIFEST_FORMAT);
+}
+
+static GKeyFile *
+gegl_module_db_get_manifest (GeglModuleDB *db)
+{
+  if (! db->manifest)
+    {
+      gchar *path    = gegl_module_db_manifest_path ();
+      gchar *version = gegl_module_db_manifest_version ();
+      gchar *found   = NULL;
+
+      db->manifest = g_key_file_new ();
+
+      if (g_key_file_load_from_file (db->manifest, path, G_KEY_FILE_NONE, NULL))
+        found = g_key_file_get_string (db->manifest,
+                                       MANIFEST_GROUP, "version", NULL);
+
+      if (g_strcmp0 (found, version))
+        {
+          g_key_file_free (db->manifest);
+          db->manifest = g_key_file_new ();
+
+          g_key_file_set_string (db->manifest,
+                                 MANIFEST_GROUP, "version", version);
+        }
+
+      g_free (found);
+      g_free (version);
+      g_free (path);
+    }
+
+  return db->manifest;
+}
+
+static void
+gegl_module_db_save_manifest (GeglModuleDB *db)
+{
+  gchar  *path  = gegl_module_db_manifest_path ();
+  gchar  *dir   = g_path_get_dirname (path);
+  GError *error = NULL;
+
+  g_mkdir_with_parents (dir, S_IRUSR | S_IWUSR | S_IXUSR);
+
+  if (! g_key_file_save_to_file (db->manifest, path, &error))
+    {
+      if (db->verbose)
+        g_print ("Failed to write module manifest '%s': %s\n",
+                 path, error->message);
+
+      g_clear_error (&error);
+    }
+
+  g_free (dir);
+  g_free (path);
+}
+
+static gboolean
+gegl_module_db_stat (const gchar *filename,
+                     gint64      *mtime,
+                     gint64      *size)
+{
+  GStatBuf st;
+
+  if (g_stat (filename, &st))
+    return FALSE;
+
+  *mtime = st.st_mtime;
+  *size  = st.st_size;
+
+  return TRUE;
+}
+
+/* removes a module, and the operations it provided, from the manifest */
+static void
+gegl_module_db_manifest_remove (GKeyFile    *manifest,
+                                const gchar *group)
+{
+  gchar **operations;
+  gint    i;
+
+  operations = g_key_file_get_string_list (manifest, group, "operations",
+                                           NULL, NULL);
+
+  for (i = 0; operations && operations[i]; i++)
+    {
+      gchar *op_group = g_strconcat (MANIFEST_OPERATION_PREFIX,
+                                     operations[i], NULL);
+
+      g_key_file_remove_group (manifest, op_group, NULL);
+      g_free (op_group);
+    }
+
+  g_strfreev (operations);
+  g_key_file_remove_group (manifest, group, NULL);
+}
+
+static void
+gegl_module_db_add_module (GeglModuleDB *db,
+                           GeglModule   *module)
+{
+  g_signal_connect (module, "modified",
+                    G_CALLBACK (gegl_module_db_module_modified),
+                    db);
+
+  db->modules = g_list_append (db->modules, module);
+  g_signal_emit (db, db_signals[ADD], 0, module);
+}
+
+/* registers the content types the operations of a deferred module load or
+ * save, which they would otherwise only register once their class is
+ * initialized.
+ */
+static void
+gegl_module_db_register_handlers (GKeyFile     *manifest,
+                                  const gchar  *group,
+                                  const gchar  *key,
+                                  gboolean    (*register_func) (const gchar *content_type,
+                                                                const gchar *handler))
+{
+  gchar **handlers;
+  gint    i;
+
+  handlers = g_key_file_get_string_list (manifest, group, key, NULL, NULL);
+
+  for (i = 0; handlers && handlers[i]; i++)
+    {
+      gchar *operation = strchr (handlers[i], '=');
+
+      if (! operation)
+        continue;
+
+      *operation++ = '\0';
+
+      register_func (handlers[i], operation);
+    }
+
+  g_strfreev (handlers);
+}
+
+/* creates the module without opening it, if the manifest knows about the
+ * file as it is on disk, and makes its operations known
+ */
+static gboolean
+gegl_module_db_load_deferred (GeglModuleDB *db,
+                              const gchar  *filename)
+{
+  GKeyFile    *manifest = gegl_module_db_get_manifest (db);
+  GeglModule  *module;
+  gchar       *group;
+  gchar      **operations;
+  gchar      **check_available;
+  gint64       mtime, size;
+  gint         i;
+
+  group = g_strconcat (MANIFEST_MODULE_PREFIX, filename, NULL);
+
+  if (! gegl_module_db_stat (filename, &mtime, &size)                     ||
+      g_key_file_get_int64 (manifest, group, "mtime", NULL) != mtime ||
+      g_key_file_get_int64 (manifest, group, "size",  NULL) != size  ||
+      ! g_key_file_has_key (manifest, group, "operations", NULL))
+    {
+      g_free (group);
+      return FALSE;
+    }
+
+  operations      = g_key_file_get_string_list (manifest, group, "operations",
+                                                NULL, NULL);
+  check_available = g_key_file_get_string_list (manifest, group,
+                                                "check-available", NULL, NULL);
+
+  module = gegl_module_new_deferred (filename, db->verbose);
+
+  for (i = 0; operations && operations[i]; i++)
+    {
+      GHashTable  *keys;
+      gchar       *op_group;
+      gchar      **key_names;
+      gint         j;
+
+      keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+      op_group  = g_strconcat (MANIFEST_OPERATION_PREFIX, operations[i], NULL);
+      key_names = g_key_file_get_keys (manifest, op_group, NULL, NULL);
+
+      for (j = 0; key_names && key_names[j]; j++)
+        {
+          g_hash_table_insert (keys, g_strdup (key_names[j]),
+                               g_key_file_get_string (manifest, op_group,
+                                                      key_names[j], NULL));
+        }
+
+      gegl_operations_add_lazy (operations[i], G_TYPE_MODULE (module), keys,
+                                check_available &&
+                                g_strv_contains ((const gchar * const *) check_available,
+                                                 operations[i]));
+
+      g_hash_table_unref (keys);
+      g_strfreev (key_names);
+      g_free (op_group);
+    }
+
+  gegl_module_db_register_handlers (manifest, group, "loaders",
+                                    gegl_operation_handlers_register_loader);
+  gegl_module_db_register_handlers (manifest, group, "savers",
+                                    gegl_operation_handlers_register_saver);
+
+  gegl_module_db_add_module (db, module);
+
+  g_strfreev (check_available);
+  g_strfreev (operations);
+  g_free (group);
+
+  return TRUE;
+}
+
+typedef struct
+{
+  GKeyFile   *manifest;
+  GHashTable *operations;        /* GeglModule -> GPtrArray of names */
+  GHashTable *check_available;   /* GeglModule -> GPtrArray of names */
+  GHashTable *loaders;           /* GeglModule -> GPtrArray of handlers */
+  GHashTable *savers;            /* GeglModule -> GPtrArray of handlers */
+  GHashTable *operation_modules; /* name -> GeglModule */
+} ManifestUpdate;
+
+static void
+gegl_module_db_manifest_add_operation (const gchar        *name,
+                                       GeglOperationClass *klass,
+                                       GTypePlugin        *plugin,
+                                       gpointer            user_data)
+{
+  ManifestUpdate *update = user_data;
+  GPtrArray      *names;
+  GHashTableIter  iter;
+  const gchar    *key;
+  const gchar    *value;
+  gchar          *op_group;
+
+  if (! plugin)
+    return;
+
+  names = g_hash_table_lookup (update->operations, plugin);
+  if (! names)
+    return;
+
+  g_ptr_array_add (names, g_strdup (name));
+
+  g_hash_table_insert (update->operation_modules, g_strdup (name), plugin);
+
+  if (klass->is_available)
+    {
+      g_ptr_array_add (g_hash_table_lookup (update->check_available, plugin),
+                       g_strdup (name));
+    }
+
+  op_group = g_strconcat (MANIFEST_OPERATION_PREFIX, name, NULL);
+
+  g_key_file_remove_group (update->manifest, op_group, NULL);
+
+  if (klass->keys)
+    {
+      g_hash_table_iter_init (&iter, klass->keys);
+
+      while (g_hash_table_iter_next (&iter, (gpointer) &key, (gpointer) &value))
+        {
+          /* not a string, but a marker for the class owning the table */
+          if (! strcmp (key, "operation-class"))
+            continue;
+
+          g_key_file_set_string (update->manifest, op_group, key, value);
+        }
+    }
+
+  g_free (op_group);
+}
+
+/* records a content-type handler, as "content-type=operation", if its
+ * operation belongs to one of the modules that were just opened
+ */
+static void
+gegl_module_db_manifest_add_handler (ManifestUpdate *update,
+                                     GHashTable     *handlers,
+                                     const gchar    *content_type,
+                                     const gchar    *operation)
+{
+  GeglModule *module;
+
+  module = g_hash_table_lookup (update->operation_modules, operation);
+
+  if (module)
+    {
+      g_ptr_array_add (g_hash_table_lookup (handlers, module),
+                       g_strdup_printf ("%s=%s", content_type, operation));
+    }
+}
+
+static void
+gegl_module_db_manifest_add_loader (gpointer key,
+                                    gpointer value,
+                                    gpointer user_data)
+{
+  ManifestUpdate *update = user_data;
+
+  gegl_module_db_manifest_add_handler (update, update->loaders, key, value);
+}
+
+static void
+gegl_module_db_manifest_add_saver (gpointer key,
+                                   gpointer value,
+                                   gpointer user_data)
+{
+  ManifestUpdate *update = user_data;
+
+  gegl_module_db_manifest_add_handler (update, update->savers, key, value);
+}
+
+/* records the operations of the modules that were just opened */
+static void
+gegl_module_db_update_manifest (GeglModuleDB *db,
+                                GList        *loaded)
+{
+  ManifestUpdate  update;
+  GHashTableIter  iter;
+  GeglModule     *module;
+  GPtrArray      *names;
+  gchar         **groups;
+  GList          *l;
+  gint            i;
+
+  update.manifest        = gegl_module_db_get_manifest (db);
+  update.operations      = g_hash_table_new_full (NULL, NULL, NULL,
+                                                  (GDestroyNotify) g_ptr_array_unref);
+  update.check_available = g_hash_table_new_full (NULL, NULL, NULL,
+                                                  (GDestroyNotify) g_ptr_array_unref);
+  update.loaders         = g_hash_table_new_full (NULL, NULL, NULL,
+                                                  (GDestroyNotify) g_ptr_array_unref);
+  update.savers          = g_hash_table_new_full (NULL, NULL, NULL,
+                                                  (GDestroyNotify) g_ptr_array_unref);
+  update.operation_modules = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                    g_free, NULL);
+
+  for (l = loaded; l; l = l->next)
+    {
+      gchar *group;
+
+      module = l->data;
+      group  = g_strconcat (MANIFEST_MODULE_PREFIX, module->filename, NULL);
+
+      gegl_module_db_manifest_remove (update.manifest, group);
+      g_free (group);
+
+      /* modules that failed to load are retried, and complain, every time */
+      if (module->state != GEGL_MODULE_STATE_NOT_LOADED)
+        continue;
+
+      g_hash_table_insert (update.operations, module,
+                           g_ptr_array_new_with_free_func (g_free));
+      g_hash_table_insert (update.check_available, module,
+                           g_ptr_array_new_with_free_func (g_free));
+      g_hash_table_insert (update.loaders, module,
+                           g_ptr_array_new_with_free_func (g_free));
+      g_hash_table_insert (update.savers, module,
+                           g_ptr_array_new_with_free_func (g_free));
+    }
+
+  /* this initializes the classes of the operations, which registers their
+   * content-type handlers.
+   */
+  gegl_operations_foreach (gegl_module_db_manifest_add_operation, &update);
+
+  gegl_operation_handlers_foreach_loader (gegl_module_db_manifest_add_loader,
+                                          &update);
+  gegl_operation_handlers_foreach_saver (gegl_module_db_manifest_add_saver,
+                                         &update);
+
+  g_hash_table_iter_init (&iter, update.operations);
+
+  while (g_hash_table_iter_next (&iter, (gpointer) &module, (gpointer) &names))
+    {
+      GPtrArray *check_available;
+      GPtrArray *loaders;
+      GPtrArray *savers;
+      gchar     *group;
+      gint64     mtime, size;
+
+      if (! gegl_module_db_stat (module->filename, &mtime, &size))
+        continue;
+
+      check_available = g_hash_table_lookup (update.check_available, module);
+      loaders         = g_hash_table_lookup (update.loaders,         module);
+      savers          = g_hash_table_lookup (update.savers,          module);
+
+      group = g_strconcat (MANIFEST_MODULE_PREFIX, module->filename, NULL);
+
+      g_key_file_set_int64 (update.manifest, group, "mtime", mtime);
+      g_key_file_set_int64 (update.manifest, group, "size",  size);
+      g_key_file_set_string_list (update.manifest, group, "operations",
+                                  (const gchar * const *) names->pdata,
+                                  names->len);
+      if (check_available->len)
+        g_key_file_set_string_list (update.manifest, group, "check-available",
+                                    (const gchar * const *) check_available->pdata,
+                                    check_available->len);
+      if (loaders->len)
+        g_key_file_set_string_list (update.manifest, group, "loaders",
+                                    (const gchar * const *) loaders->pdata,
+                                    loaders->len);
+      if (savers->len)
+        g_key_file_set_string_list (update.manifest, group, "savers",
+                                    (const gchar * const *) savers->pdata,
+                                    savers->len);
+
+      g_free (group);
+    }
+
+  /* forget modules that have been removed */
+  groups = g_key_file_get_groups (update.manifest, NULL);
+
+  for (i = 0; groups[i]; i++)
+    {
+      if (g_str_has_prefix (groups[i], MANIFEST_MODULE_PREFIX) &&
+          ! g_file_test (groups[i] + strlen (MANIFEST_MODULE_PREFIX),
+                         G_FILE_TEST_EXISTS))
+        {
+          gegl_module_db_manifest_remove (update.manifest, groups[i]);
+        }
+    }
+
+  g_strfreev (groups);
+  g_hash_table_unref (update.operation_modules);
+  g_hash_table_unref (update.savers);
+  g_hash_table_unref (update.loaders);
+  g_hash_table_unref (update.check_available);
+  g_hash_table_unref (update.operations);
+
+  gegl_module_db_save_manifest (db);
+}
+
 /**
  * gegl_module_db_load:
  * @db:          A #GeglModuleDB.
@@ -281,6 +754,11 @@ gegl_module_db_remove_duplicates (GeglModuleDB *db)
  * Scans the directories contained in @module_path using
  * gegl_datafiles_read_directories() and creates a #GeglModule
  * instance for every loadable module contained in the directories.
+ *
+ * Modules listed in the module manifest with their current modification
+ * time are not opened; their operations are registered on demand, the
+ * first time one of them is looked up. The other modules are loaded, and
+ * added to the manifest.
  **/
 void
 gegl_module_db_load (GeglModuleDB *db,
@@ -293,6 +771,7 @@ gegl_module_db_load (GeglModuleDB *db,
   {
     GeglModule   *module;
     gboolean load_inhibit;
+    GList   *loaded = NULL;
 
     gegl_datafiles_read_directories (module_path,
                                      G_FILE_TEST_EXISTS,
@@ -307,19 +786,27 @@ gegl_module_db_load (GeglModuleDB *db,
       load_inhibit = is_in_inhibit_list (filename,
                                          db->load_inhibit);
 
-      module = gegl_module_new (filename,
-                                load_inhibit,
-                                db->verbose);
+      if (load_inhibit ||
+          ! gegl_module_db_load_deferred (db, filename))
+        {
+          module = gegl_module_new (filename,
+                                    load_inhibit,
+                                    db->verbose);
+
+          gegl_module_db_add_module (db, module);
 
-      g_signal_connect (module, "modified",
-                        G_CALLBACK (gegl_module_db_module_modified),
-                        db);
+          if (! load_inhibit)
+            loaded = g_list_prepend (loaded, module);
+        }
 
-      db->modules = g_list_append (db->modules, module);
-      g_signal_emit (db, db_signals[ADD], 0, module);
       db->to_load = g_list_remove (db->to_load, filename);
       g_free (filename);
     }
+
+    if (loaded)
+      gegl_module_db_update_manifest (db, loaded);
+
+    g_list_free (loaded);
   }
 
 }
@@ -41,6 +41,8 @@ struct _GeglModuleDB
 
   gchar    *load_inhibit;
   gboolean  verbose;
+
+  GKeyFile *manifest;
 };
 
 struct _GeglModuleDBClass
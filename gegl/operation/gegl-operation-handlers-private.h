@@ -21,4 +21,9 @@
 
 void          gegl_operation_handlers_cleanup         (void);
 
+void          gegl_operation_handlers_foreach_loader  (GHFunc       func,
+                                                       gpointer     user_data);
+void          gegl_operation_handlers_foreach_saver   (GHFunc       func,
+                                                       gpointer     user_data);
+
 #endif
@@ -134,6 +134,22 @@ gegl_operation_handlers_get_saver (const gchar *content_type)
                                            "gegl:png-save");
 }
 
+void
+gegl_operation_handlers_foreach_loader (GHFunc   func,
+                                        gpointer user_data)
+{
+  if (load_handlers != NULL)
+    g_hash_table_foreach (load_handlers, func, user_data);
+}
+
+void
+gegl_operation_handlers_foreach_saver (GHFunc   func,
+                                       gpointer user_data)
+{
+  if (save_handlers != NULL)
+    g_hash_table_foreach (save_handlers, func, user_data);
+}
+
 void
 gegl_operation_handlers_cleanup (void)
 {
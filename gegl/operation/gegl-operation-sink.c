@@ -131,3 +131,48 @@ gboolean gegl_operation_sink_needs_full (GeglOperation *operation)
   klass  = GEGL_OPERATION_SINK_CLASS (G_OBJECT_GET_CLASS (operation));
   return klass->needs_full;
 }
+
+gboolean
+gegl_operation_sink_stream_begin (GeglOperation       *operation,
+                                  GeglBuffer          *input,
+                                  const GeglRectangle *roi,
+                                  gint                 level,
+                                  gint                *band_height)
+{
+  GeglOperationSinkClass *klass;
+
+  klass = GEGL_OPERATION_SINK_CLASS (G_OBJECT_GET_CLASS (operation));
+
+  if (! klass->stream_begin || ! klass->stream_band || ! klass->stream_end)
+    return FALSE;
+
+  return klass->stream_begin (operation, input, roi, level, band_height);
+}
+
+gboolean
+gegl_operation_sink_stream_band (GeglOperation       *operation,
+                                 GeglBuffer          *input,
+                                 const GeglRectangle *band,
+                                 gint                 level)
+{
+  GeglOperationSinkClass *klass;
+
+  klass = GEGL_OPERATION_SINK_CLASS (G_OBJECT_GET_CLASS (operation));
+
+  g_return_val_if_fail (klass->stream_band != NULL, FALSE);
+
+  return klass->stream_band (operation, input, band, level);
+}
+
+gboolean
+gegl_operation_sink_stream_end (GeglOperation *operation,
+                                gboolean       success)
+{
+  GeglOperationSinkClass *klass;
+
+  klass = GEGL_OPERATION_SINK_CLASS (G_OBJECT_GET_CLASS (operation));
+
+  g_return_val_if_fail (klass->stream_end != NULL, FALSE);
+
+  return klass->stream_end (operation, success);
+}
@@ -55,12 +55,47 @@ struct _GeglOperationSinkClass
                         GeglBuffer          *input,
                         const GeglRectangle *roi,
                         gint                 level);
-  gpointer              pad[4];
+
+  /* Optional streaming interface, used by the processor for needs_full
+   * sinks.  stream_begin() is called once with the input buffer (holding
+   * no data yet) and the full region to be written, and may adjust the
+   * suggested band height (for example to a multiple of the encoder's
+   * block size); returning FALSE makes the processor fall back to a
+   * single process() call.  stream_band() is then called with consecutive
+   * full-width bands, top to bottom, each valid in input only for the
+   * duration of the call, and stream_end() is called once when done, with
+   * success set to FALSE if the stream was aborted.  Streaming is only
+   * used at level 0.
+   */
+  gboolean (* stream_begin) (GeglOperation       *self,
+                             GeglBuffer          *input,
+                             const GeglRectangle *roi,
+                             gint                 level,
+                             gint                *band_height);
+  gboolean (* stream_band)  (GeglOperation       *self,
+                             GeglBuffer          *input,
+                             const GeglRectangle *band,
+                             gint                 level);
+  gboolean (* stream_end)   (GeglOperation       *self,
+                             gboolean             success);
+  gpointer              pad[1];
 };
 
 GType    gegl_operation_sink_get_type   (void) G_GNUC_CONST;
 
-gboolean gegl_operation_sink_needs_full (GeglOperation *operation);
+gboolean gegl_operation_sink_needs_full   (GeglOperation       *operation);
+
+gboolean gegl_operation_sink_stream_begin (GeglOperation       *operation,
+                                           GeglBuffer          *input,
+                                           const GeglRectangle *roi,
+                                           gint                 level,
+                                           gint                *band_height);
+gboolean gegl_operation_sink_stream_band  (GeglOperation       *operation,
+                                           GeglBuffer          *input,
+                                           const GeglRectangle *band,
+                                           gint                 level);
+gboolean gegl_operation_sink_stream_end   (GeglOperation       *operation,
+                                           gboolean             success);
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (GeglOperationSink, g_object_unref)
 
@@ -27,6 +27,7 @@
 #include "gegl-config.h"
 #include "gegl-types-internal.h"
 #include "gegl-parallel-private.h"
+#include "gegl-trace.h"
 #include "gegl-operation.h"
 #include "gegl-operation-private.h"
 #include "gegl-operation-context.h"
@@ -36,6 +37,7 @@
 #include "graph/gegl-node-private.h"
 #include "graph/gegl-connection.h"
 #include "graph/gegl-pad.h"
+#include "graph/gegl-region.h"
 #include "gegl-operations.h"
 
 
@@ -48,9 +50,12 @@ struct _GeglOperationPrivate
 {
   gdouble  pixel_time;
   gboolean attached;
+  GMutex   process_mutex;
 };
 
 
+static void            finalize                         (GObject             *object);
+
 static void            attach                           (GeglOperation       *self);
 
 static GeglRectangle   get_bounding_box                 (GeglOperation       *self);
@@ -72,6 +77,10 @@ G_DEFINE_TYPE_WITH_PRIVATE (GeglOperation, gegl_operation, G_TYPE_OBJECT)
 static void
 gegl_operation_class_init (GeglOperationClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = finalize;
+
   klass->name                      = NULL;  /* an operation class with
                                              * name == NULL is not
                                              * included when doing
@@ -96,6 +105,19 @@ gegl_operation_init (GeglOperation *self)
   GeglOperationPrivate *priv = gegl_operation_get_instance_private (self);
 
   priv->pixel_time = -1.0;
+
+  g_mutex_init (&priv->process_mutex);
+}
+
+static void
+finalize (GObject *object)
+{
+  GeglOperation        *self = GEGL_OPERATION (object);
+  GeglOperationPrivate *priv = gegl_operation_get_instance_private (self);
+
+  g_mutex_clear (&priv->process_mutex);
+
+  G_OBJECT_CLASS (gegl_operation_parent_class)->finalize (object);
 }
 
 /**
@@ -135,16 +157,19 @@ gegl_operation_process (GeglOperation        *operation,
                         const GeglRectangle  *result,
                         gint                  level)
 {
-  GeglOperationClass *klass;
-  gint64              t;
-  gint64              n_pixels;
-  gboolean            update_pixel_time;
-  gboolean            success;
+  GeglOperationClass   *klass;
+  GeglOperationPrivate *priv;
+  gint64                t;
+  gint64                n_pixels;
+  gboolean              update_pixel_time;
+  gboolean              success;
+  GeglTraceSpan         span;
 
   g_return_val_if_fail (GEGL_IS_OPERATION (operation), FALSE);
   g_return_val_if_fail (result != NULL, FALSE);
 
   klass = GEGL_OPERATION_GET_CLASS (operation);
+  priv  = gegl_operation_get_instance_private (operation);
 
   if (!strcmp (output_pad, "output") &&
       (result->width == 0 || result->height == 0))
@@ -165,6 +190,13 @@ gegl_operation_process (GeglOperation        *operation,
 
   g_return_val_if_fail (klass->process, FALSE);
 
+  /* operations that aren't threaded may keep per-instance state, so we don't
+   * let their process() be called concurrently, which happens when several
+   * chunks of the same graph are rendered at once.
+   */
+  if (! klass->threaded)
+    g_mutex_lock (&priv->process_mutex);
+
   n_pixels = (gint64) result->width * (gint64) result->height;
 
   update_pixel_time = n_pixels >=
@@ -173,8 +205,19 @@ gegl_operation_process (GeglOperation        *operation,
   if (update_pixel_time)
     t = g_get_monotonic_time ();
 
+  if (G_UNLIKELY (gegl_trace_enabled))
+    {
+      gegl_trace_span_begin (
+        &span,
+        g_intern_string (gegl_node_get_debug_name (operation->node)),
+        "process");
+    }
+
   success = klass->process (operation, context, output_pad, result, level);
 
+  if (! klass->threaded)
+    g_mutex_unlock (&priv->process_mutex);
+
   if (success && update_pixel_time)
     {
       t = g_get_monotonic_time () - t;
@@ -183,6 +226,9 @@ gegl_operation_process (GeglOperation        *operation,
                                         (gdouble) t / G_TIME_SPAN_SECOND);
     }
 
+  if (G_UNLIKELY (gegl_trace_enabled))
+    gegl_trace_span_end (&span, result, priv->pixel_time);
+
   return success;
 }
 
@@ -595,6 +641,31 @@ gegl_operation_invalidate (GeglOperation       *operation,
     gegl_node_invalidated (operation->node, roi, clear_cache);
 }
 
+void
+gegl_operation_invalidate_rectangles (GeglOperation       *operation,
+                                      const GeglRectangle *rects,
+                                      gint                 n_rects,
+                                      gboolean             clear_cache)
+{
+  GeglRegion *region;
+  gint        i;
+
+  g_return_if_fail (GEGL_IS_OPERATION (operation));
+  g_return_if_fail (rects != NULL || n_rects == 0);
+
+  if (! operation->node || n_rects <= 0)
+    return;
+
+  region = gegl_region_new ();
+
+  for (i = 0; i < n_rects; i++)
+    gegl_region_union_with_rect (region, &rects[i]);
+
+  gegl_node_invalidated_region (operation->node, region, clear_cache);
+
+  gegl_region_destroy (region);
+}
+
 gboolean
 gegl_operation_cl_set_kernel_args (GeglOperation *operation,
                                    cl_kernel      kernel,
@@ -695,10 +766,29 @@ gegl_operation_list_keys (const gchar *operation_name,
   GType                type;
   GeglOperationClass  *klass;
   GList               *list, *l;
+  GHashTable          *keys;
   gchar              **ret;
   int                  count;
   int                  i;
   g_return_val_if_fail (operation_name != NULL, NULL);
+
+  /* answer from the module manifest, without loading the module */
+  keys = gegl_operations_get_lazy_keys (operation_name);
+  if (keys)
+    {
+      count = g_hash_table_size (keys);
+      ret = g_malloc0 (sizeof (gpointer) * (count + 1));
+      list = g_hash_table_get_keys (keys);
+      for (i = 0, l = list; l; l = l->next, i++)
+        {
+          ret[i] = l->data;
+        }
+      g_list_free (list);
+      if (n_keys)
+        *n_keys = count;
+      return ret;
+    }
+
   type = gegl_operation_gtype_from_name (operation_name);
   if (!type)
     {
@@ -842,7 +932,13 @@ gegl_operation_get_key (const gchar *operation_name,
 {
   GType         type;
   GObjectClass *klass;
+  GHashTable   *keys;
   const gchar  *ret = NULL;
+
+  keys = gegl_operations_get_lazy_keys (operation_name);
+  if (keys)
+    return g_hash_table_lookup (keys, key_name);
+
   type = gegl_operation_gtype_from_name (operation_name);
   if (!type)
     {
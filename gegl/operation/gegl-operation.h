@@ -269,6 +269,21 @@ void     gegl_operation_invalidate       (GeglOperation       *operation,
                                           const GeglRectangle *roi,
                                           gboolean             clear_cache);
 
+/* Invalidate the union of a set of rectangles, for operations that know the
+ * exact area affected by a change; unlike gegl_operation_invalidate() with
+ * their bounding box, only the area actually covered by the rectangles gets
+ * recomputed, in this node and the nodes depending on it.
+ *
+ * @rects : the rectangles to invalidate
+ * @n_rects : the number of rectangles
+ * @clear_cache: whether any present caches should be zeroed out
+ */
+void     gegl_operation_invalidate_rectangles
+                                         (GeglOperation       *operation,
+                                          const GeglRectangle *rects,
+                                          gint                 n_rects,
+                                          gboolean             clear_cache);
+
 gboolean gegl_operation_cl_set_kernel_args (GeglOperation *operation,
                                             cl_kernel      kernel,
                                             gint          *p,
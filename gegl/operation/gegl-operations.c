@@ -34,8 +34,22 @@ static gchar     **accepted_licenses       = NULL;
 static GHashTable *known_operation_names   = NULL;
 static GHashTable *visible_operation_names = NULL;
 static GSList     *operations_list         = NULL;
+static GHashTable *lazy_operations         = NULL;
+static gboolean    lazy_operations_loaded  = TRUE;
 static guint       gtype_hash_serial       = 0;
 
+/* an operation listed in the module manifest, whose module has not been
+ * loaded yet; the entries are kept after loading, since the keys might
+ * have been handed out by gegl_operations_get_lazy_keys().
+ */
+typedef struct
+{
+  GTypeModule *module;
+  GHashTable  *keys;
+  gboolean     check_available;
+  gboolean     loaded;
+} GeglLazyOperation;
+
 static GRWLock  operations_cache_rw_lock        = { 0, };
 static GThread *operations_cache_rw_lock_thread = NULL;
 static int      operations_cache_rw_lock_count  = 0;
@@ -267,48 +281,224 @@ gegl_operations_set_licenses_from_string (const gchar *license_str)
   unlock_operations_cache (TRUE);
 }
 
+static void
+gegl_lazy_operation_free (GeglLazyOperation *lazy)
+{
+  g_hash_table_unref (lazy->keys);
+  g_slice_free (GeglLazyOperation, lazy);
+}
+
+/* must be called with the write lock held */
+static void
+load_lazy_module (GTypeModule *module)
+{
+  GHashTableIter     iter;
+  GeglLazyOperation *lazy;
+
+  g_hash_table_iter_init (&iter, lazy_operations);
+
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &lazy))
+    {
+      if (lazy->module == module)
+        lazy->loaded = TRUE;
+    }
+
+  GEGL_NOTE (GEGL_DEBUG_MISC, "Loading module %s on demand",
+             g_type_module_get_name (module) ?
+             g_type_module_get_name (module) : "");
+
+  /* registers the types of the module, like gegl_module_new () does */
+  if (g_type_module_use (module))
+    g_type_module_unuse (module);
+}
+
+/* must be called with the write lock held; loads the module providing
+ * name, or every module not loaded yet if name is NULL
+ */
+static void
+load_lazy_operations (const gchar *name)
+{
+  GeglLazyOperation *lazy;
+
+  if (name)
+    {
+      lazy = g_hash_table_lookup (lazy_operations, name);
+
+      if (lazy && ! lazy->loaded)
+        load_lazy_module (lazy->module);
+    }
+  else
+    {
+      GHashTableIter iter;
+
+      g_hash_table_iter_init (&iter, lazy_operations);
+
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer) &lazy))
+        {
+          if (! lazy->loaded)
+            load_lazy_module (lazy->module);
+        }
+
+      lazy_operations_loaded = TRUE;
+    }
+}
+
+static gboolean
+is_lazy (const gchar *name)
+{
+  GeglLazyOperation *lazy = g_hash_table_lookup (lazy_operations, name);
+
+  return lazy && ! lazy->loaded;
+}
+
+/* must be called with the write lock held; if any new modules have been
+ * loaded, scan for GeglOperations
+ */
+static void
+scan_operations (void)
+{
+  guint latest_serial = g_type_get_type_registration_serial ();
+
+  if (gtype_hash_serial != latest_serial)
+    {
+      add_operations (GEGL_TYPE_OPERATION);
+
+      gtype_hash_serial = latest_serial;
+
+      gegl_operations_update_visible ();
+    }
+}
+
 GType
 gegl_operation_gtype_from_name (const gchar *name)
 {
-  guint latest_serial;
   GType type;
 
   lock_operations_cache (FALSE);
 
-  /* If any new modules have been loaded, scan for GeglOperations */
-  latest_serial = g_type_get_type_registration_serial ();
-  if (gtype_hash_serial != latest_serial)
+  if (gtype_hash_serial == g_type_get_type_registration_serial () &&
+      ! is_lazy (name))
     {
-      unlock_operations_cache (FALSE);
-      lock_operations_cache (TRUE);
+      type = (GType) g_hash_table_lookup (visible_operation_names, name);
 
-      latest_serial = g_type_get_type_registration_serial ();
-      if (gtype_hash_serial != latest_serial)
+      if (type || lazy_operations_loaded)
         {
-          add_operations (GEGL_TYPE_OPERATION);
-
-          gtype_hash_serial = latest_serial;
+          unlock_operations_cache (FALSE);
 
-          gegl_operations_update_visible ();
+          return type;
         }
+    }
+
+  unlock_operations_cache (FALSE);
+  lock_operations_cache (TRUE);
+
+  load_lazy_operations (name);
+  scan_operations ();
+
+  type = (GType) g_hash_table_lookup (visible_operation_names, name);
+
+  if (! type && ! lazy_operations_loaded)
+    {
+      /* the manifest might be out of date, look in every module */
+      load_lazy_operations (NULL);
+      scan_operations ();
 
       type = (GType) g_hash_table_lookup (visible_operation_names, name);
+    }
+
+  unlock_operations_cache (TRUE);
+
+  return type;
+}
+
+/* keys of an operation known from the module manifest, without loading
+ * its module; returns NULL if the module is loaded, or if the operation
+ * might not be visible once it is.
+ */
+GHashTable *
+gegl_operations_get_lazy_keys (const gchar *name)
+{
+  GeglLazyOperation *lazy;
+  GHashTable        *keys = NULL;
+
+  lock_operations_cache (FALSE);
+
+  lazy = g_hash_table_lookup (lazy_operations, name);
 
+  if (lazy && ! lazy->loaded && ! lazy->check_available)
+    {
+      const gchar *license = g_hash_table_lookup (lazy->keys, "license");
+
+      if (! license || gegl_operations_check_license (license))
+        keys = lazy->keys;
+    }
+
+  unlock_operations_cache (FALSE);
+
+  return keys;
+}
+
+void
+gegl_operations_add_lazy (const gchar *name,
+                          GTypeModule *module,
+                          GHashTable  *keys,
+                          gboolean     check_available)
+{
+  GeglLazyOperation *lazy;
+
+  lock_operations_cache (TRUE);
+
+  if (g_hash_table_contains (known_operation_names, name) ||
+      g_hash_table_contains (lazy_operations, name))
+    {
       unlock_operations_cache (TRUE);
+      return;
     }
-  else
+
+  lazy                  = g_slice_new0 (GeglLazyOperation);
+  lazy->module          = module;
+  lazy->keys            = g_hash_table_ref (keys);
+  lazy->check_available = check_available;
+
+  g_hash_table_insert (lazy_operations, g_strdup (name), lazy);
+
+  lazy_operations_loaded = FALSE;
+
+  unlock_operations_cache (TRUE);
+}
+
+void
+gegl_operations_foreach (GeglOperationsForeachFunc func,
+                         gpointer                  user_data)
+{
+  GHashTableIter iter;
+  const gchar   *name;
+  GType          type;
+
+  lock_operations_cache (TRUE);
+
+  scan_operations ();
+
+  g_hash_table_iter_init (&iter, known_operation_names);
+
+  while (g_hash_table_iter_next (&iter, (gpointer) &name, (gpointer) &type))
     {
-      type = (GType) g_hash_table_lookup (visible_operation_names, name);
+      GeglOperationClass *klass = g_type_class_ref (type);
 
-      unlock_operations_cache (FALSE);
+      func (name, klass, g_type_get_plugin (type), user_data);
+
+      g_type_class_unref (klass);
     }
 
-  return type;
+  unlock_operations_cache (TRUE);
 }
 
 gboolean
 gegl_has_operation (const gchar *operation_type)
 {
+  if (gegl_operations_get_lazy_keys (operation_type))
+    return TRUE;
+
   return gegl_operation_gtype_from_name (operation_type) != 0;
 }
 
@@ -321,6 +511,11 @@ gchar **gegl_list_operations (guint *n_operations_p)
   gint    pasp_size = 0;
   gint    pasp_pos;
 
+  lock_operations_cache (TRUE);
+  load_lazy_operations (NULL);
+  scan_operations ();
+  unlock_operations_cache (TRUE);
+
   if (!operations_list)
     {
       gegl_operation_gtype_from_name ("");
@@ -376,6 +571,10 @@ gegl_operation_gtype_init (void)
   if (!visible_operation_names)
     visible_operation_names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
+  if (!lazy_operations)
+    lazy_operations = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                             (GDestroyNotify) gegl_lazy_operation_free);
+
   unlock_operations_cache (TRUE);
 }
 
@@ -391,6 +590,10 @@ gegl_operation_gtype_cleanup (void)
       g_hash_table_destroy (visible_operation_names);
       visible_operation_names = NULL;
 
+      g_hash_table_destroy (lazy_operations);
+      lazy_operations = NULL;
+      lazy_operations_loaded = TRUE;
+
       g_slist_free (operations_list);
       operations_list = NULL;
     }
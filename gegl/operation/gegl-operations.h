@@ -36,4 +36,25 @@ void       gegl_operation_class_register_name (GeglOperationClass *klass,
 
 void       gegl_operations_set_licenses_from_string (const gchar *license_str);
 
+typedef void (* GeglOperationsForeachFunc) (const gchar        *name,
+                                            GeglOperationClass *klass,
+                                            GTypePlugin        *plugin,
+                                            gpointer            user_data);
+
+/* Calls func for every registered operation name, with the plugin (if any)
+ * that provides it; used to generate the module manifest.
+ */
+void       gegl_operations_foreach          (GeglOperationsForeachFunc func,
+                                             gpointer                  user_data);
+
+/* Makes name known as provided by module, without loading the module until
+ * the operation is first looked up. keys are the operation keys, as listed
+ * in the module manifest.
+ */
+void       gegl_operations_add_lazy         (const gchar *name,
+                                             GTypeModule *module,
+                                             GHashTable  *keys,
+                                             gboolean     check_available);
+GHashTable * gegl_operations_get_lazy_keys  (const gchar *name);
+
 #endif
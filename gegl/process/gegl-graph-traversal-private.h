@@ -19,12 +19,24 @@
 #ifndef __GEGL_GRAPH_TRAVERSAL_PRIVATE_H__
 #define __GEGL_GRAPH_TRAVERSAL_PRIVATE_H__
 
+/* a chain of point operations, each consuming the output of the previous one
+ * only, which is processed in a single pass, without intermediate buffers.
+ */
+typedef struct
+{
+  GeglNode **nodes;   /* from the head of the chain to its tail */
+  gint       n_nodes;
+  gboolean   active;  /* whether the chain is fused for the current request */
+} GeglGraphFusedRun;
+
 struct _GeglGraphTraversal
 {
   GHashTable *contexts;
   GQueue      path;
   gboolean    rects_dirty;
   GeglBuffer *shared_empty;
+  GPtrArray  *fused_runs;     /* GeglGraphFusedRun */
+  GHashTable *fused_nodes;    /* node -> GeglGraphFusedRun */
 };
 
 #endif /* __GEGL_GRAPH_TRAVERSAL_PRIVATE_H__ */
@@ -19,6 +19,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib-object.h>
 
 #include "gegl-types-internal.h"
@@ -41,6 +43,12 @@
 #include "operation/gegl-operation.h"
 #include "operation/gegl-operation-context.h"
 #include "operation/gegl-operation-context-private.h"
+#include "operation/gegl-operation-point-composer.h"
+#include "operation/gegl-operation-point-filter.h"
+
+#include "gegl-parallel.h"
+
+#include "opencl/gegl-cl.h"
 
 typedef struct
 {
@@ -54,6 +62,7 @@ static GList *gegl_graph_get_connected_output_contexts (GeglGraphTraversal *path
 static void   _gegl_graph_do_build                     (GeglGraphTraversal *path,
                                                         GeglNode           *node);
 static GeglBuffer *gegl_graph_get_shared_empty         (GeglGraphTraversal *path);
+static void   gegl_graph_fused_run_free                (GeglGraphFusedRun  *run);
 
 static gboolean
 _gegl_graph_do_build_add_node (GeglNode *node,
@@ -113,6 +122,10 @@ gegl_graph_build (GeglNode *node)
 
   g_queue_init (&result->path);
 
+  result->fused_runs  = g_ptr_array_new_with_free_func (
+    (GDestroyNotify) gegl_graph_fused_run_free);
+  result->fused_nodes = g_hash_table_new (NULL, NULL);
+
   _gegl_graph_do_build (result, node);
 
   return result;
@@ -132,6 +145,9 @@ gegl_graph_rebuild (GeglGraphTraversal *path, GeglNode *node)
   g_queue_clear (&path->path);
   g_hash_table_unref (path->contexts);
 
+  g_ptr_array_set_size (path->fused_runs, 0);
+  g_hash_table_remove_all (path->fused_nodes);
+
   /* Replaces everything but shared_empty */
   _gegl_graph_do_build (path, node);
 }
@@ -141,10 +157,169 @@ gegl_graph_free (GeglGraphTraversal *path)
 {
   g_queue_clear (&path->path);
   g_hash_table_unref (path->contexts);
+  g_ptr_array_unref (path->fused_runs);
+  g_hash_table_unref (path->fused_nodes);
   g_clear_object (&path->shared_empty);
   g_free (path);
 }
 
+static void
+gegl_graph_fused_run_free (GeglGraphFusedRun *run)
+{
+  g_free (run->nodes);
+  g_slice_free (GeglGraphFusedRun, run);
+}
+
+/* returns TRUE if the node is a point filter or composer that can be
+ * processed as part of a fused run, i.e. whose processing is fully done by
+ * the point-op base class, calling its process function on each chunk.
+ * since fused runs are split across threads as a whole, operations which
+ * aren't threaded end the run.
+ */
+static gboolean
+gegl_graph_is_fusable (GeglNode *node)
+{
+  GeglOperation      *operation = node->operation;
+  GeglOperationClass *klass;
+  gpointer            base_class;
+  gboolean            fusable   = FALSE;
+
+  if (! operation || node->passthrough)
+    return FALSE;
+
+  klass = GEGL_OPERATION_GET_CLASS (operation);
+
+  if (! klass->threaded)
+    return FALSE;
+
+  if (GEGL_IS_OPERATION_POINT_FILTER (operation))
+    {
+      base_class = g_type_class_ref (GEGL_TYPE_OPERATION_POINT_FILTER);
+
+      fusable =
+        klass->process == GEGL_OPERATION_CLASS (base_class)->process &&
+        GEGL_OPERATION_FILTER_CLASS (klass)->process ==
+          GEGL_OPERATION_FILTER_CLASS (base_class)->process &&
+        GEGL_OPERATION_POINT_FILTER_CLASS (klass)->process;
+
+      g_type_class_unref (base_class);
+    }
+  else if (GEGL_IS_OPERATION_POINT_COMPOSER (operation))
+    {
+      base_class = g_type_class_ref (GEGL_TYPE_OPERATION_POINT_COMPOSER);
+
+      fusable =
+        klass->process == GEGL_OPERATION_CLASS (base_class)->process &&
+        GEGL_OPERATION_COMPOSER_CLASS (klass)->process ==
+          GEGL_OPERATION_COMPOSER_CLASS (base_class)->process &&
+        GEGL_OPERATION_POINT_COMPOSER_CLASS (klass)->process;
+
+      g_type_class_unref (base_class);
+    }
+
+  return fusable;
+}
+
+/* returns the node whose output is fused into node's input, if any */
+static GeglNode *
+gegl_graph_get_fusable_producer (GeglGraphTraversal *path,
+                                 GeglNode           *node)
+{
+  GeglPad  *input_pad;
+  GeglPad  *source_pad;
+  GeglNode *source_node;
+  GList    *targets;
+  gint      n_targets;
+
+  input_pad = gegl_node_get_pad (node, "input");
+
+  if (! input_pad)
+    return NULL;
+
+  source_pad = gegl_pad_get_connected_to (input_pad);
+
+  if (! source_pad || strcmp (gegl_pad_get_name (source_pad), "output"))
+    return NULL;
+
+  source_node = gegl_pad_get_node (source_pad);
+
+  if (! g_hash_table_contains (path->contexts, source_node) ||
+      source_node->cache                                    ||
+      ! gegl_graph_is_fusable (source_node))
+    {
+      return NULL;
+    }
+
+  /* the intermediate result must not be needed by anything else */
+  targets   = gegl_graph_get_connected_output_contexts (path, source_pad);
+  n_targets = g_list_length (targets);
+  g_list_free_full (targets, free_context_connection);
+
+  if (n_targets != 1)
+    return NULL;
+
+  /* and must be passed on without a format conversion */
+  if (gegl_operation_get_format (source_node->operation, "output") !=
+      gegl_operation_get_format (node->operation, "input"))
+    {
+      return NULL;
+    }
+
+  return source_node;
+}
+
+/* finds the maximal chains of point operations that can be processed in a
+ * single pass.
+ */
+static void
+gegl_graph_find_fused_runs (GeglGraphTraversal *path)
+{
+  GList *list_iter;
+
+  g_ptr_array_set_size (path->fused_runs, 0);
+  g_hash_table_remove_all (path->fused_nodes);
+
+  for (list_iter = g_queue_peek_head_link (&path->path);
+       list_iter;
+       list_iter = list_iter->next)
+    {
+      GeglNode          *node = GEGL_NODE (list_iter->data);
+      GeglNode          *producer;
+      GeglGraphFusedRun *run;
+
+      if (! gegl_graph_is_fusable (node))
+        continue;
+
+      producer = gegl_graph_get_fusable_producer (path, node);
+
+      if (! producer)
+        continue;
+
+      run = g_hash_table_lookup (path->fused_nodes, producer);
+
+      if (! run)
+        {
+          run = g_slice_new0 (GeglGraphFusedRun);
+
+          run->nodes      = g_new (GeglNode *, 1);
+          run->nodes[0]   = producer;
+          run->n_nodes    = 1;
+
+          g_ptr_array_add (path->fused_runs, run);
+          g_hash_table_insert (path->fused_nodes, producer, run);
+        }
+
+      run->nodes = g_renew (GeglNode *, run->nodes, run->n_nodes + 1);
+      run->nodes[run->n_nodes++] = node;
+
+      g_hash_table_insert (path->fused_nodes, node, run);
+
+      GEGL_NOTE (GEGL_DEBUG_PROCESS, "Fusing %s into %s",
+                 gegl_node_get_debug_name (node),
+                 gegl_node_get_debug_name (producer));
+    }
+}
+
 
 /**
  * gegl_graph_get_bounding_box:
@@ -232,6 +407,8 @@ gegl_graph_prepare (GeglGraphTraversal *path)
                              context);
       }
   }
+
+  gegl_graph_find_fused_runs (path);
 }
 
 /**
@@ -409,6 +586,248 @@ gegl_graph_get_shared_empty (GeglGraphTraversal *path)
 }
 
 
+/* decides which fused runs can be used for the prepared request.  a run is
+ * only fused if all of its nodes need to be processed, over the same area.
+ */
+static void
+gegl_graph_activate_fused_runs (GeglGraphTraversal *path)
+{
+  guint i;
+
+  for (i = 0; i < path->fused_runs->len; i++)
+    {
+      GeglGraphFusedRun    *run = g_ptr_array_index (path->fused_runs, i);
+      GeglOperationContext *tail_context;
+      gint                  j;
+
+      tail_context = g_hash_table_lookup (path->contexts,
+                                          run->nodes[run->n_nodes - 1]);
+
+      run->active = ! gegl_cl_is_accelerated ()               &&
+                    tail_context->need_rect.width  > 0        &&
+                    tail_context->need_rect.height > 0;
+
+      for (j = 0; j < run->n_nodes && run->active; j++)
+        {
+          GeglNode             *node    = run->nodes[j];
+          GeglOperationContext *context = g_hash_table_lookup (path->contexts,
+                                                               node);
+
+          if (context->cached                                            ||
+              node->passthrough                                          ||
+              (node->cache && j < run->n_nodes - 1)                      ||
+              ! gegl_rectangle_equal (&context->need_rect,
+                                      &tail_context->need_rect))
+            {
+              run->active = FALSE;
+            }
+        }
+    }
+}
+
+typedef struct
+{
+  GeglGraphFusedRun  *run;
+  GeglBuffer         *input;
+  GeglBuffer        **aux;
+  GeglBuffer         *output;
+  const Babl         *input_format;
+  const Babl        **aux_formats;
+  const Babl         *output_format;
+  gint                max_bpp;
+  gint                level;
+} FusedRunData;
+
+static void
+gegl_graph_process_fused_run_area (const GeglRectangle *area,
+                                   FusedRunData        *data)
+{
+  GeglGraphFusedRun  *run = data->run;
+  GeglBufferIterator *iter;
+  gint               *aux_index;
+  gint                read;
+  gint                j;
+
+  aux_index = g_newa (gint, run->n_nodes);
+
+  iter = gegl_buffer_iterator_new (data->output, area, data->level,
+                                   data->output_format,
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE,
+                                   2 + run->n_nodes);
+
+  read = gegl_buffer_iterator_add (iter, data->input, area, data->level,
+                                   data->input_format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  for (j = 0; j < run->n_nodes; j++)
+    {
+      aux_index[j] = -1;
+
+      if (data->aux[j])
+        {
+          aux_index[j] = gegl_buffer_iterator_add (iter, data->aux[j], area,
+                                                   data->level,
+                                                   data->aux_formats[j],
+                                                   GEGL_ACCESS_READ,
+                                                   GEGL_ABYSS_NONE);
+        }
+    }
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi     = &iter->items[0].roi;
+      gint                 length  = iter->length;
+      guchar              *temp[2] = {NULL, NULL};
+      gpointer             in      = iter->items[read].data;
+
+      if (run->n_nodes > 1)
+        {
+          temp[0] = gegl_scratch_alloc ((gsize) data->max_bpp * length);
+          temp[1] = gegl_scratch_alloc ((gsize) data->max_bpp * length);
+        }
+
+      /* run each operation over the chunk while it's still in the cache,
+       * ping-ponging between two scratch buffers.
+       */
+      for (j = 0; j < run->n_nodes; j++)
+        {
+          GeglOperation *operation = run->nodes[j]->operation;
+          gpointer       out;
+
+          if (j == run->n_nodes - 1)
+            out = iter->items[0].data;
+          else
+            out = temp[j % 2];
+
+          if (GEGL_IS_OPERATION_POINT_FILTER (operation))
+            {
+              GEGL_OPERATION_POINT_FILTER_GET_CLASS (operation)->process (
+                operation, in, out, length, roi, data->level);
+            }
+          else
+            {
+              gpointer aux = NULL;
+
+              if (aux_index[j] >= 0)
+                aux = iter->items[aux_index[j]].data;
+
+              GEGL_OPERATION_POINT_COMPOSER_GET_CLASS (operation)->process (
+                operation, in, aux, out, length, roi, data->level);
+            }
+
+          in = out;
+        }
+
+      if (run->n_nodes > 1)
+        {
+          gegl_scratch_free (temp[1]);
+          gegl_scratch_free (temp[0]);
+        }
+    }
+}
+
+/* processes a fused run of point operations in a single pass, storing the
+ * result as the output of its tail node.
+ */
+static void
+gegl_graph_process_fused_run (GeglGraphTraversal *path,
+                              GeglGraphFusedRun  *run,
+                              gint                level)
+{
+  GeglNode             *head         = run->nodes[0];
+  GeglNode             *tail         = run->nodes[run->n_nodes - 1];
+  GeglOperationContext *head_context = g_hash_table_lookup (path->contexts, head);
+  GeglOperationContext *tail_context = g_hash_table_lookup (path->contexts, tail);
+  GeglRectangle         result       = tail_context->need_rect;
+  FusedRunData          data;
+  gint                  j;
+
+  GEGL_NOTE (GEGL_DEBUG_PROCESS,
+             "Will process %d fused nodes from %s to %s",
+             run->n_nodes,
+             gegl_node_get_debug_name (head),
+             gegl_node_get_debug_name (tail));
+
+  if (level)
+    {
+      result.x      >>= level;
+      result.y      >>= level;
+      result.width  >>= level;
+      result.height >>= level;
+    }
+
+  data.run           = run;
+  data.level         = level;
+  data.aux           = g_newa (GeglBuffer *, run->n_nodes);
+  data.aux_formats   = g_newa (const Babl *, run->n_nodes);
+  data.input_format  = gegl_operation_get_format (head->operation, "input");
+  data.output_format = gegl_operation_get_format (tail->operation, "output");
+  data.max_bpp       = 0;
+
+  data.input = GEGL_BUFFER (
+    gegl_operation_context_dup_object (head_context, "input"));
+
+  if (! data.input)
+    data.input = g_object_ref (gegl_graph_get_shared_empty (path));
+
+  for (j = 0; j < run->n_nodes; j++)
+    {
+      GeglNode             *node    = run->nodes[j];
+      GeglOperationContext *context = g_hash_table_lookup (path->contexts,
+                                                           node);
+      const Babl           *format;
+
+      node->operation->node = node;
+      context->level        = level;
+
+      data.aux[j]         = NULL;
+      data.aux_formats[j] = NULL;
+
+      if (GEGL_IS_OPERATION_POINT_COMPOSER (node->operation))
+        {
+          data.aux[j] = GEGL_BUFFER (
+            gegl_operation_context_dup_object (context, "aux"));
+          data.aux_formats[j] = gegl_operation_get_format (node->operation,
+                                                           "aux");
+        }
+
+      format       = gegl_operation_get_format (node->operation, "output");
+      data.max_bpp = MAX (data.max_bpp,
+                          babl_format_get_bytes_per_pixel (format));
+    }
+
+  data.output = gegl_operation_context_get_output_maybe_in_place (
+    tail->operation, tail_context, data.input, &result);
+
+  if (result.width > 0 && result.height > 0)
+    {
+      if (gegl_operation_use_threading (tail->operation, &result))
+        {
+          gegl_parallel_distribute_area (
+            &result,
+            gegl_operation_get_pixels_per_thread (tail->operation),
+            GEGL_SPLIT_STRATEGY_AUTO,
+            (GeglParallelDistributeAreaFunc) gegl_graph_process_fused_run_area,
+            &data);
+        }
+      else
+        {
+          gegl_graph_process_fused_run_area (&result, &data);
+        }
+    }
+
+  for (j = 0; j < run->n_nodes; j++)
+    g_clear_object (&data.aux[j]);
+  g_object_unref (data.input);
+
+  /* the intermediate nodes were never processed; drop their inputs */
+  for (j = 0; j < run->n_nodes - 1; j++)
+    {
+      gegl_operation_context_purge (
+        g_hash_table_lookup (path->contexts, run->nodes[j]));
+    }
+}
+
 /**
  * gegl_graph_process:
  * @path: The traversal path
@@ -433,15 +852,26 @@ gegl_graph_process (GeglGraphTraversal *path,
   GeglOperationContext *last_context = NULL;
   GeglBuffer *operation_result = NULL;
 
+  gegl_graph_activate_fused_runs (path);
+
   for (list_iter = g_queue_peek_head_link (&path->path);
        list_iter;
        list_iter = list_iter->next)
     {
       GeglNode *node = GEGL_NODE (list_iter->data);
       GeglOperation *operation = node->operation;
+      GeglGraphFusedRun *run;
       g_return_val_if_fail (node, NULL);
       g_return_val_if_fail (operation, NULL);
-      
+
+      run = g_hash_table_lookup (path->fused_nodes, node);
+
+      /* the nodes of an active fused run are all processed together, when
+       * reaching its tail, once all of their aux inputs are available.
+       */
+      if (run && run->active && node != run->nodes[run->n_nodes - 1])
+        continue;
+
       GEGL_INSTRUMENT_START();
 
       operation_result = NULL;
@@ -483,7 +913,10 @@ gegl_graph_process (GeglGraphTraversal *path,
               /* note: this hard-coding of "output" makes some more custom
                * graph topologies harder than necessary.
                */
-              gegl_operation_process (operation, context, "output", &context->need_rect, context->level);
+              if (run && run->active)
+                gegl_graph_process_fused_run (path, run, context->level);
+              else
+                gegl_operation_process (operation, context, "output", &context->need_rect, context->level);
               operation_result = GEGL_BUFFER (gegl_operation_context_get_object (context, "output"));
 
               if (operation_result && operation_result == (GeglBuffer *)operation->node->cache)
@@ -32,8 +32,11 @@
 #include "operation/gegl-operation-sink.h"
 
 #include "gegl-config.h"
+#include "gegl-parallel.h"
+#include "gegl-parallel-private.h"
 #include "gegl-processor.h"
 #include "gegl-processor-private.h"
+#include "process/gegl-eval-manager.h"
 
 #include "graph/gegl-visitor.h"
 #include "graph/gegl-callback-visitor.h"
@@ -41,6 +44,18 @@
 
 #include "opencl/gegl-cl.h"
 
+/* the maximal number of sub-rectangles a partially cached rectangle is
+ * split into
+ */
+#define GEGL_PROCESSOR_MAX_MISSING_RECTANGLES 8
+
+typedef enum
+{
+  GEGL_PROCESSOR_STREAM_UNKNOWN, /* not negotiated with the sink yet */
+  GEGL_PROCESSOR_STREAM_NONE,    /* the sink gets the full input at once */
+  GEGL_PROCESSOR_STREAM_ACTIVE   /* the sink is being fed bands */
+} GeglProcessorStreamState;
+
 enum
 {
   PROP_0,
@@ -67,6 +82,9 @@ static void      gegl_processor_set_node     (GeglProcessor         *processor,
 static void      gegl_processor_constructed  (GObject               *object);
 static gdouble   gegl_processor_progress     (GeglProcessor         *processor);
 static gint      gegl_processor_get_band_size(gint                   size) G_GNUC_CONST;
+static void      gegl_processor_clear_eval_managers
+                                             (GeglProcessor         *processor);
+static void      gegl_processor_stream_finish(GeglProcessor         *processor);
 
 
 struct _GeglProcessor
@@ -86,6 +104,27 @@ struct _GeglProcessor
   gint             chunk_size;
 
   gdouble          progress;
+
+  /* focused rendering */
+  gboolean          have_focus;
+  GeglRectangle     focus_unscaled;
+  gboolean          dirty_rectangles_sorted;
+  GeglEvalManager **eval_managers;   /* one per rendering thread */
+  gint              n_eval_managers;
+
+  /* streaming to needs_full sinks; a band is encoded in stream_pool while
+   * the next one is rendered, and cleared from the cache once encoded.
+   */
+  GeglProcessorStreamState stream_state;
+  gint              stream_y;
+  gint              stream_band_height;
+  GeglRectangle     stream_band;     /* band being encoded, if any */
+  GeglBuffer       *stream_input;
+  GThreadPool      *stream_pool;
+  GMutex            stream_mutex;
+  GCond             stream_cond;
+  gboolean          stream_busy;
+  gboolean          stream_failed;
 };
 
 
@@ -146,7 +185,15 @@ gegl_processor_init (GeglProcessor *processor)
   processor->context          = NULL;
   processor->queued_region    = NULL;
   processor->dirty_rectangles = NULL;
+  processor->have_focus       = FALSE;
+  processor->eval_managers    = NULL;
+  processor->n_eval_managers  = 0;
+  processor->stream_state     = GEGL_PROCESSOR_STREAM_UNKNOWN;
+  processor->stream_pool      = NULL;
   //processor->chunk_size       = 128 * 128;
+
+  g_mutex_init (&processor->stream_mutex);
+  g_cond_init (&processor->stream_cond);
 }
 
 static void
@@ -165,6 +212,12 @@ gegl_processor_finalize (GObject *self_object)
 {
   GeglProcessor *processor = GEGL_PROCESSOR (self_object);
 
+  if (processor->stream_state == GEGL_PROCESSOR_STREAM_ACTIVE)
+    {
+      processor->stream_failed = TRUE;
+      gegl_processor_stream_finish (processor);
+    }
+
   g_clear_pointer (&processor->context, gegl_operation_context_destroy);
 
   g_clear_object (&processor->node);
@@ -174,6 +227,11 @@ gegl_processor_finalize (GObject *self_object)
   g_clear_pointer (&processor->queued_region, gegl_region_destroy);
   g_clear_pointer (&processor->valid_region, gegl_region_destroy);
 
+  gegl_processor_clear_eval_managers (processor);
+
+  g_mutex_clear (&processor->stream_mutex);
+  g_cond_clear (&processor->stream_cond);
+
   G_OBJECT_CLASS (gegl_processor_parent_class)->finalize (self_object);
 }
 
@@ -246,6 +304,8 @@ gegl_processor_set_node (GeglProcessor *processor,
   g_set_object (&processor->node, node);
   g_clear_object (&processor->real_node);
 
+  gegl_processor_clear_eval_managers (processor);
+
   /* nodes with meta operations are also graphs and can be sinks, so
    * we don't use their output proxy */
   if (GEGL_IS_OPERATION (node->operation))
@@ -357,6 +417,7 @@ gegl_processor_set_rectangle (GeglProcessor       *processor,
         }
       g_slist_free (processor->dirty_rectangles);
       processor->dirty_rectangles = NULL;
+      processor->dirty_rectangles_sorted = FALSE;
     }
 
   /* if the node's operation is a sink and it needs the full content then
@@ -368,6 +429,14 @@ gegl_processor_set_rectangle (GeglProcessor       *processor,
     {
       GeglCache *cache;
 
+      /* a stream in progress is for the old rectangle, abort it */
+      if (processor->stream_state == GEGL_PROCESSOR_STREAM_ACTIVE)
+        {
+          processor->stream_failed = TRUE;
+          gegl_processor_stream_finish (processor);
+        }
+      processor->stream_state = GEGL_PROCESSOR_STREAM_UNKNOWN;
+
       cache = gegl_node_get_cache (processor->input);
 
       if (!processor->context)
@@ -424,6 +493,392 @@ gegl_processor_get_band_size (gint size)
   return band_size;
 }
 
+/* Cuts a band off the biggest side of rectangle, and returns it */
+static GeglRectangle *
+gegl_processor_split_rectangle (GeglRectangle *rectangle)
+{
+  GeglRectangle *fragment;
+  gint           band_size;
+
+  fragment = g_slice_dup (GeglRectangle, rectangle);
+
+  /* When splitting a rectangle, we'll do it on the biggest side */
+  if (rectangle->width > rectangle->height)
+    {
+      band_size = gegl_processor_get_band_size (rectangle->width);
+
+      fragment->width    = band_size;
+      rectangle->width  -= band_size;
+      rectangle->x      += band_size;
+    }
+  else
+    {
+      band_size = gegl_processor_get_band_size (rectangle->height);
+
+      fragment->height   = band_size;
+      rectangle->height -= band_size;
+      rectangle->y      += band_size;
+    }
+
+  return fragment;
+}
+
+/* Stores the parts of rectangle that aren't rendered into the cache yet in
+ * *missing, which should be freed with g_free(), and returns their number.
+ * Returns 0 if the rectangle is fully cached.
+ */
+static gint
+gegl_processor_get_missing_rectangles (GeglProcessor        *processor,
+                                       GeglCache            *cache,
+                                       const GeglRectangle  *rectangle,
+                                       GeglRectangle       **missing)
+{
+  GeglRegion *region;
+  gint        n_missing;
+  gint        level;
+
+  *missing = NULL;
+
+  g_mutex_lock (&cache->mutex);
+
+  for (level = processor->level - 1; level >= 0; level--)
+    {
+      if (gegl_region_rect_in (cache->valid_region[level], rectangle) ==
+          GEGL_OVERLAP_RECTANGLE_IN)
+        {
+          g_mutex_unlock (&cache->mutex);
+
+          return 0;
+        }
+    }
+
+  region = gegl_region_rectangle (rectangle);
+  gegl_region_subtract (region, cache->valid_region[processor->level]);
+
+  g_mutex_unlock (&cache->mutex);
+
+  if (gegl_region_empty (region))
+    {
+      gegl_region_destroy (region);
+
+      return 0;
+    }
+
+  gegl_region_get_rectangles (region, missing, &n_missing);
+
+  /* rendering many slivers separately costs more than recomputing some
+   * already valid pixels, so fall back to their bounding box */
+  if (n_missing > GEGL_PROCESSOR_MAX_MISSING_RECTANGLES)
+    {
+      g_free (*missing);
+
+      *missing  = g_new (GeglRectangle, 1);
+      n_missing = 1;
+
+      gegl_region_get_clipbox (region, *missing);
+    }
+
+  gegl_region_destroy (region);
+
+  return n_missing;
+}
+
+/* Queues the missing parts of a partially cached rectangle, so that they're
+ * rendered next.
+ */
+static void
+gegl_processor_queue_missing_rectangles (GeglProcessor       *processor,
+                                         const GeglRectangle *missing,
+                                         gint                 n_missing)
+{
+  gint i;
+
+  for (i = n_missing - 1; i >= 0; i--)
+    {
+      processor->dirty_rectangles =
+        g_slist_prepend (processor->dirty_rectangles,
+                         g_slice_dup (GeglRectangle, &missing[i]));
+    }
+}
+
+static void
+gegl_processor_clear_eval_managers (GeglProcessor *processor)
+{
+  gint i;
+
+  for (i = 0; i < processor->n_eval_managers; i++)
+    g_object_unref (processor->eval_managers[i]);
+
+  g_clear_pointer (&processor->eval_managers, g_free);
+  processor->n_eval_managers = 0;
+}
+
+/* Makes sure there are at least n_eval_managers evaluation managers for the
+ * input node, so that each rendering thread has a graph traversal of its own,
+ * and prepares them.
+ */
+static void
+gegl_processor_ensure_eval_managers (GeglProcessor *processor,
+                                     gint           n_eval_managers)
+{
+  gint i;
+
+  if (n_eval_managers > processor->n_eval_managers)
+    {
+      processor->eval_managers = g_renew (GeglEvalManager *,
+                                          processor->eval_managers,
+                                          n_eval_managers);
+
+      for (i = processor->n_eval_managers; i < n_eval_managers; i++)
+        {
+          processor->eval_managers[i] =
+            gegl_eval_manager_new (processor->input, "output");
+        }
+
+      processor->n_eval_managers = n_eval_managers;
+    }
+
+  for (i = 0; i < n_eval_managers; i++)
+    gegl_eval_manager_prepare (processor->eval_managers[i]);
+}
+
+static gint
+gegl_processor_compare_focus_distance (gconstpointer a,
+                                       gconstpointer b,
+                                       gpointer      user_data)
+{
+  const GeglRectangle *rect_a = a;
+  const GeglRectangle *rect_b = b;
+  const gdouble       *center = user_data;
+  gdouble              dx, dy;
+  gdouble              dist_a, dist_b;
+
+  dx     = rect_a->x + rect_a->width  / 2.0 - center[0];
+  dy     = rect_a->y + rect_a->height / 2.0 - center[1];
+  dist_a = dx * dx + dy * dy;
+
+  dx     = rect_b->x + rect_b->width  / 2.0 - center[0];
+  dy     = rect_b->y + rect_b->height / 2.0 - center[1];
+  dist_b = dx * dx + dy * dy;
+
+  return (dist_a > dist_b) - (dist_a < dist_b);
+}
+
+/* Splits all the dirty rectangles into chunks no bigger than max_area, and
+ * sorts them by distance from the center of the focus rectangle.
+ */
+static void
+gegl_processor_sort_dirty_rectangles (GeglProcessor *processor,
+                                      gint           max_area)
+{
+  GSList  *chunks = NULL;
+  GSList  *iter;
+  gdouble  center[2];
+  gdouble  factor = 1 << processor->level;
+
+  if (processor->dirty_rectangles_sorted)
+    return;
+
+  for (iter = processor->dirty_rectangles; iter; iter = g_slist_next (iter))
+    {
+      GeglRectangle *dr = iter->data;
+
+      while ((gint64) dr->width * dr->height > max_area)
+        chunks = g_slist_prepend (chunks, gegl_processor_split_rectangle (dr));
+
+      if (dr->width && dr->height)
+        chunks = g_slist_prepend (chunks, dr);
+      else
+        g_slice_free (GeglRectangle, dr);
+    }
+
+  g_slist_free (processor->dirty_rectangles);
+
+  center[0] = (processor->focus_unscaled.x +
+               processor->focus_unscaled.width  / 2.0) / factor;
+  center[1] = (processor->focus_unscaled.y +
+               processor->focus_unscaled.height / 2.0) / factor;
+
+  processor->dirty_rectangles = g_slist_sort_with_data (
+    chunks, gegl_processor_compare_focus_distance, center);
+
+  processor->dirty_rectangles_sorted = TRUE;
+}
+
+typedef struct
+{
+  GeglProcessor *processor;
+  GeglCache     *cache;
+  GeglRectangle *chunks;
+  gint           n_chunks;
+} RenderChunksData;
+
+/* returns TRUE if any of the cache tiles covering roi was invalidated after
+ * the cache was at generation, in which case a chunk rendered over roi in
+ * the meantime may already be out of date.
+ */
+static gboolean
+gegl_processor_is_chunk_stale (GeglCache           *cache,
+                               const GeglRectangle *roi,
+                               guint                generation)
+{
+  GeglBuffer *buffer = GEGL_BUFFER (cache);
+  gint        x0, y0, x1, y1;
+  gint        x, y;
+
+  if (gegl_cache_get_generation (cache) == generation)
+    return FALSE;
+
+  x0 = gegl_tile_indice (roi->x + buffer->shift_x, buffer->tile_width);
+  y0 = gegl_tile_indice (roi->y + buffer->shift_y, buffer->tile_height);
+  x1 = gegl_tile_indice (roi->x + roi->width  - 1 + buffer->shift_x,
+                         buffer->tile_width);
+  y1 = gegl_tile_indice (roi->y + roi->height - 1 + buffer->shift_y,
+                         buffer->tile_height);
+
+  for (y = y0; y <= y1; y++)
+    for (x = x0; x <= x1; x++)
+      {
+        if ((gint) (gegl_cache_get_tile_generation (cache, x, y) -
+                    generation) > 0)
+          {
+            return TRUE;
+          }
+      }
+
+  return FALSE;
+}
+
+/* renders a chunk into the cache, the way gegl_node_blit() does with
+ * GEGL_BLIT_CACHE, but using the given evaluation manager.
+ */
+static void
+gegl_processor_render_chunk (GeglProcessor       *processor,
+                             GeglEvalManager     *eval_manager,
+                             GeglCache           *cache,
+                             const GeglRectangle *dr)
+{
+  GeglRectangle  roi   = *dr;
+  gint           level = 0;
+  GeglBuffer    *buffer;
+  guint          generation;
+
+  generation = gegl_cache_get_generation (cache);
+
+  if (processor->level)
+    {
+      roi = _gegl_get_required_for_scale (dr, 1.0 / (1 << processor->level));
+
+      if (gegl_config ()->mipmap_rendering)
+        level = processor->level;
+    }
+
+  buffer = gegl_eval_manager_apply (eval_manager, &roi, level);
+
+  if (buffer)
+    {
+      if (buffer != GEGL_BUFFER (cache))
+        gegl_buffer_copy (buffer, &roi, GEGL_ABYSS_NONE,
+                          GEGL_BUFFER (cache), NULL);
+      g_object_unref (buffer);
+    }
+
+  /* the graph may be invalidated by other threads while chunks are being
+   * rendered.  if part of the chunk was invalidated in the meantime, don't
+   * mark it as computed, so that it gets rendered again by the next request
+   * covering it.
+   */
+  if (gegl_processor_is_chunk_stale (cache, &roi, generation))
+    return;
+
+  gegl_cache_computed (cache, &roi, level);
+
+  /* tells the cache that the rectangle (dr) has been computed */
+  gegl_cache_computed (cache, dr, processor->level);
+}
+
+static void
+gegl_processor_render_chunks_func (gint     i,
+                                   gint     n,
+                                   gpointer user_data)
+{
+  RenderChunksData *data = user_data;
+  gint              j;
+
+  /* if the thread pool is busy, we're called once, and render everything */
+  for (j = i; j < data->n_chunks; j += n)
+    {
+      gegl_processor_render_chunk (data->processor,
+                                   data->processor->eval_managers[i],
+                                   data->cache,
+                                   &data->chunks[j]);
+    }
+}
+
+/* Renders the dirty chunks closest to the focus, one per thread, and returns
+ * TRUE if there is more work */
+static gboolean
+render_focused_rectangles (GeglProcessor *processor,
+                           GeglCache     *cache)
+{
+  RenderChunksData data;
+  GeglRectangle    chunks[GEGL_MAX_THREADS];
+  gint             max_chunks;
+
+  max_chunks = CLAMP (gegl_config_threads (), 1, GEGL_MAX_THREADS);
+
+  data.processor = processor;
+  data.cache     = cache;
+  data.chunks    = chunks;
+  data.n_chunks  = 0;
+
+  while (processor->dirty_rectangles && data.n_chunks < max_chunks)
+    {
+      GeglRectangle *dr = processor->dirty_rectangles->data;
+      GeglRectangle *missing;
+      gint           n_missing;
+
+      processor->dirty_rectangles = g_slist_delete_link (
+        processor->dirty_rectangles, processor->dirty_rectangles);
+
+      n_missing = gegl_processor_get_missing_rectangles (processor, cache, dr,
+                                                         &missing);
+
+      if (n_missing == 1)
+        chunks[data.n_chunks++] = missing[0];
+      else if (n_missing > 1)
+        gegl_processor_queue_missing_rectangles (processor, missing, n_missing);
+
+      g_free (missing);
+      g_slice_free (GeglRectangle, dr);
+    }
+
+  if (data.n_chunks > 0)
+    {
+      /* operations that aren't threaded serialize their process() calls.  a
+       * worker thread waiting inside one of them may run the remaining
+       * chunks of our own task, and re-enter it, so we only render the
+       * chunks concurrently when called outside the thread pool.
+       */
+      if (! gegl_parallel_is_worker_thread ())
+        {
+          gegl_processor_ensure_eval_managers (processor, data.n_chunks);
+
+          gegl_parallel_distribute (data.n_chunks,
+                                    gegl_processor_render_chunks_func,
+                                    &data);
+        }
+      else
+        {
+          gegl_processor_ensure_eval_managers (processor, 1);
+
+          gegl_processor_render_chunks_func (0, 1, &data);
+        }
+    }
+
+  return processor->dirty_rectangles != NULL;
+}
+
 /* If the processor's dirty rectangle is too big then it will be cut, added
  * to the processor's list of dirty rectangles and TRUE will be returned.
  * If the rectangle is small enough it will be processed, using a buffer or
@@ -446,6 +901,22 @@ render_rectangle (GeglProcessor *processor)
       format = gegl_buffer_get_format ((GeglBuffer *)cache);
     }
 
+  if (processor->dirty_rectangles && processor->have_focus)
+    {
+      /* when focused, chunks are rendered in parallel rather than being
+       * processed using all threads one at a time, so they're sized for a
+       * single thread */
+      gegl_processor_sort_dirty_rectangles (processor,
+                                            max_area / gegl_config_threads ());
+
+      if (buffered)
+        return render_focused_rectangles (processor, cache);
+
+      /* sinks are not assumed to be reentrant, so unbuffered rendering is
+       * still done one chunk at a time, but in order of distance from the
+       * focus */
+    }
+
   if (processor->dirty_rectangles)
     {
       GeglRectangle *dr = processor->dirty_rectangles->data;
@@ -454,32 +925,10 @@ render_rectangle (GeglProcessor *processor)
        * to smaller pieces */
       if (dr->height * dr->width > max_area && 1)
         {
-          gint band_size;
-
-          {
-            GeglRectangle *fragment;
-
-            fragment = g_slice_dup (GeglRectangle, dr);
+          processor->dirty_rectangles =
+            g_slist_prepend (processor->dirty_rectangles,
+                             gegl_processor_split_rectangle (dr));
 
-            /* When splitting a rectangle, we'll do it on the biggest side */
-            if (dr->width > dr->height)
-              {
-                band_size = gegl_processor_get_band_size ( dr->width );
-
-                fragment->width = band_size;
-                dr->width      -= band_size;
-                dr->x          += band_size;
-              }
-            else
-              {
-                band_size = gegl_processor_get_band_size (dr->height);
-
-                fragment->height = band_size;
-                dr->height      -= band_size;
-                dr->y           += band_size;
-              }
-            processor->dirty_rectangles = g_slist_prepend (processor->dirty_rectangles, fragment);
-          }
           return TRUE;
         }
       /* remove the rectangle that will be processed from the list of dirty ones */
@@ -494,29 +943,30 @@ render_rectangle (GeglProcessor *processor)
 
       if (buffered)
         {
-          gboolean found_full = FALSE;
-          for (gint level = processor->level; level >= 0; level--)
-          {
-            if (gegl_region_rect_in (cache->valid_region[level], dr) == GEGL_OVERLAP_RECTANGLE_IN)
-            {
-              found_full = TRUE;
-              break;
-            }
-            /* XXX: dr should be adjusted to be the bounding box of not-found
-             * in cache if there is partial hits
-             */
-          }
+          GeglRectangle *missing;
+          gint           n_missing;
 
-          if (!found_full)
+          /* only render the parts of dr that aren't in the cache yet */
+          n_missing = gegl_processor_get_missing_rectangles (processor, cache,
+                                                             dr, &missing);
+
+          if (n_missing == 1)
             {
               /* do the image calculations using the buffer */
               gegl_node_blit (processor->input, 1.0/(1<<processor->level),
-                              dr, format, NULL,
+                              missing, format, NULL,
                               GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_CACHE);
 
-              /* tells the cache that the rectangle (dr) has been computed */
-              gegl_cache_computed (cache, dr, processor->level);
+              /* tells the cache that the rectangle has been computed */
+              gegl_cache_computed (cache, missing, processor->level);
+            }
+          else if (n_missing > 1)
+            {
+              gegl_processor_queue_missing_rectangles (processor,
+                                                       missing, n_missing);
             }
+
+          g_free (missing);
           g_slice_free (GeglRectangle, dr);
         }
       else
@@ -697,6 +1147,7 @@ gegl_processor_render (GeglProcessor *processor,
 
           processor->dirty_rectangles = g_slist_prepend (processor->dirty_rectangles,
                                                          g_slice_dup (GeglRectangle, &roi));
+          processor->dirty_rectangles_sorted = FALSE;
         }
 
       g_free (rectangles);
@@ -732,6 +1183,7 @@ gegl_processor_render (GeglProcessor *processor,
 
           processor->dirty_rectangles = g_slist_prepend (processor->dirty_rectangles,
                                                          g_slice_dup (GeglRectangle, &roi));
+          processor->dirty_rectangles_sorted = FALSE;
         }
 
       g_free (rectangles);
@@ -753,6 +1205,173 @@ gegl_processor_work_is_opencl_node (GeglNode *node,
          GEGL_OPERATION_GET_CLASS (node->operation)->opencl_support;
 }
 
+/* encodes a single band, in the stream thread */
+static void
+gegl_processor_stream_band_func (gpointer data,
+                                 gpointer user_data)
+{
+  GeglProcessor *processor = user_data;
+  GeglRectangle *band      = data;
+  gboolean       success   = TRUE;
+
+  if (! processor->stream_failed)
+    {
+      success = gegl_operation_sink_stream_band (processor->real_node->operation,
+                                                 processor->stream_input,
+                                                 band,
+                                                 processor->context->level);
+    }
+
+  g_mutex_lock (&processor->stream_mutex);
+  if (! success)
+    processor->stream_failed = TRUE;
+  processor->stream_busy = FALSE;
+  g_cond_signal (&processor->stream_cond);
+  g_mutex_unlock (&processor->stream_mutex);
+
+  g_slice_free (GeglRectangle, band);
+}
+
+/* waits for the band being encoded, and drops it from the cache, so that
+ * only about two bands are ever kept in memory.
+ */
+static void
+gegl_processor_stream_wait (GeglProcessor *processor)
+{
+  g_mutex_lock (&processor->stream_mutex);
+  while (processor->stream_busy)
+    g_cond_wait (&processor->stream_cond, &processor->stream_mutex);
+  g_mutex_unlock (&processor->stream_mutex);
+
+  if (! gegl_rectangle_is_empty (&processor->stream_band))
+    {
+      GeglCache *cache = GEGL_CACHE (processor->stream_input);
+
+      gegl_buffer_clear (processor->stream_input, &processor->stream_band);
+      gegl_cache_invalidate (cache, &processor->stream_band);
+
+      gegl_rectangle_set (&processor->stream_band, 0, 0, 0, 0);
+    }
+}
+
+/* asks the sink whether it can consume its input band by band, rather than
+ * having the whole of it rendered to the cache first.
+ */
+static void
+gegl_processor_stream_begin (GeglProcessor *processor)
+{
+  GeglOperation       *operation = processor->real_node->operation;
+  const GeglRectangle *roi       = &processor->context->result_rect;
+  GeglCache           *cache;
+  gint                 tile_height;
+  gint                 band_height;
+
+  processor->stream_state = GEGL_PROCESSOR_STREAM_NONE;
+
+  if (gegl_rectangle_is_empty (roi))
+    return;
+
+  /* bands are rendered to, and dropped from, the level-0 cache */
+  if (processor->level != 0)
+    return;
+
+  cache       = gegl_node_get_cache (processor->input);
+  tile_height = GEGL_BUFFER (cache)->tile_height;
+
+  /* as many rows as a full render pass would process, in whole tile rows */
+  band_height = (gint64) processor->chunk_size * gegl_config_threads () /
+                roi->width;
+  band_height = (MAX (band_height, 1) + tile_height - 1) /
+                tile_height * tile_height;
+
+  if (! gegl_operation_sink_stream_begin (operation, GEGL_BUFFER (cache), roi,
+                                          processor->context->level,
+                                          &band_height))
+    return;
+
+  GEGL_NOTE (GEGL_DEBUG_PROCESS, "streaming to %s in bands of %d rows",
+             gegl_node_get_debug_name (processor->real_node), band_height);
+
+  processor->stream_state       = GEGL_PROCESSOR_STREAM_ACTIVE;
+  processor->stream_y           = roi->y;
+  processor->stream_band_height = MAX (band_height, 1);
+  processor->stream_input       = g_object_ref (GEGL_BUFFER (cache));
+  processor->stream_busy        = FALSE;
+  processor->stream_failed      = FALSE;
+  processor->stream_pool        = g_thread_pool_new (
+                                    gegl_processor_stream_band_func,
+                                    processor, 1, FALSE, NULL);
+
+  gegl_rectangle_set (&processor->stream_band, 0, 0, 0, 0);
+}
+
+static void
+gegl_processor_stream_finish (GeglProcessor *processor)
+{
+  gegl_processor_stream_wait (processor);
+
+  g_thread_pool_free (processor->stream_pool, FALSE, TRUE);
+  processor->stream_pool = NULL;
+
+  gegl_operation_sink_stream_end (processor->real_node->operation,
+                                  ! processor->stream_failed);
+
+  g_clear_object (&processor->stream_input);
+
+  processor->stream_state = GEGL_PROCESSOR_STREAM_NONE;
+}
+
+/* renders the next band into the cache, and hands it to the sink while the
+ * band after it is rendered.
+ */
+static gboolean
+gegl_processor_stream_work (GeglProcessor *processor,
+                            gdouble       *progress)
+{
+  const GeglRectangle *roi = &processor->context->result_rect;
+  GeglRectangle        band;
+
+  if (processor->stream_y >= roi->y + roi->height || processor->stream_failed)
+    {
+      gegl_processor_stream_finish (processor);
+
+      gegl_operation_context_destroy (processor->context);
+      processor->context = NULL;
+
+      if (progress)
+        *progress = 1.0;
+
+      return FALSE;
+    }
+
+  gegl_rectangle_set (&band,
+                      roi->x, processor->stream_y, roi->width,
+                      MIN (processor->stream_band_height,
+                           roi->y + roi->height - processor->stream_y));
+
+  gegl_node_blit (processor->input, 1.0, &band,
+                  gegl_buffer_get_format (processor->stream_input), NULL,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_CACHE);
+  gegl_cache_computed (GEGL_CACHE (processor->stream_input), &band, 0);
+
+  processor->stream_y += band.height;
+
+  gegl_processor_stream_wait (processor);
+
+  processor->stream_band = band;
+  processor->stream_busy = TRUE;
+  g_thread_pool_push (processor->stream_pool,
+                      g_slice_dup (GeglRectangle, &band), NULL);
+
+  if (progress)
+    {
+      *progress = (gdouble) (processor->stream_y - roi->y - band.height) /
+                  roi->height;
+    }
+
+  return TRUE;
+}
+
 /* Will call gegl_processor_render and when there is no more work to be done,
  * it will write the result to the destination */
 gboolean
@@ -778,6 +1397,15 @@ gegl_processor_work (GeglProcessor *processor,
         }
     }
 
+  if (processor->context &&
+      processor->stream_state == GEGL_PROCESSOR_STREAM_UNKNOWN)
+    {
+      gegl_processor_stream_begin (processor);
+    }
+
+  if (processor->stream_state == GEGL_PROCESSOR_STREAM_ACTIVE)
+    return gegl_processor_stream_work (processor, progress);
+
   more_work = gegl_processor_render (processor, &processor->rectangle, progress);
   if (more_work)
     {
@@ -817,6 +1445,26 @@ gegl_node_new_processor (GeglNode            *node,
                        NULL);
 }
 
+void
+gegl_processor_set_focus (GeglProcessor       *processor,
+                          const GeglRectangle *focus)
+{
+  g_return_if_fail (GEGL_IS_PROCESSOR (processor));
+
+  if (focus)
+    {
+      processor->have_focus     = TRUE;
+      processor->focus_unscaled = *focus;
+    }
+  else
+    {
+      processor->have_focus = FALSE;
+    }
+
+  /* reorder the pending chunks according to the new focus */
+  processor->dirty_rectangles_sorted = FALSE;
+}
+
 void gegl_processor_set_level (GeglProcessor *processor,
                                gint           level)
 {
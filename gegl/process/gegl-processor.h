@@ -58,6 +58,25 @@ void gegl_processor_set_scale (GeglProcessor *processor,
 void           gegl_processor_set_rectangle (GeglProcessor       *processor,
                                              const GeglRectangle *rectangle);
 
+/**
+ * gegl_processor_set_focus:
+ * @processor: a #GeglProcessor
+ * @focus: (nullable): the #GeglRectangle to render first, or NULL to restore
+ * the default rendering order.
+ *
+ * Make the processor render the area around @focus, typically the visible
+ * part of a large canvas, before the rest of its rectangle.  @focus is in the
+ * same coordinate space as the rectangle passed to
+ * gegl_processor_set_rectangle().
+ *
+ * While a focus is set, the processor's rectangle is split into chunks that
+ * are rendered in order of distance from the center of @focus, and each
+ * iteration of gegl_processor_work() renders several independent chunks in
+ * parallel, one per thread.
+ */
+void           gegl_processor_set_focus     (GeglProcessor       *processor,
+                                             const GeglRectangle *focus);
+
 
 /**
  * gegl_processor_work:
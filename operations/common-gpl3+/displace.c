@@ -309,7 +309,7 @@ process (GeglOperation       *operation,
 
   gint     x, y;
   gdouble  cx = 0.5, cy = 0.5;
-  gfloat  *in_pixel;
+  gdouble *src_coords;
   gint     n_components;
   gint     aux_index, aux2_index;
 
@@ -331,7 +331,7 @@ process (GeglOperation       *operation,
 
   n_components = babl_format_get_n_components (inout_format);
 
-  in_pixel = g_new (gfloat, n_components);
+  src_coords = g_new (gdouble, 2 * result->width);
 
   in_sampler = gegl_buffer_sampler_new_at_level (input, inout_format,
                                                  o->sampler_type, level);
@@ -376,10 +376,13 @@ process (GeglOperation       *operation,
       gfloat *out_pixel  = iter->items[0].data;
       gfloat *aux_pixel  = aux ? iter->items[aux_index].data : NULL;
       gfloat *aux2_pixel = aux2 ? iter->items[aux2_index].data : NULL;
-      gint b;
+      gint width = iter->items[0].roi.width;
 
       for (y = iter->items[0].roi.y; y < iter->items[0].roi.y + iter->items[0].roi.height; y++)
-        for (x = iter->items[0].roi.x; x < iter->items[0].roi.x + iter->items[0].roi.width; x++)
+        {
+        gdouble *coords = src_coords;
+
+        for (x = iter->items[0].roi.x; x < iter->items[0].roi.x + width; x++)
           {
             gdouble src_x, src_y;
 
@@ -398,13 +401,14 @@ process (GeglOperation       *operation,
                                                  &src_x, &src_y);
               }
 
-            gegl_sampler_get (in_sampler, src_x, src_y, NULL,
-                              in_pixel, o->abyss_policy);
+            /* gegl_sampler_get () would do this for us */
+            if (G_UNLIKELY (! isfinite (src_x)))
+              src_x = 0.0;
+            if (G_UNLIKELY (! isfinite (src_y)))
+              src_y = 0.0;
 
-            for (b = 0; b < n_components; b++)
-              out_pixel[b] = in_pixel[b];
-
-            out_pixel += n_components;
+            *coords++ = src_x;
+            *coords++ = src_y;
 
             if (aux)
               aux_pixel += 2;
@@ -412,9 +416,32 @@ process (GeglOperation       *operation,
             if (aux2)
               aux2_pixel += 2;
           }
+
+        /* sample the row in one batch; only gegl_sampler_get () samples
+         * from mipmap levels, though
+         */
+        if (level)
+          {
+            for (x = 0; x < width; x++)
+              {
+                gegl_sampler_get (in_sampler,
+                                  src_coords[2 * x], src_coords[2 * x + 1],
+                                  NULL, out_pixel, o->abyss_policy);
+
+                out_pixel += n_components;
+              }
+          }
+        else
+          {
+            gegl_sampler_get_points (in_sampler, src_coords, NULL,
+                                     out_pixel, width, o->abyss_policy);
+
+            out_pixel += n_components * width;
+          }
+        }
     }
 
-  g_free (in_pixel);
+  g_free (src_coords);
   g_object_unref (in_sampler);
 
   return  TRUE;
@@ -50,7 +50,23 @@ bilateral_filter (GeglBuffer          *src,
                   gdouble              preserve,
                   const Babl          *format);
 
+static void
+bilateral_filter_lattice (GeglBuffer          *src,
+                          const GeglRectangle *src_rect,
+                          GeglBuffer          *dst,
+                          const GeglRectangle *dst_rect,
+                          gdouble              radius,
+                          gdouble              preserve,
+                          const Babl          *format);
+
+/* from this radius up, the filter is approximated using a permutohedral
+ * lattice, whose cost per pixel doesn't depend on the radius, instead of
+ * evaluating the full (2r+1)^2 window for each pixel.
+ */
+#define LATTICE_MIN_RADIUS 8.0
+
 #include <stdio.h>
+#include <string.h>
 
 static void prepare (GeglOperation *operation)
 {
@@ -181,6 +197,23 @@ process (GeglOperation       *operation,
       gegl_buffer_copy (input, result, GEGL_ABYSS_NONE,
                         output, result);
     }
+  else if (o->blur_radius >= LATTICE_MIN_RADIUS)
+    {
+      /* the spatial weights are a gaussian with a standard deviation of
+       * sqrt(radius), which vanish long before the edge of the window for
+       * large radii; there's no need to splat pixels beyond 4 of them.
+       */
+      gint margin = MIN (ceil (o->blur_radius),
+                         ceil (4.0 * sqrt (o->blur_radius)));
+
+      gegl_rectangle_set (&compute,
+                          result->x - margin,
+                          result->y - margin,
+                          result->width  + 2 * margin,
+                          result->height + 2 * margin);
+
+      bilateral_filter_lattice (input, &compute, output, result, o->blur_radius, o->edge_preservation, format);
+    }
   else
     {
       bilateral_filter (input, &compute, output, result, o->blur_radius, o->edge_preservation, format);
@@ -274,6 +307,372 @@ bilateral_filter (GeglBuffer          *src,
   g_free (dst_buf);
 }
 
+/* the permutohedral lattice of Adams, Baek and Davis, "Fast High-Dimensional
+ * Filtering Using the Permutohedral Lattice" (Eurographics 2010).  each pixel
+ * is embedded at (x, y, r, g, b), scaled by the standard deviations of the
+ * spatial and range weights, and splatted onto the vertices of the lattice
+ * simplex enclosing it.  the lattice is then blurred along each of its axes,
+ * and the result is sliced back out at the pixels, using the same
+ * barycentric weights.
+ */
+
+#define LATTICE_D        5 /* x, y, r, g, b */
+#define LATTICE_N_VALUES 5 /* r, g, b, a, and the weight */
+
+typedef struct
+{
+  gint  *table;    /* open addressing hash table of point indices, or -1 */
+  gint   mask;
+  gint  *keys;     /* the first LATTICE_D coordinates of each point; the last
+                    * one follows, since they sum to 0
+                    */
+  gint   n_points;
+  gint   max_points;
+} Lattice;
+
+static guint
+lattice_hash (const gint *key)
+{
+  guint hash = 0;
+  gint  i;
+
+  for (i = 0; i < LATTICE_D; i++)
+    {
+      hash += key[i];
+      hash *= 2531011;
+    }
+
+  return hash;
+}
+
+/* returns the index of the point at key, adding it if create is set, or -1
+ * if it isn't on the lattice.
+ */
+static gint
+lattice_find (Lattice    *lattice,
+              const gint *key,
+              gboolean    create)
+{
+  guint i = lattice_hash (key) & lattice->mask;
+
+  while (TRUE)
+    {
+      gint point = lattice->table[i];
+
+      if (point < 0)
+        {
+          if (! create)
+            return -1;
+
+          if (lattice->n_points == lattice->max_points)
+            {
+              lattice->max_points *= 2;
+              lattice->keys = g_renew (gint, lattice->keys,
+                                       lattice->max_points * LATTICE_D);
+            }
+
+          point = lattice->n_points++;
+
+          memcpy (lattice->keys + point * LATTICE_D, key,
+                  LATTICE_D * sizeof (gint));
+
+          lattice->table[i] = point;
+
+          return point;
+        }
+
+      if (! memcmp (lattice->keys + point * LATTICE_D, key,
+                    LATTICE_D * sizeof (gint)))
+        {
+          return point;
+        }
+
+      i = (i + 1) & lattice->mask;
+    }
+}
+
+static void
+bilateral_filter_lattice (GeglBuffer          *src,
+                          const GeglRectangle *src_rect,
+                          GeglBuffer          *dst,
+                          const GeglRectangle *dst_rect,
+                          gdouble              radius,
+                          gdouble              preserve,
+                          const Babl          *format)
+{
+  const gint  d = LATTICE_D;
+  const gint  n_values = LATTICE_N_VALUES;
+  gint        n_pixels = src_rect->width * src_rect->height;
+  gfloat      scale[LATTICE_D];
+  gint        canonical[(LATTICE_D + 1) * (LATTICE_D + 1)];
+  gfloat      spatial_scale;
+  gfloat      range_scale;
+  Lattice     lattice;
+  gint       *offsets;
+  gfloat     *barycentrics;
+  gfloat     *values;
+  gfloat     *new_values;
+  gfloat     *src_buf;
+  gfloat     *dst_buf;
+  gint        table_size;
+  gint        i, j, k;
+  gint        x, y;
+
+  src_buf = g_new (gfloat, n_pixels * 4);
+  dst_buf = g_new (gfloat, dst_rect->width * dst_rect->height * 4);
+
+  gegl_buffer_get (src, src_rect, 1.0, format, src_buf, GEGL_AUTO_ROWSTRIDE,
+                   GEGL_ABYSS_NONE);
+
+  /* the spatial weights are exp (-(x^2 + y^2) / (2 * radius)), and the range
+   * weights are exp (-|c|^2 * preserve); scale the coordinates to a unit
+   * standard deviation.
+   */
+  spatial_scale = 1.0 / sqrt (radius);
+  range_scale   = sqrt (2.0 * preserve);
+
+  /* the embedding into the lattice's hyperplane, scaled so that the blur
+   * below has a unit standard deviation.
+   */
+  for (i = 0; i < d; i++)
+    scale[i] = (d + 1) * sqrt (2.0 / 3.0) / sqrt ((i + 1) * (i + 2));
+
+  /* the vertices of the canonical simplex */
+  for (i = 0; i <= d; i++)
+    {
+      for (j = 0; j <= d - i; j++)
+        canonical[i * (d + 1) + j] = i;
+      for (; j <= d; j++)
+        canonical[i * (d + 1) + j] = i - (d + 1);
+    }
+
+  /* each pixel adds at most d + 1 points */
+  table_size = 1;
+  while (table_size < 2 * (d + 1) * n_pixels)
+    table_size *= 2;
+
+  lattice.table      = g_new (gint, table_size);
+  lattice.mask       = table_size - 1;
+  lattice.max_points = MAX (n_pixels, 64);
+  lattice.keys       = g_new (gint, lattice.max_points * d);
+  lattice.n_points   = 0;
+
+  memset (lattice.table, -1, table_size * sizeof (gint));
+
+  offsets      = g_new (gint,   n_pixels * (d + 1));
+  barycentrics = g_new (gfloat, n_pixels * (d + 1));
+
+  /* find the enclosing simplex, and the barycentric coordinates, of each
+   * pixel.
+   */
+  for (y = 0; y < src_rect->height; y++)
+    for (x = 0; x < src_rect->width; x++)
+      {
+        gint          index = y * src_rect->width + x;
+        const gfloat *pixel = src_buf + index * 4;
+        gfloat        position[LATTICE_D];
+        gfloat        elevated[LATTICE_D + 1];
+        gfloat        barycentric[LATTICE_D + 2];
+        gint          rem0[LATTICE_D + 1];
+        gint          rank[LATTICE_D + 1];
+        gint          key[LATTICE_D];
+        gfloat        sum;
+        gint          isum;
+
+        /* absolute coordinates, so that the result doesn't depend on how
+         * the image is split into areas.
+         */
+        position[0] = (src_rect->x + x) * spatial_scale;
+        position[1] = (src_rect->y + y) * spatial_scale;
+        position[2] = pixel[0] * range_scale;
+        position[3] = pixel[1] * range_scale;
+        position[4] = pixel[2] * range_scale;
+
+        /* elevate the position onto the hyperplane */
+        sum = 0.0f;
+        for (i = d; i > 0; i--)
+          {
+            gfloat cf = position[i - 1] * scale[i - 1];
+
+            elevated[i] = sum - i * cf;
+            sum += cf;
+          }
+        elevated[0] = sum;
+
+        /* find the closest remainder-0 point, and sort the differential to
+         * find the permutation between the enclosing simplex and the
+         * canonical one.
+         */
+        isum = 0;
+        for (i = 0; i <= d; i++)
+          {
+            gint rd = floorf (elevated[i] / (d + 1) + 0.5f);
+
+            rem0[i] = rd * (d + 1);
+            isum   += rd;
+
+            rank[i] = 0;
+          }
+
+        for (i = 0; i < d; i++)
+          {
+            gfloat di = elevated[i] - rem0[i];
+
+            for (j = i + 1; j <= d; j++)
+              {
+                if (di < elevated[j] - rem0[j])
+                  rank[i]++;
+                else
+                  rank[j]++;
+              }
+          }
+
+        /* bring the point back onto the hyperplane */
+        for (i = 0; i <= d; i++)
+          {
+            rank[i] += isum;
+
+            if (rank[i] < 0)
+              {
+                rank[i] += d + 1;
+                rem0[i] += d + 1;
+              }
+            else if (rank[i] > d)
+              {
+                rank[i] -= d + 1;
+                rem0[i] -= d + 1;
+              }
+          }
+
+        for (i = 0; i <= d + 1; i++)
+          barycentric[i] = 0.0f;
+
+        for (i = 0; i <= d; i++)
+          {
+            gfloat v = (elevated[i] - rem0[i]) / (d + 1);
+
+            barycentric[d - rank[i]]     += v;
+            barycentric[d - rank[i] + 1] -= v;
+          }
+        barycentric[0] += 1.0f + barycentric[d + 1];
+
+        for (k = 0; k <= d; k++)
+          {
+            for (i = 0; i < d; i++)
+              key[i] = rem0[i] + canonical[k * (d + 1) + rank[i]];
+
+            offsets[index * (d + 1) + k]      = lattice_find (&lattice, key,
+                                                              TRUE);
+            barycentrics[index * (d + 1) + k] = barycentric[k];
+          }
+      }
+
+  /* the values of each point, preceded by a zero point standing in for the
+   * missing neighbors.
+   */
+  values     = g_new0 (gfloat, (lattice.n_points + 1) * n_values);
+  new_values = g_new0 (gfloat, (lattice.n_points + 1) * n_values);
+
+  /* splat */
+  for (i = 0; i < n_pixels; i++)
+    {
+      const gfloat *pixel = src_buf + i * 4;
+
+      for (k = 0; k <= d; k++)
+        {
+          gfloat  weight = barycentrics[i * (d + 1) + k];
+          gfloat *value  = values + (offsets[i * (d + 1) + k] + 1) * n_values;
+
+          value[0] += weight * pixel[0];
+          value[1] += weight * pixel[1];
+          value[2] += weight * pixel[2];
+          value[3] += weight * pixel[3];
+          value[4] += weight;
+        }
+    }
+
+  /* blur along each axis of the lattice */
+  for (j = 0; j <= d; j++)
+    {
+      gfloat *tmp;
+
+      for (i = 0; i < lattice.n_points; i++)
+        {
+          const gint *key = lattice.keys + i * d;
+          gint        key1[LATTICE_D];
+          gint        key2[LATTICE_D];
+          gfloat     *value;
+          gfloat     *value1;
+          gfloat     *value2;
+          gfloat     *new_value;
+
+          for (k = 0; k < d; k++)
+            {
+              key1[k] = key[k] + 1;
+              key2[k] = key[k] - 1;
+            }
+
+          if (j < d)
+            {
+              key1[j] = key[j] - d;
+              key2[j] = key[j] + d;
+            }
+
+          value     = values + (i + 1) * n_values;
+          value1    = values + (lattice_find (&lattice, key1, FALSE) + 1) *
+                               n_values;
+          value2    = values + (lattice_find (&lattice, key2, FALSE) + 1) *
+                               n_values;
+          new_value = new_values + (i + 1) * n_values;
+
+          for (k = 0; k < n_values; k++)
+            new_value[k] = value[k] + 0.5f * (value1[k] + value2[k]);
+        }
+
+      tmp        = values;
+      values     = new_values;
+      new_values = tmp;
+    }
+
+  /* slice; the lattice's scale factors cancel out when normalizing by the
+   * accumulated weight.
+   */
+  for (y = 0; y < dst_rect->height; y++)
+    for (x = 0; x < dst_rect->width; x++)
+      {
+        gint    index = (y + dst_rect->y - src_rect->y) * src_rect->width +
+                        (x + dst_rect->x - src_rect->x);
+        gfloat  accumulated[LATTICE_N_VALUES] = {0.0f, };
+        gfloat *out = dst_buf + (y * dst_rect->width + x) * 4;
+
+        for (k = 0; k <= d; k++)
+          {
+            gfloat        weight = barycentrics[index * (d + 1) + k];
+            const gfloat *value  = values +
+                                   (offsets[index * (d + 1) + k] + 1) *
+                                   n_values;
+
+            for (i = 0; i < n_values; i++)
+              accumulated[i] += weight * value[i];
+          }
+
+        for (i = 0; i < 4; i++)
+          out[i] = accumulated[i] / accumulated[4];
+      }
+
+  gegl_buffer_set (dst, dst_rect, 0, format, dst_buf,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_free (values);
+  g_free (new_values);
+  g_free (offsets);
+  g_free (barycentrics);
+  g_free (lattice.table);
+  g_free (lattice.keys);
+  g_free (src_buf);
+  g_free (dst_buf);
+}
+
 
 static void
 gegl_op_class_init (GeglOpClass *klass)
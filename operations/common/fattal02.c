@@ -44,6 +44,12 @@ property_double (noise, _("Noise"), 0.0)
     description (_("Gradient threshold for lowering detail enhancement"))
     value_range (0.0, 1.0)
 
+property_int (preview_level, _("Preview level"), 0)
+    description (_("Tone-map the image downscaled by this many powers of "
+                   "two, and apply the upscaled result to the full "
+                   "resolution image, for faster previews"))
+    value_range (0, 4)
+
 
 #else
 
@@ -88,6 +94,17 @@ static const gint   MINIMUM_PYRAMID = 32;
 /* precision */
 #define EPS 1.0e-12
 
+/* the cost of using an additional thread, relative to the cost of processing
+ * a single pixel in the kernels below
+ */
+#define THREAD_COST 16384.0
+
+/* dot products and norms are accumulated in blocks of a fixed size, whose
+ * partial sums are added up in order, so that the result doesn't depend on
+ * the number of threads.
+ */
+#define REDUCTION_BLOCK_SIZE 4096
+
 static void
 linbcg (guint   rows,
         guint   cols,
@@ -141,28 +158,41 @@ fattal02_copy_array (const gfloat *input,
  * Full Multigrid Algorithm for solving partial differential equations
  */
 
+typedef struct
+{
+  const gfloat *input;
+  guint         inRows;
+  guint         inCols;
+  gfloat       *output;
+  guint         outCols;
+  const gfloat *sy;
+  gfloat        dx;
+} ResampleData;
+
 static void
-fattal02_restrict (const gfloat        *input,
-                   const GeglRectangle *extent_i,
-                   gfloat              *output,
-                   const GeglRectangle *extent_o)
+fattal02_restrict_rows (gsize         offset,
+                        gsize         size,
+                        ResampleData *data)
 {
-  const guint inRows = extent_i->height,
-              inCols = extent_i->width;
+  const gfloat *input  = data->input;
+  gfloat       *output = data->output;
 
-  const guint outRows = extent_o->height,
-              outCols = extent_o->width;
+  const guint inRows  = data->inRows,
+              inCols  = data->inCols,
+              outCols = data->outCols;
 
-  const gfloat dx = (gfloat)inCols / (gfloat)outCols,
-               dy = (gfloat)inRows / (gfloat)outRows;
+  const gfloat dx = data->dx;
 
   const gfloat filterSize = 0.5;
 
-  gfloat sx, sy;
-  guint   x,  y;
+  guint y;
 
-  for (y = 0, sy = dy / 2 - 0.5; y < outRows; ++y, sy += dy)
+  for (y = offset; y < offset + size; ++y)
     {
+      const gfloat sy = data->sy[y];
+      gfloat       sx;
+      guint        x;
+
       for (x = 0, sx = dx / 2 - 0.5; x < outCols; ++x, sx += dx )
         {
           gfloat pixVal = 0;
@@ -187,29 +217,70 @@ fattal02_restrict (const gfloat        *input,
     }
 }
 
+static void
+fattal02_restrict (const gfloat        *input,
+                   const GeglRectangle *extent_i,
+                   gfloat              *output,
+                   const GeglRectangle *extent_o)
+{
+  const guint outRows = extent_o->height;
+
+  const gfloat dy = (gfloat)extent_i->height / (gfloat)outRows;
+
+  ResampleData data;
+  gfloat      *rows_sy;
+  gfloat       sy;
+  guint        y;
+
+  /* the source rows are accumulated up front, so that the rows can be
+   * processed in any order.
+   */
+  rows_sy = g_new (gfloat, outRows);
+  for (y = 0, sy = dy / 2 - 0.5; y < outRows; ++y, sy += dy)
+    rows_sy[y] = sy;
+
+  data.input   = input;
+  data.inRows  = extent_i->height;
+  data.inCols  = extent_i->width;
+  data.output  = output;
+  data.outCols = extent_o->width;
+  data.sy      = rows_sy;
+  data.dx      = (gfloat)extent_i->width / (gfloat)extent_o->width;
+
+  gegl_parallel_distribute_range (
+    outRows, THREAD_COST / extent_o->width,
+    (GeglParallelDistributeRangeFunc) fattal02_restrict_rows,
+    &data);
+
+  g_free (rows_sy);
+}
+
 
 static void
-fattal02_prolongate (const gfloat        *input,
-                     const GeglRectangle *extent_i,
-                     gfloat              *output,
-                     const GeglRectangle *extent_o)
+fattal02_prolongate_rows (gsize         offset,
+                          gsize         size,
+                          ResampleData *data)
 {
-  gfloat dx = (gfloat)extent_i->width  / (gfloat)extent_o->width,
-         dy = (gfloat)extent_i->height / (gfloat)extent_o->height;
+  const gfloat *input  = data->input;
+  gfloat       *output = data->output;
+
+  const guint outCols = data->outCols;
 
-  const guint outRows = extent_o->height,
-              outCols = extent_o->width;
+  const gfloat inRows = data->inRows,
+               inCols = data->inCols;
 
-  const gfloat inRows = extent_i->height,
-               inCols = extent_i->width;
+  const gfloat dx = data->dx;
 
   const float filterSize = 1;
 
-  gfloat sx, sy;
-  guint   x,  y;
+  guint y;
 
-  for (y = 0, sy = -dy / 2; y < outRows; ++y, sy += dy)
+  for (y = offset; y < offset + size; ++y)
     {
+      const gfloat sy = data->sy[y];
+      gfloat       sx;
+      guint        x;
+
       for (x = 0, sx = -dx / 2; x < outCols; ++x, sx += dx )
         {
           gfloat pixVal = 0;
@@ -240,6 +311,41 @@ fattal02_prolongate (const gfloat        *input,
     }
 }
 
+static void
+fattal02_prolongate (const gfloat        *input,
+                     const GeglRectangle *extent_i,
+                     gfloat              *output,
+                     const GeglRectangle *extent_o)
+{
+  const guint outRows = extent_o->height;
+
+  const gfloat dy = (gfloat)extent_i->height / (gfloat)outRows;
+
+  ResampleData data;
+  gfloat      *rows_sy;
+  gfloat       sy;
+  guint        y;
+
+  rows_sy = g_new (gfloat, outRows);
+  for (y = 0, sy = -dy / 2; y < outRows; ++y, sy += dy)
+    rows_sy[y] = sy;
+
+  data.input   = input;
+  data.inRows  = extent_i->height;
+  data.inCols  = extent_i->width;
+  data.output  = output;
+  data.outCols = extent_o->width;
+  data.sy      = rows_sy;
+  data.dx      = (gfloat)extent_i->width / (gfloat)extent_o->width;
+
+  gegl_parallel_distribute_range (
+    outRows, THREAD_COST / extent_o->width,
+    (GeglParallelDistributeRangeFunc) fattal02_prolongate_rows,
+    &data);
+
+  g_free (rows_sy);
+}
+
 
 static void
 fattal02_exact_solution (gfloat              *F,
@@ -276,19 +382,33 @@ fattal02_smooth (gfloat              *U,
 }
 
 
+typedef struct
+{
+  gfloat              *D;
+  const GeglRectangle *extent_d;
+  const gfloat        *U;
+  const GeglRectangle *extent_u;
+  const gfloat        *F;
+  const GeglRectangle *extent_f;
+} DefectData;
+
 static void
-fattal02_calculate_defect (gfloat              *D,
-                           const GeglRectangle *extent_d,
-                           gfloat              *U,
-                           const GeglRectangle *extent_u,
-                           gfloat              *F,
-                           const GeglRectangle *extent_f)
+fattal02_calculate_defect_rows (gsize       offset,
+                                gsize       size,
+                                DefectData *data)
 {
+  gfloat              *D        = data->D;
+  const gfloat        *U        = data->U;
+  const gfloat        *F        = data->F;
+  const GeglRectangle *extent_d = data->extent_d;
+  const GeglRectangle *extent_u = data->extent_u;
+  const GeglRectangle *extent_f = data->extent_f;
+
   guint sx = extent_f->width,
         sy = extent_f->height;
   guint x, y;
 
-  for (y = 0; y < sy; ++y)
+  for (y = offset; y < offset + size; ++y)
     {
       for (x = 0; x < sx; ++x)
         {
@@ -308,6 +428,22 @@ fattal02_calculate_defect (gfloat              *D,
     }
 }
 
+static void
+fattal02_calculate_defect (gfloat              *D,
+                           const GeglRectangle *extent_d,
+                           gfloat              *U,
+                           const GeglRectangle *extent_u,
+                           gfloat              *F,
+                           const GeglRectangle *extent_f)
+{
+  DefectData data = { D, extent_d, U, extent_u, F, extent_f };
+
+  gegl_parallel_distribute_range (
+    extent_f->height, THREAD_COST / extent_f->width,
+    (GeglParallelDistributeRangeFunc) fattal02_calculate_defect_rows,
+    &data);
+}
+
 
 static void
 fattal02_solve_pde_multigrid (gfloat              *F,
@@ -475,16 +611,119 @@ fattal02_solve_pde_multigrid (gfloat              *F,
 }
 
 
+typedef struct
+{
+  guint         rows;
+  guint         cols;
+  const gfloat *x;
+  gfloat       *res;
+} AtimesData;
+
+typedef struct
+{
+  const gfloat *a;
+  const gfloat *b;
+  gsize         n;
+  gdouble      *sums;
+} DotData;
+
+/* the vectors of linbcg(), and the coefficients of the current step */
+typedef struct
+{
+  const gfloat *b;
+  gfloat       *x;
+  gfloat       *p;
+  gfloat       *pp;
+  gfloat       *r;
+  gfloat       *rr;
+  gfloat       *z;
+  gfloat       *zz;
+  gfloat        ak;
+  gfloat        bk;
+} LinbcgData;
+
+
+static void
+asolve_range (gsize         offset,
+              gsize         size,
+              gfloat *const vectors[2])
+{
+  const gfloat *b = vectors[0] + offset;
+  gfloat       *x = vectors[1] + offset;
+  gsize         i;
+
+  for (i = 0; i < size; ++i)
+    x[i] = -4 * b[i];
+}
+
 static void
 asolve (gulong n,
         gfloat b[],
         gfloat x[],
         gint   itrnsp)
 {
-  guint i;
+  gfloat *vectors[2] = { b, x };
 
-  for (i = 0; i < n; ++i)
-    x[i] = -4 * b[i];
+  gegl_parallel_distribute_range (
+    n, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) asolve_range,
+    vectors);
+}
+
+/* the interior of each row is written without branches, so that it can be
+ * vectorized; the first and last rows only have a single vertical neighbor.
+ */
+static void
+atimes_rows (gsize       offset,
+             gsize       size,
+             AtimesData *data)
+{
+  const guint rows = data->rows,
+              cols = data->cols;
+  guint       r, c;
+
+  for (r = offset; r < offset + size; ++r)
+    {
+      const gfloat *row = data->x   + r * cols;
+      gfloat       *res = data->res + r * cols;
+
+      if (r > 0 && r < rows - 1)
+        {
+          const gfloat *up   = row - cols;
+          const gfloat *down = row + cols;
+
+          for (c = 1; c < cols - 1; ++c)
+            {
+              res[c] = up[c] + down[c] +
+                       row[c - 1] + row[c + 1] - 4 * row[c];
+            }
+
+          res[0]        =     up[0] +
+                              down[0] +
+                              row[1] -
+                          3 * row[0];
+          res[cols - 1] =     up[cols - 1] +
+                              down[cols - 1] +
+                              row[cols - 2] -
+                          3 * row[cols - 1];
+        }
+      else
+        {
+          const gfloat *vert = r > 0 ? row - cols : row + cols;
+
+          for (c = 1; c < cols - 1; ++c)
+            {
+              res[c] = vert[c] + row[c - 1] + row[c + 1] - 3 * row[c];
+            }
+
+          res[0]        =     vert[0] +
+                              row[1] -
+                          2 * row[0];
+          res[cols - 1] =     vert[cols - 1] +
+                              row[cols - 2] -
+                          2 * row[cols - 1];
+        }
+    }
 }
 
 static void
@@ -494,57 +733,76 @@ atimes (guint  rows,
         gfloat res[],
         gint   itrnsp)
 {
-  guint r, c;
+  AtimesData data = { rows, cols, x, res };
+
+  gegl_parallel_distribute_range (
+    rows, THREAD_COST / cols,
+    (GeglParallelDistributeRangeFunc) atimes_rows,
+    &data);
+}
 
-#define IDX(R,C) ((R) * cols + (C))
+static void
+dot_blocks (gsize    offset,
+            gsize    size,
+            DotData *data)
+{
+  gsize block;
 
-  for (r = 1; r < rows - 1; ++r)
+  for (block = offset; block < offset + size; ++block)
     {
-      for (c = 1; c < cols - 1; ++c)
+      const gsize   start = block * REDUCTION_BLOCK_SIZE;
+      const gsize   n     = MIN (REDUCTION_BLOCK_SIZE, data->n - start);
+      const gfloat *a     = data->a + start;
+      const gfloat *b     = data->b + start;
+      gfloat        lanes[8] = { 0 };
+      gdouble       sum      = 0.0;
+      gsize         i;
+      gint          j;
+
+      /* independent partial sums, which can be kept in a vector register */
+      for (i = 0; i + 8 <= n; i += 8)
         {
-          res[IDX (r,c)] = x[IDX (r-1,c)] + x[IDX (r+1,c)] +
-            x[IDX (r,c-1)] + x[IDX (r,c+1)] - 4*x[IDX (r,c)];
+          for (j = 0; j < 8; ++j)
+            lanes[j] += a[i + j] * b[i + j];
         }
-    }
 
-  for (r = 1; r < rows - 1; ++r)
-    {
-      res[IDX (r, 0)] =     x[IDX (r - 1, 0)] +
-                            x[IDX (r + 1, 0)] +
-                            x[IDX (r    , 1)] -
-                        3 * x[IDX (r    , 0)];
-
-      res[IDX (r, cols - 1)] =     x[IDX (r - 1, cols - 1)] +
-                                   x[IDX (r + 1, cols - 1)] +
-                                   x[IDX (r    , cols - 2)] -
-                               3 * x[IDX (r    , cols - 1)];
-    }
+      for (j = 0; j < 8; ++j)
+        sum += lanes[j];
 
-  for (c = 1; c < cols - 1; ++c)
-    {
-      res[IDX (0, c)] =     x[IDX (1, c    )] +
-                            x[IDX (0, c - 1)] +
-                            x[IDX (0, c + 1)] -
-                        3 * x[IDX (0, c     )];
-
-      res[IDX (rows - 1, c)] =     x[IDX (rows - 2, c    )] +
-                                   x[IDX (rows - 1, c - 1)] +
-                                   x[IDX (rows - 1, c + 1)] -
-                               3 * x[IDX (rows - 1, c    )];
+      for (; i < n; ++i)
+        sum += a[i] * b[i];
+
+      data->sums[block] = sum;
     }
+}
+
+static gfloat
+dot (gulong        n,
+     const gfloat *a,
+     const gfloat *b)
+{
+  const gsize n_blocks = (n + REDUCTION_BLOCK_SIZE - 1) / REDUCTION_BLOCK_SIZE;
+
+  DotData data;
+  gdouble sum = 0.0;
+  gsize   block;
+
+  data.a    = a;
+  data.b    = b;
+  data.n    = n;
+  data.sums = g_new (gdouble, n_blocks);
+
+  gegl_parallel_distribute_range (
+    n_blocks, THREAD_COST / REDUCTION_BLOCK_SIZE,
+    (GeglParallelDistributeRangeFunc) dot_blocks,
+    &data);
 
-  res[IDX (0       ,        0)] =     x[IDX (1       ,        0)] +
-                                      x[IDX (0       ,        1)] -
-                                  2 * x[IDX (0       ,        0)];
-  res[IDX (rows - 1,        0)] =     x[IDX (rows - 2,        0)] +
-                                      x[IDX (rows - 1,        1)] -
-                                  2 * x[IDX (rows - 1,        0)];
-  res[IDX (0       , cols - 1)] =     x[IDX (1       , cols - 1)] +
-                                      x[IDX (0       , cols - 2)] -
-                                  2 * x[IDX (0       , cols - 1)];
-  res[IDX (rows - 1, cols - 1)] =     x[IDX (rows - 2, cols - 1)] +
-                                      x[IDX (rows - 1, cols - 2)] -
-                                  2 * x[IDX (rows - 1, cols - 1)];
+  for (block = 0; block < n_blocks; ++block)
+    sum += data.sums[block];
+
+  g_free (data.sums);
+
+  return sum;
 }
 
 static gfloat
@@ -556,10 +814,7 @@ snrm (gulong n,
 
   if (itol <= 3)
     {
-      gfloat ans = 0.0;
-      for (i = 0; i < n; ++i)
-          ans += sx[i] * sx[i];
-      return sqrtf (ans);
+      return sqrtf (dot (n, sx, sx));
     }
   else
     {
@@ -571,6 +826,61 @@ snrm (gulong n,
     }
 }
 
+static void
+linbcg_residual_range (gsize       offset,
+                       gsize       size,
+                       LinbcgData *data)
+{
+  gsize j;
+
+  for (j = offset; j < offset + size; ++j)
+    {
+       data->r[j] = data->b[j] - data->r[j];
+      data->rr[j] = data->r[j];
+    }
+}
+
+static void
+linbcg_direction_range (gsize       offset,
+                        gsize       size,
+                        LinbcgData *data)
+{
+  const gfloat  bk = data->bk;
+  gfloat       *p  = data->p;
+  gfloat       *pp = data->pp;
+  const gfloat *z  = data->z;
+  const gfloat *zz = data->zz;
+  gsize         j;
+
+  for (j = offset; j < offset + size; ++j)
+    {
+       p[j] = bk *  p[j] +  z[j];
+      pp[j] = bk * pp[j] + zz[j];
+    }
+}
+
+static void
+linbcg_step_range (gsize       offset,
+                   gsize       size,
+                   LinbcgData *data)
+{
+  const gfloat  ak = data->ak;
+  gfloat       *x  = data->x;
+  gfloat       *r  = data->r;
+  gfloat       *rr = data->rr;
+  const gfloat *p  = data->p;
+  const gfloat *z  = data->z;
+  const gfloat *zz = data->zz;
+  gsize         j;
+
+  for (j = offset; j < offset + size; ++j)
+    {
+       x[j] += ak *  p[j];
+       r[j] -= ak *  z[j];
+      rr[j] -= ak * zz[j];
+    }
+}
+
 
 /**
  * Biconjugate Gradient Method
@@ -589,9 +899,9 @@ linbcg (guint   rows,
 {
   guint  n = rows * cols;
 
-  gulong j;
   gfloat ak,akden,bk,bkden,bknum,bnrm,dxnrm,xnrm,zm1nrm,znrm;
   gfloat *p,*pp,*r,*rr,*z,*zz;
+  LinbcgData data;
 
   /* To remove warning about potetial uninitialized use */
   bkden = 1;
@@ -603,13 +913,21 @@ linbcg (guint   rows,
   z  = g_new (gfloat, n);
   zz = g_new (gfloat, n);
 
+  data.b  = b;
+  data.x  = x;
+  data.p  = p;
+  data.pp = pp;
+  data.r  = r;
+  data.rr = rr;
+  data.z  = z;
+  data.zz = zz;
+
   *iter=0;
   atimes (rows, cols, x, r, 0);
-  for (j = 0; j < n; ++j)
-    {
-       r[j] = b[j] - r[j];
-      rr[j] = r[j];
-    }
+  gegl_parallel_distribute_range (
+    n, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) linbcg_residual_range,
+    &data);
 
   atimes (rows, cols, r, rr, 0);       /* minimum residual */
   znrm = 1.0;
@@ -643,47 +961,37 @@ linbcg (guint   rows,
 
       zm1nrm = znrm;
       asolve (n, rr, zz, 1);
-      for (bknum = 0.0, j = 0; j < n; ++j)
-        {
-          bknum += z[j] * rr[j];
-        }
+      bknum = dot (n, z, rr);
 
       if (*iter == 1)
         {
-          for (j = 0; j < n; ++j)
-            {
-               p[j] =  z[j];
-              pp[j] = zz[j];
-            }
+          fattal02_copy_array ( z, n,  p);
+          fattal02_copy_array (zz, n, pp);
         }
       else
         {
           bk = bknum / bkden;
 
-          for (j = 0; j < n; ++j)
-            {
-               p[j] = bk *  p[j] +  z[j];
-              pp[j] = bk * pp[j] + zz[j];
-            }
+          data.bk = bk;
+          gegl_parallel_distribute_range (
+            n, THREAD_COST,
+            (GeglParallelDistributeRangeFunc) linbcg_direction_range,
+            &data);
         }
 
       bkden = bknum;
       atimes (rows, cols, p, z, 0);
 
-      for (akden = 0.0, j = 0; j < n; ++j)
-        {
-          akden += z[j] * pp[j];
-        }
+      akden = dot (n, z, pp);
 
       ak = bknum / akden;
       atimes (rows, cols, pp, zz, 1);
 
-      for (j = 0; j < n; ++j)
-        {
-           x[j] += ak *  p[j];
-           r[j] -= ak *  z[j];
-          rr[j] -= ak * zz[j];
-        }
+      data.ak = ak;
+      gegl_parallel_distribute_range (
+        n, THREAD_COST,
+        (GeglParallelDistributeRangeFunc) linbcg_step_range,
+        &data);
 
       asolve (n, r, z, 0);
 
@@ -1221,6 +1529,192 @@ fattal02_tonemap (const gfloat        *input,   /* Y */
 }
 
 
+typedef struct
+{
+  const gfloat        *gain;
+  const gfloat        *log_lum;
+  const GeglRectangle *extent_g;
+  const gfloat        *input;
+  const GeglRectangle *extent;
+  gfloat              *output;
+  gfloat               scale;
+  gfloat               floor;
+} PreviewData;
+
+/* joint bilateral upsampling of the gain: the bilinear weights of the four
+ * nearest low resolution pixels are attenuated by how much their luminance
+ * differs from the full resolution pixel, so that the gain of one side of
+ * an edge doesn't leak into the other.
+ */
+static inline gfloat
+fattal02_gain_weight (gfloat weight,
+                      gfloat log_lum,
+                      gfloat log_lum_g)
+{
+  const gfloat d = (log_lum - log_lum_g) * 2.0f;
+
+  return weight / (1.0f + d * d);
+}
+
+static void
+fattal02_apply_gain_rows (gsize        offset,
+                          gsize        size,
+                          PreviewData *data)
+{
+  const gint width_g  = data->extent_g->width,
+             height_g = data->extent_g->height,
+             width    = data->extent->width;
+  gint       x, y;
+
+  for (y = offset; y < (gint) (offset + size); ++y)
+    {
+      const gfloat  sy = CLAMP ((y + 0.5f) / data->scale - 0.5f,
+                                0.0f, height_g - 1);
+      const gint    y0 = sy,
+                    y1 = MIN (y0 + 1, height_g - 1);
+      const gfloat  fy = sy - y0;
+      const gint    i0 = y0 * width_g,
+                    i1 = y1 * width_g;
+
+      for (x = 0; x < width; ++x)
+        {
+          const gfloat sx = CLAMP ((x + 0.5f) / data->scale - 0.5f,
+                                   0.0f, width_g - 1);
+          const gint   x0 = sx,
+                       x1 = MIN (x0 + 1, width_g - 1);
+          const gfloat fx = sx - x0;
+          const gint   i  = x + y * width;
+          const gfloat l  = MAX (data->input[i], data->floor);
+          const gfloat ll = logf (l);
+          gfloat       w00, w01, w10, w11;
+
+          w00 = fattal02_gain_weight ((1.0f - fx) * (1.0f - fy), ll,
+                                      data->log_lum[x0 + i0]);
+          w01 = fattal02_gain_weight (        fx  * (1.0f - fy), ll,
+                                      data->log_lum[x1 + i0]);
+          w10 = fattal02_gain_weight ((1.0f - fx) *         fy , ll,
+                                      data->log_lum[x0 + i1]);
+          w11 = fattal02_gain_weight (        fx  *         fy , ll,
+                                      data->log_lum[x1 + i1]);
+
+          data->output[i] = MAX (1e-4f, l * expf (
+                                   (w00 * data->gain[x0 + i0] +
+                                    w01 * data->gain[x1 + i0] +
+                                    w10 * data->gain[x0 + i1] +
+                                    w11 * data->gain[x1 + i1]) /
+                                   (w00 + w01 + w10 + w11)));
+        }
+    }
+}
+
+/* Tone-map the input downscaled by 2^level, and apply the resulting
+ * luminance gain, interpolated in the log domain, to the full resolution
+ * input, which keeps its fine detail.
+ */
+static void
+fattal02_tonemap_preview (const gfloat        *input,   /* Y */
+                          const GeglRectangle *extent,
+                          gfloat              *output,  /* L */
+                          gfloat               alfa,
+                          gfloat               beta,
+                          gfloat               noise,
+                          gint                 level)
+{
+  GeglRectangle  extent_s;
+  PreviewData    data;
+  gfloat        *small_in, *small_out;
+  gfloat         max_input = 0.0f;
+  gint           scale, x, y, i;
+
+  /* keep enough of the image for a gaussian pyramid */
+  while (level > 0 && MIN (LEVEL_WIDTH  (extent, level),
+                           LEVEL_HEIGHT (extent, level)) < 2 * MINIMUM_PYRAMID)
+    {
+      --level;
+    }
+
+  if (! level)
+    {
+      fattal02_tonemap (input, extent, output, alfa, beta, noise);
+      return;
+    }
+
+  scale    = 1 << level;
+  extent_s = LEVEL_EXTENT (extent, level);
+
+  small_in  = g_new0 (gfloat, extent_s.width * extent_s.height);
+  small_out = g_new  (gfloat, extent_s.width * extent_s.height);
+
+  /* box filter the input; pixels past the last whole block are dropped */
+  for (y = 0; y < extent_s.height * scale; ++y)
+    {
+      for (x = 0; x < extent_s.width * scale; ++x)
+        {
+          small_in[x / scale + (y / scale) * extent_s.width] +=
+            input[x + y * extent->width];
+        }
+    }
+
+  for (i = 0; i < extent_s.width * extent_s.height; ++i)
+    {
+      small_in[i] /= scale * scale;
+      max_input    = MAX (max_input, small_in[i]);
+    }
+
+  fattal02_tonemap (small_in, &extent_s, small_out, alfa, beta, noise);
+
+  /* the tone-mapper maps luminance below this to black anyway */
+  data.floor = MAX (1e-6f * max_input, G_MINFLOAT);
+
+  for (i = 0; i < extent_s.width * extent_s.height; ++i)
+    {
+      small_in[i]  = logf (MAX (small_in[i], data.floor));
+      small_out[i] = logf (small_out[i]) - small_in[i];
+    }
+
+  data.gain     = small_out;
+  data.log_lum  = small_in;
+  data.extent_g = &extent_s;
+  data.input    = input;
+  data.extent   = extent;
+  data.output   = output;
+  data.scale    = scale;
+
+  gegl_parallel_distribute_range (
+    extent->height, THREAD_COST / extent->width,
+    (GeglParallelDistributeRangeFunc) fattal02_apply_gain_rows,
+    &data);
+
+  g_free (small_in);
+  g_free (small_out);
+}
+
+
+typedef struct
+{
+  gfloat       *pix;
+  const gfloat *lum_in;
+  const gfloat *lum_out;
+  gfloat        saturation;
+} SaturationData;
+
+static void
+fattal02_saturation_range (gsize           offset,
+                           gsize           size,
+                           SaturationData *data)
+{
+  const gint pix_stride = 3;
+  gsize      i;
+
+  for (i = offset * pix_stride; i < (offset + size) * pix_stride; ++i)
+    {
+      data->pix[i] = (powf (data->pix[i] / data->lum_in[i / pix_stride],
+                            data->saturation) *
+                      data->lum_out[i / pix_stride]);
+    }
+}
+
+
 static void
 fattal02_prepare (GeglOperation *operation)
 {
@@ -1266,7 +1760,7 @@ fattal02_process (GeglOperation       *operation,
   gfloat     *lum_in,
              *lum_out,
              *pix;
-  gint        i;
+  SaturationData data;
 
   g_return_val_if_fail (operation, FALSE);
   g_return_val_if_fail (input, FALSE);
@@ -1296,15 +1790,26 @@ fattal02_process (GeglOperation       *operation,
   gegl_buffer_get (input, result, 1.0, out_format,
                    pix, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-  fattal02_tonemap (lum_in, result, lum_out, o->alpha, o->beta, noise);
-
-  for (i = 0; i < result->width * result->height * pix_stride; ++i)
+  if (o->preview_level > 0)
+    {
+      fattal02_tonemap_preview (lum_in, result, lum_out,
+                                o->alpha, o->beta, noise, o->preview_level);
+    }
+  else
     {
-      pix[i] = (powf (pix[i] / lum_in[i / pix_stride],
-                      o->saturation) *
-                lum_out[i / pix_stride]);
+      fattal02_tonemap (lum_in, result, lum_out, o->alpha, o->beta, noise);
     }
 
+  data.pix        = pix;
+  data.lum_in     = lum_in;
+  data.lum_out    = lum_out;
+  data.saturation = o->saturation;
+
+  gegl_parallel_distribute_range (
+    result->width * result->height, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) fattal02_saturation_range,
+    &data);
+
   gegl_buffer_set (output, result, 0, out_format, pix,
                    GEGL_AUTO_ROWSTRIDE);
   g_free (pix);
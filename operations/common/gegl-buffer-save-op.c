@@ -24,6 +24,15 @@
 property_file_path (path, _("File"), "/tmp/gegl-buffer.gegl")
   description (_("Target file path to write GeglBuffer to."))
 
+property_string (compression, _("Compression"), "")
+  description (_("Compression algorithm used for the stored tiles, such as "
+                 "\"fast\" or \"best\", or empty to store them uncompressed"))
+
+property_int (levels, _("Mipmap levels"), 0)
+  description (_("Number of mipmap levels to store in addition to the "
+                 "full resolution tiles"))
+  value_range (0, 8)
+
 #else
 
 #define GEGL_OP_SINK
@@ -41,7 +50,9 @@ gegl_buffer_save_op_process (GeglOperation       *operation,
 {
   GeglProperties *o = GEGL_PROPERTIES (operation);
 
-  gegl_buffer_save (input, o->path, result);
+  gegl_buffer_save_full (input, o->path, result,
+                         o->compression[0] ? o->compression : NULL,
+                         o->levels);
 
   return TRUE;
 }
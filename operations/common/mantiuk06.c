@@ -38,6 +38,12 @@ property_double (detail, _("Detail"), 1.0)
     description (_("Level of emphasis on image gradient details"))
     value_range (1.0, 99.0)
 
+property_int (preview_level, _("Preview level"), 0)
+    description (_("Tone-map the image downscaled by this many powers of "
+                   "two, and apply the upscaled result to the full "
+                   "resolution image, for faster previews"))
+    value_range (0, 4)
+
 #else
 
 #define GEGL_OP_FILTER
@@ -48,12 +54,16 @@ property_double (detail, _("Detail"), 1.0)
 #include <stdio.h>
 #include <stdlib.h>
 
-/* Using OMP with clang causes crashes */
-#if defined(HAVE_OPENMP) && ! defined(__clang__)
-#define _OMP(x) _Pragma(#x)
-#else
-#define _OMP(x) /* OMP disabled: "#x" */
-#endif
+/* the cost of using an additional thread, relative to the cost of processing
+ * a single matrix element
+ */
+#define THREAD_COST 16384.0
+
+/* dot products are accumulated in blocks of a fixed size, whose partial sums
+ * are added up in order, so that the result doesn't depend on the number of
+ * threads.
+ */
+#define DOT_BLOCK_SIZE 4096
 
 /* Common return codes for operators */
 #define PFSTMO_OK 1             /* Successful */
@@ -75,10 +85,25 @@ typedef struct pyramid_s {
 
 
 #define PYRAMID_MIN_PIXELS 3
+#define PREVIEW_MIN_SIZE   64
 #define LOOKUP_W_TO_R 107
 
 typedef int (*pfstmo_progress_callback)(int progress);
 
+/* the arguments of the matrix kernels distributed across threads */
+typedef struct
+{
+  gint          cols;
+  gint          rows;
+  const gfloat *a;
+  const gfloat *b;
+  gfloat       *c;
+  gfloat       *d;
+  gdouble      *sums;
+  gfloat        val;
+  gsize         n;
+} matrix_data_t;
+
 
 static void        mantiuk06_contrast_equalization            (pyramid_t                       *pp,
                                                                const gfloat                     contrastFactor);
@@ -221,17 +246,16 @@ static gfloat R_table[] =
 };
 
 
-/* upsample the matrix
- * upsampled matrix is twice bigger in each direction than data[]
- * res should be a pointer to allocated memory for bigger matrix
- * cols and rows are the dimmensions of the output matrix
- */
 static void
-mantiuk06_matrix_upsample (const gint          outCols,
-                           const gint          outRows,
-                           const gfloat *const in,
-                           gfloat       *const out)
+mantiuk06_matrix_upsample_rows (gsize          offset,
+                                gsize          size,
+                                matrix_data_t *data)
 {
+  const gint          outCols = data->cols;
+  const gint          outRows = data->rows;
+  const gfloat *const in      = data->a;
+  gfloat       *const out     = data->c;
+
   const int inRows = outRows/2;
   const int inCols = outCols/2;
   gint      x, y;
@@ -250,8 +274,7 @@ mantiuk06_matrix_upsample (const gint          outCols,
                                          * best.
                                          */
 
-  _OMP (omp parallel for schedule(static))
-  for (y = 0; y < outRows; y++)
+  for (y = offset; y < (gint) (offset + size); y++)
     {
       const gfloat sy  = y * dy;
       const gint   iy1 =      (  y   * inRows) / outRows;
@@ -272,14 +295,41 @@ mantiuk06_matrix_upsample (const gint          outCols,
     }
 }
 
+/* upsample the matrix
+ * upsampled matrix is twice bigger in each direction than data[]
+ * res should be a pointer to allocated memory for bigger matrix
+ * cols and rows are the dimmensions of the output matrix
+ */
+static void
+mantiuk06_matrix_upsample (const gint          outCols,
+                           const gint          outRows,
+                           const gfloat *const in,
+                           gfloat       *const out)
+{
+  matrix_data_t data;
+
+  data.cols = outCols;
+  data.rows = outRows;
+  data.a    = in;
+  data.c    = out;
+
+  gegl_parallel_distribute_range (
+    outRows, THREAD_COST / outCols,
+    (GeglParallelDistributeRangeFunc) mantiuk06_matrix_upsample_rows,
+    &data);
+}
+
 
-/* downsample the matrix */
 static void
-mantiuk06_matrix_downsample (const gint          inCols,
-                             const gint          inRows,
-                             const gfloat *const data,
-                             gfloat       *const res)
+mantiuk06_matrix_downsample_rows (gsize          offset,
+                                  gsize          size,
+                                  matrix_data_t *data)
 {
+  const gint          inCols = data->cols;
+  const gint          inRows = data->rows;
+  const gfloat *const in     = data->a;
+  gfloat       *const res    = data->c;
+
   const int outRows = inRows / 2;
   const int outCols = inCols / 2;
   gint      x, y, i, j;
@@ -305,8 +355,7 @@ mantiuk06_matrix_downsample (const gint          inCols,
    */
 
   const gfloat normalize = 1.0f/(dx*dy);
-  _OMP (omp parallel for schedule(static))
-  for (y = 0; y < outRows; y++)
+  for (y = offset; y < (gint) (offset + size); y++)
     {
       const gint   iy1 = (  y   * inRows) / outRows;
       const gint   iy2 = ((y+1) * inRows) / outRows;
@@ -359,7 +408,7 @@ mantiuk06_matrix_downsample (const gint          inCols,
                       factorx = 1.0f;
                     }
 
-                  pixVal += data[j + i*inCols] * factorx * factory;
+                  pixVal += in[j + i*inCols] * factorx * factory;
                 }
             }
 
@@ -370,17 +419,55 @@ mantiuk06_matrix_downsample (const gint          inCols,
 }
 
 
+/* downsample the matrix */
+static void
+mantiuk06_matrix_downsample (const gint          inCols,
+                             const gint          inRows,
+                             const gfloat *const data,
+                             gfloat       *const res)
+{
+  matrix_data_t mdata;
+
+  mdata.cols = inCols;
+  mdata.rows = inRows;
+  mdata.a    = data;
+  mdata.c    = res;
+
+  gegl_parallel_distribute_range (
+    inRows / 2, THREAD_COST / (inCols / 2),
+    (GeglParallelDistributeRangeFunc) mantiuk06_matrix_downsample_rows,
+    &mdata);
+}
+
+
+static void
+mantiuk06_matrix_subtract_range (gsize          offset,
+                                 gsize          size,
+                                 matrix_data_t *data)
+{
+  const gfloat *const a = data->a + offset;
+  gfloat       *const b = data->c + offset;
+  gsize               i;
+
+  for (i = 0; i < size; i++)
+    b[i] = a[i] - b[i];
+}
+
 /* return = a - b */
 static inline void
 mantiuk06_matrix_subtract (const guint         n,
                            const gfloat *const a,
                            gfloat       *const b)
 {
-  guint i;
+  matrix_data_t data;
 
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
-    b[i] = a[i] - b[i];
+  data.a = a;
+  data.c = b;
+
+  gegl_parallel_distribute_range (
+    n, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) mantiuk06_matrix_subtract_range,
+    &data);
 }
 
 /* copy matix a to b, return = a  */
@@ -392,16 +479,100 @@ mantiuk06_matrix_copy (const guint         n,
   memcpy (b, a, sizeof (gfloat) * n);
 }
 
+static void
+mantiuk06_matrix_multiply_const_range (gsize          offset,
+                                       gsize          size,
+                                       matrix_data_t *data)
+{
+  gfloat *const a   = data->c + offset;
+  const gfloat  val = data->val;
+  gsize         i;
+
+  for (i = 0; i < size; i++)
+    a[i] *= val;
+}
+
 /* multiply matrix a by scalar val */
 static inline void
 mantiuk06_matrix_multiply_const (const guint         n,
                                  gfloat       *const a,
                                  const gfloat        val)
 {
-  guint i;
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
-    a[i] *= val;
+  matrix_data_t data;
+
+  data.c   = a;
+  data.val = val;
+
+  gegl_parallel_distribute_range (
+    n, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) mantiuk06_matrix_multiply_const_range,
+    &data);
+}
+
+static void
+mantiuk06_matrix_axpy_range (gsize          offset,
+                             gsize          size,
+                             matrix_data_t *data)
+{
+  const gfloat *const x     = data->a + offset;
+  gfloat       *const y     = data->c + offset;
+  const gfloat        alpha = data->val;
+  gsize               i;
+
+  for (i = 0; i < size; i++)
+    y[i] += alpha * x[i];
+}
+
+/* y = y + alpha * x */
+static inline void
+mantiuk06_matrix_axpy (const guint         n,
+                       const gfloat        alpha,
+                       const gfloat *const x,
+                       gfloat       *const y)
+{
+  matrix_data_t data;
+
+  data.a   = x;
+  data.c   = y;
+  data.val = alpha;
+
+  gegl_parallel_distribute_range (
+    n, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) mantiuk06_matrix_axpy_range,
+    &data);
+}
+
+static void
+mantiuk06_matrix_xpay_range (gsize          offset,
+                             gsize          size,
+                             matrix_data_t *data)
+{
+  const gfloat *const x    = data->a + offset;
+  gfloat       *const y    = data->c + offset;
+  const gfloat        beta = data->val;
+  gsize               i;
+
+  for (i = 0; i < size; i++)
+    y[i] = x[i] + beta * y[i];
+}
+
+/* y = x + beta * y */
+static inline void
+mantiuk06_matrix_xpay (const guint         n,
+                       const gfloat *const x,
+                       const gfloat        beta,
+                       gfloat       *const y)
+{
+  matrix_data_t data;
+
+  data.a   = x;
+  data.c   = y;
+  data.val = beta;
+
+  gegl_parallel_distribute_range (
+    n, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) mantiuk06_matrix_xpay_range,
+    &data);
 }
 
 
@@ -418,18 +589,66 @@ mantiuk06_matrix_free (gfloat *m)
   g_free (m);
 }
 
+static void
+mantiuk06_matrix_dot_product_blocks (gsize          offset,
+                                     gsize          size,
+                                     matrix_data_t *data)
+{
+  gsize block;
+
+  for (block = offset; block < offset + size; block++)
+    {
+      const gsize         start = block * DOT_BLOCK_SIZE;
+      const gsize         n     = MIN (DOT_BLOCK_SIZE, data->n - start);
+      const gfloat *const a     = data->a + start;
+      const gfloat *const b     = data->b + start;
+      gfloat              lanes[8] = { 0 };
+      gdouble             val      = 0.0;
+      gsize               j;
+      gint                k;
+
+      /* independent partial sums, which can be kept in a vector register */
+      for (j = 0; j + 8 <= n; j += 8)
+        {
+          for (k = 0; k < 8; k++)
+            lanes[k] += a[j + k] * b[j + k];
+        }
+
+      for (k = 0; k < 8; k++)
+        val += lanes[k];
+
+      for (; j < n; j++)
+        val += a[j] * b[j];
+
+      data->sums[block] = val;
+    }
+}
+
 /* multiply vector by vector (each vector should have one dimension equal to 1) */
 static inline gfloat
 mantiuk06_matrix_dot_product (const guint         n,
                               const gfloat *const a,
                               const gfloat *const b)
 {
-  gfloat val = 0;
-  guint j;
+  const gsize   n_blocks = (n + DOT_BLOCK_SIZE - 1) / DOT_BLOCK_SIZE;
+  matrix_data_t data;
+  gdouble       val = 0.0;
+  gsize         block;
+
+  data.a    = a;
+  data.b    = b;
+  data.n    = n;
+  data.sums = g_new (gdouble, n_blocks);
 
-  _OMP (omp parallel for reduction(+:val) schedule(static))
-  for (j = 0; j < n; j++)
-    val += a[j] * b[j];
+  gegl_parallel_distribute_range (
+    n_blocks, THREAD_COST / DOT_BLOCK_SIZE,
+    (GeglParallelDistributeRangeFunc) mantiuk06_matrix_dot_product_blocks,
+    &data);
+
+  for (block = 0; block < n_blocks; block++)
+    val += data.sums[block];
+
+  g_free (data.sums);
 
   return val;
 }
@@ -442,6 +661,42 @@ mantiuk06_matrix_zero (guint   n,
   memset(m, 0, n * sizeof (gfloat));
 }
 
+static void
+mantiuk06_calculate_and_add_divergence_rows (gsize          offset,
+                                             gsize          size,
+                                             matrix_data_t *data)
+{
+  const gint cols = data->cols;
+  gint       ky, kx;
+
+  /* the first row and column are handled separately, so that the rest can
+   * be vectorized
+   */
+  for (ky = offset; ky < (gint) (offset + size); ky++)
+    {
+      const gfloat *const Gx   = data->a + ky * cols;
+      const gfloat *const Gy   = data->b + ky * cols;
+      gfloat       *const divG = data->c + ky * cols;
+
+      if (ky == 0)
+        {
+          divG[0] += Gx[0] + Gy[0];
+
+          for (kx = 1; kx < cols; kx++)
+            divG[kx] += (Gx[kx] - Gx[kx - 1]) + Gy[kx];
+        }
+      else
+        {
+          const gfloat *const Gy_prev = Gy - cols;
+
+          divG[0] += Gx[0] + (Gy[0] - Gy_prev[0]);
+
+          for (kx = 1; kx < cols; kx++)
+            divG[kx] += (Gx[kx] - Gx[kx - 1]) + (Gy[kx] - Gy_prev[kx]);
+        }
+    }
+}
+
 /* calculate divergence of two gradient maps (Gx and Gy)
  * divG(x,y) = Gx(x,y) - Gx(x-1,y) + Gy(x,y) - Gy(x,y-1)
  */
@@ -452,29 +707,17 @@ mantiuk06_calculate_and_add_divergence (const gint          cols,
                                         const gfloat *const Gy,
                                         gfloat       *const divG)
 {
-  gint ky, kx;
+  matrix_data_t data;
 
-  _OMP (omp parallel for schedule(static))
-  for (ky = 0; ky < rows; ky++)
-    {
-      for (kx = 0; kx<cols; kx++)
-        {
-          gfloat divGx, divGy;
-          const int idx = kx + ky*cols;
-
-          if (kx == 0)
-            divGx = Gx[idx];
-          else
-            divGx = Gx[idx] - Gx[idx-1];
+  data.cols = cols;
+  data.a    = Gx;
+  data.b    = Gy;
+  data.c    = divG;
 
-          if (ky == 0)
-            divGy = Gy[idx];
-          else
-            divGy = Gy[idx] - Gy[idx - cols];
-
-          divG[idx] += divGx + divGy;
-        }
-    }
+  gegl_parallel_distribute_range (
+    rows, THREAD_COST / cols,
+    (GeglParallelDistributeRangeFunc) mantiuk06_calculate_and_add_divergence_rows,
+    &data);
 }
 
 /* calculate the sum of divergences for the all pyramid level. the smaller
@@ -545,23 +788,21 @@ mantiuk06_pyramid_calculate_divergence_sum (pyramid_t *pyramid,
   mantiuk06_matrix_free (temp);
 }
 
-/* calculate scale factors (Cx,Cy) for gradients (Gx,Gy)
- * C is equal to EDGE_WEIGHT for gradients smaller than GFIXATE or
- * 1.0 otherwise
- */
-static inline void
-mantiuk06_calculate_scale_factor (const gint          n,
-                                  const gfloat *const G,
-                                  gfloat       *const C)
+static void
+mantiuk06_calculate_scale_factor_range (gsize          offset,
+                                        gsize          size,
+                                        matrix_data_t *data)
 {
   const gfloat detectT = 0.001f;
   const gfloat a = 0.038737;
   const gfloat b = 0.537756;
 
-  gint i;
+  const gfloat *const G = data->a;
+  gfloat       *const C = data->c;
+
+  gsize i;
 
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
+  for (i = offset; i < offset + size; i++)
     {
 #if 1
       const gfloat g = MAX (detectT, fabsf (G[i]));
@@ -578,6 +819,26 @@ mantiuk06_calculate_scale_factor (const gint          n,
     }
 }
 
+/* calculate scale factors (Cx,Cy) for gradients (Gx,Gy)
+ * C is equal to EDGE_WEIGHT for gradients smaller than GFIXATE or
+ * 1.0 otherwise
+ */
+static inline void
+mantiuk06_calculate_scale_factor (const gint          n,
+                                  const gfloat *const G,
+                                  gfloat       *const C)
+{
+  matrix_data_t data;
+
+  data.a = G;
+  data.c = C;
+
+  gegl_parallel_distribute_range (
+    n, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) mantiuk06_calculate_scale_factor_range,
+    &data);
+}
+
 /* calculate scale factor for the whole pyramid */
 static void
 mantiuk06_pyramid_calculate_scale_factor (pyramid_t *pyramid,
@@ -593,6 +854,19 @@ mantiuk06_pyramid_calculate_scale_factor (pyramid_t *pyramid,
     }
 }
 
+static void
+mantiuk06_scale_gradient_range (gsize          offset,
+                                gsize          size,
+                                matrix_data_t *data)
+{
+  const gfloat *const C = data->a + offset;
+  gfloat       *const G = data->c + offset;
+  gsize               i;
+
+  for (i = 0; i < size; i++)
+    G[i] *= C[i];
+}
+
 /* Scale gradient (Gx and Gy) by C (Cx and Cy)
  * G = G / C
  */
@@ -601,10 +875,15 @@ mantiuk06_scale_gradient (const gint          n,
                           gfloat       *const G,
                           const gfloat *const C)
 {
-  gint i;
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
-    G[i] *= C[i];
+  matrix_data_t data;
+
+  data.a = C;
+  data.c = G;
+
+  gegl_parallel_distribute_range (
+    n, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) mantiuk06_scale_gradient_range,
+    &data);
 }
 
 /* scale gradients for the whole one pyramid with the use of (Cx,Cy) from the
@@ -681,6 +960,42 @@ mantiuk06_pyramid_allocate (int cols,
 }
 
 
+static void
+mantiuk06_calculate_gradient_rows (gsize          offset,
+                                   gsize          size,
+                                   matrix_data_t *data)
+{
+  const gint cols = data->cols;
+  const gint rows = data->rows;
+  gint       ky, kx;
+
+  /* the last row and column are handled separately, so that the rest can be
+   * vectorized
+   */
+  for (ky = offset; ky < (gint) (offset + size); ky++)
+    {
+      const gfloat *const lum = data->a + ky * cols;
+      gfloat       *const Gx  = data->c + ky * cols;
+      gfloat       *const Gy  = data->d + ky * cols;
+
+      for (kx = 0; kx < cols - 1; kx++)
+        Gx[kx] = lum[kx + 1] - lum[kx];
+
+      Gx[cols - 1] = 0;
+
+      if (ky == rows - 1)
+        {
+          for (kx = 0; kx < cols; kx++)
+            Gy[kx] = 0;
+        }
+      else
+        {
+          for (kx = 0; kx < cols; kx++)
+            Gy[kx] = lum[kx + cols] - lum[kx];
+        }
+    }
+}
+
 /* calculate gradients */
 static inline void
 mantiuk06_calculate_gradient (const gint          cols,
@@ -689,26 +1004,18 @@ mantiuk06_calculate_gradient (const gint          cols,
                               gfloat       *const Gx,
                               gfloat       *const Gy)
 {
-  gint ky, kx;
-
-  _OMP (omp parallel for schedule(static))
-  for (ky = 0; ky < rows; ky++)
-    {
-      for (kx = 0; kx < cols; kx++)
-        {
-          const gint idx = kx + ky*cols;
-
-          if (kx == (cols - 1))
-            Gx[idx] = 0;
-          else
-            Gx[idx] = lum[idx+1] - lum[idx];
-
-          if (ky == (rows - 1))
-            Gy[idx] = 0;
-          else
-            Gy[idx] = lum[idx + cols] - lum[idx];
-        }
-    }
+  matrix_data_t data;
+
+  data.cols = cols;
+  data.rows = rows;
+  data.a    = lum;
+  data.c    = Gx;
+  data.d    = Gy;
+
+  gegl_parallel_distribute_range (
+    rows, THREAD_COST / cols,
+    (GeglParallelDistributeRangeFunc) mantiuk06_calculate_gradient_rows,
+    &data);
 }
 
 
@@ -755,17 +1062,34 @@ mantiuk06_pyramid_calculate_gradient (pyramid_t *pyramid,
 }
 
 
+static void
+mantiuk06_solveX_range (gsize          offset,
+                        gsize          size,
+                        matrix_data_t *data)
+{
+  const gfloat *const b = data->a + offset;
+  gfloat       *const x = data->c + offset;
+  gsize               i;
+
+  for (i = 0; i < size; i++)
+    x[i] = -0.25f * b[i];
+}
+
 /* x = -0.25 * b */
 static inline void
 mantiuk06_solveX (const gint          n,
                   const gfloat *const b,
                   gfloat       *const x)
 {
-  gint i;
+  matrix_data_t data;
 
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
-    x[i] = -0.25f * b[i];
+  data.a = b;
+  data.c = x;
+
+  gegl_parallel_distribute_range (
+    n, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) mantiuk06_solveX_range,
+    &data);
 }
 
 /* divG_sum = A * x = sum (divG (x))
@@ -833,7 +1157,6 @@ mantiuk06_linbcg (pyramid_t           *pyramid,
 
   for (; iter < itmax; iter++)
     {
-      guint i;
       gfloat bknum, ak, old_err2;
 
       if (progress_cb != NULL)
@@ -854,12 +1177,8 @@ mantiuk06_linbcg (pyramid_t           *pyramid,
         {
           const gfloat bk = bknum / bkden; /* beta = ...  */
 
-          _OMP (omp parallel for schedule(static))
-          for (i = 0; i < n; i++)
-            {
-              p[i]  =  z[i] + bk *  p[i];
-              pp[i] = zz[i] + bk * pp[i];
-            }
+          mantiuk06_matrix_xpay (n,  z, bk,  p); /*  p =  z + beta *  p */
+          mantiuk06_matrix_xpay (n, zz, bk, pp); /* pp = zz + beta * pp */
         }
 
       bkden = bknum; /* numerator becomes the dominator for the next iteration */
@@ -869,12 +1188,8 @@ mantiuk06_linbcg (pyramid_t           *pyramid,
 
       ak = bknum / mantiuk06_matrix_dot_product (n, z, pp); /* alfa = ...   */
 
-      _OMP (omp parallel for schedule(static))
-      for (i = 0 ; i < n ; i++ )
-        {
-          r[i]  -= ak *  z[i];  /*  r =  r - alfa *  z  */
-          rr[i] -= ak * zz[i];  /* rr = rr - alfa * zz  */
-        }
+      mantiuk06_matrix_axpy (n, -ak,  z,  r); /*  r =  r - alfa *  z  */
+      mantiuk06_matrix_axpy (n, -ak, zz, rr); /* rr = rr - alfa * zz  */
 
       old_err2 = err2;
       err2 = mantiuk06_matrix_dot_product (n, r, r);
@@ -896,9 +1211,7 @@ mantiuk06_linbcg (pyramid_t           *pyramid,
           num_backwards = 0;
         }
 
-      _OMP (omp parallel for schedule(static))
-      for (i = 0 ; i < n ; i++ )
-        x[i] += ak * p[i];      /* x =  x + alfa * p */
+      mantiuk06_matrix_axpy (n, ak, p, x);    /* x =  x + alfa * p */
 
       if (num_backwards > num_backwards_ceiling)
         {
@@ -1006,7 +1319,6 @@ mantiuk06_lincg (pyramid_t           *pyramid,
   percent_sf = 100.0f / logf (tol2 * bnrm2 / irdotr);
   for (; iter < itmax; iter++)
     {
-      gint  i;
       gfloat alpha, old_rdotr;
 
       if (progress_cb != NULL) {
@@ -1022,9 +1334,7 @@ mantiuk06_lincg (pyramid_t           *pyramid,
       alpha = rdotr / mantiuk06_matrix_dot_product (n, p, Ap);
 
       /* r = r - alpha Ap */
-      _OMP (omp parallel for schedule(static))
-      for (i = 0; i < n; i++)
-        r[i] -= alpha * Ap[i];
+      mantiuk06_matrix_axpy (n, -alpha, Ap, r);
 
       /* rdotr = r.r */
       old_rdotr = rdotr;
@@ -1048,9 +1358,7 @@ mantiuk06_lincg (pyramid_t           *pyramid,
         }
 
       /* x = x + alpha p */
-      _OMP (omp parallel for schedule(static))
-      for (i = 0; i < n; i++)
-        x[i] += alpha * p[i];
+      mantiuk06_matrix_axpy (n, alpha, p, x);
 
 
       /* Exit if we're done */
@@ -1081,9 +1389,7 @@ mantiuk06_lincg (pyramid_t           *pyramid,
           /* p = r + beta p */
           const gfloat beta = rdotr/old_rdotr;
 
-          _OMP (omp parallel for schedule(static))
-          for (i = 0; i < n; i++)
-            p[i] = r[i] + beta*p[i];
+          mantiuk06_matrix_xpay (n, r, beta, p);
         }
     }
 
@@ -1143,15 +1449,15 @@ mantiuk06_lookup_table (const gint          n,
 }
 
 
-/* transform gradient (Gx,Gy) to R */
-static inline void
-mantiuk06_transform_to_R (const gint        n,
-                          gfloat     *const G)
+static void
+mantiuk06_transform_to_R_range (gsize          offset,
+                                gsize          size,
+                                matrix_data_t *data)
 {
-  gint j;
+  gfloat *const G = data->c;
+  gsize         j;
 
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n; j++)
+  for (j = offset; j < offset + size; j++)
     {
       /* G to W */
       const gfloat absG = fabsf (G[j]);
@@ -1175,6 +1481,21 @@ mantiuk06_transform_to_R (const gint        n,
     }
 }
 
+/* transform gradient (Gx,Gy) to R */
+static inline void
+mantiuk06_transform_to_R (const gint        n,
+                          gfloat     *const G)
+{
+  matrix_data_t data;
+
+  data.c = G;
+
+  gegl_parallel_distribute_range (
+    n, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) mantiuk06_transform_to_R_range,
+    &data);
+}
+
 /* transform gradient (Gx,Gy) to R for the whole pyramid */
 static inline void
 mantiuk06_pyramid_transform_to_R (pyramid_t *pyramid)
@@ -1188,15 +1509,15 @@ mantiuk06_pyramid_transform_to_R (pyramid_t *pyramid)
     }
 }
 
-/* transform from R to G */
-static inline void
-mantiuk06_transform_to_G (const gint        n,
-                          gfloat     *const R)
+static void
+mantiuk06_transform_to_G_range (gsize          offset,
+                                gsize          size,
+                                matrix_data_t *data)
 {
-  gint j;
+  gfloat *const R = data->c;
+  gsize         j;
 
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n; j++){
+  for (j = offset; j < offset + size; j++){
     /* RESP to W */
     gint sign;
     if (R[j] < 0)
@@ -1218,6 +1539,21 @@ mantiuk06_transform_to_G (const gint        n,
   }
 }
 
+/* transform from R to G */
+static inline void
+mantiuk06_transform_to_G (const gint        n,
+                          gfloat     *const R)
+{
+  matrix_data_t data;
+
+  data.c = R;
+
+  gegl_parallel_distribute_range (
+    n, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) mantiuk06_transform_to_G_range,
+    &data);
+}
+
 /* transform from R to G for the pyramid */
 static inline void
 mantiuk06_pyramid_transform_to_G (pyramid_t *pyramid)
@@ -1322,13 +1658,57 @@ mantiuk06_hist_data_index (const void *const v1,
 }
 
 
+typedef struct
+{
+  pyramid_t        *level;
+  struct hist_data *hist;
+  gfloat            contrastFactor;
+} equalization_data_t;
+
+static void
+mantiuk06_hist_build_range (gsize                offset,
+                            gsize                size,
+                            equalization_data_t *data)
+{
+  const pyramid_t  *const l    = data->level;
+  struct hist_data *const hist = data->hist;
+  gsize                   c;
+
+  for (c = offset; c < offset + size; c++)
+    {
+      hist[c].size = sqrtf (l->Gx[c] * l->Gx[c] +
+                            l->Gy[c] * l->Gy[c]);
+    }
+}
+
+static void
+mantiuk06_hist_remap_range (gsize                offset,
+                            gsize                size,
+                            equalization_data_t *data)
+{
+  pyramid_t        *const l    = data->level;
+  struct hist_data *const hist = data->hist;
+  gsize                   c;
+
+  for (c = offset; c < offset + size; c++)
+    {
+      const gfloat scale = data->contrastFactor *
+                           hist[c].cdf          /
+                           hist[c].size;
+      l->Gx[c] *= scale;
+      l->Gy[c] *= scale;
+    }
+}
+
+
 static void
 mantiuk06_contrast_equalization (pyramid_t   *pp,
                                  const gfloat  contrastFactor )
 {
-  gint              i, idx;
-  struct hist_data *hist;
-  gint              total_pixels = 0;
+  gint                 i, idx;
+  struct hist_data    *hist;
+  gint                 total_pixels = 0;
+  equalization_data_t  data;
 
   /* Count sizes */
   pyramid_t *l = pp;
@@ -1347,16 +1727,18 @@ mantiuk06_contrast_equalization (pyramid_t   *pp,
   while (l != NULL)
     {
       const int pixels = l->rows*l->cols;
-      const int offset = idx;
-      gint      c;
 
-      _OMP (omp parallel for schedule(static))
-      for (c = 0; c < pixels; c++)
-        {
-          hist[c+offset].size = sqrtf (l->Gx[c] * l->Gx[c] +
-                                       l->Gy[c] * l->Gy[c]);
-          hist[c+offset].index = c + offset;
-        }
+      data.level = l;
+      data.hist  = hist + idx;
+
+      gegl_parallel_distribute_range (
+        pixels, THREAD_COST,
+        (GeglParallelDistributeRangeFunc) mantiuk06_hist_build_range,
+        &data);
+
+      for (i = 0; i < pixels; i++)
+        hist[idx + i].index = idx + i;
+
       idx += pixels;
       l = l->next;
     }
@@ -1368,7 +1750,6 @@ mantiuk06_contrast_equalization (pyramid_t   *pp,
   /* Calculate cdf */
   {
     const gfloat norm = 1.0f / (gfloat) total_pixels;
-    _OMP (omp parallel for schedule(static))
     for (i = 0; i < total_pixels; i++)
       hist[i].cdf = ((gfloat) i) * norm;
   }
@@ -1381,21 +1762,19 @@ mantiuk06_contrast_equalization (pyramid_t   *pp,
   /*Remap gradient magnitudes */
   l   = pp;
   idx = 0;
+  data.contrastFactor = contrastFactor;
   while (l != NULL )
     {
-      gint      c;
       const int pixels = l->rows*l->cols;
-      const int offset = idx;
 
-      _OMP (omp parallel for schedule(static))
-      for (c = 0; c < pixels; c++)
-        {
-          const gfloat scale = contrastFactor      *
-                               hist[c+offset].cdf  /
-                               hist[c+offset].size;
-          l->Gx[c] *= scale;
-          l->Gy[c] *= scale;
-        }
+      data.level = l;
+      data.hist  = hist + idx;
+
+      gegl_parallel_distribute_range (
+        pixels, THREAD_COST,
+        (GeglParallelDistributeRangeFunc) mantiuk06_hist_remap_range,
+        &data);
+
       idx += pixels;
       l    = l->next;
     }
@@ -1404,46 +1783,83 @@ mantiuk06_contrast_equalization (pyramid_t   *pp,
 }
 
 
-/* tone mapping */
-static int
-mantiuk06_contmap (const int                       c,
-                   const int                       r,
-                   gfloat                   *const rgb,
-                   gfloat                   *const Y,
-                   const gfloat                    contrastFactor,
-                   const gfloat                    saturationFactor,
-                   const gboolean                  bcg,
-                   const int                       itmax,
-                   const gfloat                    tol,
-                   pfstmo_progress_callback        progress)
+typedef struct
 {
-  const guint n = c*r;
-        guint j;
+  gfloat       *rgb;
+  gfloat       *Y;
+  gfloat        clip_min;
+  gdouble       l_min;
+  gdouble       l_max;
+  gfloat        saturationFactor;
+} contmap_data_t;
 
-  /* Normalize */
-  gfloat Ymax = Y[0],
-         clip_min;
-
-  for (j = 1; j < n; j++)
-      Ymax = MAX (Y[j], Ymax);
+static void
+mantiuk06_contmap_normalize_range (gsize           offset,
+                                   gsize           size,
+                                   contmap_data_t *data)
+{
+  const gfloat  clip_min = data->clip_min;
+  gfloat *const rgb      = data->rgb;
+  gfloat *const Y        = data->Y;
+  gsize         j;
+  gint          k;
 
-  clip_min = 1e-7f * Ymax;
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n * 4; j++)
-      if (G_UNLIKELY (rgb[j] < clip_min)) rgb[j] = clip_min;
+  for (j = offset; j < offset + size; j++)
+    {
+      for (k = 0; k < 4; k++)
+        if (G_UNLIKELY (rgb[j * 4 + k] < clip_min)) rgb[j * 4 + k] = clip_min;
 
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n; j++)
-      if (G_UNLIKELY (  Y[j] < clip_min))   Y[j] = clip_min;
+      if (G_UNLIKELY (Y[j] < clip_min)) Y[j] = clip_min;
 
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n; j++)
-    {
       rgb[j * 4 + 0] /= Y[j];
       rgb[j * 4 + 1] /= Y[j];
       rgb[j * 4 + 2] /= Y[j];
       Y[j]            = log10f (Y[j]);
     }
+}
+
+static void
+mantiuk06_contmap_output_range (gsize           offset,
+                                gsize           size,
+                                contmap_data_t *data)
+{
+  const gdouble disp_dyn_range = 2.3;
+  gfloat *const rgb            = data->rgb;
+  gfloat *const Y              = data->Y;
+  gsize         j;
+
+  for (j = offset; j < offset + size; j++)
+    {
+      /* x scaled */
+      Y[j] = ( Y[j] - data->l_min) /
+             (data->l_max - data->l_min) *
+             disp_dyn_range - disp_dyn_range;
+
+      /* Transform to linear scale RGB */
+      Y[j] = powf (10,Y[j]);
+
+      rgb[j * 4 + 0] = powf (rgb[j * 4 + 0], data->saturationFactor) * Y[j];
+      rgb[j * 4 + 1] = powf (rgb[j * 4 + 1], data->saturationFactor) * Y[j];
+      rgb[j * 4 + 2] = powf (rgb[j * 4 + 2], data->saturationFactor) * Y[j];
+    }
+}
+
+/* map the logarithmic luminance Y to display luminance, still in the
+ * logarithmic domain, and find the percentiles it is renormalized by.
+ */
+static void
+mantiuk06_contmap_luminance (const int                       c,
+                             const int                       r,
+                             gfloat                   *const Y,
+                             const gfloat                    contrastFactor,
+                             const gboolean                  bcg,
+                             const int                       itmax,
+                             const gfloat                    tol,
+                             pfstmo_progress_callback        progress,
+                             gdouble                        *l_min,
+                             gdouble                        *l_max)
+{
+  const guint n = c*r;
 
   {
     /* create pyramid */
@@ -1477,7 +1893,7 @@ mantiuk06_contmap (const int                       c,
   {
     const gdouble CUT_MARGIN = 0.1;
     gfloat       *temp = mantiuk06_matrix_alloc (n);
-    gdouble       trim, delta, l_min, l_max;
+    gdouble       trim, delta;
 
     /* copy Y to temp */
     mantiuk06_matrix_copy (n, Y, temp);
@@ -1486,38 +1902,238 @@ mantiuk06_contmap (const int                       c,
 
     /* const float median = (temp[(int)((n-1)/2)] + temp[(int)((n-1)/2+1)]) * 0.5f; */
     /* calculate median */
-    trim  = (n - 1) * CUT_MARGIN * 0.01;
-    delta = trim - floor (trim);
-    l_min = temp[(int)floor (trim)] * delta +
-            temp[(int) ceil (trim)] * (1.0 - delta);
+    trim   = (n - 1) * CUT_MARGIN * 0.01;
+    delta  = trim - floor (trim);
+    *l_min = temp[(int)floor (trim)] * delta +
+             temp[(int) ceil (trim)] * (1.0 - delta);
 
-    trim  = (n - 1) * (100.0 - CUT_MARGIN) * 0.01;
-    delta = trim - floor (trim);
-    l_max = temp[(int)floor (trim)] * delta +
-            temp[(int) ceil (trim)] * (1.0 - delta);
+    trim   = (n - 1) * (100.0 - CUT_MARGIN) * 0.01;
+    delta  = trim - floor (trim);
+    *l_max = temp[(int)floor (trim)] * delta +
+             temp[(int) ceil (trim)] * (1.0 - delta);
 
     mantiuk06_matrix_free (temp);
+  }
+}
+
+
+typedef struct
+{
+  const gfloat *small_Y;
+  const gfloat *small_out;
+  gint          small_cols;
+  gint          small_rows;
+  gfloat       *Y;
+  gint          cols;
+  gfloat        scale;
+  gfloat        detail;
+} preview_data_t;
+
+/* the bilinear weight of a low resolution pixel, attenuated by how much its
+ * luminance differs from the full resolution one, so that the mapping of one
+ * side of an edge doesn't leak into the other
+ */
+static inline gfloat
+mantiuk06_gain_weight (gfloat weight,
+                       gfloat Y,
+                       gfloat small_Y)
+{
+  const gfloat d = (Y - small_Y) * 4.6f;
+
+  return weight / (1.0f + d * d);
+}
+
+static void
+mantiuk06_apply_gain_rows (gsize           offset,
+                           gsize           size,
+                           preview_data_t *data)
+{
+  const gint cols       = data->cols,
+             small_cols = data->small_cols,
+             small_rows = data->small_rows;
+  gint       x, y;
+
+  for (y = offset; y < (gint) (offset + size); y++)
     {
-      const gdouble disp_dyn_range = 2.3;
-      _OMP (omp parallel for schedule(static))
-      for (j = 0; j < n; j++)
-          /* x scaled */
-          Y[j] = ( Y[j] - l_min) /
-                 (l_max - l_min) *
-                 disp_dyn_range - disp_dyn_range;
+      const gfloat sy = CLAMP ((y + 0.5f) / data->scale - 0.5f,
+                               0.0f, small_rows - 1);
+      const gint   y0 = sy,
+                   y1 = MIN (y0 + 1, small_rows - 1);
+      const gfloat fy = sy - y0;
+      const gint   i0 = y0 * small_cols,
+                   i1 = y1 * small_cols;
+
+      for (x = 0; x < cols; x++)
+        {
+          const gfloat sx = CLAMP ((x + 0.5f) / data->scale - 0.5f,
+                                   0.0f, small_cols - 1);
+          const gint   x0 = sx,
+                       x1 = MIN (x0 + 1, small_cols - 1);
+          const gfloat fx = sx - x0;
+          gfloat      *Y  = data->Y + x + y * cols;
+          gfloat       w00, w01, w10, w11, w;
+          gfloat       base_in, base_out;
+
+          w00 = mantiuk06_gain_weight ((1.0f - fx) * (1.0f - fy), *Y,
+                                       data->small_Y[x0 + i0]);
+          w01 = mantiuk06_gain_weight (        fx  * (1.0f - fy), *Y,
+                                       data->small_Y[x1 + i0]);
+          w10 = mantiuk06_gain_weight ((1.0f - fx) *         fy , *Y,
+                                       data->small_Y[x0 + i1]);
+          w11 = mantiuk06_gain_weight (        fx  *         fy , *Y,
+                                       data->small_Y[x1 + i1]);
+
+          w = w00 + w01 + w10 + w11;
+
+          base_in  = (w00 * data->small_Y[x0 + i0] +
+                      w01 * data->small_Y[x1 + i0] +
+                      w10 * data->small_Y[x0 + i1] +
+                      w11 * data->small_Y[x1 + i1]) / w;
+          base_out = (w00 * data->small_out[x0 + i0] +
+                      w01 * data->small_out[x1 + i0] +
+                      w10 * data->small_out[x0 + i1] +
+                      w11 * data->small_out[x1 + i1]) / w;
+
+          *Y = base_out + data->detail * (*Y - base_in);
+        }
     }
+}
 
-    /* Transform to linear scale RGB */
-    _OMP (omp parallel for schedule(static))
-    for (j = 0; j < n; j++)
-      {
-        Y[j] = powf (10,Y[j]);
+/* map the logarithmic luminance Y of an image downscaled by 2^level, and
+ * upsample the result. the detail missing from the downscaled image is added
+ * back, compressed by the same ratio as the overall contrast.
+ */
+static void
+mantiuk06_contmap_luminance_preview (const int                 c,
+                                     const int                 r,
+                                     gfloat             *const Y,
+                                     const gfloat              contrastFactor,
+                                     const gboolean            bcg,
+                                     const int                 itmax,
+                                     const gfloat              tol,
+                                     pfstmo_progress_callback  progress,
+                                     const gint                level,
+                                     gdouble                  *l_min,
+                                     gdouble                  *l_max)
+{
+  const gint     scale      = 1 << level;
+  const gint     small_cols = c / scale,
+                 small_rows = r / scale,
+                 small_n    = small_cols * small_rows;
+  gfloat        *small_Y, *small_out;
+  preview_data_t data;
+  gdouble        sum_in  = 0.0, sum_in2  = 0.0,
+                 sum_out = 0.0, sum_out2 = 0.0;
+  gint           x, y, j;
+
+  small_Y   = g_new0 (gfloat, small_n);
+  small_out = mantiuk06_matrix_alloc (small_n);
+
+  /* box filter the logarithmic luminance; pixels past the last whole block
+   * are dropped
+   */
+  for (y = 0; y < small_rows * scale; y++)
+    for (x = 0; x < small_cols * scale; x++)
+      small_Y[x / scale + (y / scale) * small_cols] += Y[x + y * c];
 
-        rgb[j * 4 + 0] = powf (rgb[j * 4 + 0], saturationFactor) * Y[j];
-        rgb[j * 4 + 1] = powf (rgb[j * 4 + 1], saturationFactor) * Y[j];
-        rgb[j * 4 + 2] = powf (rgb[j * 4 + 2], saturationFactor) * Y[j];
-      }
-  }
+  for (j = 0; j < small_n; j++)
+    {
+      small_Y[j]  /= scale * scale;
+      small_out[j] = small_Y[j];
+    }
+
+  mantiuk06_contmap_luminance (small_cols, small_rows, small_out,
+                               contrastFactor, bcg, itmax, tol, progress,
+                               l_min, l_max);
+
+  for (j = 0; j < small_n; j++)
+    {
+      sum_in   += small_Y[j];
+      sum_in2  += small_Y[j] * small_Y[j];
+      sum_out  += small_out[j];
+      sum_out2 += small_out[j] * small_out[j];
+    }
+
+  data.detail = sqrt (MAX (sum_out2 - sum_out * sum_out / small_n, 0.0) /
+                      MAX (sum_in2  - sum_in  * sum_in  / small_n, 1e-20));
+
+  data.small_Y    = small_Y;
+  data.small_out  = small_out;
+  data.small_cols = small_cols;
+  data.small_rows = small_rows;
+  data.Y          = Y;
+  data.cols       = c;
+  data.scale      = scale;
+
+  gegl_parallel_distribute_range (
+    r, THREAD_COST / c,
+    (GeglParallelDistributeRangeFunc) mantiuk06_apply_gain_rows,
+    &data);
+
+  mantiuk06_matrix_free (small_out);
+  g_free (small_Y);
+}
+
+
+/* tone mapping */
+static int
+mantiuk06_contmap (const int                       c,
+                   const int                       r,
+                   gfloat                   *const rgb,
+                   gfloat                   *const Y,
+                   const gfloat                    contrastFactor,
+                   const gfloat                    saturationFactor,
+                   const gboolean                  bcg,
+                   const int                       itmax,
+                   const gfloat                    tol,
+                   pfstmo_progress_callback        progress,
+                   gint                            preview_level)
+{
+  const guint    n = c*r;
+        guint    j;
+  contmap_data_t data;
+
+  /* Normalize */
+  gfloat Ymax = Y[0];
+
+  for (j = 1; j < n; j++)
+      Ymax = MAX (Y[j], Ymax);
+
+  data.rgb              = rgb;
+  data.Y                = Y;
+  data.clip_min         = 1e-7f * Ymax;
+  data.saturationFactor = saturationFactor;
+
+  gegl_parallel_distribute_range (
+    n, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) mantiuk06_contmap_normalize_range,
+    &data);
+
+  /* keep enough of the image for a few pyramid levels */
+  while (preview_level > 0 &&
+         MIN (c, r) / (1 << preview_level) < PREVIEW_MIN_SIZE)
+    {
+      preview_level--;
+    }
+
+  if (preview_level > 0)
+    {
+      mantiuk06_contmap_luminance_preview (c, r, Y, contrastFactor,
+                                           bcg, itmax, tol, progress,
+                                           preview_level,
+                                           &data.l_min, &data.l_max);
+    }
+  else
+    {
+      mantiuk06_contmap_luminance (c, r, Y, contrastFactor,
+                                   bcg, itmax, tol, progress,
+                                   &data.l_min, &data.l_max);
+    }
+
+  gegl_parallel_distribute_range (
+    n, THREAD_COST,
+    (GeglParallelDistributeRangeFunc) mantiuk06_contmap_output_range,
+    &data);
 
   return PFSTMO_OK;
 }
@@ -1581,7 +2197,8 @@ mantiuk06_process (GeglOperation       *operation,
                    pix, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
   mantiuk06_contmap (result->width, result->height, pix, lum,
-                     o->contrast, o->saturation, FALSE, 200, 1e-3, NULL);
+                     o->contrast, o->saturation, FALSE, 200, 1e-3, NULL,
+                     o->preview_level);
 
   /* Cleanup and set the output */
   gegl_buffer_set (output, result, 0, babl_format_with_space (OUTPUT_FORMAT, space), pix,
@@ -85,6 +85,101 @@ get_invalidated_by_change (GeglOperation       *operation,
     }
 }
 
+/* the pixels which can't be copied directly are collected per row, and
+ * sampled in one go.
+ */
+typedef struct
+{
+  gdouble           *points;
+  GeglBufferMatrix2 *scales;
+  gfloat            *samples;
+  gint              *index;
+  gint               n;
+} MapPoints;
+
+static void
+map_points_init (MapPoints *points,
+                 gint       n_max)
+{
+  points->points  = gegl_scratch_new (gdouble, 2 * n_max);
+  points->scales  = gegl_scratch_new (GeglBufferMatrix2, n_max);
+  points->samples = gegl_scratch_new (gfloat, 4 * n_max);
+  points->index   = gegl_scratch_new (gint, n_max);
+  points->n       = 0;
+}
+
+static void
+map_points_clear (MapPoints *points)
+{
+  gegl_scratch_free (points->index);
+  gegl_scratch_free (points->samples);
+  gegl_scratch_free (points->scales);
+  gegl_scratch_free (points->points);
+}
+
+static inline void
+map_points_add (MapPoints               *points,
+                gdouble                  x,
+                gdouble                  y,
+                const GeglBufferMatrix2 *scale,
+                gint                     index)
+{
+  gint n = points->n++;
+
+  /* gegl_sampler_get () would do this for us */
+  if (G_UNLIKELY (! isfinite (x)))
+    x = 0.0;
+  if (G_UNLIKELY (! isfinite (y)))
+    y = 0.0;
+
+  points->points[2 * n + 0] = x;
+  points->points[2 * n + 1] = y;
+  points->index[n]          = index;
+
+  if (scale)
+    points->scales[n] = *scale;
+}
+
+static void
+map_points_sample (MapPoints       *points,
+                   GeglSampler     *sampler,
+                   gboolean         use_scale,
+                   gint             level,
+                   gfloat          *out,
+                   GeglAbyssPolicy  abyss_policy)
+{
+  gint i;
+
+  if (level)
+    {
+      /* only gegl_sampler_get () samples from mipmap levels */
+      for (i = 0; i < points->n; i++)
+        {
+          gegl_sampler_get (sampler,
+                            points->points[2 * i + 0],
+                            points->points[2 * i + 1],
+                            use_scale ? &points->scales[i] : NULL,
+                            out + 4 * points->index[i],
+                            abyss_policy);
+        }
+    }
+  else if (points->n)
+    {
+      gegl_sampler_get_points (sampler,
+                               points->points,
+                               use_scale ? points->scales : NULL,
+                               points->samples,
+                               points->n,
+                               abyss_policy);
+
+      for (i = 0; i < points->n; i++)
+        memcpy (out + 4 * points->index[i], points->samples + 4 * i,
+                4 * sizeof (gfloat));
+    }
+
+  points->n = 0;
+}
+
 static gboolean
 process (GeglOperation       *operation,
          GeglBuffer          *input,
@@ -134,6 +229,9 @@ process (GeglOperation       *operation,
           gfloat     *out = it->items[index_out].data;
           gfloat     *coords = it->items[index_coords].data;
           GeglRectangle *roi = &it->items[0].roi;
+          MapPoints   points;
+
+          map_points_init (&points, roi->width);
 
           y = roi->y + 0.5; /* initial y coordinate */
 
@@ -141,6 +239,8 @@ process (GeglOperation       *operation,
             {
               for (r = 0; r < roi->height; r++, y++)
                 {
+                  gfloat *row_out = out;
+
                   x = roi->x + 0.5; /* initial x coordinate */
 
                   for (c = 0; c < roi->width; c++, x++)
@@ -169,16 +269,17 @@ process (GeglOperation       *operation,
                           coords_y = y + coords_y * scaling;
 #endif
 
-                          gegl_sampler_get (sampler,
-                                            coords_x, coords_y,
-                                            NULL, out,
-                                            o->abyss_policy);
+                          map_points_add (&points, coords_x, coords_y,
+                                          NULL, c);
                         }
 
                       coords += 2;
                       in += 4;
                       out += 4;
                     }
+
+                  map_points_sample (&points, sampler, FALSE, level,
+                                     row_out, o->abyss_policy);
                 }
             }
           else
@@ -212,6 +313,8 @@ process (GeglOperation       *operation,
 
               for (r = 0; r < roi->height; r++, y++)
                 {
+                  gfloat *row_out = out;
+
                   x = roi->x + 0.5; /* initial x coordinate */
 
                   for (c = 0; c < roi->width; c++, x++)
@@ -299,18 +402,21 @@ process (GeglOperation       *operation,
                           coords_y = y + coords_y * scaling;
 #endif
 
-                          gegl_sampler_get (sampler,
-                                            coords_x, coords_y,
-                                            &scale, out,
-                                            o->abyss_policy);
+                          map_points_add (&points, coords_x, coords_y,
+                                          &scale, c);
                         }
 
                       coords += 2;
                       in += 4;
                       out += 4;
                     }
+
+                  map_points_sample (&points, sampler, TRUE, level,
+                                     row_out, o->abyss_policy);
                 }
             }
+
+          map_points_clear (&points);
         }
     }
   else
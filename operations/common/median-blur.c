@@ -72,6 +72,15 @@ property_boolean (high_precision, _("High precision"), FALSE)
 #define MAX_CHUNK_WIDTH  128
 #define MAX_CHUNK_HEIGHT 128
 
+/* from this radius up, quantized square neighborhoods are processed using
+ * the constant-time algorithm of Perreault and Hébert, "Median Filtering in
+ * Constant Time" (2007), whose cost per pixel doesn't depend on the radius.
+ */
+#define CONSTANT_TIME_MIN_RADIUS       8
+#define CONSTANT_TIME_MAX_CHUNK_WIDTH  1024
+#define N_COARSE_BINS                  16
+#define N_FINE_BINS                    (DEFAULT_N_BINS / N_COARSE_BINS)
+
 #define SAFE_CLAMP(x, min, max) ((x) > (min) ? (x) < (max) ? (x) : (max) : (min))
 
 static gfloat        default_bin_values[DEFAULT_N_BINS];
@@ -81,6 +90,7 @@ static volatile gint default_values_initialized = FALSE;
 typedef struct
 {
   gboolean  quantize;
+  gboolean  constant_time;
   gint     *neighborhood_outline;
 } UserData;
 
@@ -108,6 +118,17 @@ typedef struct
   gint                n_color_components;
 } Histogram;
 
+/* the histogram of the current window of the constant-time algorithm.  the
+ * coarse bins are kept up to date for each pixel, while each group of fine
+ * bins is only brought up to date when the median falls into it.
+ */
+typedef struct
+{
+  gint  coarse[N_COARSE_BINS];
+  gint  fine[DEFAULT_N_BINS];
+  gint  last_update[N_COARSE_BINS];
+} WindowHistogram;
+
 typedef enum
 {
   LEFT_TO_RIGHT,
@@ -507,6 +528,29 @@ sort_input_values (InputValue **values,
   *scratch = out;
 }
 
+static void
+quantize_values (gint32 *src,
+                 gint    n_pixels,
+                 gint    n_components)
+{
+  gint c;
+
+  while (n_pixels--)
+    {
+      for (c = 0; c < n_components; c++)
+        {
+          gfloat value = ((gfloat *) src)[c];
+          gint   bin;
+
+          bin = floorf (SAFE_CLAMP (value, 0.0f, 1.0f) * (DEFAULT_N_BINS - 1) + 0.5f);
+
+          src[c] = bin;
+        }
+
+      src += n_components;
+    }
+}
+
 static void
 convert_values_to_bins (Histogram *hist,
                         gint32    *src,
@@ -527,20 +571,7 @@ convert_values_to_bins (Histogram *hist,
           hist->components[c].bin_values = default_bin_values;
         }
 
-      while (n_pixels--)
-        {
-          for (c = 0; c < n_components; c++)
-            {
-              gfloat value = ((gfloat *) src)[c];
-              gint   bin;
-
-              bin = floorf (SAFE_CLAMP (value, 0.0f, 1.0f) * (DEFAULT_N_BINS - 1) + 0.5f);
-
-              src[c] = bin;
-            }
-
-          src += n_components;
-        }
+      quantize_values (src, n_pixels, n_components);
 
       hist->alpha_values = default_alpha_values;
     }
@@ -706,6 +737,10 @@ prepare (GeglOperation *operation)
         format = babl_format_with_space ("R'G'B'A float", in_format);
     }
 
+  data->constant_time = data->quantize                                     &&
+                        o->neighborhood == GEGL_MEDIAN_BLUR_NEIGHBORHOOD_SQUARE &&
+                        radius >= CONSTANT_TIME_MIN_RADIUS;
+
   if (data->quantize && ! g_atomic_int_get (&default_values_initialized))
     {
       gint i;
@@ -759,6 +794,317 @@ get_abyss_policy (GeglOperation *operation,
   g_return_val_if_reached (GEGL_ABYSS_NONE);
 }
 
+static inline void
+column_histograms_modify_row (gint         *col_fine,
+                              gint         *col_coarse,
+                              const gint32 *src,
+                              gint          width,
+                              gint          n_components,
+                              gint          n_color_components,
+                              gint          diff)
+{
+  gboolean has_alpha = n_color_components < n_components;
+  gint     x;
+  gint     c;
+
+  for (x = 0; x < width; x++, src += n_components)
+    {
+      gint alpha = diff;
+
+      if (has_alpha)
+        alpha *= default_alpha_values[src[n_color_components]];
+
+      for (c = 0; c < n_components; c++)
+        {
+          gint  bin = src[c];
+          gint *fine;
+          gint *coarse;
+          gint  weight;
+
+          fine   = col_fine   + (c * width + x) * DEFAULT_N_BINS;
+          coarse = col_coarse + (c * width + x) * N_COARSE_BINS;
+          weight = c < n_color_components ? alpha : diff;
+
+          fine[bin]                 += weight;
+          coarse[bin / N_FINE_BINS] += weight;
+        }
+    }
+}
+
+/* brings the fine bins of the given coarse bin up to date with the window
+ * starting at column x.
+ */
+static inline void
+window_histogram_update_fine (WindowHistogram *win,
+                              const gint      *col_fine,
+                              gint             coarse_bin,
+                              gint             x,
+                              gint             size)
+{
+  gint *fine = win->fine + coarse_bin * N_FINE_BINS;
+  gint  last = win->last_update[coarse_bin];
+  gint  i;
+  gint  j;
+
+  col_fine += coarse_bin * N_FINE_BINS;
+
+  if (x - last >= size)
+    {
+      /* none of the columns are shared with the last update */
+      const gint *col = col_fine + x * DEFAULT_N_BINS;
+
+      for (i = 0; i < N_FINE_BINS; i++)
+        fine[i] = col[i];
+
+      for (j = 1; j < size; j++)
+        {
+          col += DEFAULT_N_BINS;
+
+          for (i = 0; i < N_FINE_BINS; i++)
+            fine[i] += col[i];
+        }
+    }
+  else
+    {
+      for (j = last; j < x; j++)
+        {
+          const gint *add = col_fine + (j + size) * DEFAULT_N_BINS;
+          const gint *sub = col_fine + j          * DEFAULT_N_BINS;
+
+          for (i = 0; i < N_FINE_BINS; i++)
+            fine[i] += add[i] - sub[i];
+        }
+    }
+
+  win->last_update[coarse_bin] = x;
+}
+
+static inline gfloat
+window_histogram_get_median (WindowHistogram *win,
+                             const gint      *col_fine,
+                             gint             x,
+                             gint             size,
+                             gint             count,
+                             gdouble          percentile)
+{
+  gint sum = 0;
+  gint i;
+
+  if (count == 0)
+    return 0.0f;
+
+  count = (gint) ceil (count * percentile);
+  count = MAX (count, 1);
+
+  for (i = 0; i < N_COARSE_BINS - 1; i++)
+    {
+      if (sum + win->coarse[i] >= count)
+        break;
+
+      sum += win->coarse[i];
+    }
+
+  window_histogram_update_fine (win, col_fine, i, x, size);
+
+  i *= N_FINE_BINS;
+
+  while ((sum += win->fine[i]) < count)
+    i++;
+
+  return default_bin_values[i];
+}
+
+static gboolean
+process_constant_time (GeglOperation       *operation,
+                       GeglBuffer          *input,
+                       GeglBuffer          *output,
+                       const GeglRectangle *roi,
+                       gint                 radius,
+                       gdouble              percentile,
+                       gdouble              alpha_percentile)
+{
+  const Babl      *format             = gegl_operation_get_format (operation, "input");
+  gint             n_components       = babl_format_get_n_components (format);
+  gint             n_color_components = n_components;
+  gboolean         has_alpha          = babl_format_has_alpha (format);
+  gint             size               = 2 * radius + 1;
+
+  gint32          *src_buf;
+  gfloat          *dst_buf;
+  GeglRectangle    src_rect;
+  gint             src_stride;
+  gint            *col_fine;
+  gint            *col_coarse;
+  WindowHistogram *hists;
+  gfloat          *dst;
+  gint             x, y;
+  gint             c;
+  gint             i;
+
+  /* the column histograms take DEFAULT_N_BINS bins per column; process wide
+   * areas in strips.
+   */
+  if (roi->width > CONSTANT_TIME_MAX_CHUNK_WIDTH)
+    {
+      gint n_x = (roi->width + CONSTANT_TIME_MAX_CHUNK_WIDTH - 1) /
+                 CONSTANT_TIME_MAX_CHUNK_WIDTH;
+
+      for (x = 0; x < n_x; x++)
+        {
+          GeglRectangle chunk;
+
+          chunk.x      = roi->x + roi->width * x       / n_x;
+          chunk.y      = roi->y;
+          chunk.width  = roi->x + roi->width * (x + 1) / n_x - chunk.x;
+          chunk.height = roi->height;
+
+          if (! process_constant_time (operation, input, output, &chunk,
+                                       radius, percentile, alpha_percentile))
+            {
+              return FALSE;
+            }
+        }
+
+      return TRUE;
+    }
+
+  if (has_alpha)
+    n_color_components--;
+
+  g_return_val_if_fail (n_color_components == 1 || n_color_components == 3, FALSE);
+
+  src_rect   = gegl_operation_get_required_for_output (operation, "input", roi);
+  src_stride = src_rect.width * n_components;
+  src_buf    = g_new (gint32, src_rect.width * src_rect.height * n_components);
+  dst_buf    = g_new (gfloat, roi->width * roi->height * n_components);
+
+  gegl_buffer_get (input, &src_rect, 1.0, format, src_buf,
+                   GEGL_AUTO_ROWSTRIDE, get_abyss_policy (operation, "input"));
+  quantize_values (src_buf, src_rect.width * src_rect.height, n_components);
+
+  col_fine   = g_new0 (gint, n_components * src_rect.width * DEFAULT_N_BINS);
+  col_coarse = g_new0 (gint, n_components * src_rect.width * N_COARSE_BINS);
+  hists      = g_new (WindowHistogram, n_components);
+
+  /* the column histograms hold the rows of the window of the current row */
+
+  for (y = 0; y < size - 1; y++)
+    {
+      column_histograms_modify_row (col_fine, col_coarse,
+                                    src_buf + y * src_stride, src_rect.width,
+                                    n_components, n_color_components, +1);
+    }
+
+  dst = dst_buf;
+
+  for (y = 0; y < roi->height; y++)
+    {
+      if (y > 0)
+        {
+          column_histograms_modify_row (col_fine, col_coarse,
+                                        src_buf + (y - 1) * src_stride,
+                                        src_rect.width,
+                                        n_components, n_color_components, -1);
+        }
+
+      column_histograms_modify_row (col_fine, col_coarse,
+                                    src_buf + (y + size - 1) * src_stride,
+                                    src_rect.width,
+                                    n_components, n_color_components, +1);
+
+      /* initialize the coarse bins of the first window of the row; the fine
+       * bins are computed when first needed.
+       */
+      for (c = 0; c < n_components; c++)
+        {
+          WindowHistogram *win    = &hists[c];
+          const gint      *coarse = col_coarse + c * src_rect.width * N_COARSE_BINS;
+
+          for (i = 0; i < N_COARSE_BINS; i++)
+            {
+              win->coarse[i]      = 0;
+              win->last_update[i] = -size;
+            }
+
+          for (x = 0; x < size; x++, coarse += N_COARSE_BINS)
+            {
+              for (i = 0; i < N_COARSE_BINS; i++)
+                win->coarse[i] += coarse[i];
+            }
+        }
+
+      for (x = 0; x < roi->width; x++, dst += n_components)
+        {
+          gint count = 0;
+
+          for (c = 0; c < n_components; c++)
+            {
+              WindowHistogram *win      = &hists[c];
+              const gint      *col_base = col_fine + c * src_rect.width * DEFAULT_N_BINS;
+
+              if (x > 0)
+                {
+                  const gint *coarse = col_coarse + c * src_rect.width * N_COARSE_BINS;
+                  const gint *add    = coarse + (x + size - 1) * N_COARSE_BINS;
+                  const gint *sub    = coarse + (x - 1)        * N_COARSE_BINS;
+
+                  for (i = 0; i < N_COARSE_BINS; i++)
+                    win->coarse[i] += add[i] - sub[i];
+                }
+
+              if (c < n_color_components)
+                {
+                  /* the color bins are weighted by alpha */
+                  if (c == 0)
+                    {
+                      for (i = 0; i < N_COARSE_BINS; i++)
+                        count += win->coarse[i];
+                    }
+
+                  dst[c] = window_histogram_get_median (win, col_base, x, size,
+                                                        count, percentile);
+                }
+              else
+                {
+                  dst[c] = window_histogram_get_median (win, col_base, x, size,
+                                                        size * size,
+                                                        alpha_percentile);
+                }
+            }
+        }
+    }
+
+  gegl_buffer_set (output, roi, 0, format, dst_buf, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (hists);
+  g_free (col_coarse);
+  g_free (col_fine);
+  g_free (dst_buf);
+  g_free (src_buf);
+
+  return TRUE;
+}
+
+static GeglSplitStrategy
+get_split_strategy (GeglOperation        *operation,
+                    GeglOperationContext *context,
+                    const gchar          *output_prop,
+                    const GeglRectangle  *result,
+                    gint                  level)
+{
+  GeglProperties *o    = GEGL_PROPERTIES (operation);
+  UserData       *data = o->user_data;
+
+  /* the constant-time algorithm slides its window along rows, and has a
+   * per-row cost proportional to the radius, so give each thread full-width
+   * bands.
+   */
+  if (data->constant_time)
+    return GEGL_SPLIT_STRATEGY_HORIZONTAL;
+
+  return GEGL_SPLIT_STRATEGY_AUTO;
+}
+
 static gboolean
 process (GeglOperation       *operation,
          GeglBuffer          *input,
@@ -804,6 +1150,12 @@ process (GeglOperation       *operation,
       alpha_percentile = 1.0 - alpha_percentile;
     }
 
+  if (data->constant_time)
+    {
+      return process_constant_time (operation, input, output, roi, radius,
+                                    percentile, alpha_percentile);
+    }
+
   if (! data->quantize &&
       (roi->width > MAX_CHUNK_WIDTH || roi->height > MAX_CHUNK_HEIGHT))
     {
@@ -994,6 +1346,7 @@ gegl_op_class_init (GeglOpClass *klass)
 
   object_class->finalize            = finalize;
   filter_class->process             = process;
+  filter_class->get_split_strategy  = get_split_strategy;
   operation_class->prepare          = prepare;
   operation_class->get_bounding_box = get_bounding_box;
   area_class->get_abyss_policy      = get_abyss_policy;
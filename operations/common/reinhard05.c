@@ -146,6 +146,9 @@ reinhard05_process (GeglOperation       *operation,
           channel [RGB],
           normalise;
 
+  gdouble lum_min, lum_max, lum_mean,
+          pix_mean[4];
+
   gint    i, c;
 
   g_return_val_if_fail (operation, FALSE);
@@ -170,34 +173,46 @@ reinhard05_process (GeglOperation       *operation,
   gegl_buffer_get (input, result, 1.0, babl_format_with_space (OUTPUT_FORMAT, space),
                    pix, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-  /* Collect the image stats, averages, etc */
-  reinhard05_stats_start (&world_lin);
-  reinhard05_stats_start (&world_log);
-  reinhard05_stats_start (&normalise);
-  for (i = 0; i < RGB; ++i)
+  /* Collect the image stats, averages, etc.  The linear stats are reduced
+   * in parallel, and cached on the input, so that adjusting the parameters
+   * doesn't reduce the input again.  They're taken from the full resolution
+   * input, like the rest of the data.
+   */
+  if (! gegl_buffer_get_statistics (input, result,
+                                    babl_format_with_space ("Y float", space),
+                                    0, &lum_min, &lum_max, &lum_mean) ||
+      ! gegl_buffer_get_statistics (input, result,
+                                    babl_format_with_space (OUTPUT_FORMAT, space),
+                                    0, NULL, NULL, pix_mean))
     {
-      reinhard05_stats_start (channel + i);
+      g_free (pix);
+      g_free (lum);
+
+      return FALSE;
     }
 
+  world_lin.min   = lum_min;
+  world_lin.max   = lum_max;
+  world_lin.avg   = lum_mean;
+  world_lin.range = lum_max - lum_min;
+  world_lin.num   = result->width * result->height;
+
+  for (c = 0; c < RGB; ++c)
+    {
+      channel[c].avg = pix_mean[c];
+    }
+
+  reinhard05_stats_start (&world_log);
+  reinhard05_stats_start (&normalise);
+
   for (i = 0; i < result->width * result->height; ++i)
     {
-      reinhard05_stats_update (&world_lin,                 lum[i] );
       reinhard05_stats_update (&world_log, logf (2.3e-5f + lum[i]));
-
-      for (c = 0; c < RGB; ++c)
-        {
-          reinhard05_stats_update (channel + c, pix[i * pix_stride + c]);
-        }
     }
 
   g_return_val_if_fail (world_lin.min >= 0.0, FALSE);
 
-  reinhard05_stats_finish (&world_lin);
   reinhard05_stats_finish (&world_log);
-  for (i = 0; i < RGB; ++i)
-    {
-      reinhard05_stats_finish (channel + i);
-    }
 
   /* Calculate key parameters */
   key       = (logf (world_lin.max) -                 world_log.avg) /
@@ -177,6 +177,45 @@ gegl_save_process (GeglOperation        *operation,
                                  level);
 }
 
+/* streaming is forwarded to the actual saver, when it supports it */
+static gboolean
+gegl_save_stream_begin (GeglOperation       *operation,
+                        GeglBuffer          *input,
+                        const GeglRectangle *roi,
+                        gint                 level,
+                        gint                *band_height)
+{
+  GeglOp        *self  = GEGL_OP (operation);
+  GeglOperation *saver = gegl_node_get_gegl_operation (self->save);
+
+  if (! GEGL_IS_OPERATION_SINK (saver))
+    return FALSE;
+
+  return gegl_operation_sink_stream_begin (saver, input, roi, level, band_height);
+}
+
+static gboolean
+gegl_save_stream_band (GeglOperation       *operation,
+                       GeglBuffer          *input,
+                       const GeglRectangle *band,
+                       gint                 level)
+{
+  GeglOp *self = GEGL_OP (operation);
+
+  return gegl_operation_sink_stream_band (gegl_node_get_gegl_operation (self->save),
+                                          input, band, level);
+}
+
+static gboolean
+gegl_save_stream_end (GeglOperation *operation,
+                      gboolean       success)
+{
+  GeglOp *self = GEGL_OP (operation);
+
+  return gegl_operation_sink_stream_end (gegl_node_get_gegl_operation (self->save),
+                                         success);
+}
+
 static void
 gegl_save_dispose (GObject *object)
 {
@@ -201,7 +240,10 @@ gegl_op_class_init (GeglOpClass *klass)
   operation_class->attach  = gegl_save_attach;
   operation_class->process = gegl_save_process;
 
-  sink_class->needs_full = TRUE;
+  sink_class->needs_full   = TRUE;
+  sink_class->stream_begin = gegl_save_stream_begin;
+  sink_class->stream_band  = gegl_save_stream_band;
+  sink_class->stream_end   = gegl_save_stream_end;
 
   gegl_operation_class_set_keys (operation_class,
     "name"       , "gegl:save",
@@ -50,14 +50,54 @@ property_int (iterations, _("Iterations"), 1)
 
 #define POW2(x) ((x)*(x))
 
+/* the labels are assigned in parallel, over bands of rows of this height;
+ * each band accumulates its own cluster sums, which are then added up in
+ * band order, so that the result doesn't depend on the number of threads.
+ */
+#define BAND_HEIGHT 64
+
 typedef struct
 {
   gfloat        center[5];
-  gfloat        sum[5];
+  gdouble       sum[5];
   glong         n_pixels;
   GeglRectangle search_window;
 } Cluster;
 
+/* the sums of a cluster over a single band */
+typedef struct
+{
+  guint         index;
+  gdouble       sum[5];
+  glong         n_pixels;
+} BandCluster;
+
+typedef struct
+{
+  BandCluster  *clusters;
+  guint         n_clusters;
+} Band;
+
+typedef struct
+{
+  GeglBuffer          *labels;
+  GeglBuffer          *input;
+  GArray              *clusters;
+  gint                 cluster_size;
+  gint                 compactness;
+  const Babl          *format;
+  const GeglRectangle *extent;
+  Band                *bands;
+} AssignData;
+
+typedef struct
+{
+  GeglBuffer          *output;
+  GeglBuffer          *labels;
+  GArray              *clusters;
+  const Babl          *format;
+} OutputData;
+
 
 static inline gfloat
 get_distance (gfloat *c1,
@@ -158,115 +198,226 @@ init_clusters (GeglBuffer     *input,
 }
 
 static void
-assign_labels (GeglBuffer *labels,
-               GeglBuffer *input,
-               GArray     *clusters,
-               gint        cluster_size,
-               gint        compactness,
-               const Babl *format)
+get_band (const GeglRectangle *extent,
+          gint                 band,
+          GeglRectangle       *rect)
 {
-  GeglBufferIterator *iter;
-  GArray  *clusters_index;
+  rect->x      = extent->x;
+  rect->y      = extent->y + band * BAND_HEIGHT;
+  rect->width  = extent->width;
+  rect->height = MIN (BAND_HEIGHT, extent->y + extent->height - rect->y);
+}
 
-  clusters_index = g_array_sized_new (FALSE, FALSE, sizeof (guint), 9);
+static void
+assign_labels_bands (gsize       offset,
+                     gsize       size,
+                     AssignData *data)
+{
+  GArray *clusters = data->clusters;
+  GArray *clusters_index;
+  gsize   b;
 
-  iter = gegl_buffer_iterator_new (input, NULL, 0, format,
-                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 2);
+  clusters_index = g_array_sized_new (FALSE, FALSE, sizeof (guint), 9);
 
-  gegl_buffer_iterator_add (iter, labels, NULL, 0,
-                            babl_format_n (babl_type ("u32"), 1),
-                            GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+  for (b = offset; b < offset + size; b++)
+    {
+      Band               *band = &data->bands[b];
+      GeglBufferIterator *iter;
+      GeglRectangle       band_rect;
+      guint               i;
 
-  while (gegl_buffer_iterator_next (iter))
-   {
-      GeglRectangle *roi = &iter->items[0].roi;
-      gfloat  *pixel = iter->items[0].data;
-      guint32 *label = iter->items[1].data;
-      glong    n_pixels = iter->length;
-      gint     x, y;
-      guint    i;
+      get_band (data->extent, b, &band_rect);
 
-      x = roi->x;
-      y = roi->y;
+      /* collect the clusters whose search_window intersect with the band */
 
-      /* construct an array of clusters index for which search_window
-       * intersect with the current roi
-       */
+      band->n_clusters = 0;
 
       for (i = 0; i < clusters->len ; i++)
         {
           Cluster *c = &g_array_index (clusters, Cluster, i);
 
-          if (gegl_rectangle_intersect (NULL, &c->search_window, roi))
-            g_array_append_val (clusters_index, i);
+          if (gegl_rectangle_intersect (NULL, &c->search_window, &band_rect))
+            band->n_clusters++;
         }
 
-      if (!clusters_index->len)
+      band->clusters   = g_new (BandCluster, band->n_clusters);
+      band->n_clusters = 0;
+
+      for (i = 0; i < clusters->len ; i++)
         {
-          g_printerr ("no clusters for roi %d,%d,%d,%d\n", roi->x, roi->y, roi->width, roi->height);
-          continue;
+          Cluster *c = &g_array_index (clusters, Cluster, i);
+
+          if (gegl_rectangle_intersect (NULL, &c->search_window, &band_rect))
+            {
+              BandCluster *bc = &band->clusters[band->n_clusters++];
+
+              bc->index    = i;
+              bc->sum[0]   = 0.0;
+              bc->sum[1]   = 0.0;
+              bc->sum[2]   = 0.0;
+              bc->sum[3]   = 0.0;
+              bc->sum[4]   = 0.0;
+              bc->n_pixels = 0;
+            }
         }
 
-      while (n_pixels--)
-        {
-          Cluster *c;
-          gfloat feature[5] = {pixel[0], pixel[1], pixel[2],
-                               (gfloat) x, (gfloat) y};
+      iter = gegl_buffer_iterator_new (data->input, &band_rect, 0,
+                                       data->format,
+                                       GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 2);
+
+      gegl_buffer_iterator_add (iter, data->labels, &band_rect, 0,
+                                babl_format_n (babl_type ("u32"), 1),
+                                GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
-          /* find the nearest cluster */
+      while (gegl_buffer_iterator_next (iter))
+       {
+          GeglRectangle *roi = &iter->items[0].roi;
+          gfloat  *pixel = iter->items[0].data;
+          guint32 *label = iter->items[1].data;
+          glong    n_pixels = iter->length;
+          gint     x, y;
 
-          gfloat  min_distance = G_MAXFLOAT;
-          guint   best_cluster = 0;
+          x = roi->x;
+          y = roi->y;
 
-          for (i = 0; i < clusters_index->len ; i++)
+          /* construct an array of the band's clusters for which
+           * search_window intersect with the current roi
+           */
+
+          for (i = 0; i < band->n_clusters ; i++)
             {
-              gfloat distance;
-              guint index = g_array_index (clusters_index, guint, i);
-              Cluster *tmp = &g_array_index (clusters, Cluster, index);
+              Cluster *c = &g_array_index (clusters, Cluster,
+                                           band->clusters[i].index);
 
-              if (x < tmp->search_window.x ||
-                  y < tmp->search_window.y ||
-                  x >= tmp->search_window.x + tmp->search_window.width ||
-                  y >= tmp->search_window.y + tmp->search_window.height)
-                continue;
+              if (gegl_rectangle_intersect (NULL, &c->search_window, roi))
+                g_array_append_val (clusters_index, i);
+            }
 
-              distance = get_distance (tmp->center, feature,
-                                       cluster_size, compactness);
+          if (!clusters_index->len)
+            {
+              g_printerr ("no clusters for roi %d,%d,%d,%d\n", roi->x, roi->y, roi->width, roi->height);
+              continue;
+            }
+
+          while (n_pixels--)
+            {
+              BandCluster *bc;
+              gfloat feature[5] = {pixel[0], pixel[1], pixel[2],
+                                   (gfloat) x, (gfloat) y};
+
+              /* find the nearest cluster */
 
-              if (distance < min_distance)
+              gfloat  min_distance = G_MAXFLOAT;
+              guint   best_cluster = g_array_index (clusters_index, guint, 0);
+
+              for (i = 0; i < clusters_index->len ; i++)
                 {
-                  min_distance = distance;
-                  best_cluster = index;
+                  gfloat distance;
+                  guint index = g_array_index (clusters_index, guint, i);
+                  Cluster *tmp = &g_array_index (clusters, Cluster,
+                                                 band->clusters[index].index);
+
+                  if (x < tmp->search_window.x ||
+                      y < tmp->search_window.y ||
+                      x >= tmp->search_window.x + tmp->search_window.width ||
+                      y >= tmp->search_window.y + tmp->search_window.height)
+                    continue;
+
+                  distance = get_distance (tmp->center, feature,
+                                           data->cluster_size,
+                                           data->compactness);
+
+                  if (distance < min_distance)
+                    {
+                      min_distance = distance;
+                      best_cluster = index;
+                    }
                 }
-            }
 
-          c = &g_array_index (clusters, Cluster, best_cluster);
-          c->sum[0] += pixel[0];
-          c->sum[1] += pixel[1];
-          c->sum[2] += pixel[2];
-          c->sum[3] += (gfloat) x;
-          c->sum[4] += (gfloat) y;
-          c->n_pixels++;
+              bc = &band->clusters[best_cluster];
+              bc->sum[0] += pixel[0];
+              bc->sum[1] += pixel[1];
+              bc->sum[2] += pixel[2];
+              bc->sum[3] += x;
+              bc->sum[4] += y;
+              bc->n_pixels++;
 
-          *label = best_cluster;
+              *label = bc->index;
 
-          pixel += 3;
-          label++;
+              pixel += 3;
+              label++;
 
-          x++;
-          if (x >= roi->x + roi->width)
-            {
-              y++;
-              x = roi->x;
+              x++;
+              if (x >= roi->x + roi->width)
+                {
+                  y++;
+                  x = roi->x;
+                }
             }
-        }
 
-      clusters_index->len = 0;
-   }
+          clusters_index->len = 0;
+       }
+    }
 
   g_array_free (clusters_index, TRUE);
 }
 
+static void
+assign_labels (GeglBuffer *labels,
+               GeglBuffer *input,
+               GArray     *clusters,
+               gint        cluster_size,
+               gint        compactness,
+               const Babl *format,
+               gdouble     pixels_per_thread)
+{
+  AssignData  data;
+  gint        n_bands;
+  gint        b;
+  guint       i;
+
+  data.labels       = labels;
+  data.input        = input;
+  data.clusters     = clusters;
+  data.cluster_size = cluster_size;
+  data.compactness  = compactness;
+  data.format       = format;
+  data.extent       = gegl_buffer_get_extent (input);
+
+  n_bands    = (data.extent->height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+  data.bands = g_new (Band, n_bands);
+
+  gegl_parallel_distribute_range (
+    n_bands,
+    MAX (pixels_per_thread / ((gdouble) data.extent->width * BAND_HEIGHT), 1.0),
+    (GeglParallelDistributeRangeFunc) assign_labels_bands,
+    &data);
+
+  /* add up the clusters sums */
+
+  for (b = 0; b < n_bands; b++)
+    {
+      Band *band = &data.bands[b];
+
+      for (i = 0; i < band->n_clusters; i++)
+        {
+          BandCluster *bc = &band->clusters[i];
+          Cluster     *c  = &g_array_index (clusters, Cluster, bc->index);
+
+          c->sum[0] += bc->sum[0];
+          c->sum[1] += bc->sum[1];
+          c->sum[2] += bc->sum[2];
+          c->sum[3] += bc->sum[3];
+          c->sum[4] += bc->sum[4];
+          c->n_pixels += bc->n_pixels;
+        }
+
+      g_free (band->clusters);
+    }
+
+  g_free (data.bands);
+}
+
 static gboolean
 update_clusters (GArray *clusters,
                  gint    cluster_size)
@@ -283,11 +434,11 @@ update_clusters (GArray *clusters,
       c->center[3] = c->sum[3] / c->n_pixels;
       c->center[4] = c->sum[4] / c->n_pixels;
 
-      c->sum[0] = 0.0f;
-      c->sum[1] = 0.0f;
-      c->sum[2] = 0.0f;
-      c->sum[3] = 0.0f;
-      c->sum[4] = 0.0f;
+      c->sum[0] = 0.0;
+      c->sum[1] = 0.0;
+      c->sum[2] = 0.0;
+      c->sum[3] = 0.0;
+      c->sum[4] = 0.0;
 
       c->n_pixels = 0;
 
@@ -299,18 +450,16 @@ update_clusters (GArray *clusters,
 }
 
 static void
-set_output (GeglBuffer *output,
-            GeglBuffer *labels,
-            GArray     *clusters,
-            const Babl *format)
+set_output_area (const GeglRectangle *area,
+                 OutputData          *data)
 {
   GeglBufferIterator *iter;
 
-  iter = gegl_buffer_iterator_new (output, NULL, 0,
-                                   format,
+  iter = gegl_buffer_iterator_new (data->output, area, 0,
+                                   data->format,
                                    GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE, 2);
 
-  gegl_buffer_iterator_add (iter, labels, NULL, 0,
+  gegl_buffer_iterator_add (iter, data->labels, area, 0,
                             babl_format_n (babl_type ("u32"), 1),
                             GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
 
@@ -322,7 +471,7 @@ set_output (GeglBuffer *output,
 
       while (n_pixels--)
         {
-          Cluster *c = &g_array_index (clusters, Cluster, *label);
+          Cluster *c = &g_array_index (data->clusters, Cluster, *label);
 
           pixel[0] = c->center[0];
           pixel[1] = c->center[1];
@@ -334,6 +483,27 @@ set_output (GeglBuffer *output,
     }
 }
 
+static void
+set_output (GeglBuffer *output,
+            GeglBuffer *labels,
+            GArray     *clusters,
+            const Babl *format,
+            gdouble     pixels_per_thread)
+{
+  OutputData data;
+
+  data.output   = output;
+  data.labels   = labels;
+  data.clusters = clusters;
+  data.format   = format;
+
+  gegl_parallel_distribute_area (
+    gegl_buffer_get_extent (output), pixels_per_thread,
+    GEGL_SPLIT_STRATEGY_AUTO,
+    (GeglParallelDistributeAreaFunc) set_output_area,
+    &data);
+}
+
 static void
 prepare (GeglOperation *operation)
 {
@@ -380,6 +550,7 @@ process (GeglOperation       *operation,
   GeglProperties *o = GEGL_PROPERTIES (operation);
   const Babl *format = gegl_operation_get_format (operation, "output");
   const GeglRectangle *src_region = gegl_buffer_get_extent (input);
+  gdouble     pixels_per_thread = gegl_operation_get_pixels_per_thread (operation);
   GeglBuffer *labels;
   GArray     *clusters;
   gint        max_dim;
@@ -411,7 +582,8 @@ process (GeglOperation       *operation,
                      clusters,
                      cluster_size,
                      o->compactness,
-                     format);
+                     format,
+                     pixels_per_thread);
 
       update_clusters (clusters, cluster_size);
 
@@ -422,7 +594,7 @@ process (GeglOperation       *operation,
 
   /* apply clusters colors to output */
 
-  set_output (output, labels, clusters, format);
+  set_output (output, labels, clusters, format, pixels_per_thread);
 
   gegl_operation_progress (operation, 1.0, "");
 
@@ -40,61 +40,30 @@ typedef struct {
   gfloat vdiff;
 } AutostretchData;
 
+/* the statistics are computed in parallel, and cached on the input; when
+ * rendering at a reduced level of detail, they're estimated from the same
+ * level of the input.
+ */
 static void
-buffer_get_auto_stretch_data (GeglOperation       *operation,
-                              GeglBuffer          *buffer,
+buffer_get_auto_stretch_data (GeglBuffer          *buffer,
                               const GeglRectangle *result,
+                              gint                 level,
                               AutostretchData     *data,
                               const Babl          *space)
 {
-  gfloat smin =  G_MAXFLOAT;
-  gfloat smax = -G_MAXFLOAT;
-  gfloat vmin =  G_MAXFLOAT;
-  gfloat vmax = -G_MAXFLOAT;
-
-  GeglBufferIterator *gi;
-  gint                done_pixels = 0;
-
-  gegl_operation_progress (operation, 0.0, "");
-
-  gi = gegl_buffer_iterator_new (buffer, result, 0, babl_format_with_space ("HSVA float", space),
-                                 GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
-
-  while (gegl_buffer_iterator_next (gi))
-    {
-      gfloat *buf = gi->items[0].data;
-      gint    i;
-
-      for (i = 0; i < gi->length; i++)
-        {
-          gfloat sval = buf[1];
-          gfloat vval = buf[2];
+  gdouble min[4] = {0.0, 0.0, 0.0, 0.0};
+  gdouble max[4] = {0.0, 0.0, 0.0, 0.0};
 
-          smin = MIN (sval, smin);
-          smax = MAX (sval, smax);
-          vmin = MIN (vval, vmin);
-          vmax = MAX (vval, vmax);
-
-          buf += 4;
-        }
-
-      done_pixels += gi->length;
-
-      gegl_operation_progress (operation,
-                               (gdouble) 0.5 * done_pixels /
-                               (gdouble) (result->width * result->height),
-                               "");
-    }
+  gegl_buffer_get_statistics (buffer, result, babl_format_with_space ("HSVA float", space),
+                              level, min, max, NULL);
 
   if (data)
     {
-      data->slo   = smin;
-      data->sdiff = smax - smin;
-      data->vlo   = vmin;
-      data->vdiff = vmax - vmin;
+      data->slo   = min[1];
+      data->sdiff = max[1] - min[1];
+      data->vlo   = min[2];
+      data->vdiff = max[2] - min[2];
     }
-
-  gegl_operation_progress (operation, 0.5, "");
 }
 
 static void
@@ -159,7 +128,7 @@ process (GeglOperation       *operation,
   GeglBufferIterator *gi;
   gint                done_pixels = 0;
 
-  buffer_get_auto_stretch_data (operation, input, result, &data, space);
+  buffer_get_auto_stretch_data (input, result, level, &data, space);
   clean_autostretch_data (&data);
 
   gegl_operation_progress (operation, 0.5, "");
@@ -36,35 +36,29 @@ property_boolean (perceptual, _("Non-linear components"), FALSE)
 
 #include "gegl-op.h"
 
+/* the statistics are computed in parallel, and cached on the input, so that
+ * re-rendering with different properties doesn't reduce the input again.
+ * when rendering at a reduced level of detail, they're estimated from the
+ * same level of the input.
+ */
 static void
-buffer_get_min_max (GeglBuffer *buffer,
-                    const Babl *format,
-                    gfloat     *min,
-                    gfloat     *max)
+buffer_get_min_max (GeglBuffer          *buffer,
+                    const GeglRectangle *rect,
+                    const Babl          *format,
+                    gint                 level,
+                    gfloat              *min,
+                    gfloat              *max)
 {
-  GeglBufferIterator *gi;
-  gint c;
-  gi = gegl_buffer_iterator_new (buffer, NULL, 0, format,
-                                 GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
-  for (c = 0; c < 3; c++)
-    {
-      min[c] =  G_MAXFLOAT;
-      max[c] = -G_MAXFLOAT;
-    }
+  gdouble dmin[4] = {0.0, 0.0, 0.0, 0.0};
+  gdouble dmax[4] = {0.0, 0.0, 0.0, 0.0};
+  gint    c;
 
-  while (gegl_buffer_iterator_next (gi))
-    {
-      gfloat *buf = gi->items[0].data;
+  gegl_buffer_get_statistics (buffer, rect, format, level, dmin, dmax, NULL);
 
-      gint i;
-      for (i = 0; i < gi->length; i++)
-        {
-          for (c = 0; c < 3; c++)
-            {
-              min[c] = MIN (buf [i * 4 + c], min[c]);
-              max[c] = MAX (buf [i * 4 + c], max[c]);
-            }
-        }
+  for (c = 0; c < 3; c++)
+    {
+      min[c] = dmin[c];
+      max[c] = dmax[c];
     }
 }
 
@@ -480,7 +474,10 @@ process (GeglOperation       *operation,
 
   o = GEGL_PROPERTIES (operation);
 
-  buffer_get_min_max (input, out_format, min, max);
+  buffer_get_min_max (input,
+                      gegl_operation_source_get_bounding_box (operation,
+                                                              "input"),
+                      out_format, level, min, max);
 
   if (o->keep_colors)
     reduce_min_max_global (min, max);
@@ -64,6 +64,12 @@ property_enum (fill, _("Superpixels color"),
 
 #define POW2(x) ((x)*(x))
 
+/* the averages are accumulated in parallel, over bands of rows of this
+ * height; the partial sums of each band are added up in band order, so
+ * that the result doesn't depend on the number of threads.
+ */
+#define BAND_HEIGHT 64
+
 typedef struct _Cell
 {
   gint          center_x;
@@ -82,6 +88,26 @@ typedef struct _CellsGrid
   gint   cells_per_column;
 } CellsGrid;
 
+typedef struct
+{
+  GeglBuffer          *buffer;
+  GeglBuffer          *labels;
+  CellsGrid           *grid;
+  const Babl          *format;
+  const GeglRectangle *extent;
+  gint32               regularization;
+
+  /* generate_labels: the position of the minimum of each cell */
+  GeglRectangle       *min_pixels;
+
+  /* get_average_colors: the range of labels found in each band, and their
+   * sums
+   */
+  guint32             *band_first;
+  guint32             *band_n_labels;
+  gdouble            **band_sums;
+} ThreadData;
+
 static void
 initiliaze_cellsgrid (CellsGrid           *grid,
                       const GeglRectangle *input_extent,
@@ -171,14 +197,15 @@ generate_gradient (GeglBuffer *input,
 }
 
 static void
-regularize_gradient  (GeglBuffer *gradient,
-                      gint32      regularization,
-                      CellsGrid  *grid)
+regularize_gradient_area (const GeglRectangle *area,
+                          ThreadData          *data)
 {
   GeglBufferIterator *iter;
+  CellsGrid          *grid = data->grid;
   gint x, y;
 
-  iter = gegl_buffer_iterator_new (gradient, NULL, 0, babl_format ("Y float"),
+  iter = gegl_buffer_iterator_new (data->buffer, area, 0,
+                                   babl_format ("Y float"),
                                    GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE, 1);
 
   while (gegl_buffer_iterator_next (iter))
@@ -199,38 +226,57 @@ regularize_gradient  (GeglBuffer *gradient,
                                      + POW2(y - cell->center_y))
                                 / (gdouble) grid->cell_size;
 
-           *pixel = *pixel + regularization * 2.0 * distance / (gdouble) grid->cell_size;
+           *pixel = *pixel + data->regularization * 2.0 * distance / (gdouble) grid->cell_size;
 
             pixel++;
           }
     }
 }
 
-static GeglBuffer *
-generate_labels (GeglBuffer *gradient,
-                 CellsGrid  *grid)
+static void
+regularize_gradient  (GeglBuffer *gradient,
+                      gint32      regularization,
+                      CellsGrid  *grid,
+                      gdouble     pixels_per_thread)
 {
-  GeglBuffer  *labels;
-  gfloat      *buff;
-  guint32      i;
-  guint32      label[2];
+  ThreadData data;
 
-  labels = gegl_buffer_new (gegl_buffer_get_extent (gradient),
-                            babl_format ("YA u32"));
+  data.buffer         = gradient;
+  data.grid           = grid;
+  data.regularization = regularization;
 
-  for (i = 0; i < grid->n_cells; i++)
+  gegl_parallel_distribute_area (
+    gegl_buffer_get_extent (gradient), pixels_per_thread,
+    GEGL_SPLIT_STRATEGY_AUTO,
+    (GeglParallelDistributeAreaFunc) regularize_gradient_area,
+    &data);
+}
+
+static void
+find_cells_minimum (gsize       offset,
+                    gsize       size,
+                    ThreadData *data)
+{
+  CellsGrid *grid = data->grid;
+  gsize      i;
+
+  for (i = offset; i < offset + size; i++)
     {
       Cell *cell   = grid->cells + i;
-      GeglRectangle min_pixel = {0, 0, 1, 1};
+      GeglRectangle *min_pixel = &data->min_pixels[i];
       gfloat min_value = G_MAXFLOAT;
+      gfloat  *buff;
       gfloat  *pixel;
       gint x = cell->area.x;
       gint y = cell->area.y;
       gint n_pixels = cell->area.width * cell->area.height;
 
+      gegl_rectangle_set (min_pixel, 0, 0, 1, 1);
+
       buff = g_new (gfloat, n_pixels);
 
-      gegl_buffer_get (gradient, &cell->area, 1.0, babl_format ("Y float"),
+      gegl_buffer_get (data->buffer, &cell->area, 1.0,
+                       babl_format ("Y float"),
                        buff, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
       pixel = buff;
@@ -240,8 +286,8 @@ generate_labels (GeglBuffer *gradient,
           if (*pixel < min_value)
             {
               min_value = *pixel;
-              min_pixel.x = x;
-              min_pixel.y = y;
+              min_pixel->x = x;
+              min_pixel->y = y;
             }
 
           pixel++;
@@ -254,18 +300,46 @@ generate_labels (GeglBuffer *gradient,
             }
         }
 
+      g_free (buff);
+    }
+}
+
+static GeglBuffer *
+generate_labels (GeglBuffer *gradient,
+                 CellsGrid  *grid,
+                 gdouble     pixels_per_thread)
+{
+  GeglBuffer  *labels;
+  ThreadData   data;
+  guint32      i;
+  guint32      label[2];
+
+  labels = gegl_buffer_new (gegl_buffer_get_extent (gradient),
+                            babl_format ("YA u32"));
+
+  data.buffer     = gradient;
+  data.grid       = grid;
+  data.min_pixels = g_new (GeglRectangle, grid->n_cells);
+
+  gegl_parallel_distribute_range (
+    grid->n_cells,
+    MAX (pixels_per_thread / POW2 (grid->cell_size), 1.0),
+    (GeglParallelDistributeRangeFunc) find_cells_minimum,
+    &data);
+
+  for (i = 0; i < grid->n_cells; i++)
+    {
       label[0] = i;
       label[1] = 1;
-      gegl_buffer_set (labels, &min_pixel, 0, babl_format ("YA u32"),
+      gegl_buffer_set (labels, &data.min_pixels[i], 0, babl_format ("YA u32"),
                        label, GEGL_AUTO_ROWSTRIDE);
-
-      g_free (buff);
     }
 
+  g_free (data.min_pixels);
+
   return labels;
 }
 
-
 static GeglBuffer *
 propagate_labels (GeglBuffer *labels,
                   GeglBuffer *gradient)
@@ -336,66 +410,171 @@ get_random_colors (CellsGrid  *grid)
   gegl_random_free (gr);
 }
 
+static void
+get_band (const GeglRectangle *extent,
+          gint                 band,
+          GeglRectangle       *rect)
+{
+  rect->x      = extent->x;
+  rect->y      = extent->y + band * BAND_HEIGHT;
+  rect->width  = extent->width;
+  rect->height = MIN (BAND_HEIGHT, extent->y + extent->height - rect->y);
+}
+
+static void
+sum_colors_bands (gsize       offset,
+                  gsize       size,
+                  ThreadData *data)
+{
+  gsize band;
+
+  for (band = offset; band < offset + size; band++)
+    {
+      GeglBufferIterator *iter;
+      GeglRectangle       rect;
+      guint32             first = G_MAXUINT32;
+      guint32             last  = 0;
+      gdouble            *sums;
+
+      get_band (data->extent, band, &rect);
+
+      /* find the range of labels in the band, which are mostly those of a
+       * few rows of cells.
+       */
+
+      iter = gegl_buffer_iterator_new (data->labels, &rect, 0,
+                                       babl_format ("YA u32"),
+                                       GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          guint32  *label    = iter->items[0].data;
+          glong     n_pixels = iter->length;
+
+          while (n_pixels--)
+            {
+              first = MIN (first, label[0]);
+              last  = MAX (last,  label[0]);
+
+              label += 2;
+            }
+        }
+
+      if (first > last)
+        {
+          data->band_first[band]    = 0;
+          data->band_n_labels[band] = 0;
+          data->band_sums[band]     = NULL;
+
+          continue;
+        }
+
+      sums = g_new0 (gdouble, 4 * (last - first + 1));
+
+      iter = gegl_buffer_iterator_new (data->labels, &rect, 0,
+                                       babl_format ("YA u32"),
+                                       GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 2);
+
+      gegl_buffer_iterator_add (iter, data->buffer, &rect, 0, data->format,
+                                GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          guint32  *label    = iter->items[0].data;
+          gfloat   *pixel    = iter->items[1].data;
+          glong     n_pixels = iter->length;
+
+          while (n_pixels--)
+            {
+              gdouble *sum = sums + 4 * (label[0] - first);
+
+              sum[0] += pixel[0];
+              sum[1] += pixel[1];
+              sum[2] += pixel[2];
+
+              sum[3]++;
+
+              pixel += 3;
+              label += 2;
+            }
+        }
+
+      data->band_first[band]    = first;
+      data->band_n_labels[band] = last - first + 1;
+      data->band_sums[band]     = sums;
+    }
+}
+
 static void
 get_average_colors (GeglBuffer *input,
                     GeglBuffer *labels,
                     CellsGrid  *grid,
-                    const Babl *space)
+                    const Babl *space,
+                    gdouble     pixels_per_thread)
 {
-  GeglBufferIterator *iter;
-  gint                i;
+  ThreadData  data;
+  gdouble    *sums;
+  gint        n_bands;
+  gint        band;
+  gint        i;
 
-  iter = gegl_buffer_iterator_new (labels, gegl_buffer_get_extent (labels),
-                                   0, babl_format ("YA u32"),
-                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 2);
+  data.buffer  = input;
+  data.labels  = labels;
+  data.format  = babl_format_with_space ("R'G'B' float", space);
+  data.extent  = gegl_buffer_get_extent (labels);
 
-  gegl_buffer_iterator_add (iter, input, gegl_buffer_get_extent (labels), 0,
-                            babl_format_with_space ("R'G'B' float", space),
-                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+  n_bands = (data.extent->height + BAND_HEIGHT - 1) / BAND_HEIGHT;
 
-  while (gegl_buffer_iterator_next (iter))
-    {
-      guint32  *label    = iter->items[0].data;
-      gfloat   *pixel    = iter->items[1].data;
-      glong     n_pixels = iter->length;
+  data.band_first    = g_new (guint32,   n_bands);
+  data.band_n_labels = g_new (guint32,   n_bands);
+  data.band_sums     = g_new (gdouble *, n_bands);
 
-      while (n_pixels--)
-        {
-          Cell *cell = grid->cells + label[0];
+  gegl_parallel_distribute_range (
+    n_bands,
+    MAX (pixels_per_thread / ((gdouble) data.extent->width * BAND_HEIGHT), 1.0),
+    (GeglParallelDistributeRangeFunc) sum_colors_bands,
+    &data);
 
-          cell->color[0] += pixel[0];
-          cell->color[1] += pixel[1];
-          cell->color[2] += pixel[2];
+  sums = g_new0 (gdouble, 4 * grid->n_cells);
 
-          cell->n_pixels++;
+  for (band = 0; band < n_bands; band++)
+    {
+      gdouble *band_sum = data.band_sums[band];
+      gdouble *sum      = sums + 4 * data.band_first[band];
 
-          pixel += 3;
-          label += 2;
-        }
+      for (i = 0; i < 4 * data.band_n_labels[band]; i++)
+        sum[i] += band_sum[i];
+
+      g_free (band_sum);
     }
 
   for (i = 0; i < grid->n_cells; i++)
     {
       Cell *cell = grid->cells + i;
-      cell->color[0] /= cell->n_pixels;
-      cell->color[1] /= cell->n_pixels;
-      cell->color[2] /= cell->n_pixels;
+
+      cell->n_pixels = sums[4 * i + 3];
+      cell->color[0] = sums[4 * i + 0] / cell->n_pixels;
+      cell->color[1] = sums[4 * i + 1] / cell->n_pixels;
+      cell->color[2] = sums[4 * i + 2] / cell->n_pixels;
     }
+
+  g_free (sums);
+  g_free (data.band_first);
+  g_free (data.band_n_labels);
+  g_free (data.band_sums);
 }
 
 static void
-fill_output (GeglBuffer *output,
-             GeglBuffer *labels,
-             CellsGrid  *grid,
-             const Babl *space)
+fill_output_area (const GeglRectangle *area,
+                  ThreadData          *data)
 {
   GeglBufferIterator *iter;
 
-  iter = gegl_buffer_iterator_new (labels, NULL, 0, babl_format ("YA u32"),
+  iter = gegl_buffer_iterator_new (data->labels, area, 0,
+                                   babl_format ("YA u32"),
                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 2);
 
-  gegl_buffer_iterator_add (iter, output, NULL, 0,
-                            babl_format_with_space ("R'G'B' float", space),
+  gegl_buffer_iterator_add (iter, data->buffer, area, 0, data->format,
                             GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
@@ -406,7 +585,7 @@ fill_output (GeglBuffer *output,
 
       while (n_pixels--)
         {
-          Cell *cell = grid->cells + label[0];
+          Cell *cell = data->grid->cells + label[0];
 
           pixel[0] = cell->color[0];
           pixel[1] = cell->color[1];
@@ -418,6 +597,27 @@ fill_output (GeglBuffer *output,
     }
 }
 
+static void
+fill_output (GeglBuffer *output,
+             GeglBuffer *labels,
+             CellsGrid  *grid,
+             const Babl *space,
+             gdouble     pixels_per_thread)
+{
+  ThreadData data;
+
+  data.buffer = output;
+  data.labels = labels;
+  data.grid   = grid;
+  data.format = babl_format_with_space ("R'G'B' float", space);
+
+  gegl_parallel_distribute_area (
+    gegl_buffer_get_extent (labels), pixels_per_thread,
+    GEGL_SPLIT_STRATEGY_AUTO,
+    (GeglParallelDistributeAreaFunc) fill_output_area,
+    &data);
+}
+
 static void
 prepare (GeglOperation *operation)
 {
@@ -464,6 +664,7 @@ process (GeglOperation       *operation,
 {
   GeglProperties  *o = GEGL_PROPERTIES (operation);
   const Babl *space = gegl_operation_get_format (operation, "output");
+  gdouble     pixels_per_thread = gegl_operation_get_pixels_per_thread (operation);
   GeglBuffer *gradient;
   GeglBuffer *initial_labels;
   GeglBuffer *propagated_labels;
@@ -472,19 +673,21 @@ process (GeglOperation       *operation,
   initiliaze_cellsgrid (&grid, gegl_buffer_get_extent (input), o->size);
 
   gradient       = generate_gradient (input, o->smoothness);
-  initial_labels = generate_labels (gradient, &grid);
+  initial_labels = generate_labels (gradient, &grid, pixels_per_thread);
 
   if (o->regularization)
-    regularize_gradient (gradient, o->regularization, &grid);
+    regularize_gradient (gradient, o->regularization, &grid,
+                         pixels_per_thread);
 
   propagated_labels = propagate_labels (initial_labels, gradient);
 
   if (o->fill == GEGL_WATERPIXELS_FILL_RANDOM)
     get_random_colors (&grid);
   else
-    get_average_colors (input, propagated_labels, &grid, space);
+    get_average_colors (input, propagated_labels, &grid, space,
+                        pixels_per_thread);
 
-  fill_output (output, propagated_labels, &grid, space);
+  fill_output (output, propagated_labels, &grid, space, pixels_per_thread);
 
   g_object_unref (gradient);
   g_object_unref (initial_labels);
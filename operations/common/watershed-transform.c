@@ -38,16 +38,22 @@ property_format (flag, _("flag"), NULL)
 
 #include "gegl-op.h"
 
-typedef struct _PixelCoords
+#include <string.h>
+
+/* pixels are referred to by their index in the extent, which limits the
+ * extent to 2^32 pixels.
+ */
+typedef struct _Queue
 {
-  gint x;
-  gint y;
-} PixelCoords;
+  guint32 *pixels;
+  gsize    head;
+  gsize    tail;
+  gsize    size;
+} Queue;
 
 typedef struct _HQ
 {
-  GQueue  *queues[256];
-  GQueue  *lowest_non_empty;
+  Queue    queues[256];
   gint     lowest_non_empty_level;
 } HQ;
 
@@ -57,16 +63,20 @@ HQ_init (HQ *hq)
   gint i;
 
   for (i = 0; i < 256; i++)
-    hq->queues[i] = g_queue_new ();
+    {
+      hq->queues[i].pixels = NULL;
+      hq->queues[i].head   = 0;
+      hq->queues[i].tail   = 0;
+      hq->queues[i].size   = 0;
+    }
 
-  hq->lowest_non_empty       = NULL;
-  hq->lowest_non_empty_level = 255;
+  hq->lowest_non_empty_level = 256;
 }
 
 static gboolean
 HQ_is_empty (HQ *hq)
 {
-  if (hq->lowest_non_empty == NULL)
+  if (hq->lowest_non_empty_level > 255)
     return TRUE;
 
   return FALSE;
@@ -75,44 +85,56 @@ HQ_is_empty (HQ *hq)
 static inline void
 HQ_push (HQ      *hq,
          guint8   level,
-         gpointer data)
+         guint32  pixel)
 {
-  g_queue_push_head (hq->queues[level], data);
+  Queue *queue = &hq->queues[level];
 
-  if (level <= hq->lowest_non_empty_level)
+  if (queue->tail == queue->size)
     {
-      hq->lowest_non_empty_level = level;
-      hq->lowest_non_empty       = hq->queues[level];
+      if (queue->head > queue->size / 2)
+        {
+          /* reuse the space of the popped pixels */
+          memmove (queue->pixels, queue->pixels + queue->head,
+                   (queue->tail - queue->head) * sizeof (guint32));
+
+          queue->tail -= queue->head;
+          queue->head  = 0;
+        }
+      else
+        {
+          queue->size   = MAX (2 * queue->size, 1024);
+          queue->pixels = g_renew (guint32, queue->pixels, queue->size);
+        }
     }
+
+  queue->pixels[queue->tail++] = pixel;
+
+  if (level < hq->lowest_non_empty_level)
+    hq->lowest_non_empty_level = level;
 }
 
-static inline gpointer
+static inline guint32
 HQ_pop (HQ *hq)
 {
-  gint i, level;
-  gpointer data = NULL;
+  gint    level = hq->lowest_non_empty_level;
+  Queue  *queue = &hq->queues[level];
+  guint32 pixel;
 
-  if (hq->lowest_non_empty != NULL)
+  pixel = queue->pixels[queue->head++];
+
+  if (queue->head == queue->tail)
     {
-      data = g_queue_pop_tail (hq->lowest_non_empty);
+      queue->head = 0;
+      queue->tail = 0;
 
-      if (g_queue_is_empty (hq->lowest_non_empty))
-        {
-          level = hq->lowest_non_empty_level;
-          hq->lowest_non_empty_level = 255;
-          hq->lowest_non_empty       = NULL;
+      for (level++; level < 256; level++)
+        if (hq->queues[level].head < hq->queues[level].tail)
+          break;
 
-          for (i = level + 1; i < 256; i++)
-            if (!g_queue_is_empty (hq->queues[i]))
-              {
-                hq->lowest_non_empty_level = i;
-                hq->lowest_non_empty       = hq->queues[i];
-                break;
-              }
-        }
+      hq->lowest_non_empty_level = level;
     }
 
-  return data;
+  return pixel;
 }
 
 static void
@@ -122,13 +144,84 @@ HQ_clean (HQ *hq)
 
   for (i = 0; i < 256; i++)
     {
-      if (!g_queue_is_empty (hq->queues[i]))
+      if (hq->queues[i].head < hq->queues[i].tail)
         g_printerr ("queue %u is not empty!\n", i);
-      else
-        g_queue_free (hq->queues[i]);
+
+      g_free (hq->queues[i].pixels);
     }
 }
 
+typedef struct
+{
+  guint8       *labels;
+  guint8       *seeds;
+  gint          width;
+  gint          height;
+  gint          bpp;
+  gint          bpc;
+  const guint8 *flag;
+  gint          flag_idx;
+} SeedData;
+
+static inline gboolean
+is_flagged (const guint8 *label,
+            const guint8 *flag,
+            gint          flag_idx,
+            gint          bpc)
+{
+  gint i;
+
+  for (i = 0; i < bpc; i++)
+    if (label[flag_idx * bpc + i] != (flag ? flag[i] : 0))
+      return FALSE;
+
+  return TRUE;
+}
+
+static void
+find_seeds (gsize     offset,
+            gsize     size,
+            SeedData *data)
+{
+  gint neighbors_coords[8][2] = {{-1, -1},{0, -1},{1, -1},
+                                 {-1, 0},         {1, 0},
+                                 {-1, 1}, {0, 1}, {1, 1}};
+  gint x, y;
+  gint j;
+
+  for (y = offset; y < (gint) (offset + size); y++)
+    for (x = 0; x < data->width; x++)
+      {
+        gsize index = (gsize) y * data->width + x;
+
+        data->seeds[index] = FALSE;
+
+        if (is_flagged (data->labels + index * data->bpp,
+                        data->flag, data->flag_idx, data->bpc))
+          continue;
+
+        for (j = 0; j < 8; j++)
+          {
+            gint nx = x + neighbors_coords[j][0];
+            gint ny = y + neighbors_coords[j][1];
+
+            if (nx < 0 || nx >= data->width || ny < 0 || ny >= data->height)
+              continue;
+
+            if (is_flagged (data->labels +
+                            ((gsize) ny * data->width + nx) * data->bpp,
+                            data->flag, data->flag_idx, data->bpc))
+              {
+                /* This pixel is not flagged and has at least one flagged
+                 * neighbour.
+                 */
+                data->seeds[index] = TRUE;
+                break;
+              }
+          }
+      }
+}
+
 static void
 attach (GeglOperation *self)
 {
@@ -219,13 +312,15 @@ process (GeglOperation       *operation,
          guint8              *flag,
          gint                 flag_idx)
 {
-  HQ      hq;
-  guint8  square3x3[72];
-  gint    i;
-  gint    j;
-  gint    x, y;
+  HQ        hq;
+  SeedData  data;
+  guint8   *labels;
+  guint8   *gradient = NULL;
+  gsize     n_pixels;
+  gsize     index;
+  gint      j;
+  gint      x, y;
   GeglBufferIterator  *iter;
-  GeglSampler         *gradient_sampler = NULL;
   const GeglRectangle *extent = gegl_buffer_get_extent (input);
 
   const Babl  *gradient_format = babl_format ("Y u8");
@@ -237,193 +332,114 @@ process (GeglOperation       *operation,
                                  {-1, 0},         {1, 0},
                                  {-1, 1}, {0, 1}, {1, 1}};
 
-  /* initialize hierarchical queues */
+  n_pixels = (gsize) extent->width * extent->height;
 
-  HQ_init (&hq);
+  if (n_pixels > G_MAXUINT32)
+    {
+      g_warning ("watershed-transform: the input is too large");
+      return FALSE;
+    }
+
+  /* the labels are propagated in memory, and written to the output once
+   * done.
+   */
+  labels = g_malloc (n_pixels * bpp);
+
+  gegl_buffer_get (input, extent, 1.0, labels_format, labels,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-  iter = gegl_buffer_iterator_new (input, extent, 0, labels_format,
-                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE,
-                                   aux ? 11 : 10);
-
-  gegl_buffer_iterator_add (iter, output, extent, 0, labels_format,
-                            GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
-
-  /* Add 8 neighbours. */
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (-1, -1, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (0, -1, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (1, -1, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (-1, 0, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (1, 0, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (-1, 1, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (0, 1, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (1, 1, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
   /* Priority map: lower is higher priority. */
   if (aux)
-    gegl_buffer_iterator_add (iter, aux, extent, 0, gradient_format,
-                              GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+    {
+      gradient = g_malloc (n_pixels);
+
+      gegl_buffer_get (aux, extent, 1.0, gradient_format, gradient,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+    }
+
+  /* find the labelled pixels with at least one unlabelled neighbour, in
+   * parallel.
+   */
+
+  data.labels   = labels;
+  data.seeds    = g_malloc (n_pixels);
+  data.width    = extent->width;
+  data.height   = extent->height;
+  data.bpp      = bpp;
+  data.bpc      = bpc;
+  data.flag     = flag;
+  data.flag_idx = flag_idx;
+
+  gegl_parallel_distribute_range (
+    extent->height,
+    gegl_operation_get_pixels_per_thread (operation) / extent->width,
+    (GeglParallelDistributeRangeFunc) find_seeds,
+    &data);
+
+  /* initialize hierarchical queues. the seeds are queued in the order the
+   * input's tiles are iterated, since pixels at the same level are flooded
+   * in the order they are queued.
+   */
+
+  HQ_init (&hq);
+
+  iter = gegl_buffer_iterator_new (input, extent, 0, labels_format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
 
   while (gegl_buffer_iterator_next (iter))
     {
-      GeglRectangle *roi      = &iter->items[0].roi;
-      guint8        *label    = iter->items[0].data;
-      guint8        *outlabel = iter->items[1].data;
-      guint8        *n[8]     =
-        {
-          iter->items[2].data,
-          iter->items[3].data,
-          iter->items[4].data,
-          iter->items[5].data,
-          iter->items[6].data,
-          iter->items[7].data,
-          iter->items[8].data,
-          iter->items[9].data
-        };
-      guint8        *prio    = aux ? iter->items[10].data : NULL;
+      GeglRectangle *roi = &iter->items[0].roi;
 
       for (y = roi->y; y < roi->y + roi->height; y++)
         for (x = roi->x; x < roi->x + roi->width; x++)
           {
-            gboolean flagged = TRUE;
-
-            for (i = 0; i < bpc; i++)
-              if (label[flag_idx * bpc + i] != (flag ? flag[i] : 0))
-                {
-                  flagged = FALSE;
-                  break;
-                }
-            if (! flagged)
-              {
-                for (j = 0; j < 8; j++)
-                  {
-                    if (x == 0 && (j == 0 || j == 3 || j == 5))
-                      continue;
-                    if (y == 0 && (j == 0 || j == 1 || j == 2))
-                      continue;
-                    if (x == extent->width - 1 && (j == 2 || j == 4 || j == 7))
-                      continue;
-                    if (y == extent->height - 1 && (j == 5 || j == 6 || j == 7))
-                      continue;
-
-                    flagged = TRUE;
-                    for (i = 0; i < bpc; i++)
-                      if (n[j][flag_idx * bpc + i] != (flag ? flag[i] : 0))
-                        {
-                          flagged = FALSE;
-                          break;
-                        }
-                    if (flagged)
-                      break;
-                  }
-                if (flagged)
-                  {
-                    /* This pixel is not flagged and has at least one flagged
-                     * neighbour.
-                     */
-                    PixelCoords *p = g_new (PixelCoords, 1);
-                    p->x = x;
-                    p->y = y;
-
-                    HQ_push (&hq, prio ? *prio : 0, p);
-                  }
-              }
+            index = (gsize) (y - extent->y) * extent->width + (x - extent->x);
 
-            for (i = 0; i < bpp; i++)
-              outlabel[i] = label[i];
-
-            if (prio)
-              prio++;
-            label    += bpp;
-            outlabel += bpp;
-            for (j = 0; j < 8; j++)
-              n[j] += bpp;
+            if (data.seeds[index])
+              HQ_push (&hq, gradient ? gradient[index] : 0, index);
           }
     }
 
-  if (aux)
-    gradient_sampler = gegl_buffer_sampler_new_at_level (aux,
-                                                         gradient_format,
-                                                         GEGL_SAMPLER_NEAREST,
-                                                         level);
+  g_free (data.seeds);
+
   while (!HQ_is_empty (&hq))
     {
-      PixelCoords *p = (PixelCoords *) HQ_pop (&hq);
-      guint8       label[bpp];
-
-      GeglRectangle square_rect = {p->x - 1, p->y - 1, 3, 3};
-
-      gegl_buffer_get (output, &square_rect, 1.0, labels_format,
-                       square3x3,
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-
-      for (i = 0; i < bpp; i++)
-        label[i] = square3x3[4 * bpp + i];
+      guint32       p     = HQ_pop (&hq);
+      gint          x     = p % extent->width;
+      gint          y     = p / extent->width;
+      const guint8 *label = labels + (gsize) p * bpp;
 
       /* compute neighbors coordinate */
       for (j = 0; j < 8; j++)
         {
           guint8   *neighbor_label;
-          gint      nx = p->x + neighbors_coords[j][0];
-          gint      ny = p->y + neighbors_coords[j][1];
-          gboolean  flagged = TRUE;
+          gint      nx = x + neighbors_coords[j][0];
+          gint      ny = y + neighbors_coords[j][1];
+          gsize     n;
 
           if (nx < 0 || nx >= extent->width || ny < 0 || ny >= extent->height)
             continue;
 
-          neighbor_label = square3x3 + ((neighbors_coords[j][0] + 1) + (neighbors_coords[j][1] + 1) * 3) * bpp;
+          n              = (gsize) ny * extent->width + nx;
+          neighbor_label = labels + n * bpp;
 
-          for (i = 0; i < bpc; i++)
-            if (neighbor_label[flag_idx * bpc + i] != (flag ? flag[i] : 0))
-              {
-                flagged = FALSE;
-                break;
-              }
-          if (flagged)
+          if (is_flagged (neighbor_label, flag, flag_idx, bpc))
             {
-              guint8 gradient_value = 0;
-              GeglRectangle n_rect = {nx, ny, 1, 1};
-              PixelCoords *n = g_new (PixelCoords, 1);
-              n->x = nx;
-              n->y = ny;
-
-              if (gradient_sampler)
-                gegl_sampler_get (gradient_sampler,
-                                  (gdouble) nx,
-                                  (gdouble) ny,
-                                  NULL, &gradient_value, GEGL_ABYSS_NONE);
-
-              HQ_push (&hq, gradient_value, n);
-
-              for (i = 0; i < bpp; i++)
-                neighbor_label[i] = label[i];
-
-              gegl_buffer_set (output, &n_rect,
-                               0, labels_format,
-                               neighbor_label, GEGL_AUTO_ROWSTRIDE);
+              HQ_push (&hq, gradient ? gradient[n] : 0, n);
+
+              memcpy (neighbor_label, label, bpp);
             }
         }
-
-      g_free (p);
     }
-  if (gradient_sampler)
-    g_object_unref (gradient_sampler);
+
+  gegl_buffer_set (output, extent, 0, labels_format, labels,
+                   GEGL_AUTO_ROWSTRIDE);
 
   HQ_clean (&hq);
+
+  g_free (labels);
+  g_free (gradient);
+
   return  TRUE;
 }
 
@@ -32,6 +32,7 @@ property_file_path (path, "File", "")
 #include "gegl-op.h"
 
 #include <ImfInputFile.h>
+#include <ImfTiledInputFile.h>
 #include <ImfChannelList.h>
 #include <ImfRgbaFile.h>
 #include <ImfRgbaYca.h>
@@ -68,17 +69,34 @@ static gfloat chroma_sampling[] =
   };
 
 
+/* the tile layout of tiled files */
+typedef struct
+{
+  gboolean tiled;
+  gint     tile_width;
+  gint     tile_height;
+} ExrTiling;
+
 static gboolean
 query_exr              (const gchar *path,
                         gint        *width,
                         gint        *height,
                         gint        *ff_ptr,
-                        gpointer    *format);
+                        gpointer    *format,
+                        ExrTiling   *tiling);
 
 static gboolean
-import_exr             (GeglBuffer  *gegl_buffer,
-                        const gchar *path,
-                        gint         format_flags);
+import_exr             (GeglBuffer          *gegl_buffer,
+                        const gchar         *path,
+                        gint                 format_flags,
+                        const GeglRectangle *rows);
+
+static gboolean
+import_exr_tiles       (GeglBuffer          *gegl_buffer,
+                        const gchar         *path,
+                        gint                 format_flags,
+                        const GeglRectangle *roi,
+                        gint                 level);
 
 static void
 convert_yca_to_rgba    (GeglBuffer *buf,
@@ -124,7 +142,8 @@ insert_channels        (FrameBuffer  &fb,
                         char         *base,
                         gint          width,
                         gint          format_flags,
-                        gint          bpp);
+                        gint          bpp,
+                        gsize         rowstride);
 
 
 
@@ -407,7 +426,8 @@ insert_channels (FrameBuffer  &fb,
                  char         *base,
                  gint          width,
                  gint          format_flags,
-                 gint          bpp)
+                 gint          bpp,
+                 gsize         rowstride)
 {
   gint alpha_offset;
   PixelType tp;
@@ -428,9 +448,9 @@ insert_channels (FrameBuffer  &fb,
 
   if (format_flags & COLOR_RGB)
     {
-      fb.insert ("R", Slice (tp, base,          bpp, 0, 1,1, 0.0));
-      fb.insert ("G", Slice (tp, base+bpc,      bpp, 0, 1,1, 0.0));
-      fb.insert ("B", Slice (tp, base+bpc*2,    bpp, 0, 1,1, 0.0));
+      fb.insert ("R", Slice (tp, base,          bpp, rowstride, 1,1, 0.0));
+      fb.insert ("G", Slice (tp, base+bpc,      bpp, rowstride, 1,1, 0.0));
+      fb.insert ("B", Slice (tp, base+bpc*2,    bpp, rowstride, 1,1, 0.0));
     }
   else if (format_flags & COLOR_C)
     {
@@ -440,19 +460,23 @@ insert_channels (FrameBuffer  &fb,
     }
   else if (format_flags & COLOR_Y)
     {
-      fb.insert ("Y",  Slice (tp, base, bpp, 0, 1,1, 0.5));
+      fb.insert ("Y",  Slice (tp, base, bpp, rowstride, 1,1, 0.5));
       alpha_offset = bpc;
     }
 
   if (format_flags & COLOR_ALPHA)
-    fb.insert ("A", Slice (tp, base+alpha_offset, bpp, 0, 1,1, 1.0));
+    fb.insert ("A", Slice (tp, base+alpha_offset, bpp, rowstride, 1,1, 1.0));
 }
 
 
+/* reads the full-width rows covered by rows, which needs to cover the
+ * whole image for chroma subsampled files.
+ */
 static gboolean
-import_exr (GeglBuffer  *gegl_buffer,
-            const gchar *path,
-            gint         format_flags)
+import_exr (GeglBuffer          *gegl_buffer,
+            const gchar         *path,
+            gint                 format_flags,
+            const GeglRectangle *rows)
 {
   try
     {
@@ -483,15 +507,18 @@ import_exr (GeglBuffer  *gegl_buffer,
                        base,
                        gegl_buffer_get_width (gegl_buffer),
                        format_flags,
-                       pxsize);
+                       pxsize,
+                       0);
 
       file.setFrameBuffer (frameBuffer);
 
       {
         gint i;
+        gint y1 = MAX (dw.min.y, dw.min.y + rows->y);
+        gint y2 = MIN (dw.max.y, dw.min.y + rows->y + rows->height - 1);
         GeglRectangle rect;
 
-        for (i=dw.min.y; i<=dw.max.y; i++)
+        for (i=y1; i<=y2; i++)
           {
             gegl_rectangle_set (&rect, 0, i-dw.min.y,gegl_buffer_get_width (gegl_buffer), 1);
             file.readPixels (i);
@@ -528,12 +555,96 @@ import_exr (GeglBuffer  *gegl_buffer,
 }
 
 
+/* reads the tiles covering roi, at the file's resolution level matching
+ * level when it has one.
+ */
+static gboolean
+import_exr_tiles (GeglBuffer          *gegl_buffer,
+                  const gchar         *path,
+                  gint                 format_flags,
+                  const GeglRectangle *roi,
+                  gint                 level)
+{
+  try
+    {
+      TiledInputFile file (path);
+      FrameBuffer frameBuffer;
+      Box2i dw = file.header().dataWindow();
+      GeglRectangle area;
+      GeglRectangle level_rect;
+      gint lx = 0;
+      gint dx1, dx2, dy1, dy2;
+      gint pxsize;
+      gsize rowstride;
+      char *pixels;
+      char *base;
+
+      if (level > 0)
+        lx = MIN (level, MIN (file.numXLevels (), file.numYLevels ()) - 1);
+
+      /* roi at the level that is going to be read */
+      gegl_rectangle_set (&area,
+                          roi->x >> lx, roi->y >> lx,
+                          ((roi->x + roi->width + (1 << lx) - 1) >> lx) - (roi->x >> lx),
+                          ((roi->y + roi->height + (1 << lx) - 1) >> lx) - (roi->y >> lx));
+      gegl_rectangle_set (&level_rect, 0, 0,
+                          file.levelWidth (lx), file.levelHeight (lx));
+
+      if (! gegl_rectangle_intersect (&area, &area, &level_rect))
+        return TRUE;
+
+      dx1 = area.x / file.tileXSize ();
+      dy1 = area.y / file.tileYSize ();
+      dx2 = (area.x + area.width - 1) / file.tileXSize ();
+      dy2 = (area.y + area.height - 1) / file.tileYSize ();
+
+      /* read whole tiles, clipped to the level's extent */
+      gegl_rectangle_set (&area,
+                          dx1 * file.tileXSize (), dy1 * file.tileYSize (),
+                          (dx2 - dx1 + 1) * file.tileXSize (),
+                          (dy2 - dy1 + 1) * file.tileYSize ());
+      gegl_rectangle_intersect (&area, &area, &level_rect);
+
+      g_object_get (gegl_buffer, "px-size", &pxsize, (void *) NULL);
+
+      rowstride = (gsize) area.width * pxsize;
+      pixels = (char*) g_malloc0 (rowstride * area.height);
+
+      /* as in import_exr(), OpenEXR wants a pointer to (0 0) */
+      base = pixels - pxsize * (dw.min.x + area.x) -
+                      rowstride * (dw.min.y + area.y);
+
+      insert_channels (frameBuffer,
+                       file.header(),
+                       base,
+                       area.width,
+                       format_flags,
+                       pxsize,
+                       rowstride);
+
+      file.setFrameBuffer (frameBuffer);
+      file.readTiles (dx1, dx2, dy1, dy2, lx, lx);
+
+      gegl_buffer_set (gegl_buffer, &area, lx, NULL, pixels, rowstride);
+
+      g_free (pixels);
+    }
+  catch (...)
+    {
+      g_warning ("failed to load `%s'", path);
+      return FALSE;
+    }
+  return TRUE;
+}
+
+
 static gboolean
 query_exr (const gchar *path,
            gint        *width,
            gint        *height,
            gint        *ff_ptr,
-           gpointer    *format)
+           gpointer    *format,
+           ExrTiling   *tiling)
 {
   gchar format_string[16];
   gint format_flags = 0;
@@ -550,6 +661,19 @@ query_exr (const gchar *path,
       *width  = dw.max.x - dw.min.x + 1;
       *height = dw.max.y - dw.min.y + 1;
 
+      if (tiling)
+        {
+          tiling->tiled = file.header().hasTileDescription ();
+
+          if (tiling->tiled)
+            {
+              const TileDescription &td = file.header().tileDescription ();
+
+              tiling->tile_width  = td.xSize;
+              tiling->tile_height = td.ySize;
+            }
+        }
+
       if (hasChromaticities(file.header()))
       {
         const Chromaticities &c2 = chromaticities (file.header());
@@ -669,7 +793,7 @@ get_bounding_box (GeglOperation *operation)
   gint          w, h, ff;
   gpointer      format;
 
-  if (query_exr (o->path, &w, &h, &ff, &format))
+  if (query_exr (o->path, &w, &h, &ff, &format, NULL))
     {
       result.width = w;
       result.height = h;
@@ -688,27 +812,68 @@ process (GeglOperation       *operation,
   GeglProperties *o = GEGL_PROPERTIES (operation);
   gint        w,h,ff;
   gpointer    format;
+  ExrTiling   tiling;
   gboolean    ok;
 
-  ok = query_exr (o->path, &w, &h, &ff, &format);
+  ok = query_exr (o->path, &w, &h, &ff, &format, &tiling);
+
+  if (! ok)
+    return FALSE;
+
+  /* chroma subsampled images are reconstructed as a whole */
+  if (ff & COLOR_C)
+    {
+      GeglRectangle all = { 0, 0, w, h };
 
-  if (ok)
+      return import_exr (output, o->path, ff, &all);
+    }
+  else if (tiling.tiled)
     {
-      import_exr (output, o->path, ff);
+      return import_exr_tiles (output, o->path, ff, result, level);
     }
   else
     {
-      return FALSE;
+      return import_exr (output, o->path, ff, result);
     }
-
-  return TRUE;
 }
 
+/* tiles and scanlines can be read individually, so only the part of the
+ * file covering roi is decoded.
+ */
 static GeglRectangle
 get_cached_region (GeglOperation       *operation,
                    const GeglRectangle *roi)
 {
-  return get_bounding_box (operation);
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+  GeglRectangle   result = { 0, 0, 0, 0 };
+  GeglRectangle   bounds;
+  gint            w, h, ff;
+  gpointer        format;
+  ExrTiling       tiling;
+
+  if (! query_exr (o->path, &w, &h, &ff, &format, &tiling))
+    return get_bounding_box (operation);
+
+  gegl_rectangle_set (&bounds, 0, 0, w, h);
+
+  if (ff & COLOR_C)
+    return bounds;
+
+  if (tiling.tiled)
+    {
+      GeglRectangle tile_grid = { 0, 0, tiling.tile_width, tiling.tile_height };
+
+      gegl_rectangle_align (&result, roi, &tile_grid,
+                            GEGL_RECTANGLE_ALIGNMENT_SUPERSET);
+    }
+  else
+    {
+      gegl_rectangle_set (&result, 0, roi->y, w, roi->height);
+    }
+
+  gegl_rectangle_intersect (&result, &result, &bounds);
+
+  return result;
 }
 
 static void
@@ -235,17 +235,26 @@ gegl_jpg_load_query_jpg (GInputStream *stream,
   return status;
 }
 
+/* the largest reduction libjpeg's scaled IDCT can decode to, as a mipmap
+ * level (1/8 scale)
+ */
+#define MAX_SCALED_LEVEL 3
+
 static gint
 gegl_jpg_load_buffer_import_jpg (GeglBuffer   *gegl_buffer,
                                  GInputStream *stream,
                                  gint          dest_x,
-                                 gint          dest_y)
+                                 gint          dest_y,
+                                 gint          level)
 {
   gint row_stride;
   struct jpeg_decompress_struct  cinfo;
   struct jpeg_error_mgr          jerr;
   struct jpeg_source_mgr         src;
-  JSAMPARRAY                     buffer;
+  JSAMPROW                      *rows;
+  guchar                        *pixels;
+  gint                           n_rows;
+  gint                           i;
   const Babl                    *format;
   GeglRectangle                  write_rect;
   GioSource gio_source = { stream, NULL, 1024 };
@@ -264,6 +273,13 @@ gegl_jpg_load_buffer_import_jpg (GeglBuffer   *gegl_buffer,
    */
   cinfo.dct_method = JDCT_FLOAT;
 
+  /* when a mipmap level is requested, let the IDCT decode straight to a
+   * reduced size, rather than decoding every pixel and scaling down later
+   */
+  level = CLAMP (level, 0, MAX_SCALED_LEVEL);
+  cinfo.scale_num   = 1;
+  cinfo.scale_denom = 1 << level;
+
   (void) jpeg_start_decompress (&cinfo);
 
   format = babl_from_jpeg_colorspace(cinfo.out_color_space,
@@ -281,14 +297,20 @@ gegl_jpg_load_buffer_import_jpg (GeglBuffer   *gegl_buffer,
   if ((row_stride) % 2)
     (row_stride)++;
 
-  /* allocated with the jpeg library, and freed with the decompress context */
-  buffer = (*cinfo.mem->alloc_sarray)
-    ((j_common_ptr) &cinfo, JPOOL_IMAGE, row_stride, 1);
+  /* decode a tile row at a time, so that it can be stored in one go */
+  g_object_get (gegl_buffer, "tile-height", &n_rows, NULL);
+  n_rows = CLAMP (n_rows, 1, (gint) cinfo.output_height);
+
+  pixels = g_malloc ((gsize) row_stride * n_rows);
+  rows   = g_new (JSAMPROW, n_rows);
 
-  write_rect.x = dest_x;
-  write_rect.y = dest_y;
+  for (i = 0; i < n_rows; i++)
+    rows[i] = pixels + (gsize) row_stride * i;
+
+  write_rect.x = dest_x >> level;
+  write_rect.y = dest_y >> level;
   write_rect.width  = cinfo.output_width;
-  write_rect.height = 1;
+  write_rect.height = 0;
 
   // Most CMYK JPEG files are produced by Adobe Photoshop. Each component is stored where 0 means 100% ink
   // However this might not be case for all. Gory details: https://bugzilla.mozilla.org/show_bug.cgi?id=674619
@@ -297,14 +319,26 @@ gegl_jpg_load_buffer_import_jpg (GeglBuffer   *gegl_buffer,
 
   while (cinfo.output_scanline < cinfo.output_height)
     {
-      jpeg_read_scanlines (&cinfo, buffer, 1);
+      gint n_read = 0;
+
+      while (n_read < n_rows &&
+             cinfo.output_scanline < cinfo.output_height)
+        {
+          n_read += jpeg_read_scanlines (&cinfo, rows + n_read,
+                                         n_rows - n_read);
+        }
 
-      gegl_buffer_set (gegl_buffer, &write_rect, 0,
-                       format, buffer[0],
-                       GEGL_AUTO_ROWSTRIDE);
-      write_rect.y += 1;
+      write_rect.height = n_read;
+
+      gegl_buffer_set (gegl_buffer, &write_rect, level,
+                       format, pixels,
+                       row_stride);
+      write_rect.y += n_read;
     }
 
+  g_free (rows);
+  g_free (pixels);
+
   jpeg_destroy_decompress (&cinfo);
 
   return 0;
@@ -350,7 +384,7 @@ gegl_jpg_load_process (GeglOperation       *operation,
   GInputStream *stream = gegl_gio_open_input_stream(o->uri, o->path, &file, &err);
   if (!stream)
     return FALSE;
-  status = gegl_jpg_load_buffer_import_jpg(output, stream, 0, 0);
+  status = gegl_jpg_load_buffer_import_jpg(output, stream, 0, 0, level);
   g_input_stream_close(stream, NULL, NULL);
 
   if (err)
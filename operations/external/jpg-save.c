@@ -262,79 +262,89 @@ write_icc_profile (j_compress_ptr cinfo,
 
 
 
+/* the state of a save in progress, kept in user_data while streaming */
+typedef struct
+{
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_error_mgr       jerr;
+  struct jpeg_destination_mgr dest;
+  GOutputStream              *stream;
+  GFile                      *file;
+  gboolean                    started;
+  const Babl                 *format;
+  JSAMPROW                    row_pointer[1];
+} JpgSave;
+
 static gint
-export_jpg (GeglOperation               *operation,
-            GeglBuffer                  *input,
-            const GeglRectangle         *result,
-            struct jpeg_compress_struct  cinfo,
-            gint                         quality,
-            gint                         smoothing,
-            gboolean                     optimize,
-            gboolean                     progressive,
-            gboolean                     grayscale,
-            GeglMetadata                *metadata)
+export_jpg_header (GeglOperation               *operation,
+                   GeglBuffer                  *input,
+                   const GeglRectangle         *result,
+                   JpgSave                     *save,
+                   gint                         quality,
+                   gint                         smoothing,
+                   gboolean                     optimize,
+                   gboolean                     progressive,
+                   gboolean                     grayscale,
+                   GeglMetadata                *metadata)
 {
-  gint     src_x, src_y;
+  struct jpeg_compress_struct *cinfo = &save->cinfo;
   gint     width, height;
-  JSAMPROW row_pointer[1];
   const Babl *format;
   const Babl *fmt = gegl_buffer_get_format (input);
   const Babl *space = babl_format_get_space (fmt);
   gint     cmyk = babl_space_is_cmyk (space);
   gint     gray = babl_space_is_gray (space);
 
-  src_x = result->x;
-  src_y = result->y;
   width = result->width;
   height = result->height;
 
   if (gray)
     grayscale = 1;
 
-  cinfo.image_width = width;
-  cinfo.image_height = height;
+  cinfo->image_width = width;
+  cinfo->image_height = height;
 
   if (!grayscale)
     {
       if (cmyk)
       {
-        cinfo.input_components = 4;
-        cinfo.in_color_space = JCS_CMYK;
+        cinfo->input_components = 4;
+        cinfo->in_color_space = JCS_CMYK;
       }
       else
       {
-        cinfo.input_components = 3;
-        cinfo.in_color_space = JCS_RGB;
+        cinfo->input_components = 3;
+        cinfo->in_color_space = JCS_RGB;
       }
     }
   else
     {
-      cinfo.input_components = 1;
-      cinfo.in_color_space = JCS_GRAYSCALE;
+      cinfo->input_components = 1;
+      cinfo->in_color_space = JCS_GRAYSCALE;
     }
 
-  jpeg_set_defaults (&cinfo);
-  jpeg_set_quality (&cinfo, quality, TRUE);
-  cinfo.smoothing_factor = smoothing;
-  cinfo.optimize_coding = optimize;
+  jpeg_set_defaults (cinfo);
+  jpeg_set_quality (cinfo, quality, TRUE);
+  cinfo->smoothing_factor = smoothing;
+  cinfo->optimize_coding = optimize;
   if (progressive)
-    jpeg_simple_progression (&cinfo);
+    jpeg_simple_progression (cinfo);
 
   /* Use 1x1,1x1,1x1 MCUs and no subsampling */
-  cinfo.comp_info[0].h_samp_factor = 1;
-  cinfo.comp_info[0].v_samp_factor = 1;
+  cinfo->comp_info[0].h_samp_factor = 1;
+  cinfo->comp_info[0].v_samp_factor = 1;
 
   if (!grayscale)
     {
-      cinfo.comp_info[1].h_samp_factor = 1;
-      cinfo.comp_info[1].v_samp_factor = 1;
-      cinfo.comp_info[2].h_samp_factor = 1;
-      cinfo.comp_info[2].v_samp_factor = 1;
+      cinfo->comp_info[1].h_samp_factor = 1;
+      cinfo->comp_info[1].v_samp_factor = 1;
+      cinfo->comp_info[2].h_samp_factor = 1;
+      cinfo->comp_info[2].v_samp_factor = 1;
     }
 
   /* No restart markers */
-  cinfo.restart_interval = 0;
-  cinfo.restart_in_rows = 0;
+  cinfo->restart_interval = 0;
+  cinfo->restart_in_rows = 0;
 
   /* Resolution */
   if (metadata != NULL)
@@ -350,25 +360,26 @@ export_jpg (GeglOperation               *operation,
         switch (unit)
           {
           case GEGL_RESOLUTION_UNIT_DPI:
-            cinfo.density_unit = 1;               /* dots/inch */
-            cinfo.X_density = lroundf (resx);
-            cinfo.Y_density = lroundf (resy);
+            cinfo->density_unit = 1;               /* dots/inch */
+            cinfo->X_density = lroundf (resx);
+            cinfo->Y_density = lroundf (resy);
             break;
           case GEGL_RESOLUTION_UNIT_DPM:
-            cinfo.density_unit = 2;               /* dots/cm */
-            cinfo.X_density = lroundf (resx / 100.0f);
-            cinfo.Y_density = lroundf (resy / 100.0f);
+            cinfo->density_unit = 2;               /* dots/cm */
+            cinfo->X_density = lroundf (resx / 100.0f);
+            cinfo->Y_density = lroundf (resy / 100.0f);
             break;
           case GEGL_RESOLUTION_UNIT_NONE:
           default:
-            cinfo.density_unit = 0;               /* unknown */
-            cinfo.X_density = lroundf (resx);
-            cinfo.Y_density = lroundf (resy);
+            cinfo->density_unit = 0;               /* unknown */
+            cinfo->X_density = lroundf (resx);
+            cinfo->Y_density = lroundf (resy);
             break;
           }
     }
 
-  jpeg_start_compress (&cinfo, TRUE);
+  jpeg_start_compress (cinfo, TRUE);
+  save->started = TRUE;
 
   if (metadata != NULL)
     {
@@ -391,7 +402,7 @@ export_jpg (GeglOperation               *operation,
               g_string_append (string, "\n\n");
             }
         }
-      jpeg_write_marker (&cinfo, JPEG_COM, (guchar *) string->str, string->len);
+      jpeg_write_marker (cinfo, JPEG_COM, (guchar *) string->str, string->len);
       g_value_unset (&value);
       g_string_free (string, TRUE);
 
@@ -405,7 +416,7 @@ export_jpg (GeglOperation               *operation,
     /* XXX : we should write a grayscale profile - possible created from the
              RGB - if the incoming space has a non-grayscale ICC profile */
     if (icc_profile)
-      write_icc_profile (&cinfo, (void*)icc_profile, icc_len);
+      write_icc_profile (cinfo, (void*)icc_profile, icc_len);
   }
 
   if (!grayscale)
@@ -413,95 +424,178 @@ export_jpg (GeglOperation               *operation,
       if (cmyk)
       {
         format = babl_format_with_space ("cmyk u8", space);
-        row_pointer[0] = g_malloc (width * 4);
+        save->row_pointer[0] = g_malloc (width * 4);
       }
       else
       {
         format = babl_format_with_space ("R'G'B' u8", space);
-        row_pointer[0] = g_malloc (width * 3);
+        save->row_pointer[0] = g_malloc (width * 3);
       }
     }
   else
     {
       format = babl_format_with_space ("Y' u8", space);
-      row_pointer[0] = g_malloc (width);
+      save->row_pointer[0] = g_malloc (width);
     }
 
-  while (cinfo.next_scanline < cinfo.image_height) {
-    GeglRectangle rect;
+  save->format = format;
 
-    rect.x = src_x;
-    rect.y = src_y + cinfo.next_scanline;
-    rect.width = width;
-    rect.height = 1;
+  return 0;
+}
 
-    gegl_buffer_get (input, &rect, 1.0, format,
-                     row_pointer[0], GEGL_AUTO_ROWSTRIDE,
-                     GEGL_ABYSS_NONE);
+static gboolean
+jpg_save_write_rows (JpgSave             *save,
+                     GeglBuffer          *input,
+                     const GeglRectangle *rows)
+{
+  gint i;
 
-    jpeg_write_scanlines (&cinfo, row_pointer, 1);
-  }
+  for (i = 0; i < rows->height; i++)
+    {
+      GeglRectangle rect;
 
-  jpeg_finish_compress (&cinfo);
+      rect.x = rows->x;
+      rect.y = rows->y + i;
+      rect.width = rows->width;
+      rect.height = 1;
 
-  g_free (row_pointer[0]);
+      gegl_buffer_get (input, &rect, 1.0, save->format,
+                       save->row_pointer[0], GEGL_AUTO_ROWSTRIDE,
+                       GEGL_ABYSS_NONE);
 
-  return 0;
+      jpeg_write_scanlines (&save->cinfo, save->row_pointer, 1);
+    }
+
+  return TRUE;
 }
 
 static gboolean
-process (GeglOperation       *operation,
-         GeglBuffer          *input,
-         const GeglRectangle *result,
-         int                  level)
+jpg_save_close (JpgSave  *save,
+                gboolean  success)
+{
+  if (save->started)
+    {
+      if (success)
+        {
+          jpeg_finish_compress (&save->cinfo);
+        }
+      else
+        {
+          /* flush and close what was written so far */
+          close_stream (&save->cinfo);
+          jpeg_abort_compress (&save->cinfo);
+        }
+    }
+
+  if (! success)
+    g_warning ("could not export JPEG file");
+
+  jpeg_destroy_compress (&save->cinfo);
+
+  g_clear_object (&save->stream);
+  g_clear_object (&save->file);
+
+  g_free (save->row_pointer[0]);
+  g_slice_free (JpgSave, save);
+
+  return success;
+}
+
+static JpgSave *
+jpg_save_open (GeglOperation       *operation,
+               GeglBuffer          *input,
+               const GeglRectangle *result)
 {
   GeglProperties *o = GEGL_PROPERTIES (operation);
-  struct jpeg_compress_struct cinfo;
-  struct jpeg_error_mgr jerr;
-  struct jpeg_destination_mgr dest;
-  GOutputStream *stream;
-  GFile *file = NULL;
-  gboolean status = TRUE;
-  GError *error = NULL;
+  JpgSave        *save;
+  GError         *error = NULL;
+
+  save = g_slice_new0 (JpgSave);
 
-  cinfo.err = jpeg_std_error (&jerr);
+  save->cinfo.err = jpeg_std_error (&save->jerr);
 
-  jpeg_create_compress (&cinfo);
+  jpeg_create_compress (&save->cinfo);
 
-  stream = gegl_gio_open_output_stream (NULL, o->path, &file, &error);
-  if (stream == NULL)
+  save->stream = gegl_gio_open_output_stream (NULL, o->path, &save->file, &error);
+  if (save->stream == NULL)
     {
-      status = FALSE;
       g_warning ("%s", error->message);
-      goto cleanup;
+      g_error_free (error);
+      jpg_save_close (save, FALSE);
+      return NULL;
     }
 
-  dest.init_destination = init_buffer;
-  dest.empty_output_buffer = write_to_stream;
-  dest.term_destination = close_stream;
+  save->dest.init_destination = init_buffer;
+  save->dest.empty_output_buffer = write_to_stream;
+  save->dest.term_destination = close_stream;
 
-  cinfo.client_data = stream;
-  cinfo.dest = &dest;
+  save->cinfo.client_data = save->stream;
+  save->cinfo.dest = &save->dest;
 
-  if (export_jpg (operation, input, result, cinfo,
-                  o->quality, o->smoothing, o->optimize, o->progressive, o->grayscale,
-                  GEGL_METADATA (o->metadata)))
+  if (export_jpg_header (operation, input, result, save,
+                         o->quality, o->smoothing, o->optimize, o->progressive,
+                         o->grayscale, GEGL_METADATA (o->metadata)))
     {
-      status = FALSE;
-      g_warning("could not export JPEG file");
-      goto cleanup;
+      jpg_save_close (save, FALSE);
+      return NULL;
     }
 
-cleanup:
-  jpeg_destroy_compress (&cinfo);
+  return save;
+}
+
+static gboolean
+process (GeglOperation       *operation,
+         GeglBuffer          *input,
+         const GeglRectangle *result,
+         int                  level)
+{
+  JpgSave *save;
+
+  save = jpg_save_open (operation, input, result);
+  if (save == NULL)
+    return FALSE;
+
+  return jpg_save_close (save, jpg_save_write_rows (save, input, result));
+}
+
+/* scanlines are compressed as they come; progressive and optimized images
+ * are still buffered as coefficients by libjpeg, but not as pixels
+ */
+static gboolean
+stream_begin (GeglOperation       *operation,
+              GeglBuffer          *input,
+              const GeglRectangle *result,
+              gint                 level,
+              gint                *band_height)
+{
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+
+  o->user_data = jpg_save_open (operation, input, result);
+
+  return o->user_data != NULL;
+}
+
+static gboolean
+stream_band (GeglOperation       *operation,
+             GeglBuffer          *input,
+             const GeglRectangle *band,
+             gint                 level)
+{
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+
+  return jpg_save_write_rows (o->user_data, input, band);
+}
 
-  if (stream != NULL)
-    g_clear_object (&stream);
+static gboolean
+stream_end (GeglOperation *operation,
+            gboolean       success)
+{
+  GeglProperties *o    = GEGL_PROPERTIES (operation);
+  JpgSave        *save = o->user_data;
 
-  if (file != NULL)
-    g_clear_object (&file);
+  o->user_data = NULL;
 
-  return  status;
+  return jpg_save_close (save, success);
 }
 
 static void
@@ -513,8 +607,11 @@ gegl_op_class_init (GeglOpClass *klass)
   operation_class = GEGL_OPERATION_CLASS (klass);
   sink_class      = GEGL_OPERATION_SINK_CLASS (klass);
 
-  sink_class->process    = process;
-  sink_class->needs_full = TRUE;
+  sink_class->process      = process;
+  sink_class->needs_full   = TRUE;
+  sink_class->stream_begin = stream_begin;
+  sink_class->stream_band  = stream_band;
+  sink_class->stream_end   = stream_end;
 
   gegl_operation_class_set_keys (operation_class,
     "name",          "gegl:jpg-save",
@@ -118,19 +118,31 @@ clear_png_text (gpointer data)
   g_free (text->text);
 }
 
+/* the state of a save in progress, kept in user_data while streaming */
+typedef struct
+{
+  png_structp    png;
+  png_infop      info;
+  GOutputStream *stream;
+  GFile         *file;
+  const Babl    *format;
+  guchar        *pixels;
+  GArray        *itxt;
+} PngSave;
+
 static gint
-export_png (GeglOperation       *operation,
-            GeglBuffer          *input,
-            const GeglRectangle *result,
-            png_structp          png,
-            png_infop            info,
-            gint                 compression,
-            gint                 bit_depth,
-            GeglMetadata        *metadata)
+export_png_header (GeglOperation       *operation,
+                   GeglBuffer          *input,
+                   const GeglRectangle *result,
+                   png_structp          png,
+                   png_infop            info,
+                   gint                 compression,
+                   gint                 bit_depth,
+                   GeglMetadata        *metadata,
+                   const Babl         **out_format,
+                   GArray             **out_itxt)
 {
-  gint           i, src_x, src_y;
   png_uint_32    width, height;
-  guchar        *pixels;
   png_color_16   white;
   int            png_color_type;
   gchar          format_string[16];
@@ -139,8 +151,6 @@ export_png (GeglOperation       *operation,
   const Babl    *format;
   GArray        *itxt = NULL;
 
-  src_x = result->x;
-  src_y = result->y;
   width = result->width;
   height = result->height;
 
@@ -335,86 +345,172 @@ export_png (GeglOperation       *operation,
   if (bit_depth > 8)
     png_set_swap (png);
 #endif
-  pixels = g_malloc0 (width * babl_format_get_bytes_per_pixel (format));
 
-  for (i=0; i< height; i++)
+  *out_format = format;
+  *out_itxt   = itxt;
+  return 0;
+}
+
+static gboolean
+png_save_write_rows (PngSave             *save,
+                     GeglBuffer          *input,
+                     const GeglRectangle *rows)
+{
+  gint i;
+
+  if (setjmp (png_jmpbuf (save->png)))
+    return FALSE;
+
+  for (i = 0; i < rows->height; i++)
     {
       GeglRectangle rect;
 
-      rect.x = src_x;
-      rect.y = src_y+i;
-      rect.width = width;
+      rect.x = rows->x;
+      rect.y = rows->y + i;
+      rect.width = rows->width;
       rect.height = 1;
 
-      gegl_buffer_get (input, &rect, 1.0, format, pixels, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      gegl_buffer_get (input, &rect, 1.0, save->format, save->pixels,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      png_write_rows (save->png, &save->pixels, 1);
+    }
+
+  return TRUE;
+}
 
-      png_write_rows (png, &pixels, 1);
+static gboolean
+png_save_close (PngSave  *save,
+                gboolean  success)
+{
+  if (success)
+    {
+      if (setjmp (png_jmpbuf (save->png)))
+        success = FALSE;
+      else
+        png_write_end (save->png, save->info);
     }
 
-  png_write_end (png, info);
+  if (! success)
+    g_warning ("could not export PNG file");
 
-  g_free (pixels);
+  if (save->info != NULL)
+    png_destroy_write_struct (&save->png, &save->info);
+  else if (save->png != NULL)
+    png_destroy_write_struct (&save->png, NULL);
 
-  if (itxt != NULL)
-    g_array_unref (itxt);
-  return 0;
+  g_clear_object (&save->stream);
+  g_clear_object (&save->file);
+
+  g_free (save->pixels);
+  if (save->itxt != NULL)
+    g_array_unref (save->itxt);
+
+  g_slice_free (PngSave, save);
+
+  return success;
 }
 
-static gboolean
-process (GeglOperation       *operation,
-         GeglBuffer          *input,
-         const GeglRectangle *result,
-         gint                 level)
+static PngSave *
+png_save_open (GeglOperation       *operation,
+               GeglBuffer          *input,
+               const GeglRectangle *result)
 {
   GeglProperties *o = GEGL_PROPERTIES (operation);
-  png_structp png = NULL;
-  png_infop info = NULL;
-  GOutputStream *stream = NULL;
-  GFile *file = NULL;
-  gboolean status = TRUE;
-  GError *error = NULL;
-
-  png = png_create_write_struct (PNG_LIBPNG_VER_STRING, NULL, error_fn, NULL);
-  if (png != NULL)
-    info = png_create_info_struct (png);
-  if (png == NULL || info == NULL)
+  PngSave        *save;
+  GError         *error = NULL;
+
+  save = g_slice_new0 (PngSave);
+
+  save->png = png_create_write_struct (PNG_LIBPNG_VER_STRING, NULL, error_fn, NULL);
+  if (save->png != NULL)
+    save->info = png_create_info_struct (save->png);
+  if (save->png == NULL || save->info == NULL)
     {
-      status = FALSE;
       g_warning ("failed to initialize PNG writer");
-      goto cleanup;
+      png_save_close (save, FALSE);
+      return NULL;
     }
 
-  stream = gegl_gio_open_output_stream (NULL, o->path, &file, &error);
-  if (stream == NULL)
+  save->stream = gegl_gio_open_output_stream (NULL, o->path, &save->file, &error);
+  if (save->stream == NULL)
     {
-      status = FALSE;
       g_warning ("%s", error->message);
-      goto cleanup;
+      g_error_free (error);
+      png_save_close (save, FALSE);
+      return NULL;
     }
 
-  png_set_write_fn (png, stream, write_fn, flush_fn);
+  png_set_write_fn (save->png, save->stream, write_fn, flush_fn);
 
-  if (export_png (operation, input, result, png, info, o->compression, o->bitdepth,
-                  GEGL_METADATA (o->metadata)))
+  if (export_png_header (operation, input, result, save->png, save->info,
+                         o->compression, o->bitdepth,
+                         GEGL_METADATA (o->metadata),
+                         &save->format, &save->itxt))
     {
-      status = FALSE;
-      g_warning("could not export PNG file");
-      goto cleanup;
+      png_save_close (save, FALSE);
+      return NULL;
     }
 
-cleanup:
-  if (info != NULL)
-    png_destroy_write_struct (&png, &info);
-  else if (png != NULL)
-    png_destroy_write_struct (&png, NULL);
+  save->pixels = g_malloc0 (result->width *
+                            babl_format_get_bytes_per_pixel (save->format));
+
+  return save;
+}
 
-  if (stream != NULL)
-    g_clear_object(&stream);
+static gboolean
+process (GeglOperation       *operation,
+         GeglBuffer          *input,
+         const GeglRectangle *result,
+         gint                 level)
+{
+  PngSave *save;
+
+  save = png_save_open (operation, input, result);
+  if (save == NULL)
+    return FALSE;
+
+  return png_save_close (save, png_save_write_rows (save, input, result));
+}
+
+/* rows are written as they come, so that only a band of the image needs to
+ * exist at any time
+ */
+static gboolean
+stream_begin (GeglOperation       *operation,
+              GeglBuffer          *input,
+              const GeglRectangle *result,
+              gint                 level,
+              gint                *band_height)
+{
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+
+  o->user_data = png_save_open (operation, input, result);
+
+  return o->user_data != NULL;
+}
+
+static gboolean
+stream_band (GeglOperation       *operation,
+             GeglBuffer          *input,
+             const GeglRectangle *band,
+             gint                 level)
+{
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+
+  return png_save_write_rows (o->user_data, input, band);
+}
+
+static gboolean
+stream_end (GeglOperation *operation,
+            gboolean       success)
+{
+  GeglProperties *o    = GEGL_PROPERTIES (operation);
+  PngSave        *save = o->user_data;
 
-  if (file != NULL)
-    g_clear_object(&file);
+  o->user_data = NULL;
 
-  return status;
+  return png_save_close (save, success);
 }
 
 static void
@@ -426,8 +522,11 @@ gegl_op_class_init (GeglOpClass *klass)
   operation_class = GEGL_OPERATION_CLASS (klass);
   sink_class      = GEGL_OPERATION_SINK_CLASS (klass);
 
-  sink_class->process    = process;
-  sink_class->needs_full = TRUE;
+  sink_class->process      = process;
+  sink_class->needs_full   = TRUE;
+  sink_class->stream_begin = stream_begin;
+  sink_class->stream_band  = stream_band;
+  sink_class->stream_end   = stream_end;
 
   gegl_operation_class_set_keys (operation_class,
     "name",          "gegl:png-save",
@@ -46,10 +46,29 @@ typedef enum {
   PIXMAP_RAW    = 54,
 } map_type;
 
+/* the state of a save in progress, kept in user_data while streaming */
+typedef struct
+{
+  FILE     *fp;
+  map_type  type;
+  gsize     bpc;
+} PpmSave;
+
+static void
+ppm_save_write_header (FILE     *fp,
+                       gint      width,
+                       gint      height,
+                       gsize     bpc,
+                       map_type  type)
+{
+  /* Write the header */
+  fprintf (fp, "P%c\n%d %d\n", type, width, height );
+  fprintf (fp, "%d\n", (bpc == sizeof (guchar)) ? 255 : 65535);
+}
+
 static void
 ppm_save_write(FILE    *fp,
                gint     width,
-               gint     height,
                gsize    numsamples,
                gsize    bpc,
                guchar  *data,
@@ -57,10 +76,6 @@ ppm_save_write(FILE    *fp,
 {
   guint i;
 
-  /* Write the header */
-  fprintf (fp, "P%c\n%d %d\n", type, width, height );
-  fprintf (fp, "%d\n", (bpc == sizeof (guchar)) ? 255 : 65535);
-
   /* Raw images writes the data in binary form */
   if (type == PIXMAP_RAW)
     {
@@ -111,20 +126,19 @@ ppm_save_write(FILE    *fp,
     }
 }
 
-static gboolean
-process (GeglOperation       *operation,
-         GeglBuffer          *input,
-         const GeglRectangle *rect,
-         gint                 level)
+static PpmSave *
+ppm_save_open (GeglOperation       *operation,
+               const GeglRectangle *rect)
 {
   GeglProperties *o = GEGL_PROPERTIES (operation);
+  PpmSave        *save;
+  FILE           *fp;
 
-  FILE     *fp;
-  guchar   *data;
-  map_type  type;
-  gsize     bpc;
-  gsize     numsamples;
-  gboolean  ret = FALSE;
+  if ((o->bitdepth != 8) && (o->bitdepth != 16))
+    {
+      g_warning ("Bitdepths of 8 and 16 are only accepted currently.");
+      return NULL;
+    }
 
 #ifndef _WIN64
   fp = (!strcmp (o->path, "-") ? stdout : fopen(o->path, "wb") );
@@ -140,21 +154,32 @@ process (GeglOperation       *operation,
 #endif
 
   if (!fp)
-    return FALSE;
+    return NULL;
 
-  if ((o->bitdepth != 8) && (o->bitdepth != 16))
-    {
-      g_warning ("Bitdepths of 8 and 16 are only accepted currently.");
-      goto out;
-    }
+  save = g_slice_new (PpmSave);
+
+  save->fp   = fp;
+  save->type = (o->rawformat ? PIXMAP_RAW : PIXMAP_ASCII);
+  save->bpc  = (o->bitdepth == 8) ? (sizeof (guchar)) : (sizeof (gushort));
+
+  ppm_save_write_header (fp, rect->width, rect->height, save->bpc, save->type);
+
+  return save;
+}
 
-  type = (o->rawformat ? PIXMAP_RAW : PIXMAP_ASCII);
-  bpc = (o->bitdepth == 8) ? (sizeof (guchar)) : (sizeof (gushort));
-  numsamples = rect->width * rect->height * CHANNEL_COUNT;
+static gboolean
+ppm_save_write_rows (PpmSave             *save,
+                     GeglBuffer          *input,
+                     const GeglRectangle *rect)
+{
+  guchar *data;
+  gsize   numsamples;
+
+  numsamples = (gsize) rect->width * rect->height * CHANNEL_COUNT;
 
-  data = g_malloc (numsamples * bpc);
+  data = g_malloc (numsamples * save->bpc);
 
-  switch (bpc)
+  switch (save->bpc)
     {
     case 1:
       gegl_buffer_get (input, rect, 1.0, babl_format ("R'G'B' u8"), data,
@@ -170,17 +195,77 @@ process (GeglOperation       *operation,
       g_warning ("%s: Programmer stupidity error", G_STRLOC);
     }
 
-  ppm_save_write (fp, rect->width, rect->height, numsamples, bpc, data, type);
+  ppm_save_write (save->fp, rect->width, numsamples, save->bpc, data,
+                  save->type);
 
   g_free (data);
 
-  ret = TRUE;
+  return ! ferror (save->fp);
+}
+
+static gboolean
+ppm_save_close (PpmSave  *save,
+                gboolean  success)
+{
+  if (save->fp != stdout)
+    fclose( save->fp );
+
+  g_slice_free (PpmSave, save);
+
+  return success;
+}
+
+static gboolean
+process (GeglOperation       *operation,
+         GeglBuffer          *input,
+         const GeglRectangle *rect,
+         gint                 level)
+{
+  PpmSave *save;
+
+  save = ppm_save_open (operation, rect);
+  if (save == NULL)
+    return FALSE;
+
+  return ppm_save_close (save, ppm_save_write_rows (save, input, rect));
+}
+
+/* the pixel data is written band by band, as it is rendered */
+static gboolean
+stream_begin (GeglOperation       *operation,
+              GeglBuffer          *input,
+              const GeglRectangle *rect,
+              gint                 level,
+              gint                *band_height)
+{
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+
+  o->user_data = ppm_save_open (operation, rect);
+
+  return o->user_data != NULL;
+}
+
+static gboolean
+stream_band (GeglOperation       *operation,
+             GeglBuffer          *input,
+             const GeglRectangle *band,
+             gint                 level)
+{
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+
+  return ppm_save_write_rows (o->user_data, input, band);
+}
+
+static gboolean
+stream_end (GeglOperation *operation,
+            gboolean       success)
+{
+  GeglProperties *o    = GEGL_PROPERTIES (operation);
+  PpmSave        *save = o->user_data;
 
- out:
-  if (fp != stdout)
-    fclose( fp );
+  o->user_data = NULL;
 
-  return ret;
+  return ppm_save_close (save, success);
 }
 
 
@@ -193,8 +278,11 @@ gegl_op_class_init (GeglOpClass *klass)
   operation_class = GEGL_OPERATION_CLASS (klass);
   sink_class      = GEGL_OPERATION_SINK_CLASS (klass);
 
-  sink_class->process = process;
-  sink_class->needs_full = TRUE;
+  sink_class->process      = process;
+  sink_class->needs_full   = TRUE;
+  sink_class->stream_begin = stream_begin;
+  sink_class->stream_band  = stream_band;
+  sink_class->stream_end   = stream_end;
 
   gegl_operation_class_set_keys (operation_class,
     "name",        "gegl:ppm-save",
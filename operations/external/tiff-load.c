@@ -51,6 +51,8 @@ property_object(metadata, _("Metadata"), GEGL_TYPE_METADATA)
 #include <glib/gprintf.h>
 #include <tiffio.h>
 
+#define TIFF_LOAD_MAX_LEVELS 8
+
 typedef enum {
   TIFF_LOADING_RGBA,
   TIFF_LOADING_CONTIGUOUS,
@@ -77,6 +79,17 @@ typedef struct
 
   gint width;
   gint height;
+
+  /* libtiff handles aren't thread safe, and tiled images are read a
+   * region at a time, possibly from several threads
+   */
+  GMutex mutex;
+  tdir_t main_directory;
+  tdir_t current_directory;
+  /* directories holding reduced-resolution versions of the image, by
+   * mipmap level, 0 if there is none
+   */
+  tdir_t levels[TIFF_LOAD_MAX_LEVELS];
 } Priv;
 
 #ifdef HAVE_STRPTIME
@@ -673,6 +686,87 @@ query_tiff(GeglOperation *operation)
   return 0;
 }
 
+static void
+set_directory(Priv   *p,
+              tdir_t  directory)
+{
+  if (p->current_directory != directory)
+    {
+      TIFFSetDirectory(p->tiff, directory);
+      p->current_directory = directory;
+    }
+}
+
+/* finds the reduced-resolution images following the main one, as written
+ * by pyramidal TIFF writers, which can be read tile by tile in place of
+ * mipmap levels.
+ */
+static void
+query_levels(GeglOperation *operation)
+{
+  GeglProperties *o = GEGL_PROPERTIES(operation);
+  Priv *p = (Priv*) o->user_data;
+  gushort bits_per_sample, samples_per_pixel, planar_config;
+  tdir_t directories;
+  tdir_t d;
+
+  memset(p->levels, 0, sizeof(p->levels));
+
+  if (p->mode != TIFF_LOADING_CONTIGUOUS || !TIFFIsTiled(p->tiff))
+    return;
+
+  TIFFGetFieldDefaulted(p->tiff, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
+  TIFFGetFieldDefaulted(p->tiff, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
+
+  directories = TIFFNumberOfDirectories(p->tiff);
+
+  for (d = p->main_directory + 1; d < directories; d++)
+    {
+      guint32 subfile_type = 0;
+      guint32 width, height;
+      gushort bps, spp;
+      gint level;
+
+      if (!TIFFSetDirectory(p->tiff, d))
+        break;
+
+      TIFFGetFieldDefaulted(p->tiff, TIFFTAG_SUBFILETYPE, &subfile_type);
+
+      /* the next full-resolution page ends the pyramid */
+      if (!(subfile_type & FILETYPE_REDUCEDIMAGE))
+        break;
+
+      TIFFGetFieldDefaulted(p->tiff, TIFFTAG_BITSPERSAMPLE, &bps);
+      TIFFGetFieldDefaulted(p->tiff, TIFFTAG_SAMPLESPERPIXEL, &spp);
+      TIFFGetFieldDefaulted(p->tiff, TIFFTAG_PLANARCONFIG, &planar_config);
+
+      if (!TIFFIsTiled(p->tiff) ||
+          bps != bits_per_sample || spp != samples_per_pixel ||
+          planar_config != PLANARCONFIG_CONTIG ||
+          !TIFFGetField(p->tiff, TIFFTAG_IMAGEWIDTH, &width) ||
+          !TIFFGetField(p->tiff, TIFFTAG_IMAGELENGTH, &height) ||
+          width == 0 || height == 0)
+        continue;
+
+      for (level = 1; level < TIFF_LOAD_MAX_LEVELS; level++)
+        {
+          /* writers round the halved sizes either way */
+          if ((width  == (guint32) p->width  >> level ||
+               width  == (guint32) (p->width  + (1 << level) - 1) >> level) &&
+              (height == (guint32) p->height >> level ||
+               height == (guint32) (p->height + (1 << level) - 1) >> level))
+            {
+              if (!p->levels[level])
+                p->levels[level] = d;
+              break;
+            }
+        }
+    }
+
+  TIFFSetDirectory(p->tiff, p->main_directory);
+  p->current_directory = p->main_directory;
+}
+
 static gint
 load_RGBA(GeglOperation *operation,
           GeglBuffer    *output)
@@ -716,9 +810,44 @@ load_RGBA(GeglOperation *operation,
   return 0;
 }
 
+/* the tiles of the current directory covering roi, which is in its own
+ * coordinates; scanline images are always read whole.
+ */
+static void
+get_tile_range(Priv                *p,
+               const GeglRectangle *roi,
+               guint32              tile_width,
+               guint32              tile_height,
+               gint                *x0,
+               gint                *y0,
+               gint                *x1,
+               gint                *y1)
+{
+  guint32 width, height;
+
+  TIFFGetField(p->tiff, TIFFTAG_IMAGEWIDTH, &width);
+  TIFFGetField(p->tiff, TIFFTAG_IMAGELENGTH, &height);
+
+  if (!TIFFIsTiled(p->tiff) || roi == NULL)
+    {
+      *x0 = 0;
+      *y0 = 0;
+      *x1 = width;
+      *y1 = height;
+      return;
+    }
+
+  *x0 = MAX(roi->x, 0) / tile_width * tile_width;
+  *y0 = MAX(roi->y, 0) / tile_height * tile_height;
+  *x1 = MIN(roi->x + roi->width, (gint) width);
+  *y1 = MIN(roi->y + roi->height, (gint) height);
+}
+
 static gint
 load_contiguous(GeglOperation *operation,
-                GeglBuffer    *output)
+                GeglBuffer    *output,
+                const GeglRectangle *roi,
+                gint           level)
 {
   GeglProperties *o = GEGL_PROPERTIES(operation);
   Priv *p = (Priv*) o->user_data;
@@ -726,6 +855,7 @@ load_contiguous(GeglOperation *operation,
   guint32 tile_height = 1;
   guchar *buffer;
   gint x, y;
+  gint x0, y0, x1, y1;
 
   g_return_val_if_fail(p->tiff != NULL, -1);
 
@@ -741,9 +871,11 @@ load_contiguous(GeglOperation *operation,
 
   g_assert(buffer != NULL);
 
-  for (y = 0; y < p->height; y += tile_height)
+  get_tile_range(p, roi, tile_width, tile_height, &x0, &y0, &x1, &y1);
+
+  for (y = y0; y < y1; y += tile_height)
     {
-      for (x = 0; x < p->width; x += tile_width)
+      for (x = x0; x < x1; x += tile_width)
         {
           GeglRectangle tile = { x, y, tile_width, tile_height };
 
@@ -752,7 +884,7 @@ load_contiguous(GeglOperation *operation,
           else
             TIFFReadScanline(p->tiff, buffer, y, 0);
 
-          gegl_buffer_set(output, &tile, 0, p->format,
+          gegl_buffer_set(output, &tile, level, p->format,
                           (guchar *) buffer,
                           GEGL_AUTO_ROWSTRIDE);
         }
@@ -764,7 +896,8 @@ load_contiguous(GeglOperation *operation,
 
 static gint
 load_separated(GeglOperation *operation,
-               GeglBuffer    *output)
+               GeglBuffer    *output,
+               const GeglRectangle *roi)
 {
   GeglProperties *o = GEGL_PROPERTIES(operation);
   Priv *p = (Priv*) o->user_data;
@@ -798,6 +931,7 @@ load_separated(GeglOperation *operation,
       const Babl *component_type;
       gint plane_bytes_per_pixel;
       gint x, y;
+      gint x0, y0, x1, y1;
 
       component_type = babl_format_get_type(p->format, i);
 
@@ -805,9 +939,11 @@ load_separated(GeglOperation *operation,
 
       plane_bytes_per_pixel = babl_format_get_bytes_per_pixel(plane_format);
 
-      for (y = 0; y < p->height; y += tile_height)
+      get_tile_range(p, roi, tile_width, tile_height, &x0, &y0, &x1, &y1);
+
+      for (y = y0; y < y1; y += tile_height)
         {
-          for (x = 0; x < p->width; x += tile_width)
+          for (x = x0; x < x1; x += tile_width)
             {
               GeglRectangle output_tile = { x, y, tile_width, tile_height };
               GeglRectangle plane_tile = { 0, 0, tile_width, tile_height };
@@ -866,12 +1002,16 @@ static void
 prepare(GeglOperation *operation)
 {
   GeglProperties *o = GEGL_PROPERTIES(operation);
-  Priv *p = (o->user_data) ? o->user_data : g_new0(Priv, 1);
+  Priv *p = o->user_data;
   GError *error = NULL;
   GFile *file = NULL;
   gint directories;
 
-  g_assert(p != NULL);
+  if (p == NULL)
+    {
+      p = g_new0(Priv, 1);
+      g_mutex_init(&p->mutex);
+    }
 
   if (p->file != NULL && (o->uri || o->path))
     {
@@ -929,6 +1069,9 @@ prepare(GeglOperation *operation)
       if (o->directory > 1 && o->directory <= directories)
         TIFFSetDirectory(p->tiff, o->directory - 1);
 
+      p->main_directory = TIFFCurrentDirectory(p->tiff);
+      p->current_directory = p->main_directory;
+
       if (query_tiff(operation))
         {
           g_warning("could not query TIFF file");
@@ -936,6 +1079,8 @@ prepare(GeglOperation *operation)
           return;
         }
 
+      query_levels(operation);
+
         p->directory = o->directory;
     }
 
@@ -966,39 +1111,102 @@ process(GeglOperation *operation,
 {
   GeglProperties *o = GEGL_PROPERTIES(operation);
   Priv *p = (Priv*) o->user_data;
+  gboolean success = FALSE;
 
   if (p->tiff != NULL)
     {
+      g_mutex_lock(&p->mutex);
+
       switch (p->mode)
       {
       case TIFF_LOADING_RGBA:
         if (!load_RGBA(operation, output))
-          return TRUE;
+          success = TRUE;
         break;
 
       case TIFF_LOADING_CONTIGUOUS:
-        if (!load_contiguous(operation, output))
-          return TRUE;
+        {
+          gint l;
+
+          /* use the closest reduced-resolution image, if any */
+          for (l = MIN(level, TIFF_LOAD_MAX_LEVELS - 1); l > 0; l--)
+            if (p->levels[l])
+              break;
+
+          if (l > 0)
+            {
+              GeglRectangle area;
+
+              gegl_rectangle_set(&area,
+                                 result->x >> l, result->y >> l,
+                                 ((result->x + result->width + (1 << l) - 1) >> l) - (result->x >> l),
+                                 ((result->y + result->height + (1 << l) - 1) >> l) - (result->y >> l));
+
+              set_directory(p, p->levels[l]);
+              if (!load_contiguous(operation, output, &area, l))
+                success = TRUE;
+              set_directory(p, p->main_directory);
+            }
+          else if (!load_contiguous(operation, output, result, 0))
+            {
+              success = TRUE;
+            }
+        }
         break;
 
       case TIFF_LOADING_SEPARATED:
-        if (!load_separated(operation, output))
-          return TRUE;
+        if (!load_separated(operation, output, result))
+          success = TRUE;
         break;
 
       default:
         break;
       }
+
+      g_mutex_unlock(&p->mutex);
     }
 
-  return FALSE;
+  return success;
 }
 
+/* tiled images are randomly accessible, only the tiles covering roi are
+ * decoded; images made of strips, or loaded through the RGBA fallback,
+ * are read whole.
+ */
 static GeglRectangle
 get_cached_region(GeglOperation       *operation,
                   const GeglRectangle *roi)
 {
-  return get_bounding_box(operation);
+  GeglProperties *o = GEGL_PROPERTIES(operation);
+  Priv *p = (Priv*) o->user_data;
+  GeglRectangle bounds = get_bounding_box(operation);
+  GeglRectangle result;
+  guint32 tile_width, tile_height;
+
+  if (p == NULL || p->tiff == NULL || p->mode == TIFF_LOADING_RGBA)
+    return bounds;
+
+  g_mutex_lock(&p->mutex);
+
+  if (!TIFFIsTiled(p->tiff) ||
+      !TIFFGetField(p->tiff, TIFFTAG_TILEWIDTH, &tile_width) ||
+      !TIFFGetField(p->tiff, TIFFTAG_TILELENGTH, &tile_height))
+    {
+      g_mutex_unlock(&p->mutex);
+      return bounds;
+    }
+
+  g_mutex_unlock(&p->mutex);
+
+  {
+    GeglRectangle tile_grid = { 0, 0, tile_width, tile_height };
+
+    gegl_rectangle_align(&result, roi, &tile_grid,
+                         GEGL_RECTANGLE_ALIGNMENT_SUPERSET);
+    gegl_rectangle_intersect(&result, &result, &bounds);
+  }
+
+  return result;
 }
 
 static void
@@ -1008,7 +1216,10 @@ finalize(GObject *object)
 
   if (o->user_data != NULL)
     {
+      Priv *p = (Priv*) o->user_data;
+
       cleanup(GEGL_OPERATION(object));
+      g_mutex_clear(&p->mutex);
       g_clear_pointer(&o->user_data, g_free);
     }
 
@@ -56,6 +56,9 @@ typedef struct
   gsize position;
 
   TIFF *tiff;
+
+  const Babl *format;
+  gint y;        /* first row of the image */
 } Priv;
 
 static void
@@ -342,57 +345,48 @@ get_file_size(thandle_t handle)
   return (toff_t) size;
 }
 
+/* writes the scanlines of rows, which need to follow the ones written
+ * before; this is also used to save band by band when streaming.
+ */
 static gint
 save_contiguous(GeglOperation *operation,
                 GeglBuffer    *input,
-                const GeglRectangle *result,
-                const Babl *format)
+                const GeglRectangle *rows)
 {
   GeglProperties *o = GEGL_PROPERTIES(operation);
   Priv *p = (Priv*) o->user_data;
   gint bytes_per_pixel, bytes_per_row;
-  gint tile_width = result->width;
-  gint tile_height = result->height;
   guchar *buffer;
-  gint x, y;
+  gint row;
 
   g_return_val_if_fail(p->tiff != NULL, -1);
 
-  bytes_per_pixel = babl_format_get_bytes_per_pixel(format);
-  bytes_per_row = bytes_per_pixel * tile_width;
+  bytes_per_pixel = babl_format_get_bytes_per_pixel(p->format);
+  bytes_per_row = bytes_per_pixel * rows->width;
 
-  buffer = g_try_new(guchar, bytes_per_row * tile_height);
+  buffer = g_try_new(guchar, (gsize) bytes_per_row * rows->height);
 
   g_assert(buffer != NULL);
 
-  for (y = result->y; y < result->y + tile_height; y += tile_height)
-    {
-      for (x = result->x; x < result->x + tile_width; x += tile_width)
-        {
-          GeglRectangle tile = { x, y, tile_width, tile_height };
-          gint row;
-
-          gegl_buffer_get(input, &tile, 1.0, format, buffer,
-                          GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gegl_buffer_get(input, rows, 1.0, p->format, buffer,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-          for (row = 0; row < tile_height; row++)
-            {
-              guchar *tile_row = buffer + (bytes_per_row * row);
-              gint written;
+  for (row = 0; row < rows->height; row++)
+    {
+      guchar *tile_row = buffer + ((gsize) bytes_per_row * row);
+      gint written;
 
-              written = TIFFWriteScanline(p->tiff, tile_row, row, 0);
+      written = TIFFWriteScanline(p->tiff, tile_row,
+                                  rows->y + row - p->y, 0);
 
-              if (!written)
-                {
-                  g_critical("failed a scanline write on row %d", row);
-                  continue;
-                }
-            }
+      if (!written)
+        {
+          g_critical("failed a scanline write on row %d",
+                     rows->y + row - p->y);
+          continue;
         }
     }
 
-  TIFFFlushData(p->tiff);
-
   g_free(buffer);
   return 0;
 }
@@ -752,14 +746,16 @@ export_tiff (GeglOperation *operation,
       gegl_metadata_unregister_map (GEGL_METADATA (o->metadata));
     }
 
-  return save_contiguous(operation, input, result, format);
+  p->format = format;
+  p->y = result->y;
+
+  return 0;
 }
 
 static gboolean
-process(GeglOperation *operation,
-        GeglBuffer *input,
-        const GeglRectangle *result,
-        int level)
+tiff_save_open(GeglOperation *operation,
+               GeglBuffer *input,
+               const GeglRectangle *result)
 {
   GeglProperties *o = GEGL_PROPERTIES(operation);
   Priv *p = g_new0(Priv, 1);
@@ -802,12 +798,72 @@ process(GeglOperation *operation,
     }
 
 cleanup:
-  cleanup(operation);
-  g_clear_pointer(&o->user_data, g_free);
+  if (!status)
+    {
+      cleanup(operation);
+      g_clear_pointer(&o->user_data, g_free);
+    }
   g_clear_error(&error);
   return status;
 }
 
+static gboolean
+tiff_save_close(GeglOperation *operation,
+                gboolean success)
+{
+  GeglProperties *o = GEGL_PROPERTIES(operation);
+  Priv *p = (Priv*) o->user_data;
+
+  if (success)
+    TIFFFlushData(p->tiff);
+  else
+    g_warning("could not export TIFF file");
+
+  cleanup(operation);
+  g_clear_pointer(&o->user_data, g_free);
+  return success;
+}
+
+static gboolean
+process(GeglOperation *operation,
+        GeglBuffer *input,
+        const GeglRectangle *result,
+        int level)
+{
+  if (!tiff_save_open(operation, input, result))
+    return FALSE;
+
+  return tiff_save_close(operation,
+                         save_contiguous(operation, input, result) == 0);
+}
+
+/* strips are written as the bands they are made of come in */
+static gboolean
+stream_begin(GeglOperation *operation,
+             GeglBuffer *input,
+             const GeglRectangle *result,
+             gint level,
+             gint *band_height)
+{
+  return tiff_save_open(operation, input, result);
+}
+
+static gboolean
+stream_band(GeglOperation *operation,
+            GeglBuffer *input,
+            const GeglRectangle *band,
+            gint level)
+{
+  return save_contiguous(operation, input, band) == 0;
+}
+
+static gboolean
+stream_end(GeglOperation *operation,
+           gboolean success)
+{
+  return tiff_save_close(operation, success);
+}
+
 static void
 gegl_op_class_init(GeglOpClass *klass)
 {
@@ -819,6 +875,9 @@ gegl_op_class_init(GeglOpClass *klass)
 
   sink_class->needs_full = TRUE;
   sink_class->process = process;
+  sink_class->stream_begin = stream_begin;
+  sink_class->stream_band = stream_band;
+  sink_class->stream_end = stream_end;
 
   gegl_operation_class_set_keys(operation_class,
     "name",          "gegl:tiff-save",
@@ -48,6 +48,7 @@ property_path   (d, _("Vector"), NULL)
 #define GEGL_OP_C_SOURCE vector-stroke.c
 
 #include "gegl-plugin.h"
+#include <math.h>
 
 /* the path api isn't public yet */
 #include "property-types/gegl-path.h"
@@ -58,12 +59,97 @@ static void path_changed (GeglPath *path,
 #include "gegl-op.h"
 #include <cairo.h>
 
+/* the maximal number of brush dabs used to cover an appended segment when
+ * invalidating it
+ */
+#define MAX_SEGMENT_DABS 64
+
+/* when a single line segment has been appended to the path, as when painting
+ * with a brush, invalidate the tiles along the segment only, rather than its
+ * whole bounding box.  returns FALSE if the change isn't such an append.
+ */
+static gboolean
+invalidate_appended_segment (GeglPath            *path,
+                             const GeglRectangle *roi,
+                             GeglOperation       *operation)
+{
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+  GeglRectangle   rects[MAX_SEGMENT_DABS + 1];
+  GeglPathItem    prev;
+  GeglPathItem    last;
+  gdouble         x0, y0, x1, y1;
+  gdouble         margin;
+  gdouble         length;
+  gint            n_nodes;
+  gint            n_steps;
+  gint            i;
+
+  if (o->transform && o->transform[0] != '\0')
+    return FALSE;
+
+  n_nodes = gegl_path_get_n_nodes (path);
+
+  if (n_nodes < 2                                       ||
+      ! gegl_path_get_node (path, n_nodes - 1, &last)   ||
+      ! gegl_path_get_node (path, n_nodes - 2, &prev)   ||
+      last.type != 'L')
+    {
+      return FALSE;
+    }
+
+  x0 = prev.point[0].x;
+  y0 = prev.point[0].y;
+  x1 = last.point[0].x;
+  y1 = last.point[0].y;
+
+  /* make sure roi is the bounding box of the segment, as reported by
+   * gegl_path_append()
+   */
+  if (roi->x      != (gint) MIN (x0, x1)  ||
+      roi->y      != (gint) MIN (y0, y1)  ||
+      roi->width  != (gint) fabs (x1 - x0) ||
+      roi->height != (gint) fabs (y1 - y0))
+    {
+      return FALSE;
+    }
+
+  margin  = MAX (o->width, 1.0);
+  length  = sqrt ((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+  n_steps = ceil (length / margin);
+
+  if (n_steps > MAX_SEGMENT_DABS)
+    return FALSE;
+
+  /* cover the segment with squares spaced at most margin apart, each
+   * extending margin around its center
+   */
+  for (i = 0; i <= n_steps; i++)
+    {
+      gdouble t = n_steps ? (gdouble) i / n_steps : 0.0;
+      gdouble x = x0 + (x1 - x0) * t;
+      gdouble y = y0 + (y1 - y0) * t;
+
+      rects[i].x      = floor (x - margin) - 1;
+      rects[i].y      = floor (y - margin) - 1;
+      rects[i].width  = ceil (2.0 * margin) + 3;
+      rects[i].height = ceil (2.0 * margin) + 3;
+    }
+
+  gegl_operation_invalidate_rectangles (operation, rects, n_steps + 1, FALSE);
+
+  return TRUE;
+}
+
 static void path_changed (GeglPath *path,
                           const GeglRectangle *roi,
                           gpointer userdata)
 {
   GeglRectangle rect = *roi;
   GeglProperties    *o   = GEGL_PROPERTIES (userdata);
+
+  if (invalidate_appended_segment (path, roi, userdata))
+    return;
+
   /* invalidate the incoming rectangle */
 
   rect.x -= o->width/2;
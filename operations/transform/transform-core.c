@@ -44,6 +44,12 @@
  */
 #define GEGL_TRANSFORM_CORE_EPSILON ((gdouble) 0.0000001)
 
+/*
+ * Number of output pixels whose source coordinates are computed before
+ * handing them to the sampler in one batch.
+ */
+#define TRANSFORM_CHUNK 128
+
 enum
 {
   PROP_ORIGIN_X = 1,
@@ -1129,8 +1135,6 @@ transform_affine (GeglOperation       *operation,
                                          level?GEGL_SAMPLER_NEAREST:transform->sampler,
                                          level);
 
-  GeglSamplerGetFun sampler_get_fun = gegl_sampler_get_fun (sampler);
-
   GeglRectangle  bounding_box = *gegl_buffer_get_abyss (src);
   GeglRectangle  context_rect = *gegl_sampler_get_context_rect (sampler);
   GeglRectangle  dest_extent  = *roi;
@@ -1226,26 +1230,21 @@ transform_affine (GeglOperation       *operation,
               gdouble u_float = u_start;
               gdouble v_float = v_start;
 
-              gint x;
-
               memset (dest_ptr, 0, (gint) components * sizeof (gfloat) * x1);
               dest_ptr += (gint) components * x1;
 
               u_float += x1 * inverse_jacobian.coeff [0][0];
               v_float += x1 * inverse_jacobian.coeff [1][0];
 
-              for (x = x1; x < x2; x++)
-                {
-                  sampler_get_fun (sampler,
-                                   u_float, v_float,
-                                   &inverse_jacobian,
-                                   dest_ptr,
-                                   abyss_policy);
-                  dest_ptr += (gint) components;
-
-                  u_float += inverse_jacobian.coeff [0][0];
-                  v_float += inverse_jacobian.coeff [1][0];
-                }
+              gegl_sampler_get_span (sampler,
+                                     u_float, v_float,
+                                     inverse_jacobian.coeff [0][0],
+                                     inverse_jacobian.coeff [1][0],
+                                     &inverse_jacobian,
+                                     dest_ptr,
+                                     x2 - x1,
+                                     abyss_policy);
+              dest_ptr += (gint) components * (x2 - x1);
 
               memset (dest_ptr, 0, (gint) components * sizeof (gfloat) * (roi->width - x2));
               dest_ptr += (gint) components * (roi->width - x2);
@@ -1284,7 +1283,8 @@ transform_generic (GeglOperation       *operation,
                                          level?GEGL_SAMPLER_NEAREST:
                                                transform->sampler,
                                          level);
-  GeglSamplerGetFun sampler_get_fun = gegl_sampler_get_fun (sampler);
+  gdouble              coords[TRANSFORM_CHUNK * 2];
+  GeglBufferMatrix2    inverse_jacobians[TRANSFORM_CHUNK];
 
   GeglRectangle  bounding_box = *gegl_buffer_get_abyss (src);
   GeglRectangle  context_rect = *gegl_sampler_get_context_rect (sampler);
@@ -1373,32 +1373,44 @@ transform_generic (GeglOperation       *operation,
             v_float += x1 * inverse.coeff [1][0];
             w_float += x1 * inverse.coeff [2][0];
 
-            for (x = x1; x < x2; x++)
+            for (x = x1; x < x2;)
               {
-                gdouble w_recip = (gdouble) 1.0 / w_float;
-                gdouble u = u_float * w_recip;
-                gdouble v = v_float * w_recip;
-
-                GeglBufferMatrix2 inverse_jacobian;
-                inverse_jacobian.coeff [0][0] =
-                  (inverse.coeff [0][0] - inverse.coeff [2][0] * u) * w_recip;
-                inverse_jacobian.coeff [0][1] =
-                  (inverse.coeff [0][1] - inverse.coeff [2][1] * u) * w_recip;
-                inverse_jacobian.coeff [1][0] =
-                  (inverse.coeff [1][0] - inverse.coeff [2][0] * v) * w_recip;
-                inverse_jacobian.coeff [1][1] =
-                  (inverse.coeff [1][1] - inverse.coeff [2][1] * v) * w_recip;
-
-                sampler_get_fun (sampler,
-                                 u, v,
-                                 &inverse_jacobian,
-                                 dest_ptr,
-                                 abyss_policy);
-
-                dest_ptr += (gint) components;
-                u_float += inverse.coeff [0][0];
-                v_float += inverse.coeff [1][0];
-                w_float += inverse.coeff [2][0];
+                gint n = MIN (x2 - x, TRANSFORM_CHUNK);
+                gint j;
+
+                for (j = 0; j < n; j++)
+                  {
+                    gdouble w_recip = (gdouble) 1.0 / w_float;
+                    gdouble u = u_float * w_recip;
+                    gdouble v = v_float * w_recip;
+
+                    GeglBufferMatrix2 *inverse_jacobian = &inverse_jacobians[j];
+                    inverse_jacobian->coeff [0][0] =
+                      (inverse.coeff [0][0] - inverse.coeff [2][0] * u) * w_recip;
+                    inverse_jacobian->coeff [0][1] =
+                      (inverse.coeff [0][1] - inverse.coeff [2][1] * u) * w_recip;
+                    inverse_jacobian->coeff [1][0] =
+                      (inverse.coeff [1][0] - inverse.coeff [2][0] * v) * w_recip;
+                    inverse_jacobian->coeff [1][1] =
+                      (inverse.coeff [1][1] - inverse.coeff [2][1] * v) * w_recip;
+
+                    coords[j * 2]     = u;
+                    coords[j * 2 + 1] = v;
+
+                    u_float += inverse.coeff [0][0];
+                    v_float += inverse.coeff [1][0];
+                    w_float += inverse.coeff [2][0];
+                  }
+
+                gegl_sampler_get_points (sampler,
+                                         coords,
+                                         inverse_jacobians,
+                                         dest_ptr,
+                                         n,
+                                         abyss_policy);
+
+                dest_ptr += (gint) components * n;
+                x        += n;
               }
 
             memset (dest_ptr, 0, (gint) components * sizeof (gfloat) * (roi->width - x2));
@@ -1438,7 +1450,7 @@ transform_nearest (GeglOperation       *operation,
   GeglSampler *sampler = gegl_buffer_sampler_new_at_level (src, format,
                                          GEGL_SAMPLER_NEAREST,
                                          level);
-  GeglSamplerGetFun sampler_get_fun = gegl_sampler_get_fun (sampler);
+  gdouble              coords[TRANSFORM_CHUNK * 2];
 
   GeglRectangle  bounding_box = *gegl_buffer_get_abyss (src);
   GeglRectangle  dest_extent  = *roi;
@@ -1520,22 +1532,32 @@ transform_nearest (GeglOperation       *operation,
             v_float += x1 * inverse.coeff [1][0];
             w_float += x1 * inverse.coeff [2][0];
 
-            for (x = x1; x < x2; x++)
+            for (x = x1; x < x2;)
               {
-                gdouble w_recip = (gdouble) 1.0 / w_float;
-                gdouble u = u_float * w_recip;
-                gdouble v = v_float * w_recip;
-
-                sampler_get_fun (sampler,
-                                 u, v,
-                                 NULL,
-                                 dest_ptr,
-                                 abyss_policy);
-
-                dest_ptr += px_size;
-                u_float += inverse.coeff [0][0];
-                v_float += inverse.coeff [1][0];
-                w_float += inverse.coeff [2][0];
+                gint n = MIN (x2 - x, TRANSFORM_CHUNK);
+                gint j;
+
+                for (j = 0; j < n; j++)
+                  {
+                    gdouble w_recip = (gdouble) 1.0 / w_float;
+
+                    coords[j * 2]     = u_float * w_recip;
+                    coords[j * 2 + 1] = v_float * w_recip;
+
+                    u_float += inverse.coeff [0][0];
+                    v_float += inverse.coeff [1][0];
+                    w_float += inverse.coeff [2][0];
+                  }
+
+                gegl_sampler_get_points (sampler,
+                                         coords,
+                                         NULL,
+                                         dest_ptr,
+                                         n,
+                                         abyss_policy);
+
+                dest_ptr += px_size * n;
+                x        += n;
               }
 
             memset (dest_ptr, 0, px_size * (roi->width - x2));
@@ -0,0 +1,185 @@
+#include "test-common.h"
+
+#define BPP         16
+#define N_BUFFERS   4
+#define SAMPLES     4096
+#define MAX_THREADS 64
+
+/* hammers gegl_buffer_get() on a small set of shared buffers from a varying
+ * number of threads.  all the tiles fit in the cache, so this measures how
+ * well cache hits scale with the number of threads.
+ */
+
+typedef struct
+{
+  GeglBuffer *buffers[N_BUFFERS];
+  gint        rands[SAMPLES * 2];
+} ThreadData;
+
+static ThreadData data;
+
+/* the threads are started once per thread count, and are kept in sync with
+ * a generation counter, so that thread creation isn't part of the timing.
+ */
+static GThread  *threads[MAX_THREADS];
+static gint      n_threads;
+static GMutex    mutex;
+static GCond     start_cond;
+static GCond     done_cond;
+static gint      generation;
+static gint      n_running;
+static gboolean  quit;
+
+static void
+get_samples (gint thread_no)
+{
+  gfloat px[8 * 8 * 4];
+  gint   j;
+
+  for (j = 0; j < SAMPLES; j++)
+    {
+      gint          k    = (j + thread_no * 131) % SAMPLES;
+      GeglRectangle rect = {data.rands[k * 2], data.rands[k * 2 + 1], 8, 8};
+
+      gegl_buffer_get (data.buffers[(j + thread_no) % N_BUFFERS], &rect, 1.0,
+                       NULL, px, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+    }
+}
+
+static gpointer
+get_thread (gpointer user_data)
+{
+  gint thread_no         = GPOINTER_TO_INT (user_data);
+  gint thread_generation = 0;
+
+  g_mutex_lock (&mutex);
+
+  while (TRUE)
+    {
+      while (generation == thread_generation && ! quit)
+        g_cond_wait (&start_cond, &mutex);
+
+      if (quit)
+        break;
+
+      thread_generation = generation;
+
+      g_mutex_unlock (&mutex);
+
+      get_samples (thread_no);
+
+      g_mutex_lock (&mutex);
+
+      if (--n_running == 0)
+        g_cond_signal (&done_cond);
+    }
+
+  g_mutex_unlock (&mutex);
+
+  return NULL;
+}
+
+static void
+start_threads (gint count)
+{
+  gint i;
+
+  n_threads  = count;
+  generation = 0;
+  quit       = FALSE;
+
+  for (i = 0; i < n_threads; i++)
+    threads[i] = g_thread_new (NULL, get_thread, GINT_TO_POINTER (i));
+}
+
+static void
+stop_threads (void)
+{
+  gint i;
+
+  g_mutex_lock (&mutex);
+  quit = TRUE;
+  g_cond_broadcast (&start_cond);
+  g_mutex_unlock (&mutex);
+
+  for (i = 0; i < n_threads; i++)
+    g_thread_join (threads[i]);
+}
+
+static void
+run_threads (void)
+{
+  g_mutex_lock (&mutex);
+
+  n_running = n_threads;
+  generation++;
+  g_cond_broadcast (&start_cond);
+
+  while (n_running > 0)
+    g_cond_wait (&done_cond, &mutex);
+
+  g_mutex_unlock (&mutex);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglRectangle  bound = {0, 0, 1024, 1024};
+  const Babl    *format;
+  gchar         *buf;
+  gint           count;
+  gint           i;
+
+  gegl_init (NULL, NULL);
+  format = babl_format ("RGBA float");
+  buf = g_malloc0 (bound.width * bound.height * BPP);
+
+  for (i = 0; i < N_BUFFERS; i++)
+    {
+      data.buffers[i] = gegl_buffer_new (&bound, format);
+
+      /* pre-initialize */
+      gegl_buffer_set (data.buffers[i], &bound, 0, NULL, buf,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  for (i = 0; i < SAMPLES; i++)
+    {
+      data.rands[i * 2]     = rand () % (bound.width - 8);
+      data.rands[i * 2 + 1] = rand () % (bound.height - 8);
+    }
+
+  for (count = 1; count <= MAX_THREADS; count *= 2)
+    {
+      gchar *suffix = g_strdup_printf (" %i threads", count);
+
+      start_threads (count);
+
+      /* warm up */
+      run_threads ();
+
+      test_start ();
+      for (i = 0; i < ITERATIONS && converged < BAIL_COUNT; i++)
+        {
+          test_start_iter ();
+          run_threads ();
+          test_end_iter ();
+        }
+      test_end_suffix ("gegl_buffer_get 8x8 shared", suffix,
+                       1.0 * 8 * 8 * SAMPLES * count * ITERATIONS * BPP);
+
+      stop_threads ();
+
+      g_free (suffix);
+    }
+
+  for (i = 0; i < N_BUFFERS; i++)
+    g_object_unref (data.buffers[i]);
+
+  g_free (buf);
+
+  gegl_exit ();
+
+  return 0;
+}
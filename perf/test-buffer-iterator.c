@@ -0,0 +1,98 @@
+#include "test-common.h"
+
+#define BPP 16
+
+/* iterates over a buffer with a varying number of sub-iterators, and with
+ * and without a format conversion.
+ */
+
+static void
+iterate (const gchar *id,
+         GeglBuffer  *buffer,
+         GeglBuffer  *buffer2,
+         const Babl  *format,
+         gboolean     read,
+         gboolean     write)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+  gint                 i;
+
+  test_start ();
+
+  for (i = 0; i < ITERATIONS && converged < BAIL_COUNT; i++)
+    {
+      GeglBufferIterator *iter;
+      gfloat              sum = 0.0f;
+
+      test_start_iter ();
+
+      iter = gegl_buffer_iterator_new (buffer, extent, 0, format,
+                                       write ? GEGL_ACCESS_WRITE :
+                                               GEGL_ACCESS_READ,
+                                       GEGL_ABYSS_NONE, 2);
+
+      if (read && write)
+        {
+          gegl_buffer_iterator_add (iter, buffer2, extent, 0, format,
+                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+        }
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          gfloat *data = iter->items[0].data;
+
+          if (write)
+            {
+              gfloat *src = read ? iter->items[1].data : NULL;
+              gint    j;
+
+              for (j = 0; j < iter->length * 4; j++)
+                data[j] = src ? src[j] : 0.5f;
+            }
+          else
+            {
+              sum += data[0];
+            }
+        }
+
+      test_end_iter ();
+
+      /* keep the reads from being optimized away */
+      if (sum == -1.0f)
+        g_print ("%f\n", sum);
+    }
+
+  test_end_full (id, "",
+                 (gdouble) extent->width * extent->height * BPP * ITERATIONS,
+                 (gdouble) extent->width * extent->height * ITERATIONS);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglBuffer *buffer;
+  GeglBuffer *buffer2;
+
+  gegl_init (&argc, &argv);
+
+  buffer  = test_buffer (2048, 2048, babl_format ("RGBA float"));
+  buffer2 = test_buffer (2048, 2048, babl_format ("RGBA float"));
+
+  iterate ("iterator read", buffer, NULL,
+           babl_format ("RGBA float"), TRUE, FALSE);
+  iterate ("iterator write", buffer, NULL,
+           babl_format ("RGBA float"), FALSE, TRUE);
+  iterate ("iterator read+write", buffer, buffer2,
+           babl_format ("RGBA float"), TRUE, TRUE);
+  iterate ("iterator read (converting)", buffer, NULL,
+           babl_format ("R'G'B'A float"), TRUE, FALSE);
+  iterate ("iterator read+write (converting)", buffer, buffer2,
+           babl_format ("R'G'B'A float"), TRUE, TRUE);
+
+  g_object_unref (buffer2);
+  g_object_unref (buffer);
+
+  gegl_exit ();
+  return 0;
+}
@@ -24,6 +24,10 @@ void test_end (const gchar *id,
 void test_end_suffix (const gchar *id,
                       const gchar *suffix,
                       gdouble      bytes);
+void test_end_full (const gchar *id,
+                    const gchar *suffix,
+                    gdouble      bytes,
+                    gdouble      pixels);
 GeglBuffer *test_buffer (gint width,
                          gint height,
                          const Babl *format);
@@ -90,15 +94,136 @@ static void test_end_iter (void)
   prev_median = median;
 }
 
-void test_end_suffix (const gchar *id,
-                      const gchar *suffix,
-                      gdouble      bytes)
+/* machine-readable results.  when GEGL_PERF_JSON is set to a file name, the
+ * results of all the tests run by the program are written to it, as a JSON
+ * array, on exit.
+ */
+static GString *json_results = NULL;
+
+static void test_json_write (void)
+{
+  const gchar *path = g_getenv ("GEGL_PERF_JSON");
+
+  g_string_append (json_results, "\n]\n");
+
+  if (! g_file_set_contents (path, json_results->str, json_results->len,
+                             NULL))
+    {
+      g_printerr ("failed to write %s\n", path);
+    }
+
+  g_string_free (json_results, TRUE);
+}
+
+static gint test_threads (void)
+{
+  gint threads;
+
+  g_object_get (gegl_config (), "threads", &threads, NULL);
+
+  return threads;
+}
+
+static void test_json_append_string (GString     *json,
+                                     const gchar *str)
+{
+  g_string_append_c (json, '"');
+
+  for (; *str; str++)
+    {
+      guchar c = *str;
+
+      if (c == '"' || c == '\\')
+        g_string_append_printf (json, "\\%c", c);
+      else if (c < 0x20)
+        g_string_append_printf (json, "\\u%04x", c);
+      else
+        g_string_append_c (json, c);
+    }
+
+  g_string_append_c (json, '"');
+}
+
+static void test_json_add (const gchar *id,
+                           const gchar *suffix,
+                           gdouble      bytes,
+                           gdouble      pixels)
+{
+  /* iter_db is sorted by compute_median () */
+  static const gdouble  percentiles[] = {0.0, 0.1, 0.25, 0.5, 0.75, 0.9, 1.0};
+  gdouble               seconds       = compute_median () / 1000000.0;
+  gchar                *name;
+  guint                 i;
+
+  if (! g_getenv ("GEGL_PERF_JSON") || iter_no == 0)
+    return;
+
+  if (! json_results)
+    {
+      json_results = g_string_new ("[");
+
+      atexit (test_json_write);
+    }
+  else
+    {
+      g_string_append_c (json_results, ',');
+    }
+
+  name = g_strconcat (id, suffix, NULL);
+
+  g_string_append (json_results, "\n  {\"id\": ");
+  test_json_append_string (json_results, name);
+  g_string_append_printf (json_results,
+                          ", \"threads\": %d, \"iterations\": %d",
+                          test_threads (), iter_no);
+
+  /* bytes and pixels are totals over ITERATIONS iterations */
+  g_string_append_printf (json_results, ", \"bytes_per_second\": %.17g",
+                          bytes / ITERATIONS / seconds);
+
+  if (pixels > 0.0)
+    {
+      g_string_append_printf (json_results, ", \"pixels_per_second\": %.17g",
+                              pixels / ITERATIONS / seconds);
+    }
+
+  /* per-iteration times, in seconds */
+  g_string_append (json_results, ", \"percentiles\": {");
+
+  for (i = 0; i < G_N_ELEMENTS (percentiles); i++)
+    {
+      gint j = MIN (percentiles[i] * iter_no, iter_no - 1);
+
+      g_string_append_printf (json_results, "%s\"p%d\": %.17g",
+                              i ? ", " : "",
+                              (gint) (percentiles[i] * 100.0),
+                              iter_db[j] / 1000000.0);
+    }
+
+  g_string_append (json_results, "}}");
+
+  g_free (name);
+}
+
+void test_end_full (const gchar *id,
+                    const gchar *suffix,
+                    gdouble      bytes,
+                    gdouble      pixels)
 {
 //  long ticks = babl_ticks ()-ticks_start;
   g_print ("@ %s%s: %.2f megabytes/second\n",
        id, suffix,
         (bytes / 1024.0 / ITERATIONS/ 1024.0)  / (compute_median()/1000000.0));
   //     (bytes / 1024.0 / 1024.0)  / (ticks / 1000000.0));
+
+  test_json_add (id, suffix, bytes, pixels);
+}
+
+void test_end_suffix (const gchar *id,
+                      const gchar *suffix,
+                      gdouble      bytes)
+{
+  test_end_full (id, suffix, bytes, 0.0);
 }
 
 void test_end (const gchar *id,
@@ -154,14 +279,48 @@ void do_bench (const gchar *id,
       test_func(buffer);
       test_end_iter();
     }
-  test_end_suffix (id, suffix, ((double)gegl_buffer_get_pixel_count (buffer)) * 16 * ITERATIONS);
+  test_end_full (id, suffix,
+                 ((double)gegl_buffer_get_pixel_count (buffer)) * 16 * ITERATIONS,
+                 ((double)gegl_buffer_get_pixel_count (buffer)) * ITERATIONS);
 }
 
+/* when GEGL_PERF_THREADS is set to a comma-separated list of thread counts,
+ * each benchmark is additionally run with each of these thread counts, to
+ * measure how it scales.
+ */
 void bench (const gchar *id,
             GeglBuffer  *buffer,
             t_run_perf   test_func)
 {
+  const gchar *threads = g_getenv ("GEGL_PERF_THREADS");
+
   do_bench(id, buffer, test_func, FALSE );
   do_bench(id, buffer, test_func, TRUE );
+
+  if (threads)
+    {
+      gchar **counts = g_strsplit (threads, ",", -1);
+      gint    orig   = test_threads ();
+      gint    i;
+
+      for (i = 0; counts[i]; i++)
+        {
+          gint   n_threads = atoi (counts[i]);
+          gchar *scaled_id;
+
+          if (n_threads <= 0)
+            continue;
+
+          g_object_set (gegl_config (), "threads", n_threads, NULL);
+
+          scaled_id = g_strdup_printf ("%s (%d threads)", id, n_threads);
+          do_bench (scaled_id, buffer, test_func, FALSE);
+          g_free (scaled_id);
+        }
+
+      g_object_set (gegl_config (), "threads", orig, NULL);
+
+      g_strfreev (counts);
+    }
 }
 
@@ -15,22 +15,21 @@
  * Copyright (C) 2018 Ell
  */
 
+#include <string.h>
+
 #include "test-common.h"
 #include "buffer/gegl-compression.h"
 
 #define SUCCESS  0
 #define FAILURE -1
 
-static gpointer
-load_png (const gchar *path,
-          const Babl  *format,
-          gint        *n)
+static GeglBuffer *
+load_png (const gchar *path)
 {
   GeglNode   *node;
   GeglNode   *node_source;
   GeglNode   *node_sink;
   GeglBuffer *buffer = NULL;
-  gpointer    data;
 
   node = gegl_node_new ();
 
@@ -49,54 +48,35 @@ load_png (const gchar *path,
 
   g_object_unref (node);
 
-  *n   = gegl_buffer_get_width (buffer) * gegl_buffer_get_height (buffer);
-  data = g_malloc (*n * babl_format_get_bytes_per_pixel (format));
-
-  gegl_buffer_get (buffer, NULL, 1.0, format, data,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-
-  g_object_unref (buffer);
-
-  return data;
+  return buffer;
 }
 
-gint
-main (gint    argc,
-      gchar **argv)
+static gboolean
+test_format (GeglBuffer   *buffer,
+             const Babl   *format,
+             const gchar **algorithms)
 {
-  const Babl   *format;
-  gint          bpp;
-  gchar        *path;
-  gpointer      data;
-  gint          n;
-  gint          size;
-  guint8       *compressed;
-  gint          max_compressed_size;
-  guint8       *decompressed;
-  const gchar **algorithms;
-  gint          i;
-  gint          result = FAILURE;
-
-  gegl_init (&argc, &argv);
-
-  format = babl_format ("R'G'B'A u8");
-  bpp    = babl_format_get_bytes_per_pixel (format);
-
-  path = g_build_filename (g_getenv ("ABS_TOP_SRCDIR"),
-                           "tests", "compositions", "data", "car-stack.png",
-                           NULL);
-
-  data = load_png (path, format, &n);
+  gint      bpp = babl_format_get_bytes_per_pixel (format);
+  gint      n;
+  gint      size;
+  gpointer  data;
+  guint8   *compressed;
+  gint      max_compressed_size;
+  guint8   *decompressed;
+  gint      i;
+  gboolean  success = FALSE;
+
+  n    = gegl_buffer_get_width (buffer) * gegl_buffer_get_height (buffer);
   size = n * bpp;
+  data = g_malloc (size);
 
-  g_free (path);
+  gegl_buffer_get (buffer, NULL, 1.0, format, data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-  max_compressed_size = 2 * n * bpp;
+  max_compressed_size = 2 * size;
   compressed          = g_malloc (max_compressed_size);
   decompressed        = g_malloc (size);
 
-  algorithms = gegl_compression_list ();
-
   for (i = 0; algorithms[i]; i++)
     {
       const GeglCompression *compression = gegl_compression (algorithms[i]);
@@ -104,7 +84,8 @@ main (gint    argc,
       gint                   compressed_size;
       gint                   j;
 
-      id = g_strdup_printf ("%s compress", algorithms[i]);
+      id = g_strdup_printf ("%s: %s compress",
+                            babl_get_name (format), algorithms[i]);
       test_start ();
 
       for (j = 0; j < ITERATIONS && converged < BAIL_COUNT; j++)
@@ -116,6 +97,9 @@ main (gint    argc,
                                            compressed, &compressed_size,
                                            max_compressed_size))
             {
+              g_printerr ("%s failed\n", id);
+              g_free (id);
+
               goto end;
             }
 
@@ -125,7 +109,8 @@ main (gint    argc,
       test_end (id, (gdouble) size * ITERATIONS);
       g_free (id);
 
-      id = g_strdup_printf ("%s decompress", algorithms[i]);
+      id = g_strdup_printf ("%s: %s decompress",
+                            babl_get_name (format), algorithms[i]);
       test_start ();
 
       for (j = 0; j < ITERATIONS && converged < BAIL_COUNT; j++)
@@ -136,6 +121,9 @@ main (gint    argc,
                                              decompressed, n,
                                              compressed, compressed_size))
             {
+              g_printerr ("%s failed\n", id);
+              g_free (id);
+
               goto end;
             }
 
@@ -144,18 +132,73 @@ main (gint    argc,
 
       test_end (id, (gdouble) size * ITERATIONS);
       g_free (id);
+
+      if (memcmp (data, decompressed, size))
+        {
+          g_printerr ("%s: %s: round trip mismatch\n",
+                      babl_get_name (format), algorithms[i]);
+
+          goto end;
+        }
+
+      g_print ("  %s: %s ratio: %.3f\n",
+               babl_get_name (format), algorithms[i],
+               (gdouble) compressed_size / size);
     }
 
-  result = SUCCESS;
+  success = TRUE;
 
 end:
-  g_free (algorithms);
-
   g_free (compressed);
   g_free (decompressed);
 
   g_free (data);
 
+  return success;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  const gchar  *formats[] = {"R'G'B'A u8",
+                             "R'G'B' u8",
+                             "RGBA u16",
+                             "RGBA half",
+                             "RGBA float",
+                             "Y' u8"};
+  gchar        *path;
+  GeglBuffer   *buffer;
+  const gchar **algorithms;
+  gint          i;
+  gint          result = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  path = g_build_filename (g_getenv ("ABS_TOP_SRCDIR"),
+                           "tests", "compositions", "data", "car-stack.png",
+                           NULL);
+
+  buffer = load_png (path);
+
+  g_free (path);
+
+  algorithms = gegl_compression_list ();
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++)
+    {
+      if (! test_format (buffer, babl_format (formats[i]), algorithms))
+        {
+          result = FAILURE;
+
+          break;
+        }
+    }
+
+  g_free (algorithms);
+
+  g_object_unref (buffer);
+
   gegl_exit ();
 
   return result;
@@ -0,0 +1,118 @@
+#include "test-common.h"
+
+/* benchmarks the most commonly used operations, each processing a buffer
+ * into another.  composers use the input buffer as their aux input as well.
+ */
+
+typedef struct
+{
+  const gchar *operation;
+  const gchar *property;
+  gdouble      value;
+} TestOperation;
+
+static const TestOperation operations[] =
+{
+  /* point operations */
+  { "gegl:brightness-contrast",   "contrast",  1.2  },
+  { "gegl:levels",                "in-high",   0.9  },
+  { "gegl:exposure",              "exposure",  0.5  },
+  { "gegl:color-temperature",     NULL,        0.0  },
+  { "gegl:threshold",             NULL,        0.0  },
+  { "gegl:mono-mixer",            NULL,        0.0  },
+  { "gegl:color-to-alpha",        NULL,        0.0  },
+  { "gegl:invert-linear",         NULL,        0.0  },
+  { "gegl:saturation",            "scale",     1.5  },
+
+  /* composers */
+  { "gegl:over",                  NULL,        0.0  },
+  { "gegl:multiply",              NULL,        0.0  },
+  { "gegl:opacity",               "value",     0.5  },
+
+  /* area operations */
+  { "gegl:gaussian-blur",         "std-dev-x", 10.0 },
+  { "gegl:box-blur",              "radius",    10   },
+  { "gegl:median-blur",           "radius",    5    },
+  { "gegl:unsharp-mask",          NULL,        0.0  },
+  { "gegl:bilateral-filter",      NULL,        0.0  },
+  { "gegl:noise-reduction",       NULL,        0.0  },
+  { "gegl:snn-mean",              NULL,        0.0  },
+  { "gegl:mean-curvature-blur",   NULL,        0.0  },
+  { "gegl:motion-blur-linear",    NULL,        0.0  },
+  { "gegl:difference-of-gaussians", NULL,      0.0  },
+  { "gegl:high-pass",             NULL,        0.0  },
+  { "gegl:edge-sobel",            NULL,        0.0  },
+  { "gegl:emboss",                NULL,        0.0  },
+  { "gegl:pixelize",              NULL,        0.0  },
+  { "gegl:dropshadow",            NULL,        0.0  },
+  { "gegl:shadows-highlights",    NULL,        0.0  },
+
+  /* transforms */
+  { "gegl:rotate",                "degrees",   10.0 },
+  { "gegl:scale-ratio",           "x",         0.7  }
+};
+
+static const TestOperation *current;
+
+static void run_operation (GeglBuffer *buffer);
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglBuffer *buffer;
+  guint       i;
+
+  gegl_init (&argc, &argv);
+
+  buffer = test_buffer (1024, 1024, babl_format ("RGBA float"));
+
+  for (i = 0; i < G_N_ELEMENTS (operations); i++)
+    {
+      current = &operations[i];
+
+      if (! gegl_has_operation (current->operation))
+        {
+          g_print ("%s is not available, skipping\n", current->operation);
+          continue;
+        }
+
+      bench (current->operation, buffer, &run_operation);
+    }
+
+  g_object_unref (buffer);
+
+  gegl_exit ();
+  return 0;
+}
+
+static void run_operation (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *node, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  node = gegl_node_new_child (gegl, "operation", current->operation, NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  if (current->property)
+    {
+      GParamSpec *pspec = gegl_operation_find_property (current->operation,
+                                                        current->property);
+
+      if (pspec && G_PARAM_SPEC_VALUE_TYPE (pspec) == G_TYPE_INT)
+        gegl_node_set (node, current->property, (gint) current->value, NULL);
+      else
+        gegl_node_set (node, current->property, current->value, NULL);
+    }
+
+  gegl_node_link_many (source, node, sink, NULL);
+
+  if (gegl_node_has_pad (node, "aux"))
+    gegl_node_connect (source, "output", node, "aux");
+
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
@@ -0,0 +1,40 @@
+#include "test-common.h"
+
+void point_chain (GeglBuffer *buffer);
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglBuffer *buffer;
+
+  gegl_init (&argc, &argv);
+
+  buffer = test_buffer (2048, 1024, babl_format ("RGBA float"));
+
+  bench ("point-chain", buffer, &point_chain);
+
+  return 0;
+}
+
+void point_chain (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *bcontrast, *levels, *saturation, *invert;
+  GeglNode   *multiply, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  bcontrast = gegl_node_new_child (gegl, "operation", "gegl:brightness-contrast", "contrast", 0.2, NULL);
+  levels = gegl_node_new_child (gegl, "operation", "gegl:levels", "in-high", 0.9, NULL);
+  saturation = gegl_node_new_child (gegl, "operation", "gegl:saturation", "scale", 1.5, NULL);
+  invert = gegl_node_new_child (gegl, "operation", "gegl:invert-linear", NULL);
+  multiply = gegl_node_new_child (gegl, "operation", "gegl:multiply", NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, bcontrast, levels, saturation, invert, multiply, sink, NULL);
+  gegl_node_connect (source, "output", multiply, "aux");
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
@@ -0,0 +1,42 @@
+#include "test-common.h"
+
+/* runs a chain of the generated point filters and composers, which are
+ * built as x86_64-v2/v3 and NEON variants.  run with GEGL_USE_SIMD=no to
+ * compare against the generic builds.
+ */
+
+void composers (GeglBuffer *buffer);
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglBuffer *buffer;
+
+  gegl_init (&argc, &argv);
+
+  buffer = test_buffer (2048, 1024, babl_format ("RGBA float"));
+
+  bench ("point composers", buffer, &composers);
+
+  return 0;
+}
+
+void composers (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *multiply, *screen, *gamma, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  multiply = gegl_node_new_child (gegl, "operation", "gegl:multiply", "value", 0.8, NULL);
+  screen = gegl_node_new_child (gegl, "operation", "gegl:screen", NULL);
+  gamma = gegl_node_new_child (gegl, "operation", "gegl:gamma", "value", 1.2, NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, multiply, screen, gamma, sink, NULL);
+  gegl_node_connect (source, "output", screen, "aux");
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
@@ -0,0 +1,57 @@
+#include "test-common.h"
+
+/* renders a graph through a GeglProcessor, in chunks, the way interactive
+ * applications do, with and without a focus point.
+ */
+
+static gboolean use_focus = FALSE;
+
+static void render (GeglBuffer *buffer);
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglBuffer *buffer;
+
+  gegl_init (&argc, &argv);
+
+  buffer = test_buffer (2048, 1024, babl_format ("RGBA float"));
+
+  bench ("processor", buffer, &render);
+
+  use_focus = TRUE;
+  bench ("processor (focused)", buffer, &render);
+
+  g_object_unref (buffer);
+
+  gegl_exit ();
+  return 0;
+}
+
+static void render (GeglBuffer *buffer)
+{
+  GeglProcessor *processor;
+  GeglBuffer    *buffer2 = NULL;
+  GeglNode      *gegl, *source, *blur, *bcontrast, *sink;
+  GeglRectangle  focus   = {1000, 500, 32, 32};
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  blur = gegl_node_new_child (gegl, "operation", "gegl:gaussian-blur", "std-dev-x", 4.0, "std-dev-y", 4.0, NULL);
+  bcontrast = gegl_node_new_child (gegl, "operation", "gegl:brightness-contrast", "contrast", 1.2, NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, blur, bcontrast, sink, NULL);
+
+  processor = gegl_node_new_processor (sink, gegl_buffer_get_extent (buffer));
+
+  if (use_focus)
+    gegl_processor_set_focus (processor, &focus);
+
+  while (gegl_processor_work (processor, NULL));
+
+  g_object_unref (processor);
+  g_object_unref (gegl);
+  g_clear_object (&buffer2);
+}
@@ -0,0 +1,96 @@
+#include "test-common.h"
+
+#define BPP        16
+#define CACHE_SIZE (16 * 1024 * 1024)
+
+/* writes and reads back a buffer much larger than the tile cache, so that
+ * most tiles go through the swap.
+ */
+
+/* tiles are written to the swap asynchronously; wait for the swap writer
+ * to finish all the queued work.
+ */
+static void
+wait_for_swap (void)
+{
+  gboolean busy;
+
+  while (TRUE)
+    {
+      g_object_get (gegl_stats (), "swap-busy", &busy, NULL);
+
+      if (! busy)
+        break;
+
+      g_usleep (100);
+    }
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglRectangle  bound = {0, 0, 4096, 2048};
+  const Babl    *format;
+  guchar        *buf;
+  gint           i;
+
+  gegl_init (&argc, &argv);
+
+  g_object_set (gegl_config (),
+                "tile-cache-size", (guint64) CACHE_SIZE,
+                NULL);
+
+  format = babl_format ("RGBA float");
+  buf    = g_malloc (bound.width * bound.height * BPP);
+
+  for (i = 0; i < bound.width * bound.height * BPP; i++)
+    buf[i] = rand () & 0xff;
+
+  test_start ();
+  for (i = 0; i < ITERATIONS && converged < BAIL_COUNT; i++)
+    {
+      GeglBuffer *buffer = gegl_buffer_new (&bound, format);
+
+      /* don't time the freeing of the previous buffer's tiles */
+      wait_for_swap ();
+
+      test_start_iter ();
+      gegl_buffer_set (buffer, &bound, 0, NULL, buf, GEGL_AUTO_ROWSTRIDE);
+      gegl_buffer_flush (buffer);
+      wait_for_swap ();
+      test_end_iter ();
+
+      g_object_unref (buffer);
+    }
+  test_end_full ("swap write", "",
+                 1.0 * bound.width * bound.height * ITERATIONS * BPP,
+                 1.0 * bound.width * bound.height * ITERATIONS);
+
+  test_start ();
+  for (i = 0; i < ITERATIONS && converged < BAIL_COUNT; i++)
+    {
+      GeglBuffer *buffer = gegl_buffer_new (&bound, format);
+
+      gegl_buffer_set (buffer, &bound, 0, NULL, buf, GEGL_AUTO_ROWSTRIDE);
+      gegl_buffer_flush (buffer);
+
+      /* read the tiles back from the swap file, rather than from the queue */
+      wait_for_swap ();
+
+      test_start_iter ();
+      gegl_buffer_get (buffer, &bound, 1.0, NULL, buf,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      test_end_iter ();
+
+      g_object_unref (buffer);
+    }
+  test_end_full ("swap read", "",
+                 1.0 * bound.width * bound.height * ITERATIONS * BPP,
+                 1.0 * bound.width * bound.height * ITERATIONS);
+
+  g_free (buf);
+
+  gegl_exit ();
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include "../../gegl/buffer/gegl-buffer-iterator-private.h"
+
+/* writes value to the whole of level of buffer, without emitting the
+ * changed signal, so that only the written tiles tell the storage it
+ * changed.
+ */
+static void
+fill_level (GeglBuffer *buffer,
+            gint        level,
+            gfloat      value)
+{
+  GeglRectangle       rect = *gegl_buffer_get_extent (buffer);
+  GeglBufferIterator *iter;
+
+  rect.width  >>= level;
+  rect.height >>= level;
+
+  iter = gegl_buffer_iterator_new (buffer, &rect, level,
+                                   babl_format ("Y float"),
+                                   GEGL_ACCESS_WRITE | GEGL_ITERATOR_NO_NOTIFY,
+                                   GEGL_ABYSS_NONE, 1);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gfloat *data = iter->items[0].data;
+      gint    i;
+
+      for (i = 0; i < iter->length; i++)
+        data[i] = value;
+    }
+}
+
+TEST ()
+{
+  GeglBuffer    *buffer, *sub;
+  GeglRectangle  bound = {0, 0, 20, 20};
+  GeglRectangle  rect = {0, 0, 5, 5};
+  GeglRectangle  sub_rect = {10, 10, 10, 10};
+  gdouble        percentiles[3] = {0.0, 50.0, 100.0};
+  gdouble        values[3];
+  guint64        bins[4];
+  gdouble        min, max, mean;
+  test_start ();
+
+  buffer = gegl_buffer_new (&bound, babl_format ("Y float"));
+  vgrad (buffer);
+
+  gegl_buffer_get_statistics (buffer, NULL, NULL, 0, &min, &max, &mean);
+  print (("level 0: %.3f %.3f %.3f\n", min, max, mean));
+
+  /* an estimate from the first mipmap level */
+  gegl_buffer_get_statistics (buffer, NULL, NULL, 1, &min, &max, &mean);
+  print (("level 1: %.3f %.3f %.3f\n", min, max, mean));
+
+  /* writing to a mipmap level drops the cached results of that level too */
+  gegl_buffer_get_statistics (buffer, NULL, NULL, 1, &min, &max, &mean);
+  fill_level (buffer, 1, 0.5);
+
+  gegl_buffer_get_statistics (buffer, NULL, NULL, 1, &min, &max, &mean);
+  print (("level 1 changed: %.3f %.3f %.3f\n", min, max, mean));
+
+  /* the cached results must be dropped once the buffer changes */
+  fill_rect (buffer, &rect, 1.0);
+
+  gegl_buffer_get_statistics (buffer, NULL, NULL, 0, &min, &max, &mean);
+  print (("changed: %.3f %.3f %.3f\n", min, max, mean));
+
+  sub = gegl_buffer_create_sub_buffer (buffer, &sub_rect);
+  gegl_buffer_get_statistics (sub, NULL, NULL, 0, &min, &max, &mean);
+  print (("sub-buffer: %.3f %.3f %.3f\n", min, max, mean));
+  g_object_unref (sub);
+
+  gegl_buffer_get_histogram (buffer, NULL, NULL, 0, 0, 0.0, 1.0, 4, bins);
+  print (("histogram: %d %d %d %d\n",
+          (gint) bins[0], (gint) bins[1], (gint) bins[2], (gint) bins[3]));
+
+  gegl_buffer_get_percentiles (buffer, NULL, NULL, 0, 0, 3, percentiles, values);
+  print (("percentiles: %.2f %.2f %.2f\n", values[0], values[1], values[2]));
+
+  g_object_unref (buffer);
+  test_end ();
+}
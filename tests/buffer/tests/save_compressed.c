@@ -0,0 +1,37 @@
+TEST ()
+{
+  /* Makes sure a buffer saved with compressed tiles and stored mipmap
+   * levels reads back the same, both when loaded and when opened
+   */
+  GeglBuffer    *buffer = NULL;
+  GeglRectangle  rect = {0, 0, 20, 20};
+  gchar         *path = NULL;
+
+  test_start ();
+
+  /* Create */
+  buffer = gegl_buffer_new (&rect, babl_format ("Y float"));
+  vgrad (buffer);
+  path = g_build_filename (g_get_tmp_dir (), "gegl-buffer-compressed.gegl", NULL);
+
+  /* Save */
+  gegl_buffer_save_full (buffer, path, NULL, "fast", 2);
+  g_object_unref (buffer);
+  buffer = NULL;
+
+  /* Load */
+  buffer = gegl_buffer_load (path);
+  print_buffer (buffer);
+  g_object_unref (buffer);
+  buffer = NULL;
+
+  /* Open */
+  buffer = gegl_buffer_open (path);
+  print_buffer (buffer);
+  g_object_unref (buffer);
+  buffer = NULL;
+
+  g_unlink (path);
+  g_free (path);
+  test_end ();
+}
@@ -0,0 +1,170 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* checks that the lattice approximation used by gegl:bilateral-filter for
+ * large radii stays close to the brute-force filter.
+ */
+
+#include <math.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define WIDTH    300
+#define HEIGHT   200
+#define RADIUS   16.0
+#define PRESERVE 8.0
+
+#define MAX_MEAN_DIFF 0.005
+#define MAX_DIFF      0.1
+
+
+static void
+bilateral_filter_reference (GeglBuffer *buffer,
+                            gfloat     *dst)
+{
+  gint                r     = ceil (RADIUS);
+  const GeglRectangle rect  = {-r, -r, WIDTH + 2 * r, HEIGHT + 2 * r};
+  gfloat             *src   = g_new (gfloat, rect.width * rect.height * 4);
+  gint                x, y;
+
+  gegl_buffer_get (buffer, &rect, 1.0, babl_format ("RGBA float"), src,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      {
+        const gfloat *center = src + ((y + r) * rect.width + x + r) * 4;
+        gdouble       accumulated[4] = {0.0, };
+        gdouble       count          = 0.0;
+        gint          u, v;
+        gint          c;
+
+        for (v = -r; v <= r; v++)
+          for (u = -r; u <= r; u++)
+            {
+              const gfloat *pixel = center + (v * rect.width + u) * 4;
+              gdouble       diff  = 0.0;
+              gdouble       weight;
+
+              for (c = 0; c < 3; c++)
+                diff += (center[c] - pixel[c]) * (center[c] - pixel[c]);
+
+              weight = exp (-diff * PRESERVE) *
+                       exp (-0.5 * (u * u + v * v) / RADIUS);
+
+              for (c = 0; c < 4; c++)
+                accumulated[c] += pixel[c] * weight;
+              count += weight;
+            }
+
+        for (c = 0; c < 4; c++)
+          dst[(y * WIDTH + x) * 4 + c] = accumulated[c] / count;
+      }
+
+  g_free (src);
+}
+
+int main(int argc, char *argv[])
+{
+  int                 result = SUCCESS;
+  const GeglRectangle rect   = {0, 0, WIDTH, HEIGHT};
+  GeglBuffer         *buffer;
+  GeglNode           *graph;
+  GeglNode           *source;
+  GeglNode           *filter;
+  gfloat             *pixels;
+  gfloat             *output;
+  gfloat             *reference;
+  gdouble             diff_sum = 0.0;
+  gdouble             diff_max = 0.0;
+  gint                x, y;
+  gint                i;
+
+  gegl_init (&argc, &argv);
+
+  /* two noisy regions split by a diagonal edge, with a vertical step in
+   * the blue channel, and a horizontal gradient in the green one.  the
+   * image spans several tiles, so that the filter is applied per area.
+   */
+  g_random_set_seed (1);
+
+  buffer = gegl_buffer_new (&rect, babl_format ("RGBA float"));
+  pixels = g_new (gfloat, WIDTH * HEIGHT * 4);
+
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      {
+        gfloat *pixel = pixels + (y * WIDTH + x) * 4;
+        gfloat  noise = g_random_double_range (0.0, 0.05);
+
+        pixel[0] = (x + y > HEIGHT ? 0.8 : 0.2) + noise;
+        pixel[1] = 0.5 * x / WIDTH + noise;
+        pixel[2] = y < HEIGHT / 2 ? 0.3 : 0.6;
+        pixel[3] = 1.0;
+      }
+
+  gegl_buffer_set (buffer, &rect, 0, babl_format ("RGBA float"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation", "gegl:buffer-source",
+                                "buffer",    buffer,
+                                NULL);
+  filter = gegl_node_new_child (graph,
+                                "operation",         "gegl:bilateral-filter",
+                                "blur-radius",       RADIUS,
+                                "edge-preservation", PRESERVE,
+                                NULL);
+  gegl_node_link (source, filter);
+
+  output    = g_new (gfloat, WIDTH * HEIGHT * 4);
+  reference = g_new (gfloat, WIDTH * HEIGHT * 4);
+
+  gegl_node_blit (filter, 1.0, &rect, babl_format ("RGBA float"), output,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  bilateral_filter_reference (buffer, reference);
+
+  for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+    {
+      gdouble diff = fabs (output[i] - reference[i]);
+
+      diff_sum += diff;
+      diff_max  = MAX (diff_max, diff);
+    }
+
+  if (diff_sum / (WIDTH * HEIGHT * 4) > MAX_MEAN_DIFF || diff_max > MAX_DIFF)
+    {
+      g_printerr ("gegl:bilateral-filter differs from the reference: "
+                  "mean difference %g, max difference %g\n",
+                  diff_sum / (WIDTH * HEIGHT * 4), diff_max);
+
+      result = FAILURE;
+    }
+
+  g_object_unref (graph);
+  g_object_unref (buffer);
+  g_free (pixels);
+  g_free (output);
+  g_free (reference);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,179 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* checks that the mipmap levels which gegl_buffer_set_mipmap_mode() has
+ * rebuilt in the background after a write are the same as the ones built on
+ * demand, both when filtering in the buffer's format and in linear light.
+ */
+
+#include <string.h>
+
+#include "gegl.h"
+#include "gegl-buffer-backend.h"
+#include "gegl-buffer-private.h"
+#include "gegl-tile-handler-chain.h"
+#include "gegl-tile-handler-zoom.h"
+#include "gegl-tile-storage.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define N_TILES  4
+#define N_LEVELS 2
+
+#define TIMEOUT  (10 * G_TIME_SPAN_SECOND)
+
+
+/* waits for the background rebuild of the buffer's mipmap levels */
+static gboolean
+wait_for_rebuild (GeglBuffer *buffer)
+{
+  GeglTileHandlerZoom *zoom;
+  gint64               end_time = g_get_monotonic_time () + TIMEOUT;
+
+  zoom = (GeglTileHandlerZoom *) gegl_tile_handler_chain_get_first (
+    GEGL_TILE_HANDLER_CHAIN (buffer->tile_storage),
+    GEGL_TYPE_TILE_HANDLER_ZOOM);
+
+  while (g_get_monotonic_time () < end_time)
+    {
+      gboolean done;
+
+      g_mutex_lock (&zoom->dirty_mutex);
+      done = ! zoom->rebuild_queued && g_hash_table_size (zoom->dirty) == 0;
+      g_mutex_unlock (&zoom->dirty_mutex);
+
+      if (done)
+        return TRUE;
+
+      g_usleep (1000);
+    }
+
+  return FALSE;
+}
+
+static gboolean
+test_mipmap_mode (gboolean linear)
+{
+  const Babl    *format = babl_format ("R'G'B'A u8");
+  gint           bpp    = babl_format_get_bytes_per_pixel (format);
+  GeglRectangle  rect   = {0, 0, 0, 0};
+  GeglBuffer    *eager;
+  GeglBuffer    *lazy;
+  guint8        *pixels;
+  gint           tile_width;
+  gint           tile_height;
+  gboolean       success = TRUE;
+  gint           x, y, z;
+  gint           i;
+
+  eager = gegl_buffer_new (NULL, format);
+  lazy  = gegl_buffer_new (NULL, format);
+
+  g_object_get (eager,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  rect.width  = N_TILES * tile_width;
+  rect.height = N_TILES * tile_height;
+
+  gegl_buffer_set_extent (eager, &rect);
+  gegl_buffer_set_extent (lazy,  &rect);
+
+  gegl_buffer_set_mipmap_mode (eager, N_LEVELS, linear);
+  gegl_buffer_set_mipmap_mode (lazy,  0,        linear);
+
+  g_random_set_seed (1);
+
+  pixels = g_new (guint8, rect.width * rect.height * bpp);
+
+  for (i = 0; i < rect.width * rect.height * bpp; i++)
+    pixels[i] = g_random_int_range (0, 256);
+
+  gegl_buffer_set (eager, &rect, 0, format, pixels, GEGL_AUTO_ROWSTRIDE);
+  gegl_buffer_set (lazy,  &rect, 0, format, pixels, GEGL_AUTO_ROWSTRIDE);
+
+  if (! wait_for_rebuild (eager))
+    {
+      g_printerr ("the mipmap levels weren't rebuilt (linear: %d)\n", linear);
+
+      success = FALSE;
+    }
+
+  for (z = 1; success && z <= N_LEVELS; z++)
+    {
+      for (y = 0; y < N_TILES >> z; y++)
+        for (x = 0; x < N_TILES >> z; x++)
+          {
+            GeglTileSource *eager_source = GEGL_TILE_SOURCE (eager);
+            GeglTileSource *lazy_source  = GEGL_TILE_SOURCE (lazy);
+            GeglTile       *eager_tile;
+            GeglTile       *lazy_tile;
+
+            /* the eager levels must be ready before they're read */
+            if (! gegl_tile_source_exist (eager_source, x, y, z))
+              {
+                g_printerr ("tile %d, %d at level %d wasn't rebuilt "
+                            "(linear: %d)\n",
+                            x, y, z, linear);
+
+                success = FALSE;
+
+                continue;
+              }
+
+            eager_tile = gegl_tile_source_get_tile (eager_source, x, y, z);
+            lazy_tile  = gegl_tile_source_get_tile (lazy_source,  x, y, z);
+
+            if (memcmp (gegl_tile_get_data (eager_tile),
+                        gegl_tile_get_data (lazy_tile),
+                        tile_width * tile_height * bpp))
+              {
+                g_printerr ("tile %d, %d at level %d differs from the one "
+                            "built on demand (linear: %d)\n",
+                            x, y, z, linear);
+
+                success = FALSE;
+              }
+
+            gegl_tile_unref (eager_tile);
+            gegl_tile_unref (lazy_tile);
+          }
+    }
+
+  g_object_unref (eager);
+  g_object_unref (lazy);
+  g_free (pixels);
+
+  return success;
+}
+
+int main(int argc, char *argv[])
+{
+  int result = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  if (! test_mipmap_mode (FALSE) ||
+      ! test_mipmap_mode (TRUE))
+    {
+      result = FAILURE;
+    }
+
+  gegl_exit ();
+
+  return result;
+}
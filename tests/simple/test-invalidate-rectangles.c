@@ -0,0 +1,118 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gegl.h"
+#include "gegl-plugin.h"
+#include "graph/gegl-node-private.h"
+#include "graph/gegl-cache.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+/* invalidates two distant rectangles of a source node, and makes sure only
+ * these rectangles, rather than their bounding box, get invalidated
+ * downstream, both in terms of the emitted area, and of the cache tiles
+ * whose generation is bumped.
+ */
+
+static void
+invalidated (GeglNode      *node,
+             GeglRectangle *rect,
+             gpointer       user_data)
+{
+  gint64 *area = user_data;
+
+  *area += (gint64) rect->width * rect->height;
+}
+
+static guint
+get_tile_generation (GeglCache *cache,
+                     gint       x,
+                     gint       y)
+{
+  GeglBuffer *buffer = GEGL_BUFFER (cache);
+
+  return gegl_cache_get_tile_generation (
+    cache,
+    gegl_tile_indice (x + buffer->shift_x, buffer->tile_width),
+    gegl_tile_indice (y + buffer->shift_y, buffer->tile_height));
+}
+
+int main(int argc, char *argv[])
+{
+  gint           result    = SUCCESS;
+  GeglRectangle  rects[2]  = {{0, 0, 10, 10}, {1000, 1000, 10, 10}};
+  gint64         area      = 0;
+  GeglNode      *gegl;
+  GeglNode      *checkerboard;
+  GeglNode      *invert;
+  GeglCache     *cache;
+  guint          generations[3];
+
+  gegl_init (&argc, &argv);
+
+  gegl         = gegl_node_new ();
+  checkerboard = gegl_node_new_child (gegl,
+                                      "operation", "gegl:checkerboard",
+                                      NULL);
+  invert       = gegl_node_new_child (gegl,
+                                      "operation",    "gegl:invert-linear",
+                                      "cache-policy", GEGL_CACHE_POLICY_ALWAYS,
+                                      NULL);
+
+  gegl_node_link (checkerboard, invert);
+
+  g_signal_connect (invert, "invalidated",
+                    G_CALLBACK (invalidated), &area);
+
+  cache = gegl_node_get_cache (invert);
+
+  generations[0] = get_tile_generation (cache, 0, 0);
+  generations[1] = get_tile_generation (cache, 1000, 1000);
+  generations[2] = get_tile_generation (cache, 500, 500);
+
+  gegl_operation_invalidate_rectangles (
+    gegl_node_get_gegl_operation (checkerboard), rects, 2, FALSE);
+
+  if (area != 2 * 10 * 10)
+    {
+      g_printerr ("test-invalidate-rectangles: expected an invalidated area "
+                  "of %d pixels, got %" G_GINT64_FORMAT "\n",
+                  2 * 10 * 10, area);
+      result = FAILURE;
+    }
+
+  if (get_tile_generation (cache, 0, 0)       == generations[0] ||
+      get_tile_generation (cache, 1000, 1000) == generations[1])
+    {
+      g_printerr ("test-invalidate-rectangles: the generation of an "
+                  "invalidated tile didn't change\n");
+      result = FAILURE;
+    }
+
+  if (get_tile_generation (cache, 500, 500) != generations[2])
+    {
+      g_printerr ("test-invalidate-rectangles: the generation of a tile "
+                  "between the invalidated rectangles changed\n");
+      result = FAILURE;
+    }
+
+  g_object_unref (gegl);
+  gegl_exit ();
+
+  return result;
+}
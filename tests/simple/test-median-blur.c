@@ -0,0 +1,206 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* checks that gegl:median-blur, which uses a constant-time algorithm for
+ * large square neighborhoods of 8-bit images, matches a brute-force median.
+ */
+
+#include <math.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define WIDTH  300
+#define HEIGHT 200
+
+
+/* the percentile of the neighborhood of each pixel, computed the way the
+ * histograms of gegl:median-blur do: the color components are weighted by
+ * alpha, and the abyss is clamped.
+ */
+static void
+median_blur_reference (const guint8 *src,
+                       guint8       *dst,
+                       gint          n_components,
+                       gint          radius,
+                       gdouble       percentile,
+                       gdouble       alpha_percentile)
+{
+  gboolean has_alpha          = n_components == 4;
+  gint     n_color_components = has_alpha ? 3 : n_components;
+  gint     x, y;
+  gint     c;
+
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      {
+        for (c = 0; c < n_components; c++)
+          {
+            gint bins[256] = {0, };
+            gint count     = 0;
+            gint sum       = 0;
+            gint u, v;
+            gint i;
+
+            for (v = y - radius; v <= y + radius; v++)
+              for (u = x - radius; u <= x + radius; u++)
+                {
+                  const guint8 *pixel = src + (CLAMP (v, 0, HEIGHT - 1) * WIDTH +
+                                               CLAMP (u, 0, WIDTH  - 1)) *
+                                              n_components;
+                  gint          weight = 1;
+
+                  if (has_alpha && c < n_color_components)
+                    weight = pixel[n_color_components];
+
+                  bins[pixel[c]] += weight;
+                  count          += weight;
+                }
+
+            if (count == 0)
+              {
+                dst[(y * WIDTH + x) * n_components + c] = 0;
+                continue;
+              }
+
+            count = ceil (count * (c < n_color_components ? percentile :
+                                                            alpha_percentile));
+            count = MAX (count, 1);
+
+            for (i = 0; (sum += bins[i]) < count; i++);
+
+            dst[(y * WIDTH + x) * n_components + c] = i;
+          }
+      }
+}
+
+static gboolean
+test_median_blur (const gchar *format_name,
+                  gint         radius,
+                  gdouble      percentile,
+                  gdouble      alpha_percentile)
+{
+  const GeglRectangle  rect         = {0, 0, WIDTH, HEIGHT};
+  const Babl          *format       = babl_format (format_name);
+  gint                 n_components = babl_format_get_n_components (format);
+  GeglBuffer          *buffer;
+  GeglNode            *graph;
+  GeglNode            *source;
+  GeglNode            *filter;
+  guint8              *pixels;
+  guint8              *output;
+  guint8              *reference;
+  gint                 n_different  = 0;
+  gint                 x, y;
+  gint                 c;
+  gint                 i;
+
+  /* noise over a few flat regions, with a fully transparent block, so that
+   * both the fine and the coarse levels of the histograms are exercised.
+   */
+  g_random_set_seed (1);
+
+  pixels = g_new (guint8, WIDTH * HEIGHT * n_components);
+
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      {
+        guint8 *pixel = pixels + (y * WIDTH + x) * n_components;
+
+        for (c = 0; c < n_components; c++)
+          {
+            gint base = (x < WIDTH / 2 ? 64 : 160) + (y < HEIGHT / 2 ? 0 : 32);
+
+            pixel[c] = CLAMP (base + g_random_int_range (-48, 48), 0, 255);
+          }
+
+        if (n_components == 4)
+          {
+            if (x >= 40 && x < 80 && y >= 40 && y < 80)
+              pixel[3] = 0;
+            else
+              pixel[3] = g_random_int_range (0, 256);
+          }
+      }
+
+  buffer = gegl_buffer_new (&rect, format);
+
+  gegl_buffer_set (buffer, &rect, 0, format, pixels, GEGL_AUTO_ROWSTRIDE);
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation", "gegl:buffer-source",
+                                "buffer",    buffer,
+                                NULL);
+  filter = gegl_node_new_child (graph,
+                                "operation",        "gegl:median-blur",
+                                "neighborhood",     0, /* square */
+                                "radius",           radius,
+                                "percentile",       percentile,
+                                "alpha-percentile", alpha_percentile,
+                                NULL);
+  gegl_node_link (source, filter);
+
+  output    = g_new (guint8, WIDTH * HEIGHT * n_components);
+  reference = g_new (guint8, WIDTH * HEIGHT * n_components);
+
+  gegl_node_blit (filter, 1.0, &rect, format, output,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  median_blur_reference (pixels, reference, n_components, radius,
+                         percentile / 100.0, alpha_percentile / 100.0);
+
+  for (i = 0; i < WIDTH * HEIGHT * n_components; i++)
+    {
+      if (output[i] != reference[i])
+        n_different++;
+    }
+
+  if (n_different)
+    {
+      g_printerr ("gegl:median-blur differs from the reference for %s, "
+                  "radius %d: %d different components\n",
+                  format_name, radius, n_different);
+    }
+
+  g_object_unref (graph);
+  g_object_unref (buffer);
+  g_free (pixels);
+  g_free (output);
+  g_free (reference);
+
+  return n_different == 0;
+}
+
+int main(int argc, char *argv[])
+{
+  int result = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  if (! test_median_blur ("R'G'B'A u8",  8, 50.0, 50.0) ||
+      ! test_median_blur ("R'G'B'A u8", 12, 30.0, 70.0) ||
+      ! test_median_blur ("R'G'B' u8",   8, 50.0, 50.0) ||
+      ! test_median_blur ("R'G'B' u8",  16, 75.0, 50.0))
+    {
+      result = FAILURE;
+    }
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,241 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* checks that the content-type handlers of the operations are available
+ * when their modules are loaded on demand from the module manifest, so that
+ * gegl:load and gegl:save keep finding the operation for a file extension.
+ *
+ * the test runs itself twice, with a private cache directory: the first run
+ * writes the manifest, the second one reads it.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "gegl.h"
+#include "operation/gegl-operation-handlers.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define WIDTH    64
+#define HEIGHT   48
+
+
+static gboolean
+test_warm_manifest (void)
+{
+  const GeglRectangle  rect    = {0, 0, WIDTH, HEIGHT};
+  const Babl          *format  = babl_format ("R'G'B'A u8");
+  const gchar         *loader  = gegl_operation_handlers_get_loader (".png");
+  const gchar         *saver   = gegl_operation_handlers_get_saver (".png");
+  gchar               *path;
+  GeglBuffer          *buffer;
+  GeglBuffer          *loaded;
+  GeglNode            *graph;
+  GeglNode            *node;
+  GeglNode            *sink;
+  guint8              *pixels;
+  guint8              *output;
+  gboolean             success = TRUE;
+  gint                 i;
+
+  /* the handlers were looked up above, before anything forced the modules
+   * to load.  png support is optional, so there is nothing to check without
+   * it.
+   */
+  if (! gegl_has_operation ("gegl:png-load") ||
+      ! gegl_has_operation ("gegl:png-save"))
+    return TRUE;
+
+  if (g_strcmp0 (loader, "gegl:png-load") ||
+      g_strcmp0 (saver,  "gegl:png-save"))
+    {
+      g_printerr ("wrong handlers for .png with a warm manifest: "
+                  "loader '%s', saver '%s'\n",
+                  loader ? loader : "(null)",
+                  saver  ? saver  : "(null)");
+
+      return FALSE;
+    }
+
+  path = g_build_filename (g_get_user_cache_dir (), "module-manifest.png",
+                           NULL);
+
+  pixels = g_new (guint8, WIDTH * HEIGHT * 4);
+  output = g_new0 (guint8, WIDTH * HEIGHT * 4);
+
+  for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+    pixels[i] = (i * 7) % 256;
+
+  buffer = gegl_buffer_new (&rect, format);
+  gegl_buffer_set (buffer, &rect, 0, format, pixels, GEGL_AUTO_ROWSTRIDE);
+
+  graph = gegl_node_new ();
+  node  = gegl_node_new_child (graph,
+                               "operation", "gegl:buffer-source",
+                               "buffer",    buffer,
+                               NULL);
+  sink  = gegl_node_new_child (graph,
+                               "operation", "gegl:save",
+                               "path",      path,
+                               NULL);
+  gegl_node_link (node, sink);
+  gegl_node_process (sink);
+  g_object_unref (graph);
+
+  loaded = NULL;
+  graph  = gegl_node_new ();
+  node   = gegl_node_new_child (graph,
+                                "operation", "gegl:load",
+                                "path",      path,
+                                NULL);
+  sink   = gegl_node_new_child (graph,
+                                "operation", "gegl:buffer-sink",
+                                "buffer",    &loaded,
+                                NULL);
+  gegl_node_link (node, sink);
+  gegl_node_process (sink);
+  g_object_unref (graph);
+
+  if (! loaded ||
+      gegl_buffer_get_width (loaded)  != WIDTH ||
+      gegl_buffer_get_height (loaded) != HEIGHT)
+    {
+      g_printerr ("gegl:load didn't load '%s' back\n", path);
+
+      success = FALSE;
+    }
+  else
+    {
+      gegl_buffer_get (loaded, &rect, 1.0, format, output,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      if (memcmp (pixels, output, WIDTH * HEIGHT * 4))
+        {
+          g_printerr ("'%s' differs from the saved buffer\n", path);
+
+          success = FALSE;
+        }
+    }
+
+  g_clear_object (&loaded);
+  g_object_unref (buffer);
+  g_unlink (path);
+  g_free (path);
+  g_free (pixels);
+  g_free (output);
+
+  return success;
+}
+
+static gboolean
+run_child (const gchar  *program,
+           const gchar  *mode,
+           gchar       **envp)
+{
+  gchar  *argv[] = {(gchar *) program, (gchar *) mode, NULL};
+  gint    status;
+  GError *error  = NULL;
+
+  if (! g_spawn_sync (NULL, argv, envp, G_SPAWN_DEFAULT,
+                      NULL, NULL, NULL, NULL, &status, &error) ||
+      ! g_spawn_check_exit_status (status, &error))
+    {
+      g_printerr ("the %s run failed: %s\n", mode + 2, error->message);
+
+      g_clear_error (&error);
+
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+remove_directory (const gchar *path)
+{
+  GDir        *dir = g_dir_open (path, 0, NULL);
+  const gchar *name;
+
+  if (dir)
+    {
+      while ((name = g_dir_read_name (dir)))
+        {
+          gchar *child = g_build_filename (path, name, NULL);
+
+          if (g_file_test (child, G_FILE_TEST_IS_DIR))
+            remove_directory (child);
+          else
+            g_unlink (child);
+
+          g_free (child);
+        }
+
+      g_dir_close (dir);
+    }
+
+  g_rmdir (path);
+}
+
+int main(int argc, char *argv[])
+{
+  int     result = SUCCESS;
+  gchar  *dir;
+  gchar **envp;
+
+  if (argc > 1 && ! strcmp (argv[1], "--cold"))
+    {
+      gegl_init (&argc, &argv);
+      gegl_exit ();
+
+      return SUCCESS;
+    }
+  else if (argc > 1 && ! strcmp (argv[1], "--warm"))
+    {
+      gegl_init (&argc, &argv);
+
+      if (! test_warm_manifest ())
+        result = FAILURE;
+
+      gegl_exit ();
+
+      return result;
+    }
+
+  dir = g_dir_make_tmp ("gegl-module-manifest-XXXXXX", NULL);
+
+  if (! dir)
+    {
+      g_printerr ("failed to create a temporary cache directory\n");
+
+      return FAILURE;
+    }
+
+  envp = g_environ_setenv (g_get_environ (), "XDG_CACHE_HOME", dir, TRUE);
+
+  if (! run_child (argv[0], "--cold", envp) ||
+      ! run_child (argv[0], "--warm", envp))
+    {
+      result = FAILURE;
+    }
+
+  remove_directory (dir);
+
+  g_strfreev (envp);
+  g_free (dir);
+
+  return result;
+}
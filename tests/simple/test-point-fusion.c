@@ -0,0 +1,183 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* checks that a chain of point operations, which is processed in a single
+ * fused pass, gives the same result as applying the operations one at a
+ * time.  the chain includes gegl:contrast-curve, which isn't threaded.
+ */
+
+#include <math.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define WIDTH    300
+#define HEIGHT   200
+#define N_OPS    4
+
+#define MAX_DIFF 1e-6
+
+
+static GeglNode *
+new_op (GeglNode  *graph,
+        gint       i,
+        GeglCurve *curve)
+{
+  switch (i)
+    {
+    case 0:
+      return gegl_node_new_child (graph,
+                                  "operation", "gegl:mono-mixer",
+                                  NULL);
+
+    case 1:
+      return gegl_node_new_child (graph,
+                                  "operation", "gegl:exposure",
+                                  "exposure",    0.5,
+                                  "black-level", 0.05,
+                                  NULL);
+
+    case 2:
+      return gegl_node_new_child (graph,
+                                  "operation", "gegl:contrast-curve",
+                                  "curve",     curve,
+                                  NULL);
+
+    case 3:
+      return gegl_node_new_child (graph,
+                                  "operation", "gegl:exposure",
+                                  "exposure",    -0.25,
+                                  "black-level", 0.0,
+                                  NULL);
+    }
+
+  g_return_val_if_reached (NULL);
+}
+
+int main(int argc, char *argv[])
+{
+  int                 result = SUCCESS;
+  const GeglRectangle rect   = {0, 0, WIDTH, HEIGHT};
+  const Babl         *format = babl_format ("YA float");
+  GeglBuffer         *input;
+  GeglBuffer         *buffer;
+  GeglCurve          *curve;
+  GeglNode           *graph;
+  GeglNode           *source;
+  GeglNode           *node;
+  gfloat             *pixels;
+  gfloat             *output;
+  gfloat             *reference;
+  gdouble             diff_max = 0.0;
+  gint                i;
+
+  gegl_init (&argc, &argv);
+
+  g_random_set_seed (1);
+
+  pixels = g_new (gfloat, WIDTH * HEIGHT * 4);
+
+  for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+    pixels[i] = g_random_double ();
+
+  input = gegl_buffer_new (&rect, babl_format ("RGBA float"));
+
+  gegl_buffer_set (input, &rect, 0, babl_format ("RGBA float"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  curve = gegl_curve_new (0.0, 1.0);
+  gegl_curve_add_point (curve, 0.0, 0.1);
+  gegl_curve_add_point (curve, 0.4, 0.6);
+  gegl_curve_add_point (curve, 1.0, 0.9);
+
+  output    = g_new (gfloat, WIDTH * HEIGHT * 2);
+  reference = g_new (gfloat, WIDTH * HEIGHT * 2);
+
+  /* the whole chain in a single graph, which gets fused */
+  graph = gegl_node_new ();
+  node  = gegl_node_new_child (graph,
+                               "operation", "gegl:buffer-source",
+                               "buffer",    input,
+                               NULL);
+
+  for (i = 0; i < N_OPS; i++)
+    {
+      GeglNode *op = new_op (graph, i, curve);
+
+      gegl_node_link (node, op);
+
+      node = op;
+    }
+
+  gegl_node_blit (node, 1.0, &rect, format, output,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (graph);
+
+  /* one operation at a time, storing the intermediate results in buffers of
+   * the operations' own output format.
+   */
+  buffer = g_object_ref (input);
+
+  for (i = 0; i < N_OPS; i++)
+    {
+      GeglBuffer *next = gegl_buffer_new (&rect, format);
+
+      graph  = gegl_node_new ();
+      source = gegl_node_new_child (graph,
+                                    "operation", "gegl:buffer-source",
+                                    "buffer",    buffer,
+                                    NULL);
+      node   = new_op (graph, i, curve);
+
+      gegl_node_link (source, node);
+
+      gegl_node_blit_buffer (node, next, &rect, 0, GEGL_ABYSS_NONE);
+
+      g_object_unref (graph);
+      g_object_unref (buffer);
+
+      buffer = next;
+    }
+
+  gegl_buffer_get (buffer, &rect, 1.0, format, reference,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  g_object_unref (buffer);
+
+  for (i = 0; i < WIDTH * HEIGHT * 2; i++)
+    diff_max = MAX (diff_max, fabs (output[i] - reference[i]));
+
+  if (diff_max > MAX_DIFF)
+    {
+      g_printerr ("the fused point operations differ from the unfused ones: "
+                  "max difference %g\n",
+                  diff_max);
+
+      result = FAILURE;
+    }
+
+  g_object_unref (curve);
+  g_object_unref (input);
+  g_free (pixels);
+  g_free (output);
+  g_free (reference);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,162 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+/* renders a graph through a focused processor, whose chunks are rendered in
+ * parallel, out of order, and makes sure the result matches a plain blit.
+ * the graphs include operations which aren't threaded, whose process() must
+ * not be called concurrently.
+ */
+
+static gboolean
+test_processor_focus (GeglNode            *source,
+                      GeglNode            *sink,
+                      const GeglRectangle *rect,
+                      const GeglRectangle *focus)
+{
+  const Babl    *format = babl_format ("RGBA float");
+  GeglProcessor *processor;
+  GeglBuffer    *buffer = NULL;
+  gfloat        *expected;
+  gfloat        *result;
+  gsize          size;
+  gboolean       success;
+
+  size     = (gsize) rect->width * rect->height * 4 * sizeof (gfloat);
+  expected = g_malloc (size);
+  result   = g_malloc0 (size);
+
+  gegl_node_blit (source, 1.0, rect, format, expected,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  gegl_node_set (sink,
+                 "buffer", &buffer,
+                 NULL);
+
+  processor = g_object_new (GEGL_TYPE_PROCESSOR,
+                            "node",      sink,
+                            "chunksize", 64 * 64,
+                            "rectangle", rect,
+                            NULL);
+
+  gegl_processor_set_focus (processor, focus);
+
+  while (gegl_processor_work (processor, NULL));
+
+  g_object_unref (processor);
+
+  gegl_buffer_get (buffer, rect, 1.0, format, result,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  success = ! memcmp (expected, result, size);
+
+  gegl_node_set (sink,
+                 "buffer", NULL,
+                 NULL);
+
+  g_object_unref (buffer);
+  g_free (expected);
+  g_free (result);
+
+  return success;
+}
+
+int main(int argc, char *argv[])
+{
+  gint           result  = SUCCESS;
+  GeglRectangle  rect    = { 0, 0, 512, 384 };
+  GeglRectangle  focus1  = { 200, 150, 64, 64 };
+  GeglRectangle  focus2  = { -1000, 2000, 10, 10 };
+  GeglNode      *gegl;
+  GeglNode      *checkerboard;
+  GeglNode      *median;
+  GeglNode      *buffer_source;
+  GeglNode      *contrast_curve;
+  GeglNode      *sink;
+  GeglBuffer    *input;
+  GeglCurve     *curve;
+
+  gegl_init (&argc, &argv);
+
+  gegl         = gegl_node_new ();
+  checkerboard = gegl_node_new_child (gegl,
+                                      "operation", "gegl:checkerboard",
+                                      "x", 13,
+                                      "y", 7,
+                                      NULL);
+  median       = gegl_node_new_child (gegl,
+                                      "operation", "gegl:median-blur",
+                                      "radius", 2,
+                                      NULL);
+  sink         = gegl_node_new_child (gegl,
+                                      "operation", "gegl:buffer-sink",
+                                      NULL);
+
+  gegl_node_link_many (checkerboard, median, sink, NULL);
+
+  if (! test_processor_focus (median, sink, &rect, &focus1))
+    {
+      g_printerr ("test-processor-focus: focus inside the rectangle failed\n");
+      result = FAILURE;
+    }
+  else if (! test_processor_focus (median, sink, &rect, &focus2))
+    {
+      g_printerr ("test-processor-focus: focus outside the rectangle failed\n");
+      result = FAILURE;
+    }
+
+  /* an unthreaded source, and an unthreaded point filter */
+  input = gegl_buffer_new (&rect, babl_format ("RGBA float"));
+
+  gegl_node_blit_buffer (checkerboard, input, &rect, 0, GEGL_ABYSS_NONE);
+
+  curve = gegl_curve_new (0.0, 1.0);
+  gegl_curve_add_point (curve, 0.0, 0.2);
+  gegl_curve_add_point (curve, 0.5, 0.7);
+  gegl_curve_add_point (curve, 1.0, 0.9);
+
+  buffer_source  = gegl_node_new_child (gegl,
+                                        "operation", "gegl:buffer-source",
+                                        "buffer", input,
+                                        NULL);
+  contrast_curve = gegl_node_new_child (gegl,
+                                        "operation", "gegl:contrast-curve",
+                                        "curve", curve,
+                                        NULL);
+
+  gegl_node_link_many (buffer_source, contrast_curve, sink, NULL);
+
+  if (result == SUCCESS &&
+      ! test_processor_focus (contrast_curve, sink, &rect, &focus1))
+    {
+      g_printerr ("test-processor-focus: unthreaded operations failed\n");
+      result = FAILURE;
+    }
+
+  g_object_unref (curve);
+  g_object_unref (input);
+
+  g_object_unref (gegl);
+  gegl_exit ();
+
+  return result;
+}